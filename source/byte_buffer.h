@@ -1,9 +1,12 @@
 #pragma once
 
 #include <cstddef>
+#include <cstring>
 #include <memory>
 #include <array>
+#include <vector>
 #include <algorithm>
+#include <stdexcept>
 #include <zlib-ng.h>
 #include <tracy/Tracy.hpp>
 
@@ -26,73 +29,65 @@ namespace vx3d
         [[nodiscard]] inline std::uint64_t _bswapu64(std::uint64_t val) const noexcept;
 
         // This method will decompress the internal buffer
-                void _decompress()
-                {
-                    ZoneScopedN("ByteBuffer::decompress")
-                    auto decompressed_data = std::vector<std::byte>();
-
-                    const std::uint32_t CHUNK = 16384 * 16;
-                    int                 ret;
-                    zng_stream          stream;
-                    stream.zalloc                    = Z_NULL;
-                    stream.zfree                     = Z_NULL;
-                    stream.opaque                    = Z_NULL;
-                    stream.avail_in                  = Z_NULL;
-                    stream.next_in                   = Z_NULL;
-                    std::uint32_t compressed_index   = 0;
-                    std::uint32_t decompressed_index = 0;
-
-                    ret = zng_inflateInit(&stream);
-                    if (ret != Z_OK) throw std::logic_error("Failed to init inflate stream");
-
-                    do {
-                        stream.avail_in = glm::max(std::uint32_t(_size - compressed_index),
-                        CHUNK); if (stream.avail_in == 0) break;
-
-                        stream.next_in = reinterpret_cast<const uint8_t
-                        *>(&_data[compressed_index]);
-
-                        decompressed_data.resize(decompressed_index + stream.avail_in);
-                        do {
-                            stream.avail_out = CHUNK;
-                            stream.next_out  =
-                              reinterpret_cast<uint8_t *>(&decompressed_data[decompressed_index]);
-                            ret              = zng_inflate(&stream, Z_NO_FLUSH);
-                            if (ret == Z_STREAM_ERROR) throw std::logic_error("State Clobbered");
-                            switch (ret)
-                            {
-                            case Z_NEED_DICT:
-                            case Z_DATA_ERROR:
-                            {
-                                zng_inflateEnd(&stream);
-                                throw std::logic_error("Invalid or incomplete deflate data");
-                            }
-                            case Z_MEM_ERROR:
-                            {
-                                zng_inflateEnd(&stream);
-                                throw std::logic_error("Out of memory!");
-                            }
-                            }
-                        } while (stream.avail_out == 0);
-                    } while (ret != Z_STREAM_END);
+        void _decompress()
+        {
+            ZoneScopedN("ByteBuffer::decompress")
+            auto decompressed_data = std::vector<std::byte>();
+
+            const std::uint32_t CHUNK = 16384 * 16;
+            int                 ret;
+            zng_stream          stream;
+            stream.zalloc   = Z_NULL;
+            stream.zfree    = Z_NULL;
+            stream.opaque   = Z_NULL;
+            stream.avail_in = static_cast<std::uint32_t>(_size);
+            stream.next_in  = reinterpret_cast<const uint8_t *>(_data.get());
+            size_t decompressed_index = 0;
+
+            ret = zng_inflateInit(&stream);
+            if (ret != Z_OK) throw std::logic_error("Failed to init inflate stream");
 
+            do {
+                decompressed_data.resize(decompressed_index + CHUNK);
+                stream.avail_out = CHUNK;
+                stream.next_out =
+                  reinterpret_cast<uint8_t *>(&decompressed_data[decompressed_index]);
+
+                ret = zng_inflate(&stream, Z_NO_FLUSH);
+                if (ret == Z_STREAM_ERROR) throw std::logic_error("State Clobbered");
+                switch (ret)
+                {
+                case Z_NEED_DICT:
+                case Z_DATA_ERROR:
+                case Z_BUF_ERROR:    // Ran out of input before the end of the stream
+                {
                     zng_inflateEnd(&stream);
-                    if (ret != Z_STREAM_END) throw std::logic_error("Invalid or incomplete deflate data");
-
-                    _data = std::make_unique<std::byte[]>(decompressed_data.size());
-                    _size = decompressed_data.size();
-                    std::memcpy(_data.get(), decompressed_data.data(), decompressed_data.size());
-                    decompressed_data.clear();
+                    throw std::logic_error("Invalid or incomplete deflate data");
                 }
+                case Z_MEM_ERROR:
+                {
+                    zng_inflateEnd(&stream);
+                    throw std::logic_error("Out of memory!");
+                }
+                }
+
+                decompressed_index += CHUNK - stream.avail_out;
+            } while (ret != Z_STREAM_END);
+
+            zng_inflateEnd(&stream);
+
+            _data = std::make_unique<std::byte[]>(decompressed_index);
+            _size = decompressed_index;
+            std::memcpy(_data.get(), decompressed_data.data(), decompressed_index);
+        }
 
     public:
-        explicit byte_buffer(void *data, size_t size, bool compressed = false)
+        explicit byte_buffer(const void *data, size_t size, bool compressed = false)
             : _compressed(compressed), _cursor(0), _size(size),
               _data(std::make_unique<std::byte[]>(size))
         {
             std::memcpy(_data.get(), data, _size);
-                        if (_compressed)
-                            _decompress();
+            if (_compressed) _decompress();
         }
 
         [[nodiscard]] std::byte *at_and_increment(size_t size)
@@ -105,6 +100,8 @@ namespace vx3d
 
         [[nodiscard]] inline size_t size() const noexcept { return _size; }
 
+        [[nodiscard]] inline const std::byte *data() const noexcept { return _data.get(); }
+
         [[nodiscard]] inline std::uint8_t read_u8()
         {
             return static_cast<std::uint8_t>(_data[_cursor++]);
@@ -0,0 +1,252 @@
+#include "biomes.h"
+
+#include <algorithm>
+
+#include <tracy/Tracy.hpp>
+
+#include <loader/packed_array.h>
+
+namespace
+{
+    struct biome_entry
+    {
+        vx3d::loader::biome_id   id;
+        std::string_view         legacy_name;    // Name before the 1.18 renames, if it changed
+        vx3d::loader::biome_info info;
+    };
+
+    // clang-format off
+    constexpr biome_entry biome_table[] = {
+      { 0, "", { "ocean", 0.5f, 0.5f } },
+      { 1, "", { "plains", 0.8f, 0.4f } },
+      { 2, "", { "desert", 2.0f, 0.0f } },
+      { 3, "mountains", { "windswept_hills", 0.2f, 0.3f } },
+      { 4, "", { "forest", 0.7f, 0.8f } },
+      { 5, "", { "taiga", 0.25f, 0.8f } },
+      { 6, "", { "swamp", 0.8f, 0.9f, 0x617B64 } },
+      { 7, "", { "river", 0.5f, 0.5f } },
+      { 8, "nether", { "nether_wastes", 2.0f, 0.0f } },
+      { 9, "", { "the_end", 0.5f, 0.5f } },
+      { 10, "", { "frozen_ocean", 0.0f, 0.5f, 0x3938C9 } },
+      { 11, "", { "frozen_river", 0.0f, 0.5f, 0x3938C9 } },
+      { 12, "snowy_tundra", { "snowy_plains", 0.0f, 0.5f } },
+      { 13, "", { "snowy_mountains", 0.0f, 0.5f } },
+      { 14, "", { "mushroom_fields", 0.9f, 1.0f } },
+      { 15, "", { "mushroom_field_shore", 0.9f, 1.0f } },
+      { 16, "", { "beach", 0.8f, 0.4f } },
+      { 17, "", { "desert_hills", 2.0f, 0.0f } },
+      { 18, "", { "wooded_hills", 0.7f, 0.8f } },
+      { 19, "", { "taiga_hills", 0.25f, 0.8f } },
+      { 20, "", { "mountain_edge", 0.2f, 0.3f } },
+      { 21, "", { "jungle", 0.95f, 0.9f } },
+      { 22, "", { "jungle_hills", 0.95f, 0.9f } },
+      { 23, "jungle_edge", { "sparse_jungle", 0.95f, 0.8f } },
+      { 24, "", { "deep_ocean", 0.5f, 0.5f } },
+      { 25, "stone_shore", { "stony_shore", 0.2f, 0.3f } },
+      { 26, "", { "snowy_beach", 0.05f, 0.3f } },
+      { 27, "", { "birch_forest", 0.6f, 0.6f } },
+      { 28, "", { "birch_forest_hills", 0.6f, 0.6f } },
+      { 29, "", { "dark_forest", 0.7f, 0.8f } },
+      { 30, "", { "snowy_taiga", -0.5f, 0.4f } },
+      { 31, "", { "snowy_taiga_hills", -0.5f, 0.4f } },
+      { 32, "giant_tree_taiga", { "old_growth_pine_taiga", 0.3f, 0.8f } },
+      { 33, "", { "giant_tree_taiga_hills", 0.3f, 0.8f } },
+      { 34, "wooded_mountains", { "windswept_forest", 0.2f, 0.3f } },
+      { 35, "", { "savanna", 2.0f, 0.0f } },
+      { 36, "", { "savanna_plateau", 2.0f, 0.0f } },
+      { 37, "", { "badlands", 2.0f, 0.0f } },
+      { 38, "wooded_badlands_plateau", { "wooded_badlands", 2.0f, 0.0f } },
+      { 39, "", { "badlands_plateau", 2.0f, 0.0f } },
+      { 40, "", { "small_end_islands", 0.5f, 0.5f } },
+      { 41, "", { "end_midlands", 0.5f, 0.5f } },
+      { 42, "", { "end_highlands", 0.5f, 0.5f } },
+      { 43, "", { "end_barrens", 0.5f, 0.5f } },
+      { 44, "", { "warm_ocean", 0.5f, 0.5f, 0x43D5EE } },
+      { 45, "", { "lukewarm_ocean", 0.5f, 0.5f, 0x45ADF2 } },
+      { 46, "", { "cold_ocean", 0.5f, 0.5f, 0x3D57D6 } },
+      { 47, "", { "deep_warm_ocean", 0.5f, 0.5f, 0x43D5EE } },
+      { 48, "", { "deep_lukewarm_ocean", 0.5f, 0.5f, 0x45ADF2 } },
+      { 49, "", { "deep_cold_ocean", 0.5f, 0.5f, 0x3D57D6 } },
+      { 50, "", { "deep_frozen_ocean", 0.5f, 0.5f, 0x3938C9 } },
+      { 127, "", { "the_void", 0.5f, 0.5f } },
+      { 129, "", { "sunflower_plains", 0.8f, 0.4f } },
+      { 130, "", { "desert_lakes", 2.0f, 0.0f } },
+      { 131, "gravelly_mountains", { "windswept_gravelly_hills", 0.2f, 0.3f } },
+      { 132, "", { "flower_forest", 0.7f, 0.8f } },
+      { 133, "", { "taiga_mountains", 0.25f, 0.8f } },
+      { 134, "", { "swamp_hills", 0.8f, 0.9f, 0x617B64 } },
+      { 140, "", { "ice_spikes", 0.0f, 0.5f } },
+      { 149, "", { "modified_jungle", 0.95f, 0.9f } },
+      { 151, "", { "modified_jungle_edge", 0.95f, 0.8f } },
+      { 155, "tall_birch_forest", { "old_growth_birch_forest", 0.6f, 0.6f } },
+      { 156, "", { "tall_birch_hills", 0.6f, 0.6f } },
+      { 157, "", { "dark_forest_hills", 0.7f, 0.8f } },
+      { 158, "", { "snowy_taiga_mountains", -0.5f, 0.4f } },
+      { 160, "giant_spruce_taiga", { "old_growth_spruce_taiga", 0.25f, 0.8f } },
+      { 161, "", { "giant_spruce_taiga_hills", 0.25f, 0.8f } },
+      { 162, "", { "modified_gravelly_mountains", 0.2f, 0.3f } },
+      { 163, "shattered_savanna", { "windswept_savanna", 2.0f, 0.0f } },
+      { 164, "", { "shattered_savanna_plateau", 2.0f, 0.0f } },
+      { 165, "", { "eroded_badlands", 2.0f, 0.0f } },
+      { 166, "", { "modified_wooded_badlands_plateau", 2.0f, 0.0f } },
+      { 167, "", { "modified_badlands_plateau", 2.0f, 0.0f } },
+      { 168, "", { "bamboo_jungle", 0.95f, 0.9f } },
+      { 169, "", { "bamboo_jungle_hills", 0.95f, 0.9f } },
+      { 170, "", { "soul_sand_valley", 2.0f, 0.0f } },
+      { 171, "", { "crimson_forest", 2.0f, 0.0f } },
+      { 172, "", { "warped_forest", 2.0f, 0.0f } },
+      { 173, "", { "basalt_deltas", 2.0f, 0.0f } },
+      { 174, "", { "dripstone_caves", 0.8f, 0.4f } },
+      { 175, "", { "lush_caves", 0.5f, 0.5f } },
+      { 176, "", { "meadow", 0.5f, 0.8f, 0x0E4ECF } },
+      { 177, "", { "grove", -0.2f, 0.8f } },
+      { 178, "", { "snowy_slopes", -0.3f, 0.9f } },
+      { 179, "", { "jagged_peaks", -0.7f, 0.9f } },
+      { 180, "", { "frozen_peaks", -0.7f, 0.9f } },
+      { 181, "", { "stony_peaks", 1.0f, 0.3f } },
+      { 182, "", { "deep_dark", 0.8f, 0.4f } },
+      { 183, "", { "mangrove_swamp", 0.8f, 0.9f, 0x3A7A6A } },
+      { 184, "", { "cherry_grove", 0.5f, 0.8f, 0x5DB7EF } },
+      { 185, "", { "pale_garden", 0.7f, 0.8f, 0x76889D } },
+    };
+    // clang-format on
+
+    [[nodiscard]] const std::array<const vx3d::loader::biome_info *, 256> &info_table()
+    {
+        static const auto table = []
+        {
+            auto built = std::array<const vx3d::loader::biome_info *, 256>();
+            built.fill(&biome_table[1].info);
+            for (const auto &entry : biome_table) built[entry.id] = &entry.info;
+            return built;
+        }();
+        return table;
+    }
+}    // namespace
+
+vx3d::loader::biome_id vx3d::loader::biomes::from_name(std::string_view name)
+{
+    if (const auto separator = name.find(':'); separator != std::string_view::npos)
+        name.remove_prefix(separator + 1);
+
+    for (const auto &entry : biome_table)
+        if (entry.info.name == name || entry.legacy_name == name) return entry.id;
+
+    return unknown;
+}
+
+vx3d::loader::biome_id vx3d::loader::biomes::from_legacy(std::int32_t id)
+{
+    return id >= 0 && id < 255 ? static_cast<biome_id>(id) : unknown;
+}
+
+const vx3d::loader::biome_info &vx3d::loader::biomes::info(biome_id id)
+{
+    return *::info_table()[id];
+}
+
+vx3d::loader::biome_id
+  vx3d::loader::biome_grid::at(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept
+{
+    if (cells.empty()) return biomes::unknown;
+
+    const auto width = 16 >> cell_shift;
+    const auto layer = std::clamp((y - min_y) >> cell_shift, 0, layers - 1);
+    return cells[(layer * width + (z >> cell_shift)) * width + (x >> cell_shift)];
+}
+
+void vx3d::loader::biome_grid::layer(std::int32_t y, std::array<biome_id, 256> &out) const noexcept
+{
+    for (auto z = 0; z < 16; z++)
+        for (auto x = 0; x < 16; x++) out[z * 16 + x] = at(x, y, z);
+}
+
+void vx3d::loader::biome_grid::surface(
+  const std::array<std::int16_t, 256> &heights,
+  std::array<biome_id, 256> &          out) const noexcept
+{
+    for (auto z = 0; z < 16; z++)
+        for (auto x = 0; x < 16; x++) out[z * 16 + x] = at(x, heights[z * 16 + x], z);
+}
+
+vx3d::loader::biome_grid vx3d::loader::decode_biomes(const vx3d::nbt::node &biomes)
+{
+    ZoneScopedN("Loader::decode_biomes");
+    auto grid = biome_grid();
+
+    const auto type = biomes.type();
+    if (type != nbt::TagType::BYTE_ARRAY && type != nbt::TagType::INT_ARRAY) return grid;
+
+    const auto size = biomes.array_size();
+    const auto read = [&](std::int32_t i)
+    {
+        return type == nbt::TagType::BYTE_ARRAY
+          ? static_cast<std::int32_t>(static_cast<std::uint8_t>(biomes.array_data()[i]))
+          : biomes.int_at(i);
+    };
+
+    if (size == 256)
+    {
+        // Pre-1.15, one biome per column
+        grid.cell_shift = 0;
+        grid.layers     = 1;
+    }
+    else if (size > 0 && size % 16 == 0)
+    {
+        // 1.15 to 1.17, 4x4x4 cells stacked upwards from y = 0
+        grid.cell_shift = 2;
+        grid.layers     = size / 16;
+    }
+    else
+        return grid;
+
+    grid.cells.resize(size);
+    for (auto i = 0; i < size; i++) grid.cells[i] = biomes::from_legacy(read(i));
+
+    return grid;
+}
+
+vx3d::loader::biome_grid
+  vx3d::loader::make_section_biomes(std::int32_t min_section, std::int32_t sections)
+{
+    auto grid       = biome_grid();
+    grid.min_y      = min_section * 16;
+    grid.cell_shift = 2;
+    grid.layers     = sections * 4;
+    grid.cells.assign(static_cast<size_t>(grid.layers) * 16, biomes::plains);
+    return grid;
+}
+
+void vx3d::loader::decode_section_biomes(
+  const vx3d::nbt::node &container,
+  std::int32_t           section_y,
+  biome_grid &           grid)
+{
+    const auto first_layer = (section_y * 16 - grid.min_y) >> 2;
+    if (first_layer < 0 || first_layer + 4 > grid.layers) return;
+
+    const auto *palette = container.get_node("palette");
+    if (!palette) return;
+
+    auto palette_ids = std::vector<biome_id>();
+    for (auto entry = palette->first_child(); entry; entry = entry->next_sibling())
+        palette_ids.push_back(biomes::from_name(entry->as_string()));
+    if (palette_ids.empty()) return;
+
+    auto *out = &grid.cells[static_cast<size_t>(first_layer) * 16];
+
+    const auto *data = container.get_node("data");
+    if (palette_ids.size() == 1 || !data)
+    {
+        std::fill(out, out + 64, palette_ids[0]);
+        return;
+    }
+
+    // Cells are ordered y, z, x within the section, matching the grid layout
+    auto indices = std::array<std::uint16_t, 64>();
+    const auto bits = palette_bits(static_cast<std::uint32_t>(palette_ids.size()), 1);
+    unpack_indices(*data, bits, 64, false, indices.data());
+
+    for (auto i = 0; i < 64; i++)
+        out[i] = indices[i] < palette_ids.size() ? palette_ids[indices[i]] : biomes::unknown;
+}
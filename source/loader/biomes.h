@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <nbt/nbt.h>
+
+namespace vx3d::loader
+{
+    // Biomes use the pre-1.18 numeric ids, biomes added afterwards are given free ids above 175
+    using biome_id = std::uint8_t;
+
+    struct biome_info
+    {
+        std::string_view name;
+        float            temperature = 0.5f;
+        float            downfall    = 0.5f;
+        std::uint32_t    water       = 0x3F76E4;    // 0xRRGGBB
+    };
+
+    namespace biomes
+    {
+        constexpr biome_id ocean   = 0;
+        constexpr biome_id plains  = 1;
+        constexpr biome_id unknown = 255;
+
+        /// Resolves both modern ("minecraft:windswept_hills") and legacy ("mountains") names
+        [[nodiscard]] biome_id from_name(std::string_view name);
+
+        [[nodiscard]] biome_id from_legacy(std::int32_t id);
+
+        /// Climate of a biome, unknown ids get plains
+        [[nodiscard]] const biome_info &info(biome_id id);
+    }    // namespace biomes
+
+    // Biomes of one chunk. Pre-1.15 chunks store one biome per column, afterwards it's one biome
+    // per 4x4x4 cell, both are kept at their native resolution.
+    struct biome_grid
+    {
+        std::int32_t          min_y      = 0;    // Block y of the lowest layer
+        std::uint8_t          cell_shift = 2;    // log2 of the cell width, 0 for per column biomes
+        std::int32_t          layers     = 0;    // Vertical cells, 1 for per column biomes
+        std::vector<biome_id> cells;
+
+        [[nodiscard]] bool empty() const noexcept { return cells.empty(); }
+
+        [[nodiscard]] biome_id at(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept;
+
+        /// Expands the biomes at a single height into one entry per column (z * 16 + x)
+        void layer(std::int32_t y, std::array<biome_id, 256> &out) const noexcept;
+
+        /// Like `layer` but every column is sampled at its own height
+        void surface(const std::array<std::int16_t, 256> &heights, std::array<biome_id, 256> &out)
+          const noexcept;
+    };
+
+    /// Decodes the pre-1.18 `Biomes` tag, either the 16x16 byte/int column array or the 1.15+
+    /// array of 4x4x4 cells
+    [[nodiscard]] biome_grid decode_biomes(const vx3d::nbt::node &biomes);
+
+    /// Creates an empty grid able to hold the 1.18+ per section containers of `sections` sections
+    [[nodiscard]] biome_grid make_section_biomes(std::int32_t min_section, std::int32_t sections);
+
+    /// Decodes a 1.18+ section `biomes` container into the matching layers of `grid`
+    void decode_section_biomes(
+      const vx3d::nbt::node &container,
+      std::int32_t           section_y,
+      biome_grid &           grid);
+}    // namespace vx3d::loader
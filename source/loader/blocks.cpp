@@ -0,0 +1,510 @@
+#include "blocks.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include <tsl/robin_map.h>
+#include <tracy/Tracy.hpp>
+
+namespace
+{
+    constexpr auto legacy_unresolved = std::numeric_limits<vx3d::loader::block_id>::max();
+
+    constexpr auto colors = std::array<std::string_view, 16>({
+      "white",
+      "orange",
+      "magenta",
+      "light_blue",
+      "yellow",
+      "lime",
+      "pink",
+      "gray",
+      "light_gray",
+      "cyan",
+      "purple",
+      "blue",
+      "brown",
+      "green",
+      "red",
+      "black",
+    });
+
+    constexpr auto woods =
+      std::array<std::string_view, 6>({ "oak", "spruce", "birch", "jungle", "acacia", "dark_oak" });
+
+    // Pre-flattening block ids, variants that only differ by data value are resolved separately
+    constexpr auto legacy_names = std::array<std::string_view, 256>({
+      "air",
+      "stone",
+      "grass_block",
+      "dirt",
+      "cobblestone",
+      "oak_planks",
+      "oak_sapling",
+      "bedrock",
+      "water",
+      "water",
+      "lava",
+      "lava",
+      "sand",
+      "gravel",
+      "gold_ore",
+      "iron_ore",
+      "coal_ore",
+      "oak_log",
+      "oak_leaves",
+      "sponge",
+      "glass",
+      "lapis_ore",
+      "lapis_block",
+      "dispenser",
+      "sandstone",
+      "note_block",
+      "red_bed",
+      "powered_rail",
+      "detector_rail",
+      "sticky_piston",
+      "cobweb",
+      "grass",
+      "dead_bush",
+      "piston",
+      "piston_head",
+      "white_wool",
+      "moving_piston",
+      "dandelion",
+      "poppy",
+      "brown_mushroom",
+      "red_mushroom",
+      "gold_block",
+      "iron_block",
+      "smooth_stone",
+      "smooth_stone_slab",
+      "bricks",
+      "tnt",
+      "bookshelf",
+      "mossy_cobblestone",
+      "obsidian",
+      "torch",
+      "fire",
+      "spawner",
+      "oak_stairs",
+      "chest",
+      "redstone_wire",
+      "diamond_ore",
+      "diamond_block",
+      "crafting_table",
+      "wheat",
+      "farmland",
+      "furnace",
+      "furnace",
+      "oak_sign",
+      "oak_door",
+      "ladder",
+      "rail",
+      "cobblestone_stairs",
+      "oak_wall_sign",
+      "lever",
+      "stone_pressure_plate",
+      "iron_door",
+      "oak_pressure_plate",
+      "redstone_ore",
+      "redstone_ore",
+      "redstone_torch",
+      "redstone_torch",
+      "stone_button",
+      "snow",
+      "ice",
+      "snow_block",
+      "cactus",
+      "clay",
+      "sugar_cane",
+      "jukebox",
+      "oak_fence",
+      "carved_pumpkin",
+      "netherrack",
+      "soul_sand",
+      "glowstone",
+      "nether_portal",
+      "jack_o_lantern",
+      "cake",
+      "repeater",
+      "repeater",
+      "white_stained_glass",
+      "oak_trapdoor",
+      "infested_stone",
+      "stone_bricks",
+      "brown_mushroom_block",
+      "red_mushroom_block",
+      "iron_bars",
+      "glass_pane",
+      "melon",
+      "pumpkin_stem",
+      "melon_stem",
+      "vine",
+      "oak_fence_gate",
+      "brick_stairs",
+      "stone_brick_stairs",
+      "mycelium",
+      "lily_pad",
+      "nether_bricks",
+      "nether_brick_fence",
+      "nether_brick_stairs",
+      "nether_wart",
+      "enchanting_table",
+      "brewing_stand",
+      "cauldron",
+      "end_portal",
+      "end_portal_frame",
+      "end_stone",
+      "dragon_egg",
+      "redstone_lamp",
+      "redstone_lamp",
+      "oak_planks",
+      "oak_slab",
+      "cocoa",
+      "sandstone_stairs",
+      "emerald_ore",
+      "ender_chest",
+      "tripwire_hook",
+      "tripwire",
+      "emerald_block",
+      "spruce_stairs",
+      "birch_stairs",
+      "jungle_stairs",
+      "command_block",
+      "beacon",
+      "cobblestone_wall",
+      "flower_pot",
+      "carrots",
+      "potatoes",
+      "oak_button",
+      "skeleton_skull",
+      "anvil",
+      "trapped_chest",
+      "light_weighted_pressure_plate",
+      "heavy_weighted_pressure_plate",
+      "comparator",
+      "comparator",
+      "daylight_detector",
+      "redstone_block",
+      "nether_quartz_ore",
+      "hopper",
+      "quartz_block",
+      "quartz_stairs",
+      "activator_rail",
+      "dropper",
+      "white_terracotta",
+      "white_stained_glass_pane",
+      "acacia_leaves",
+      "acacia_log",
+      "acacia_stairs",
+      "dark_oak_stairs",
+      "slime_block",
+      "barrier",
+      "iron_trapdoor",
+      "prismarine",
+      "sea_lantern",
+      "hay_block",
+      "white_carpet",
+      "terracotta",
+      "coal_block",
+      "packed_ice",
+      "sunflower",
+      "white_banner",
+      "white_wall_banner",
+      "daylight_detector",
+      "red_sandstone",
+      "red_sandstone_stairs",
+      "red_sandstone",
+      "red_sandstone_slab",
+      "spruce_fence_gate",
+      "birch_fence_gate",
+      "jungle_fence_gate",
+      "dark_oak_fence_gate",
+      "acacia_fence_gate",
+      "spruce_fence",
+      "birch_fence",
+      "jungle_fence",
+      "dark_oak_fence",
+      "acacia_fence",
+      "spruce_door",
+      "birch_door",
+      "jungle_door",
+      "acacia_door",
+      "dark_oak_door",
+      "end_rod",
+      "chorus_plant",
+      "chorus_flower",
+      "purpur_block",
+      "purpur_pillar",
+      "purpur_stairs",
+      "purpur_block",
+      "purpur_slab",
+      "end_stone_bricks",
+      "beetroots",
+      "dirt_path",
+      "end_gateway",
+      "repeating_command_block",
+      "chain_command_block",
+      "frosted_ice",
+      "magma_block",
+      "nether_wart_block",
+      "red_nether_bricks",
+      "bone_block",
+      "structure_void",
+      "observer",
+      "white_shulker_box",
+      "orange_shulker_box",
+      "magenta_shulker_box",
+      "light_blue_shulker_box",
+      "yellow_shulker_box",
+      "lime_shulker_box",
+      "pink_shulker_box",
+      "gray_shulker_box",
+      "light_gray_shulker_box",
+      "cyan_shulker_box",
+      "purple_shulker_box",
+      "blue_shulker_box",
+      "brown_shulker_box",
+      "green_shulker_box",
+      "red_shulker_box",
+      "black_shulker_box",
+      "white_glazed_terracotta",
+      "orange_glazed_terracotta",
+      "magenta_glazed_terracotta",
+      "light_blue_glazed_terracotta",
+      "yellow_glazed_terracotta",
+      "lime_glazed_terracotta",
+      "pink_glazed_terracotta",
+      "gray_glazed_terracotta",
+      "light_gray_glazed_terracotta",
+      "cyan_glazed_terracotta",
+      "purple_glazed_terracotta",
+      "blue_glazed_terracotta",
+      "brown_glazed_terracotta",
+      "green_glazed_terracotta",
+      "red_glazed_terracotta",
+      "black_glazed_terracotta",
+      "white_concrete",
+      "white_concrete_powder",
+      "air",
+      "air",
+      "structure_block",
+    });
+
+    struct registry_state
+    {
+        registry_state()
+        {
+            blocks.reserve(vx3d::loader::block_registry::max_blocks);
+            for (auto &entry : legacy) entry.store(legacy_unresolved, std::memory_order_relaxed);
+        }
+
+        std::shared_mutex                            mutex;
+        std::vector<vx3d::loader::block_info>        blocks;
+        tsl::robin_map<std::string, vx3d::loader::block_id> ids;
+
+        // (id << 4 | data) -> block, filled on first use
+        std::array<std::atomic<vx3d::loader::block_id>, 4096 * 16> legacy;
+    };
+
+    [[nodiscard]] bool is_any_of(std::string_view name, std::initializer_list<std::string_view> names)
+    {
+        return std::find(names.begin(), names.end(), name) != names.end();
+    }
+
+    [[nodiscard]] bool
+      contains_any_of(std::string_view name, std::initializer_list<std::string_view> parts)
+    {
+        return std::any_of(
+          parts.begin(),
+          parts.end(),
+          [name](auto part) { return name.find(part) != std::string_view::npos; });
+    }
+
+    [[nodiscard]] vx3d::loader::block_info classify(std::string name)
+    {
+        using namespace vx3d::loader;
+
+        const auto separator = name.find(':');
+        const auto path      = std::string_view(name).substr(separator + 1);
+
+        auto info = block_info();
+        if (is_any_of(path, { "air", "cave_air", "void_air", "structure_void", "barrier", "light" }))
+            info.flags |= block_flag_air;
+        if (is_any_of(path, { "water", "bubble_column" })) info.flags |= block_flag_water;
+        if (is_any_of(path, { "kelp", "kelp_plant", "seagrass", "tall_seagrass" }))
+            info.flags |= block_flag_aquatic;
+        if (path == "lava") info.flags |= block_flag_lava;
+
+        if (contains_any_of(path, { "_sapling", "_tulip", "torch", "rail", "_button", "_pressure_plate",
+                                    "sign", "_banner", "carpet", "_roots", "_petals" }) ||
+            is_any_of(path, { "grass", "short_grass", "tall_grass", "fern", "large_fern", "dead_bush",
+                              "dandelion", "poppy", "blue_orchid", "allium", "azure_bluet",
+                              "oxeye_daisy", "cornflower", "lily_of_the_valley", "wither_rose",
+                              "sunflower", "lilac", "rose_bush", "peony", "brown_mushroom",
+                              "red_mushroom", "redstone_wire", "snow", "vine", "lever", "tripwire",
+                              "tripwire_hook", "sugar_cane", "wheat", "carrots", "potatoes",
+                              "beetroots", "nether_wart", "sweet_berry_bush", "nether_sprouts",
+                              "glow_lichen", "cobweb", "ladder", "fire", "soul_fire",
+                              "pumpkin_stem", "melon_stem", "attached_pumpkin_stem",
+                              "attached_melon_stem" }))
+            info.flags |= block_flag_passable;
+        else if (contains_any_of(path, { "leaves", "glass", "_slab", "_stairs", "fence", "_wall",
+                                         "_pane", "iron_bars", "door", "chest", "_bed", "cactus",
+                                         "barrier", "farmland", "dirt_path", "magma_block" }))
+            info.flags |= block_flag_no_spawn;
+
+        if (is_any_of(
+              path,
+              { "grass_block", "grass", "short_grass", "tall_grass", "fern", "large_fern", "sugar_cane" }))
+            info.tint = tint_type::grass;
+        else if (is_any_of(
+                   path,
+                   { "oak_leaves",
+                     "jungle_leaves",
+                     "acacia_leaves",
+                     "dark_oak_leaves",
+                     "mangrove_leaves",
+                     "vine" }))
+            info.tint = tint_type::foliage;
+        else if (info.flags & block_flag_water)
+            info.tint = tint_type::water;
+
+        info.name = std::move(name);
+        return info;
+    }
+
+    // Callers must hold the registry lock exclusively
+    vx3d::loader::block_id insert(registry_state &registry, std::string key)
+    {
+        const auto id = static_cast<vx3d::loader::block_id>(registry.blocks.size());
+        registry.blocks.push_back(::classify(key));
+        registry.ids.insert({ std::move(key), id });
+        return id;
+    }
+
+    [[nodiscard]] registry_state &state()
+    {
+        // Leaked on purpose, ids may be looked up by worker threads during shutdown
+        static auto *instance = []
+        {
+            auto *created = new registry_state();
+            ::insert(*created, "minecraft:air");
+            ::insert(*created, "vx3d:unknown");
+            return created;
+        }();
+        return *instance;
+    }
+
+    [[nodiscard]] std::string legacy_name(std::uint16_t id, std::uint8_t data)
+    {
+        const auto variant = [](auto prefix, auto suffix) { return std::string(prefix) + suffix; };
+
+        switch (id)
+        {
+        case 1:
+        {
+            constexpr auto stones = std::array<std::string_view, 7>(
+              { "stone", "granite", "polished_granite", "diorite", "polished_diorite", "andesite", "polished_andesite" });
+            return std::string(stones[data < stones.size() ? data : 0]);
+        }
+        case 3:
+        {
+            constexpr auto dirts = std::array<std::string_view, 3>({ "dirt", "coarse_dirt", "podzol" });
+            return std::string(dirts[data < dirts.size() ? data : 0]);
+        }
+        case 5: return variant(woods[data < woods.size() ? data : 0], "_planks");
+        case 6: return variant(woods[(data & 7) < woods.size() ? data & 7 : 0], "_sapling");
+        case 12: return data == 1 ? "red_sand" : "sand";
+        case 17: return variant(woods[data & 3], "_log");
+        case 18: return variant(woods[data & 3], "_leaves");
+        case 31:
+        {
+            constexpr auto plants = std::array<std::string_view, 3>({ "dead_bush", "grass", "fern" });
+            return std::string(plants[data < plants.size() ? data : 1]);
+        }
+        case 35: return variant(colors[data], "_wool");
+        case 38:
+        {
+            constexpr auto flowers = std::array<std::string_view, 9>({ "poppy",
+                                                                       "blue_orchid",
+                                                                       "allium",
+                                                                       "azure_bluet",
+                                                                       "red_tulip",
+                                                                       "orange_tulip",
+                                                                       "white_tulip",
+                                                                       "pink_tulip",
+                                                                       "oxeye_daisy" });
+            return std::string(flowers[data < flowers.size() ? data : 0]);
+        }
+        case 95: return variant(colors[data], "_stained_glass");
+        case 126: return variant(woods[(data & 7) < woods.size() ? data & 7 : 0], "_slab");
+        case 159: return variant(colors[data], "_terracotta");
+        case 160: return variant(colors[data], "_stained_glass_pane");
+        case 161: return variant(woods[4 + (data & 1)], "_leaves");
+        case 162: return variant(woods[4 + (data & 1)], "_log");
+        case 171: return variant(colors[data], "_carpet");
+        case 175:
+        {
+            constexpr auto plants = std::array<std::string_view, 6>(
+              { "sunflower", "lilac", "tall_grass", "large_fern", "rose_bush", "peony" });
+            return std::string(plants[(data & 7) < plants.size() ? data & 7 : 0]);
+        }
+        case 251: return variant(colors[data], "_concrete");
+        case 252: return variant(colors[data], "_concrete_powder");
+        default: return std::string(id < legacy_names.size() ? legacy_names[id] : "vx3d:unknown");
+        }
+    }
+}    // namespace
+
+vx3d::loader::block_id vx3d::loader::block_registry::intern(std::string_view name)
+{
+    auto key = name.find(':') == std::string_view::npos ? "minecraft:" + std::string(name)
+                                                        : std::string(name);
+
+    auto &registry = state();
+    {
+        auto guard = std::shared_lock(registry.mutex);
+        if (const auto at = registry.ids.find(key); at != registry.ids.end()) return at->second;
+    }
+
+    ZoneScopedN("BlockRegistry::intern");
+    auto guard = std::unique_lock(registry.mutex);
+    if (const auto at = registry.ids.find(key); at != registry.ids.end()) return at->second;
+    if (registry.blocks.size() == max_blocks) return unknown;
+
+    return ::insert(registry, std::move(key));
+}
+
+vx3d::loader::block_id vx3d::loader::block_registry::legacy(std::uint16_t id, std::uint8_t data)
+{
+    auto &slot = state().legacy[(id & 0xFFF) << 4 | (data & 0xF)];
+
+    auto resolved = slot.load(std::memory_order_acquire);
+    if (resolved == legacy_unresolved)
+    {
+        resolved = intern(::legacy_name(id, data & 0xF));
+        slot.store(resolved, std::memory_order_release);
+    }
+    return resolved;
+}
+
+const vx3d::loader::block_info &vx3d::loader::block_registry::info(block_id id)
+{
+    // The storage is reserved up front and never reallocates, so once an id has been handed out
+    // its entry can be read without taking the lock
+    return state().blocks[id];
+}
+
+std::size_t vx3d::loader::block_registry::size()
+{
+    auto &registry = state();
+    auto  guard    = std::shared_lock(registry.mutex);
+    return registry.blocks.size();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace vx3d::loader
+{
+    // Index into the block registry, shared by every chunk format
+    using block_id = std::uint16_t;
+
+    enum class tint_type : std::uint8_t
+    {
+        none,
+        grass,
+        foliage,
+        water
+    };
+
+    enum block_flags : std::uint8_t
+    {
+        block_flag_air      = 1 << 0,    // Nothing visible, air variants and invisible blocks
+        block_flag_water    = 1 << 1,
+        block_flag_aquatic  = 1 << 2,    // Always submerged, seagrass and kelp
+        block_flag_lava     = 1 << 3,
+        block_flag_passable = 1 << 4,    // Plants, torches, rails and other things without collision
+        block_flag_no_spawn = 1 << 5,    // Solid, but not a full block mobs can spawn on
+    };
+
+    struct block_info
+    {
+        std::string  name;
+        tint_type    tint  = tint_type::none;
+        std::uint8_t flags = 0;
+
+        [[nodiscard]] bool is_air() const noexcept { return flags & block_flag_air; }
+
+        // Water, or something that's always covered by it
+        [[nodiscard]] bool is_water() const noexcept
+        {
+            return flags & (block_flag_water | block_flag_aquatic);
+        }
+
+        [[nodiscard]] bool is_passable() const noexcept
+        {
+            return flags & (block_flag_air | block_flag_passable);
+        }
+
+        [[nodiscard]] bool can_spawn_on() const noexcept
+        {
+            return !(flags &
+                     (block_flag_air | block_flag_passable | block_flag_no_spawn | block_flag_water |
+                      block_flag_aquatic | block_flag_lava));
+        }
+    };
+
+    // Interns namespaced block names into small ids. Ids are never freed and stay stable for the
+    // lifetime of the process, so anything decoded can be compared and cached by id.
+    class block_registry
+    {
+    public:
+        static constexpr block_id air     = 0;
+        static constexpr block_id unknown = 1;    // Used once the registry is full
+
+        static constexpr std::size_t max_blocks = 16384;
+
+        /// Finds or creates the id for a block name, "stone" and "minecraft:stone" are the same block
+        [[nodiscard]] static block_id intern(std::string_view name);
+
+        /// Maps a pre-1.13 numeric id and data value to the flattened block
+        [[nodiscard]] static block_id legacy(std::uint16_t id, std::uint8_t data);
+
+        /// Looking up an id that was handed out is lock free
+        [[nodiscard]] static const block_info &info(block_id id);
+
+        [[nodiscard]] static std::size_t size();
+    };
+}    // namespace vx3d::loader
@@ -0,0 +1,395 @@
+#include "chunk.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <tracy/Tracy.hpp>
+
+#include <nbt/selective.h>
+#include <loader/packed_array.h>
+
+namespace
+{
+    [[nodiscard]] std::int64_t
+      integer_or(const vx3d::nbt::node *parent, std::string_view name, std::int64_t fallback)
+    {
+        const auto *found = parent ? parent->get_node(name) : nullptr;
+        return found ? found->as_integer() : fallback;
+    }
+
+    // Returns false when the section turned out to be nothing but air
+    [[nodiscard]] bool decode_palette_section(
+      const vx3d::nbt::node &        palette,
+      const vx3d::nbt::node *        data,
+      bool                           spanning,
+      vx3d::loader::chunk_section &out)
+    {
+        using namespace vx3d::loader;
+
+        auto ids   = std::vector<block_id>();
+        auto solid = false;
+        for (auto entry = palette.first_child(); entry; entry = entry->next_sibling())
+        {
+            const auto *name = entry->get_node("Name");
+            const auto  id   = name ? block_registry::intern(name->as_string()) : block_registry::air;
+            ids.push_back(id);
+            solid |= !block_registry::info(id).is_air();
+        }
+
+        if (!solid) return false;
+
+        if (ids.size() == 1 || !data)
+        {
+            out.blocks.fill(ids[0]);
+            return true;
+        }
+
+        const auto bits = palette_bits(static_cast<std::uint32_t>(ids.size()), 4);
+        unpack_indices(*data, bits, 4096, spanning, out.blocks.data());
+
+        for (auto &block : out.blocks) block = block < ids.size() ? ids[block] : block_registry::air;
+
+        return true;
+    }
+
+    [[nodiscard]] bool
+      decode_legacy_section(const vx3d::nbt::node &section, vx3d::loader::chunk_section &out)
+    {
+        using namespace vx3d::loader;
+
+        const auto *blocks = section.get_node("Blocks");
+        if (!blocks || blocks->array_size() < 4096) return false;
+
+        const auto *add  = section.get_node("Add");
+        const auto *data = section.get_node("Data");
+
+        const auto *block_bytes = reinterpret_cast<const std::uint8_t *>(blocks->array_data());
+        const auto *add_bytes =
+          add && add->array_size() >= 2048 ? reinterpret_cast<const std::uint8_t *>(add->array_data())
+                                           : nullptr;
+        const auto *data_bytes = data && data->array_size() >= 2048
+          ? reinterpret_cast<const std::uint8_t *>(data->array_data())
+          : nullptr;
+
+        auto solid = false;
+        for (auto i = 0; i < 4096; i++)
+        {
+            // Nibble arrays pack the even index into the low half of each byte
+            const auto shift = (i & 1) * 4;
+            const auto high  = add_bytes ? (add_bytes[i >> 1] >> shift) & 0xF : 0;
+            const auto value = data_bytes ? (data_bytes[i >> 1] >> shift) & 0xF : 0;
+            const auto id    = static_cast<std::uint16_t>(block_bytes[i] | high << 8);
+
+            out.blocks[i] = id == 0 ? block_registry::air
+                                    : block_registry::legacy(id, static_cast<std::uint8_t>(value));
+            solid |= id != 0;
+        }
+
+        return solid;
+    }
+
+    void decode_section_light(
+      const vx3d::nbt::node &section,
+      std::int32_t           y,
+      vx3d::loader::chunk &  decoded)
+    {
+        const auto *block = section.get_node("BlockLight");
+        const auto *sky   = section.get_node("SkyLight");
+
+        const auto valid = [](const vx3d::nbt::node *array)
+        { return array && array->type() == vx3d::nbt::TagType::BYTE_ARRAY && array->array_size() == 2048; };
+        if (!valid(block) && !valid(sky)) return;
+
+        // Kept packed, the nibbles are only expanded a layer at a time when shading
+        auto &out = decoded.light.emplace_back();
+        out.y     = static_cast<std::int8_t>(y);
+        if (valid(block)) std::memcpy(out.block.data(), block->array_data(), 2048);
+        if (valid(sky))
+        {
+            std::memcpy(out.sky.data(), sky->array_data(), 2048);
+            out.has_sky = true;
+        }
+    }
+
+    void decode_section(const vx3d::nbt::node &section, std::uint32_t flags, vx3d::loader::chunk &decoded)
+    {
+        using namespace vx3d::loader;
+
+        const auto y        = static_cast<std::int32_t>(::integer_or(&section, "Y", 0));
+        const auto spanning = decoded.data_version < data_version_no_spanning;
+
+        if (flags & decode_flag_biomes)
+            if (const auto *biomes = section.get_node("biomes"))
+                decode_section_biomes(*biomes, y, decoded.biomes);
+
+        if (flags & decode_flag_light) ::decode_section_light(section, y, decoded);
+
+        if (!(flags & decode_flag_blocks)) return;
+
+        auto &out = decoded.sections.emplace_back();
+        out.y     = static_cast<std::int8_t>(y);
+
+        auto solid = false;
+        if (const auto *states = section.get_node("block_states"))
+        {
+            if (const auto *palette = states->get_node("palette"))
+                solid = ::decode_palette_section(*palette, states->get_node("data"), false, out);
+        }
+        else if (const auto *palette = section.get_node("Palette"))
+            solid = ::decode_palette_section(*palette, section.get_node("BlockStates"), spanning, out);
+        else
+            solid = ::decode_legacy_section(section, out);
+
+        if (!solid) decoded.sections.pop_back();
+    }
+
+    void sort_sections(vx3d::loader::chunk &decoded)
+    {
+        std::sort(
+          decoded.sections.begin(),
+          decoded.sections.end(),
+          [](const auto &a, const auto &b) { return a.y < b.y; });
+        std::sort(
+          decoded.light.begin(),
+          decoded.light.end(),
+          [](const auto &a, const auto &b) { return a.y < b.y; });
+    }
+
+    // A single tag cut out of a larger document, parsed on its own
+    struct parsed_tag
+    {
+        vx3d::nbt::node::byte_buffer buffer;
+        vx3d::nbt::node::node_list   nodes;
+
+        [[nodiscard]] const vx3d::nbt::node &root() const { return *nodes.root(); }
+    };
+
+    [[nodiscard]] parsed_tag
+      parse_tag(vx3d::nbt::TagType type, const std::byte *payload, const std::byte *end)
+    {
+        // Gets the type and empty name the parser expects in front of the payload
+        auto bytes = std::vector<std::byte>(3 + static_cast<std::size_t>(end - payload));
+        bytes[0]   = static_cast<std::byte>(type);
+        std::memcpy(bytes.data() + 3, payload, static_cast<std::size_t>(end - payload));
+
+        auto buffer = vx3d::nbt::node::byte_buffer(bytes.data(), bytes.size());
+        auto nodes  = vx3d::nbt::node::read(buffer);
+        return parsed_tag { std::move(buffer), std::move(nodes) };
+    }
+}    // namespace
+
+const vx3d::loader::chunk_section *vx3d::loader::chunk::section(std::int32_t section_y) const noexcept
+{
+    for (const auto &section : sections)
+        if (section.y == section_y) return &section;
+    return nullptr;
+}
+
+vx3d::loader::block_id
+  vx3d::loader::chunk::block_at(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept
+{
+    const auto *found = section(y >> 4);
+    return found ? found->at(x, y & 15, z) : block_registry::air;
+}
+
+std::int32_t vx3d::loader::chunk::highest_block(
+  std::int32_t x,
+  std::int32_t z,
+  std::int32_t below,
+  std::uint8_t skip_flags) const noexcept
+{
+    for (auto section = sections.rbegin(); section != sections.rend(); section++)
+    {
+        const auto base = section->y * 16;
+        if (base >= below) continue;
+
+        const auto top = std::min(15, below - 1 - base);
+        for (auto y = top; y >= 0; y--)
+            if (!(block_registry::info(section->at(x, y, z)).flags & skip_flags)) return base + y;
+    }
+
+    return no_block;
+}
+
+const vx3d::loader::section_light *
+  vx3d::loader::chunk::light_section(std::int32_t section_y) const noexcept
+{
+    for (const auto &section : light)
+        if (section.y == section_y) return &section;
+    return nullptr;
+}
+
+std::uint8_t
+  vx3d::loader::chunk::block_light_at(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept
+{
+    const auto *found = light_section(y >> 4);
+    return found ? found->block_at(x, y & 15, z) : 0;
+}
+
+std::uint8_t
+  vx3d::loader::chunk::sky_light_at(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept
+{
+    if (const auto *found = light_section(y >> 4)) return found->sky_at(x, y & 15, z);
+    return light.empty() || (y >> 4) > light.back().y ? 15 : 0;
+}
+
+std::size_t vx3d::loader::chunk::memory_size() const noexcept
+{
+    return sizeof(chunk) + sections.capacity() * sizeof(chunk_section) +
+      light.capacity() * sizeof(section_light) + biomes.cells.capacity();
+}
+
+vx3d::loader::chunk vx3d::loader::decode_chunk(const vx3d::nbt::node &root, std::uint32_t flags)
+{
+    ZoneScopedN("Loader::decode_chunk");
+    auto decoded    = chunk();
+    decoded.decoded = flags;
+
+    // Everything moved from the `Level` compound up to the root in 1.18
+    const auto *level = root.get_node("Level");
+    if (!level) level = &root;
+
+    decoded.data_version = static_cast<std::int32_t>(::integer_or(&root, "DataVersion", 0));
+    decoded.x            = static_cast<std::int32_t>(::integer_or(level, "xPos", 0));
+    decoded.z            = static_cast<std::int32_t>(::integer_or(level, "zPos", 0));
+
+    const auto *sections = level->get_node("sections");
+    if (!sections) sections = level->get_node("Sections");
+
+    if ((flags & decode_flag_biomes) && level != &root)
+        if (const auto *biomes = level->get_node("Biomes")) decoded.biomes = decode_biomes(*biomes);
+
+    if (!sections) return decoded;
+
+    auto min_section = std::numeric_limits<std::int32_t>::max();
+    auto max_section = std::numeric_limits<std::int32_t>::min();
+    for (auto section = sections->first_child(); section; section = section->next_sibling())
+    {
+        if (!section->get_node("biomes")) continue;
+        const auto y = static_cast<std::int32_t>(::integer_or(section, "Y", 0));
+        min_section  = std::min(min_section, y);
+        max_section  = std::max(max_section, y);
+    }
+
+    if ((flags & decode_flag_biomes) && min_section <= max_section)
+        decoded.biomes = make_section_biomes(min_section, max_section - min_section + 1);
+
+    for (auto section = sections->first_child(); section; section = section->next_sibling())
+        ::decode_section(*section, flags, decoded);
+
+    ::sort_sections(decoded);
+    return decoded;
+}
+
+vx3d::loader::chunk vx3d::loader::decode_chunk_range(
+  const std::byte *data,
+  std::size_t      size,
+  std::int32_t     min_y,
+  std::int32_t     max_y,
+  std::uint32_t    flags)
+{
+    ZoneScopedN("Loader::decode_chunk_range");
+    using vx3d::nbt::TagType;
+
+    auto decoded    = chunk();
+    decoded.decoded = flags;
+
+    const auto min_section = min_y >> 4;
+    const auto max_section = max_y >> 4;
+
+    // Only a section's `Y` is looked at while scanning, the ones in range are parsed afterwards
+    // since `DataVersion` may well come after them
+    struct section_bytes
+    {
+        std::int32_t     y;
+        const std::byte *begin;
+        const std::byte *end;
+        bool             has_biomes;
+    };
+    auto in_range      = std::vector<section_bytes>();
+    auto legacy_biomes = std::pair<const std::byte *, const std::byte *>();
+    auto legacy_type   = TagType::END;
+
+    // Lowest and highest section with a 1.18+ biome container
+    auto biome_sections = std::pair(
+      std::numeric_limits<std::int32_t>::max(),
+      std::numeric_limits<std::int32_t>::min());
+
+    auto scanner = vx3d::nbt::scanner(data, size);
+    if (scanner.root().type != TagType::COMPOUND) return decoded;
+
+    const auto scan_level = [&](auto &self, bool is_root) -> void
+    {
+        for (auto tag = scanner.next(); tag.type != TagType::END; tag = scanner.next())
+        {
+            if (is_root && tag.type == TagType::COMPOUND && tag.name == "Level")
+                self(self, false);
+            else if (is_root && tag.name == "DataVersion" && tag.type == TagType::INT)
+                decoded.data_version = static_cast<std::int32_t>(scanner.read_integer(tag.type));
+            else if ((tag.name == "xPos" || tag.name == "zPos") && tag.type == TagType::INT)
+                (tag.name == "xPos" ? decoded.x : decoded.z) =
+                  static_cast<std::int32_t>(scanner.read_integer(tag.type));
+            else if (!is_root && tag.name == "Biomes" && (flags & decode_flag_biomes))
+            {
+                legacy_type         = tag.type;
+                legacy_biomes.first = scanner.position();
+                scanner.skip(tag.type);
+                legacy_biomes.second = scanner.position();
+            }
+            else if (tag.type == TagType::LIST && (tag.name == "sections" || tag.name == "Sections"))
+            {
+                const auto [type, count] = scanner.read_list();
+                for (auto i = 0; i < count; i++)
+                {
+                    if (type != TagType::COMPOUND)
+                    {
+                        scanner.skip(type);
+                        continue;
+                    }
+
+                    auto section = section_bytes { 0, scanner.position(), nullptr, false };
+                    for (auto child = scanner.next(); child.type != TagType::END; child = scanner.next())
+                    {
+                        if (child.name == "Y" && child.type == TagType::BYTE)
+                            section.y = static_cast<std::int32_t>(scanner.read_integer(child.type));
+                        else
+                        {
+                            section.has_biomes |= child.name == "biomes";
+                            scanner.skip(child.type);
+                        }
+                    }
+                    section.end = scanner.position();
+
+                    if (section.has_biomes)
+                    {
+                        biome_sections.first  = std::min(biome_sections.first, section.y);
+                        biome_sections.second = std::max(biome_sections.second, section.y);
+                    }
+                    if (section.y >= min_section && section.y <= max_section) in_range.push_back(section);
+                }
+            }
+            else
+                scanner.skip(tag.type);
+        }
+    };
+    scan_level(scan_level, true);
+
+    if (legacy_biomes.first)
+    {
+        const auto document = ::parse_tag(legacy_type, legacy_biomes.first, legacy_biomes.second);
+        decoded.biomes      = decode_biomes(document.root());
+    }
+    else if ((flags & decode_flag_biomes) && biome_sections.first <= biome_sections.second)
+        decoded.biomes =
+          make_section_biomes(biome_sections.first, biome_sections.second - biome_sections.first + 1);
+
+    for (const auto &section : in_range)
+    {
+        const auto document = ::parse_tag(TagType::COMPOUND, section.begin, section.end);
+        ::decode_section(document.root(), flags, decoded);
+    }
+
+    ::sort_sections(decoded);
+    return decoded;
+}
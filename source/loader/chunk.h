@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <nbt/nbt.h>
+#include <loader/blocks.h>
+#include <loader/biomes.h>
+#include <loader/light.h>
+
+namespace vx3d::loader
+{
+    /// Packs the coordinates of a chunk or a region into one key, x in the upper half
+    [[nodiscard]] constexpr std::uint64_t position_key(std::int32_t x, std::int32_t z) noexcept
+    {
+        return static_cast<std::uint64_t>(x) << 32 | (static_cast<std::uint64_t>(z) & 0xFFFFFFFF);
+    }
+
+    enum decode_flags : std::uint32_t
+    {
+        decode_flag_blocks = 1 << 0,
+        decode_flag_biomes = 1 << 1,
+        decode_flag_all    = decode_flag_blocks | decode_flag_biomes,
+
+        // Not part of `decode_flag_all`, light is only decoded while a lighting view needs it
+        decode_flag_light = 1 << 2,
+    };
+
+    struct chunk_section
+    {
+        std::int8_t y = 0;
+
+        // Indexed (y << 8) | (z << 4) | x, the same order the game stores them in
+        std::array<block_id, 4096> blocks {};
+
+        [[nodiscard]] block_id at(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept
+        {
+            return blocks[(y << 8) | (z << 4) | x];
+        }
+    };
+
+    struct chunk
+    {
+        std::int32_t  x            = 0;
+        std::int32_t  z            = 0;
+        std::int32_t  data_version = 0;
+        std::uint32_t decoded      = 0;    // The decode flags this chunk was read with
+
+        // Only sections holding something other than air, sorted bottom to top
+        std::vector<chunk_section> sections;
+        biome_grid                 biomes;
+
+        // Sorted bottom to top, empty unless decoded with `decode_flag_light`
+        std::vector<section_light> light;
+
+        static constexpr std::int32_t no_block = std::numeric_limits<std::int32_t>::min();
+
+        [[nodiscard]] const chunk_section *section(std::int32_t section_y) const noexcept;
+
+        [[nodiscard]] block_id block_at(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept;
+
+        /// Height of the highest block in a column that has none of `skip_flags`
+        /// \param below Only blocks strictly below this height are considered
+        /// \return `no_block` if the column has nothing but skipped blocks
+        [[nodiscard]] std::int32_t highest_block(
+          std::int32_t x,
+          std::int32_t z,
+          std::int32_t below      = std::numeric_limits<std::int32_t>::max(),
+          std::uint8_t skip_flags = block_flag_air) const noexcept;
+
+        [[nodiscard]] const section_light *light_section(std::int32_t section_y) const noexcept;
+
+        [[nodiscard]] std::uint8_t
+          block_light_at(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept;
+
+        /// Sky light, anything above the stored light sections is open sky
+        [[nodiscard]] std::uint8_t
+          sky_light_at(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept;
+
+        /// Approximate heap footprint, used to budget caches
+        [[nodiscard]] std::size_t memory_size() const noexcept;
+    };
+
+    // DataVersion of 20w17a, block states stopped spanning across longs
+    constexpr std::int32_t data_version_no_spanning = 2529;
+
+    /// Decodes a chunk from its root NBT compound, supporting the pre-1.13 numeric format, the
+    /// 1.13-1.17 `Level` palettes and the 1.18+ root level sections
+    /// \param root The root compound of the chunk
+    /// \param flags Which parts of the chunk to decode
+    [[nodiscard]] chunk
+      decode_chunk(const vx3d::nbt::node &root, std::uint32_t flags = decode_flag_all);
+
+    /// Decodes only the sections overlapping a range of heights straight from serialized chunk
+    /// NBT, every other section is skipped over without being parsed
+    /// \param data Decompressed chunk NBT
+    /// \param min_y Lowest block height of interest
+    /// \param max_y Highest block height of interest
+    [[nodiscard]] chunk decode_chunk_range(
+      const std::byte *data,
+      std::size_t      size,
+      std::int32_t     min_y,
+      std::int32_t     max_y,
+      std::uint32_t    flags = decode_flag_all);
+}    // namespace vx3d::loader
@@ -0,0 +1,67 @@
+#include "chunk_cache.h"
+
+vx3d::loader::chunk_cache::chunk_cache(std::size_t budget_bytes) : _budget_bytes(budget_bytes)
+{
+}
+
+std::shared_ptr<const vx3d::loader::chunk>
+  vx3d::loader::chunk_cache::find(std::int32_t x, std::int32_t z, std::uint32_t flags)
+{
+    ZoneScopedN("ChunkCache::find");
+    auto guard = std::lock_guard(_mutex);
+
+    const auto at = _lookup.find(position_key(x, z));
+    if (at == _lookup.end()) return nullptr;
+
+    const auto entry = at->second;
+    if ((entry->decoded->decoded & flags) != flags) return nullptr;
+
+    _entries.splice(_entries.begin(), _entries, entry);
+    return entry->decoded;
+}
+
+std::uint32_t vx3d::loader::chunk_cache::decoded_flags(std::int32_t x, std::int32_t z)
+{
+    auto guard = std::lock_guard(_mutex);
+
+    const auto at = _lookup.find(position_key(x, z));
+    return at == _lookup.end() ? 0 : at->second->decoded->decoded;
+}
+
+void vx3d::loader::chunk_cache::insert(std::shared_ptr<const chunk> decoded)
+{
+    ZoneScopedN("ChunkCache::insert");
+    auto guard = std::lock_guard(_mutex);
+
+    const auto key = position_key(decoded->x, decoded->z);
+    if (const auto at = _lookup.find(key); at != _lookup.end()) _erase(at->second);
+
+    const auto size = decoded->memory_size();
+    _entries.push_front({ key, std::move(decoded), size });
+    _lookup.insert({ key, _entries.begin() });
+    _size_bytes += size;
+
+    // Never evict the chunk that was just inserted, even if it alone is over budget
+    while (_size_bytes > _budget_bytes && _entries.size() > 1) _erase(std::prev(_entries.end()));
+}
+
+void vx3d::loader::chunk_cache::erase(std::int32_t x, std::int32_t z)
+{
+    auto guard = std::lock_guard(_mutex);
+    if (const auto at = _lookup.find(position_key(x, z)); at != _lookup.end()) _erase(at->second);
+}
+
+void vx3d::loader::chunk_cache::clear()
+{
+    auto guard = std::lock_guard(_mutex);
+    _entries.clear();
+    _lookup.clear();
+    _size_bytes = 0;
+}
+
+void vx3d::loader::chunk_cache::_erase(std::list<entry>::iterator at)
+{
+    _size_bytes -= at->size;
+    _lookup.erase(at->key);
+    _entries.erase(at);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+
+#include <tsl/robin_map.h>
+#include <tracy/Tracy.hpp>
+
+#include <loader/chunk.h>
+
+namespace vx3d::loader
+{
+    // Least recently used cache of decoded chunks, bounded by their memory footprint
+    class chunk_cache
+    {
+    public:
+        explicit chunk_cache(std::size_t budget_bytes);
+
+        /// \return The cached chunk if it was decoded with at least `flags`, otherwise nullptr
+        [[nodiscard]] std::shared_ptr<const chunk>
+          find(std::int32_t x, std::int32_t z, std::uint32_t flags = 0);
+
+        /// Flags the cached copy was decoded with, 0 if there is none
+        [[nodiscard]] std::uint32_t decoded_flags(std::int32_t x, std::int32_t z);
+
+        /// Inserts or replaces a chunk, evicting the least recently used ones past the budget
+        void insert(std::shared_ptr<const chunk> decoded);
+
+        void erase(std::int32_t x, std::int32_t z);
+
+        void clear();
+
+        [[nodiscard]] std::size_t size_bytes() const noexcept { return _size_bytes; }
+
+    private:
+        struct entry
+        {
+            std::uint64_t                key;
+            std::shared_ptr<const chunk> decoded;
+            std::size_t                  size;
+        };
+
+        void _erase(std::list<entry>::iterator at);
+
+        std::mutex _mutex;
+
+        std::size_t _budget_bytes;
+        std::size_t _size_bytes = 0;
+
+        // Front is the most recently used
+        std::list<entry>                                          _entries;
+        tsl::robin_map<std::uint64_t, std::list<entry>::iterator> _lookup;
+    };
+}    // namespace vx3d::loader
@@ -0,0 +1,629 @@
+#include "entity_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include <daw/daw_memory_mapped_file.h>
+#include <tracy/Tracy.hpp>
+
+#include <nbt/selective.h>
+#include <loader/minecraft_loader.h>
+#include <util/cache_path.h>
+
+namespace
+{
+    using vx3d::nbt::TagType;
+
+    constexpr auto index_magic   = std::uint32_t(0x49455856);    // "VXEI"
+    constexpr auto index_version = std::uint32_t(1);
+
+    // Regions are 512 blocks across
+    constexpr auto region_shift = 9;
+
+    // Stacks of riders deeper than this are not worth following
+    constexpr auto max_passenger_depth = 16;
+
+    [[nodiscard]] std::uint64_t spread_bits(std::uint32_t value) noexcept
+    {
+        auto spread = static_cast<std::uint64_t>(value);
+        spread      = (spread | spread << 16) & 0x0000FFFF0000FFFF;
+        spread      = (spread | spread << 8) & 0x00FF00FF00FF00FF;
+        spread      = (spread | spread << 4) & 0x0F0F0F0F0F0F0F0F;
+        spread      = (spread | spread << 2) & 0x3333333333333333;
+        spread      = (spread | spread << 1) & 0x5555555555555555;
+        return spread;
+    }
+
+    [[nodiscard]] bool is_integer(TagType type) noexcept
+    {
+        return type == TagType::BYTE || type == TagType::SHORT || type == TagType::INT ||
+          type == TagType::LONG;
+    }
+
+    void skip_elements(vx3d::nbt::scanner &scanner, TagType type, std::int32_t count)
+    {
+        for (auto i = 0; i < count; i++) scanner.skip(type);
+    }
+
+    // Elements of a `block_entities` or `TileEntities` list
+    void scan_block_entities(
+      vx3d::nbt::scanner &                        scanner,
+      std::int32_t                                count,
+      std::vector<vx3d::loader::scanned_entity> &found)
+    {
+        for (auto i = 0; i < count; i++)
+        {
+            auto entity = vx3d::loader::scanned_entity();
+            for (auto tag = scanner.next(); tag.type != TagType::END; tag = scanner.next())
+            {
+                if (tag.type == TagType::STRING && tag.name == "id")
+                    entity.id = scanner.read_string();
+                else if (::is_integer(tag.type) && tag.name == "x")
+                    entity.position.x = static_cast<std::int32_t>(scanner.read_integer(tag.type));
+                else if (::is_integer(tag.type) && tag.name == "y")
+                    entity.position.y = static_cast<std::int32_t>(scanner.read_integer(tag.type));
+                else if (::is_integer(tag.type) && tag.name == "z")
+                    entity.position.z = static_cast<std::int32_t>(scanner.read_integer(tag.type));
+                else
+                    scanner.skip(tag.type);
+            }
+
+            if (!entity.id.empty()) found.push_back(entity);
+        }
+    }
+
+    // Elements of an `Entities` or `Passengers` list
+    void scan_entities(
+      vx3d::nbt::scanner &                        scanner,
+      std::int32_t                                count,
+      std::vector<vx3d::loader::scanned_entity> &found,
+      std::int32_t                                depth)
+    {
+        for (auto i = 0; i < count; i++)
+        {
+            auto entity       = vx3d::loader::scanned_entity();
+            auto has_position = false;
+            for (auto tag = scanner.next(); tag.type != TagType::END; tag = scanner.next())
+            {
+                if (tag.type == TagType::STRING && tag.name == "id")
+                    entity.id = scanner.read_string();
+                else if (tag.type == TagType::LIST && tag.name == "Pos")
+                {
+                    const auto [type, elements] = scanner.read_list();
+                    auto coordinates            = std::array<double, 3>();
+                    for (auto j = 0; j < elements; j++)
+                    {
+                        const auto value = scanner.read_number(type);
+                        if (j < 3) coordinates[j] = value;
+                    }
+
+                    has_position      = elements >= 3;
+                    entity.position.x = static_cast<std::int32_t>(std::floor(coordinates[0]));
+                    entity.position.y = static_cast<std::int32_t>(std::floor(coordinates[1]));
+                    entity.position.z = static_cast<std::int32_t>(std::floor(coordinates[2]));
+                }
+                else if (tag.type == TagType::LIST && tag.name == "Passengers")
+                {
+                    const auto [type, elements] = scanner.read_list();
+                    if (type == TagType::COMPOUND && depth < max_passenger_depth)
+                        ::scan_entities(scanner, elements, found, depth + 1);
+                    else
+                        ::skip_elements(scanner, type, elements);
+                }
+                else
+                    scanner.skip(tag.type);
+            }
+
+            if (!entity.id.empty() && has_position) found.push_back(entity);
+        }
+    }
+
+    // The chunk root, or the `Level` compound it held before 1.18
+    void scan_chunk_compound(
+      vx3d::nbt::scanner &                        scanner,
+      std::vector<vx3d::loader::scanned_entity> &found,
+      bool                                        is_root)
+    {
+        for (auto tag = scanner.next(); tag.type != TagType::END; tag = scanner.next())
+        {
+            if (is_root && tag.type == TagType::COMPOUND && tag.name == "Level")
+                ::scan_chunk_compound(scanner, found, false);
+            else if (
+              tag.type == TagType::LIST && (tag.name == "block_entities" || tag.name == "TileEntities"))
+            {
+                const auto [type, count] = scanner.read_list();
+                if (type == TagType::COMPOUND)
+                    ::scan_block_entities(scanner, count, found);
+                else
+                    ::skip_elements(scanner, type, count);
+            }
+            else if (tag.type == TagType::LIST && tag.name == "Entities")
+            {
+                const auto [type, count] = scanner.read_list();
+                if (type == TagType::COMPOUND)
+                    ::scan_entities(scanner, count, found, 0);
+                else
+                    ::skip_elements(scanner, type, count);
+            }
+            else
+                scanner.skip(tag.type);
+        }
+    }
+
+    [[nodiscard]] bool parse_region_name(const std::filesystem::path &path, std::int32_t &x, std::int32_t &z)
+    {
+        if (path.extension() != ".mca") return false;
+        const auto stem = path.stem().string();
+        return std::sscanf(stem.c_str(), "r.%d.%d", &x, &z) == 2;
+    }
+
+    [[nodiscard]] std::filesystem::path
+      region_path(const std::filesystem::path &folder, std::int32_t x, std::int32_t z)
+    {
+        return folder / ("r." + std::to_string(x) + "." + std::to_string(z) + ".mca");
+    }
+
+    template<typename T>
+    void write_value(std::ofstream &out, const T &value)
+    {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    [[nodiscard]] bool read_value(std::ifstream &in, T &value)
+    {
+        return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+    }
+}    // namespace
+
+std::uint64_t vx3d::loader::morton_code(std::int32_t x, std::int32_t z) noexcept
+{
+    // Flipping the sign bit keeps negative coordinates ordered below positive ones
+    const auto biased_x = static_cast<std::uint32_t>(x) ^ 0x80000000u;
+    const auto biased_z = static_cast<std::uint32_t>(z) ^ 0x80000000u;
+    return ::spread_bits(biased_x) | ::spread_bits(biased_z) << 1;
+}
+
+void vx3d::loader::scan_chunk_entities(
+  const std::byte *            data,
+  std::size_t                  size,
+  std::vector<scanned_entity> &found)
+{
+    ZoneScopedN("Loader::scan_chunk_entities");
+    auto scanner = vx3d::nbt::scanner(data, size);
+    if (scanner.root().type != TagType::COMPOUND) return;
+    ::scan_chunk_compound(scanner, found, true);
+}
+
+vx3d::loader::entity_index::~entity_index()
+{
+    _cancel = true;
+    if (_worker.joinable()) _worker.join();
+}
+
+void vx3d::loader::entity_index::build(const std::filesystem::path &world_folder)
+{
+    clear();
+    _worker = std::thread(&entity_index::_index, this, world_folder);
+}
+
+void vx3d::loader::entity_index::clear()
+{
+    _cancel = true;
+    if (_worker.joinable()) _worker.join();
+    _cancel  = false;
+    _ready   = false;
+    _indexed = 0;
+    _regions = 0;
+
+    {
+        auto guard = std::lock_guard(_names_mutex);
+        _names.clear();
+        _name_lookup.clear();
+    }
+
+    auto guard = std::lock_guard(_snapshot_mutex);
+    _snapshot.reset();
+}
+
+float vx3d::loader::entity_index::progress() const noexcept
+{
+    const auto total = _regions.load();
+    if (total == 0) return _ready ? 1.0f : 0.0f;
+    return static_cast<float>(_indexed.load()) / static_cast<float>(total);
+}
+
+std::vector<std::string> vx3d::loader::entity_index::types() const
+{
+    auto names = std::vector<std::string>();
+    if (const auto current = _current())
+        for (const auto &bucket : current->buckets) names.push_back(bucket.name);
+
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+std::size_t vx3d::loader::entity_index::count(std::string_view type) const
+{
+    const auto current = _current();
+    if (!current) return 0;
+
+    const auto at = current->lookup.find(std::string(type));
+    return at == current->lookup.end() ? 0 : current->buckets[at->second].positions.size();
+}
+
+std::vector<vx3d::loader::entity_position>
+  vx3d::loader::entity_index::query(std::string_view type, glm::ivec3 min, glm::ivec3 max) const
+{
+    ZoneScopedN("EntityIndex::query");
+    auto found = std::vector<entity_position>();
+
+    const auto current = _current();
+    if (!current) return found;
+
+    const auto at = current->lookup.find(std::string(type));
+    if (at == current->lookup.end()) return found;
+    const auto &bucket = current->buckets[at->second];
+
+    const auto low  = glm::ivec3(std::min(min.x, max.x), std::min(min.y, max.y), std::min(min.z, max.z));
+    const auto high = glm::ivec3(std::max(min.x, max.x), std::max(min.y, max.y), std::max(min.z, max.z));
+
+    const auto inside = [&](const entity_position &position)
+    {
+        return position.x >= low.x && position.x <= high.x && position.y >= low.y &&
+          position.y <= high.y && position.z >= low.z && position.z <= high.z;
+    };
+
+    for (const auto &region : bucket.regions)
+    {
+        const auto region_min_x = region.x * (1 << region_shift);
+        const auto region_min_z = region.z * (1 << region_shift);
+        const auto region_max_x = region_min_x + (1 << region_shift) - 1;
+        const auto region_max_z = region_min_z + (1 << region_shift) - 1;
+
+        if (region_max_x < low.x || region_min_x > high.x || region_max_z < low.z ||
+            region_min_z > high.z || region.max_y < low.y || region.min_y > high.y)
+            continue;
+
+        const auto first = bucket.positions.begin() + region.begin;
+        const auto last  = bucket.positions.begin() + region.end;
+
+        // Whole regions inside the box don't need looking at one by one
+        if (region_min_x >= low.x && region_max_x <= high.x && region_min_z >= low.z &&
+            region_max_z <= high.z && region.min_y >= low.y && region.max_y <= high.y)
+            found.insert(found.end(), first, last);
+        else
+            std::copy_if(first, last, std::back_inserter(found), inside);
+    }
+
+    return found;
+}
+
+void vx3d::loader::entity_index::_index(std::filesystem::path world_folder)
+{
+    ZoneScopedN("EntityIndex::index");
+
+    const auto cache_file = vx3d::cache::world_file(world_folder, "entities.bin");
+
+    auto cached = std::vector<region_records>();
+    if (!cache_file.empty() && !_load(cache_file, cached)) cached.clear();
+
+    auto cached_lookup = tsl::robin_map<std::uint64_t, std::size_t>();
+    for (auto i = std::size_t(0); i < cached.size(); i++)
+        cached_lookup[morton_code(cached[i].x, cached[i].z)] = i;
+
+    // Chunks and, from 1.17 on, their entities live in separate region files
+    auto stamps = tsl::robin_map<std::uint64_t, region_records>();
+    for (const auto *directory : { "region", "entities" })
+    {
+        auto error = std::error_code();
+        for (const auto &file : std::filesystem::directory_iterator(world_folder / directory, error))
+        {
+            auto x = std::int32_t(0);
+            auto z = std::int32_t(0);
+            if (!::parse_region_name(file.path(), x, z)) continue;
+
+            auto &region = stamps[morton_code(x, z)];
+            region.x     = x;
+            region.z     = z;
+
+            const auto size = file.file_size(error);
+            const auto time = file.last_write_time(error).time_since_epoch().count();
+            if (directory == std::string_view("region"))
+            {
+                region.stamp.region_size = size;
+                region.stamp.region_time = time;
+            }
+            else
+            {
+                region.stamp.entities_size = size;
+                region.stamp.entities_time = time;
+            }
+        }
+    }
+
+    auto regions = std::vector<region_records>();
+    auto stale   = std::vector<std::size_t>();
+    regions.reserve(stamps.size());
+    for (const auto &[key, region] : stamps)
+    {
+        const auto at = cached_lookup.find(key);
+        if (at != cached_lookup.end() && cached[at->second].stamp == region.stamp)
+            regions.push_back(std::move(cached[at->second]));
+        else
+        {
+            stale.push_back(regions.size());
+            regions.push_back(region);
+        }
+    }
+    cached.clear();
+
+    _regions = static_cast<int>(regions.size());
+    _indexed = static_cast<int>(regions.size() - stale.size());
+
+    // Whatever was still valid is searchable while the rest is scanned
+    if (!stale.empty() && _indexed > 0) _publish(regions);
+
+    auto next    = std::atomic<std::size_t>(0);
+    auto workers = std::vector<std::thread>();
+    const auto worker_count =
+      std::clamp(std::thread::hardware_concurrency(), 1u, static_cast<std::uint32_t>(stale.size() + 1));
+    for (auto i = 0u; i < worker_count; i++)
+        workers.emplace_back(
+          [&]
+          {
+              for (auto at = next++; at < stale.size() && !_cancel; at = next++)
+              {
+                  auto &region = regions[stale[at]];
+                  region       = _scan_region(world_folder, region.x, region.z, region.stamp);
+                  _indexed++;
+              }
+          });
+    for (auto &worker : workers) worker.join();
+
+    if (_cancel) return;
+
+    _publish(regions);
+    _ready = true;
+
+    if (!cache_file.empty() && !stale.empty()) _save(cache_file, regions);
+}
+
+vx3d::loader::entity_index::region_records vx3d::loader::entity_index::_scan_region(
+  const std::filesystem::path &world_folder,
+  std::int32_t                 x,
+  std::int32_t                 z,
+  const region_stamp &         stamp)
+{
+    ZoneScopedN("EntityIndex::scan_region");
+
+    auto region  = region_records();
+    region.x     = x;
+    region.z     = z;
+    region.stamp = stamp;
+
+    auto types   = tsl::robin_map<std::string, std::uint32_t>();
+    auto found   = std::vector<scanned_entity>();
+    auto failed  = 0;
+
+    for (const auto *directory : { "region", "entities" })
+    {
+        const auto path = ::region_path(world_folder / directory, x, z);
+
+        auto error = std::error_code();
+        if (!std::filesystem::exists(path, error) || std::filesystem::file_size(path, error) < 8192)
+            continue;
+
+        const auto file = daw::filesystem::memory_mapped_file_t<std::uint8_t>(path.string());
+        if (!file) continue;
+
+        for (const auto &location : read_data_table(file))
+        {
+            if (_cancel) return region;
+            if (!location.valid()) continue;
+
+            try
+            {
+                const auto buffer = read_chunk_data(location, file);
+                found.clear();
+                scan_chunk_entities(buffer.data(), buffer.size(), found);
+
+                for (const auto &entity : found)
+                {
+                    auto name = std::string(entity.id);
+                    if (name.find(':') == std::string::npos) name.insert(0, "minecraft:");
+
+                    auto at = types.find(name);
+                    if (at == types.end()) at = types.insert({ name, _intern(name) }).first;
+                    region.records.push_back({ at->second, entity.position });
+                }
+            }
+            catch (const std::exception &)
+            {
+                failed++;
+            }
+        }
+    }
+
+    if (failed)
+        std::cerr << "Couldn't index " << failed << " chunks in region " << x << ", " << z
+                  << std::endl;
+
+    return region;
+}
+
+std::uint32_t vx3d::loader::entity_index::_intern(std::string_view name)
+{
+    auto guard = std::lock_guard(_names_mutex);
+    const auto key = std::string(name);
+    if (const auto at = _name_lookup.find(key); at != _name_lookup.end()) return at->second;
+
+    const auto id = static_cast<std::uint32_t>(_names.size());
+    _names.push_back(key);
+    _name_lookup.insert({ key, id });
+    return id;
+}
+
+void vx3d::loader::entity_index::_publish(const std::vector<region_records> &regions)
+{
+    ZoneScopedN("EntityIndex::publish");
+
+    auto names = std::vector<std::string>();
+    {
+        auto guard = std::lock_guard(_names_mutex);
+        names      = _names;
+    }
+
+    auto keyed = std::vector<std::vector<std::pair<std::uint64_t, entity_position>>>(names.size());
+    for (const auto &region : regions)
+        for (const auto &record : region.records)
+            if (record.type < keyed.size())
+                keyed[record.type].push_back(
+                  { morton_code(record.position.x, record.position.z), record.position });
+
+    auto built = std::make_shared<snapshot>();
+    for (auto type = std::size_t(0); type < keyed.size(); type++)
+    {
+        auto &entries = keyed[type];
+        if (entries.empty()) continue;
+
+        std::sort(
+          entries.begin(),
+          entries.end(),
+          [](const auto &a, const auto &b) { return a.first < b.first; });
+
+        auto &bucket = built->buckets.emplace_back();
+        bucket.name  = names[type];
+        bucket.positions.reserve(entries.size());
+
+        // A region covers an aligned square, so its entries are next to each other on the curve
+        for (const auto &[code, position] : entries)
+        {
+            const auto region_x = position.x >> region_shift;
+            const auto region_z = position.z >> region_shift;
+            const auto index    = static_cast<std::uint32_t>(bucket.positions.size());
+
+            if (bucket.regions.empty() || bucket.regions.back().x != region_x ||
+                bucket.regions.back().z != region_z)
+                bucket.regions.push_back({ region_x, region_z, index, index, position.y, position.y });
+
+            auto &summary = bucket.regions.back();
+            summary.end   = index + 1;
+            summary.min_y = std::min(summary.min_y, position.y);
+            summary.max_y = std::max(summary.max_y, position.y);
+            bucket.positions.push_back(position);
+        }
+
+        built->lookup.insert({ bucket.name, static_cast<std::uint32_t>(built->buckets.size() - 1) });
+    }
+
+    auto guard = std::lock_guard(_snapshot_mutex);
+    _snapshot  = std::move(built);
+}
+
+bool vx3d::loader::entity_index::_load(
+  const std::filesystem::path &path,
+  std::vector<region_records> &regions)
+{
+    ZoneScopedN("EntityIndex::load");
+    auto in = std::ifstream(path, std::ios::binary);
+    if (!in) return false;
+
+    auto magic   = std::uint32_t(0);
+    auto version = std::uint32_t(0);
+    if (!::read_value(in, magic) || !::read_value(in, version) || magic != index_magic ||
+        version != index_version)
+        return false;
+
+    // Persisted type indices are remapped onto the names interned this run
+    auto name_count = std::uint32_t(0);
+    if (!::read_value(in, name_count)) return false;
+    auto remap = std::vector<std::uint32_t>(name_count);
+    for (auto &id : remap)
+    {
+        auto length = std::uint16_t(0);
+        if (!::read_value(in, length)) return false;
+        auto name = std::string(length, '\0');
+        if (!in.read(name.data(), length)) return false;
+        id = _intern(name);
+    }
+
+    auto region_count = std::uint32_t(0);
+    if (!::read_value(in, region_count)) return false;
+    regions.resize(region_count);
+    for (auto &region : regions)
+    {
+        auto record_count = std::uint32_t(0);
+        if (!::read_value(in, region.x) || !::read_value(in, region.z) ||
+            !::read_value(in, region.stamp) || !::read_value(in, record_count))
+            return false;
+
+        region.records.resize(record_count);
+        if (!in.read(reinterpret_cast<char *>(region.records.data()), record_count * sizeof(record)))
+            return false;
+
+        for (auto &record : region.records)
+        {
+            if (record.type >= remap.size()) return false;
+            record.type = remap[record.type];
+        }
+    }
+
+    return true;
+}
+
+void vx3d::loader::entity_index::_save(
+  const std::filesystem::path &      path,
+  const std::vector<region_records> &regions) const
+{
+    ZoneScopedN("EntityIndex::save");
+
+    // Written next to the old index and moved over it, so a crash never leaves half a file
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+        auto out = std::ofstream(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) return;
+
+        ::write_value(out, index_magic);
+        ::write_value(out, index_version);
+
+        {
+            auto guard = std::lock_guard(_names_mutex);
+            ::write_value(out, static_cast<std::uint32_t>(_names.size()));
+            for (const auto &name : _names)
+            {
+                ::write_value(out, static_cast<std::uint16_t>(name.size()));
+                out.write(name.data(), static_cast<std::streamsize>(name.size()));
+            }
+        }
+
+        ::write_value(out, static_cast<std::uint32_t>(regions.size()));
+        for (const auto &region : regions)
+        {
+            ::write_value(out, region.x);
+            ::write_value(out, region.z);
+            ::write_value(out, region.stamp);
+            ::write_value(out, static_cast<std::uint32_t>(region.records.size()));
+            out.write(
+              reinterpret_cast<const char *>(region.records.data()),
+              static_cast<std::streamsize>(region.records.size() * sizeof(record)));
+        }
+
+        if (!out) return;
+    }
+
+    auto error = std::error_code();
+    std::filesystem::rename(temporary, path, error);
+    if (error) std::cerr << "Couldn't write entity index: " << error.message() << std::endl;
+}
+
+std::shared_ptr<const vx3d::loader::entity_index::snapshot>
+  vx3d::loader::entity_index::_current() const
+{
+    auto guard = std::lock_guard(_snapshot_mutex);
+    return _snapshot;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <tsl/robin_map.h>
+
+namespace vx3d::loader
+{
+    struct entity_position
+    {
+        std::int32_t x = 0;
+        std::int32_t y = 0;
+        std::int32_t z = 0;
+    };
+
+    /// Interleaves the bits of x and z, so every aligned power of two square is one contiguous run
+    [[nodiscard]] std::uint64_t morton_code(std::int32_t x, std::int32_t z) noexcept;
+
+    struct scanned_entity
+    {
+        std::string_view id;    // Points into the scanned NBT, not always namespaced
+        entity_position  position;
+    };
+
+    /// Pulls the id and block position of every block entity and entity out of a chunk's NBT,
+    /// both the region chunk formats and the 1.17+ `entities/` chunks are understood
+    /// \param found Appended to, entities riding others are included
+    void scan_chunk_entities(const std::byte *data, std::size_t size, std::vector<scanned_entity> &found);
+
+    // Where every block entity and entity of a world is, bucketed by id. Each bucket is sorted
+    // along a Morton curve, so a region's worth of positions is one run with a summary in front.
+    // The index is built on a background thread and persisted, regions whose files haven't
+    // changed since are not scanned again.
+    class entity_index
+    {
+    public:
+        entity_index() = default;
+
+        ~entity_index();
+
+        entity_index(const entity_index &) = delete;
+
+        entity_index &operator=(const entity_index &) = delete;
+
+        /// Starts (re)indexing a world in the background, cancelling any index in progress
+        void build(const std::filesystem::path &world_folder);
+
+        /// Cancels indexing and drops the index
+        void clear();
+
+        /// True once every region has been indexed, queries before that see a partial index
+        [[nodiscard]] bool ready() const noexcept { return _ready; }
+
+        /// Fraction of the regions that have been indexed
+        [[nodiscard]] float progress() const noexcept;
+
+        /// Every id that's been found at least once, sorted
+        [[nodiscard]] std::vector<std::string> types() const;
+
+        [[nodiscard]] std::size_t count(std::string_view type) const;
+
+        /// Positions of everything with an id inside an inclusive block box
+        [[nodiscard]] std::vector<entity_position>
+          query(std::string_view type, glm::ivec3 min, glm::ivec3 max) const;
+
+    private:
+        struct region_stamp
+        {
+            std::uint64_t region_size     = 0;
+            std::int64_t  region_time     = 0;
+            std::uint64_t entities_size   = 0;
+            std::int64_t  entities_time   = 0;
+
+            [[nodiscard]] bool operator==(const region_stamp &other) const noexcept
+            {
+                return region_size == other.region_size && region_time == other.region_time &&
+                  entities_size == other.entities_size && entities_time == other.entities_time;
+            }
+        };
+
+        struct record
+        {
+            std::uint32_t   type = 0;    // Index into the type names
+            entity_position position;
+        };
+
+        // Everything found in one pair of region / entities files, the unit that's persisted
+        struct region_records
+        {
+            std::int32_t        x = 0;
+            std::int32_t        z = 0;
+            region_stamp        stamp;
+            std::vector<record> records;
+        };
+
+        struct region_summary
+        {
+            std::int32_t  x     = 0;
+            std::int32_t  z     = 0;
+            std::uint32_t begin = 0;
+            std::uint32_t end   = 0;
+            std::int32_t  min_y = 0;
+            std::int32_t  max_y = 0;
+        };
+
+        struct bucket
+        {
+            std::string                  name;
+            std::vector<entity_position> positions;    // Sorted by `morton_code`
+            std::vector<region_summary>  regions;      // Sorted the same way
+        };
+
+        // What queries read, swapped in whole so they never wait for the indexer
+        struct snapshot
+        {
+            std::vector<bucket>                          buckets;
+            tsl::robin_map<std::string, std::uint32_t>   lookup;
+        };
+
+        void _index(std::filesystem::path world_folder);
+
+        [[nodiscard]] region_records
+          _scan_region(const std::filesystem::path &world_folder, std::int32_t x, std::int32_t z, const region_stamp &stamp);
+
+        [[nodiscard]] std::uint32_t _intern(std::string_view name);
+
+        void _publish(const std::vector<region_records> &regions);
+
+        [[nodiscard]] bool _load(const std::filesystem::path &path, std::vector<region_records> &regions);
+
+        void _save(const std::filesystem::path &path, const std::vector<region_records> &regions) const;
+
+        [[nodiscard]] std::shared_ptr<const snapshot> _current() const;
+
+        std::thread       _worker;
+        std::atomic<bool> _cancel   = false;
+        std::atomic<bool> _ready    = false;
+        std::atomic<int>  _indexed  = 0;
+        std::atomic<int>  _regions  = 0;
+
+        // Shared by every region, records refer to names by index
+        mutable std::mutex                         _names_mutex;
+        std::vector<std::string>                   _names;
+        tsl::robin_map<std::string, std::uint32_t> _name_lookup;
+
+        mutable std::mutex              _snapshot_mutex;
+        std::shared_ptr<const snapshot> _snapshot;
+    };
+}    // namespace vx3d::loader
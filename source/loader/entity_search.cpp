@@ -0,0 +1,43 @@
+#include "entity_search.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <loader/world_loader.h>
+
+namespace
+{
+    // How often indexing is checked on while it runs
+    constexpr auto poll_interval = std::chrono::milliseconds(50);
+}    // namespace
+
+int vx3d::loader::run_entity_search(
+  const std::filesystem::path &world_folder,
+  std::string_view             type,
+  const glm::ivec3 &           min,
+  const glm::ivec3 &           max)
+{
+    auto loader = world_loader();
+    loader.set_world(world_folder, true);
+
+    const auto &entities = loader.entities();
+    while (!entities.ready()) std::this_thread::sleep_for(::poll_interval);
+
+    auto id = std::string(type);
+    if (!entities.count(id) && id.find(':') == std::string::npos) id = "minecraft:" + id;
+    if (!entities.count(id))
+    {
+        std::cerr << "Nothing called " << type << " in " << world_folder << ", there's";
+        for (const auto &name : entities.types()) std::cerr << ' ' << name;
+        std::cerr << std::endl;
+        return 1;
+    }
+
+    const auto found = entities.query(id, min, max);
+    for (const auto &position : found)
+        std::cout << position.x << ' ' << position.y << ' ' << position.z << '\n';
+    std::cout << found.size() << " of " << entities.count(id) << ' ' << id << std::endl;
+    return 0;
+}
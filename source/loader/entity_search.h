@@ -0,0 +1,19 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+
+#include <glm/glm.hpp>
+
+namespace vx3d::loader
+{
+    /// Indexes the entities of a world, or brings its cached index up to date, and prints the
+    /// position of everything with an id inside an inclusive block box, one `x y z` a line. Ids
+    /// without a namespace are looked up in `minecraft:` as well.
+    /// \return An exit code, not 0 if nothing with the id was found anywhere in the world
+    int run_entity_search(
+      const std::filesystem::path &world_folder,
+      std::string_view             type,
+      const glm::ivec3 &           min,
+      const glm::ivec3 &           max);
+}    // namespace vx3d::loader
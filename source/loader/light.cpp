@@ -0,0 +1,41 @@
+#include "light.h"
+
+#include <cstring>
+
+#include <util/simd.h>
+
+void vx3d::loader::unpack_nibbles(const std::uint8_t *packed, std::uint8_t *out, std::size_t bytes) noexcept
+{
+    auto i = std::size_t(0);
+
+#if defined(VX3D_SIMD_SSE2)
+    const auto low_mask = _mm_set1_epi8(0x0F);
+    for (; i + 16 <= bytes; i += 16)
+    {
+        const auto value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + i));
+        const auto low   = _mm_and_si128(value, low_mask);
+        const auto high  = _mm_and_si128(_mm_srli_epi16(value, 4), low_mask);
+
+        // Interleaving low and high puts every pair back in index order
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2), _mm_unpacklo_epi8(low, high));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2 + 16), _mm_unpackhi_epi8(low, high));
+    }
+#endif
+
+    for (; i < bytes; i++)
+    {
+        out[i * 2]     = packed[i] & 0xF;
+        out[i * 2 + 1] = packed[i] >> 4;
+    }
+}
+
+void vx3d::loader::section_light::layer(std::int32_t y, std::uint8_t *block_out, std::uint8_t *sky_out)
+  const noexcept
+{
+    // A layer is 256 values, 128 consecutive bytes starting at y * 128
+    unpack_nibbles(block.data() + y * 128, block_out, 128);
+    if (has_sky)
+        unpack_nibbles(sky.data() + y * 128, sky_out, 128);
+    else
+        std::memset(sky_out, 0, 256);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace vx3d::loader
+{
+    // Block and sky light of one section, left in the packed 4 bit layout the game saves
+    struct section_light
+    {
+        std::int8_t y       = 0;
+        bool        has_sky = false;    // The nether and end don't store sky light
+
+        // Two values per byte, even indices in the low nibble, indexed like chunk_section::blocks
+        std::array<std::uint8_t, 2048> block {};
+        std::array<std::uint8_t, 2048> sky {};
+
+        [[nodiscard]] static std::uint8_t
+          nibble(const std::array<std::uint8_t, 2048> &packed, std::int32_t index) noexcept
+        {
+            return (packed[index >> 1] >> ((index & 1) * 4)) & 0xF;
+        }
+
+        [[nodiscard]] std::uint8_t block_at(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept
+        {
+            return nibble(block, (y << 8) | (z << 4) | x);
+        }
+
+        [[nodiscard]] std::uint8_t sky_at(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept
+        {
+            return has_sky ? nibble(sky, (y << 8) | (z << 4) | x) : 0;
+        }
+
+        /// Expands one horizontal 16x16 layer (z * 16 + x) of both light kinds
+        void layer(std::int32_t y, std::uint8_t *block_out, std::uint8_t *sky_out) const noexcept;
+    };
+
+    /// Expands packed nibbles into one byte per value
+    /// \param packed Source bytes, the even value of each pair in the low nibble
+    /// \param out Receives `bytes * 2` values
+    /// \param bytes Packed bytes to read
+    void unpack_nibbles(const std::uint8_t *packed, std::uint8_t *out, std::size_t bytes) noexcept;
+}    // namespace vx3d::loader
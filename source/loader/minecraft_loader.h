@@ -2,6 +2,7 @@
 
 #include <filesystem>
 #include <algorithm>
+#include <bitset>
 #include <fstream>
 #include <iostream>
 #include <cmath>
@@ -15,6 +16,7 @@
 
 #include <thread_pool.h>
 #include <nbt/nbt.h>
+#include <loader/chunk.h>
 
 namespace vx3d::loader
 {
@@ -25,6 +27,7 @@ namespace vx3d::loader
         std::uint32_t time_stamp = 0;
         std::int32_t  x = 0;
         std::int32_t  z = 0;
+        bool          external = false;    // Too big for the region, stored in a c.X.Z.mcc next to it
 
         chunk_location() = default;
         chunk_location(std::int32_t x, std::int32_t z) : x(x), z(z) {}
@@ -36,6 +39,15 @@ namespace vx3d::loader
         }
     };
 
+    // What the 8 KiB header of a region file says about each of its chunks, indexed z * 32 + x,
+    // enough to draw the header overlays without reading any chunk
+    struct region_header
+    {
+        std::array<std::uint32_t, 1024> time_stamps {};
+        std::array<std::uint8_t, 1024>  sectors {};    // 4 KiB each, 0 where there's no chunk
+        std::bitset<1024>               external;
+    };
+
     inline std::array<chunk_location, 1024>
       read_data_table(const daw::filesystem::memory_mapped_file_t<std::uint8_t> &file_data)
     {
@@ -64,8 +76,8 @@ namespace vx3d::loader
               (time_stamp_bytes[2] << 8) | time_stamp_bytes[3];
             locations[i].size   = bytes[3];
             locations[i].offset = offset;
-            locations[i].x      = offset & 31;
-            locations[i].z      = offset / 32;
+            locations[i].x      = i & 31;
+            locations[i].z      = i / 32;
 
             if (offset == 0 || locations[i].size == 0)
             {
@@ -78,40 +90,48 @@ namespace vx3d::loader
         return locations;
     }
 
-    inline void read_chunk(
+    // Decompressed chunk NBT, the nodes point into the buffer so both live together
+    struct chunk_document
+    {
+        vx3d::nbt::node::byte_buffer buffer;
+        vx3d::nbt::node::node_list   nodes;
+
+        [[nodiscard]] const vx3d::nbt::node &root() const { return *nodes.root(); }
+    };
+
+    /// Reads and decompresses the NBT of a chunk without parsing it
+    [[nodiscard]] inline vx3d::nbt::node::byte_buffer read_chunk_data(
       const chunk_location &                                     location,
       const daw::filesystem::memory_mapped_file_t<std::uint8_t> &file)
     {
-        ZoneScopedN("Loader::read_chunk");
+        ZoneScopedN("Loader::read_chunk_data");
 
-        const auto index = location.offset * 4096;
+        const auto index = static_cast<std::size_t>(location.offset) * 4096;
+        if (index + 5 > file.size()) throw std::runtime_error("Chunk lies outside of region file");
 
-        // Keep running
         const auto header = std::array<std::uint32_t, 5>(
           { file[index + 0], file[index + 1], file[index + 2], file[index + 3], file[index + 4] });
 
         const auto length = ((header[0] << 24) | (header[1]) << 16 | (header[2] << 8) | header[3]);
         const auto compression_scheme = header[4];
         if (compression_scheme != 2)    // If it's not zlib... oh man
-            throw std::exception("Invalid compress scheme");
+            throw std::runtime_error("Invalid compress scheme");
+        if (length == 0 || index + 4 + length > file.size())
+            throw std::runtime_error("Chunk length exceeds region file");
 
-        auto chunk_data = std::vector<std::byte>(length - 1);
-        std::memcpy(chunk_data.data(), &file[index + 5], length - 1);
-
-        auto buffer = vx3d::byte_buffer<bit_endianness::big>(chunk_data.data(), length - 1, true);
+        return vx3d::nbt::node::byte_buffer(&file[index + 5], length - 1, true);
+    }
 
-        static std::atomic<uint32_t> last_size = 0;
+    [[nodiscard]] inline chunk_document read_chunk(
+      const chunk_location &                                     location,
+      const daw::filesystem::memory_mapped_file_t<std::uint8_t> &file)
+    {
+        ZoneScopedN("Loader::read_chunk");
 
-        if (length - 1 > last_size)
-        {
-            last_size = length - 1;
-            std::ofstream out(std::string("./test.nbt"), std::ios::binary | std::ios::trunc);
-            out.write(reinterpret_cast<const char *>(&file[index + 5]), length - 1);
-            out.flush();
-            out.close();
-        }
+        auto buffer = read_chunk_data(location, file);
+        auto nodes  = nbt::node::read(buffer);
 
-        auto node = nbt::node::read(buffer);
+        return chunk_document { std::move(buffer), std::move(nodes) };
     }
 
     inline int read_region_file(const std::filesystem::path &file, vx3d::thread_pool *thread_pool)
@@ -131,7 +151,7 @@ namespace vx3d::loader
                 {
                     chunks_read++;
                     thread_pool->submit_task([location, file_handle]
-                                             { read_chunk(location, *file_handle); });
+                                             { (void) read_chunk(location, *file_handle); });
                 }
             }
         }
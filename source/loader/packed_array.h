@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+
+#include <nbt/nbt.h>
+
+namespace vx3d::loader
+{
+    /// Bits used per entry to index a palette of the given size
+    /// \param palette_size Entries in the palette
+    /// \param minimum_bits The lower bound the format enforces (4 for block states, 0 for biomes)
+    [[nodiscard]] inline std::uint32_t palette_bits(std::uint32_t palette_size, std::uint32_t minimum_bits)
+    {
+        auto bits = std::uint32_t(0);
+        while ((std::uint32_t(1) << bits) < palette_size) bits++;
+        return bits < minimum_bits ? minimum_bits : bits;
+    }
+
+    /// Unpacks a LONG_ARRAY of palette indices into `out`
+    /// \param data The packed long array
+    /// \param bits Bits per entry
+    /// \param count Entries to unpack
+    /// \param spanning Whether entries may cross long boundaries (chunks saved before 1.16)
+    /// \param out Must hold `count` values, entries that are missing from `data` are zeroed
+    inline void unpack_indices(
+      const vx3d::nbt::node &data,
+      std::uint32_t          bits,
+      std::uint32_t          count,
+      bool                   spanning,
+      std::uint16_t *        out)
+    {
+        const auto longs = static_cast<std::uint32_t>(data.array_size());
+        const auto mask  = (std::uint64_t(1) << bits) - 1;
+
+        if (bits == 0 || longs == 0)
+        {
+            for (auto i = std::uint32_t(0); i < count; i++) out[i] = 0;
+            return;
+        }
+
+        if (!spanning)
+        {
+            const auto per_long = 64 / bits;
+            auto       index    = std::uint32_t(0);
+            for (auto i = std::uint32_t(0); i < longs && index < count; i++)
+            {
+                auto value = static_cast<std::uint64_t>(data.long_at(i));
+                for (auto j = std::uint32_t(0); j < per_long && index < count; j++)
+                {
+                    out[index++] = static_cast<std::uint16_t>(value & mask);
+                    value >>= bits;
+                }
+            }
+            for (; index < count; index++) out[index] = 0;
+            return;
+        }
+
+        for (auto i = std::uint32_t(0); i < count; i++)
+        {
+            const auto bit   = std::uint64_t(i) * bits;
+            const auto word  = static_cast<std::uint32_t>(bit / 64);
+            const auto shift = static_cast<std::uint32_t>(bit % 64);
+            if (word >= longs)
+            {
+                out[i] = 0;
+                continue;
+            }
+
+            auto value = static_cast<std::uint64_t>(data.long_at(word)) >> shift;
+            if (shift + bits > 64 && word + 1 < longs)
+                value |= static_cast<std::uint64_t>(data.long_at(word + 1)) << (64 - shift);
+            out[i] = static_cast<std::uint16_t>(value & mask);
+        }
+    }
+}    // namespace vx3d::loader
@@ -2,10 +2,10 @@
 
 std::uint64_t vx3d::world_loader::hash_pos(std::int32_t x, std::int32_t z)
 {
-    return static_cast<std::uint64_t>(x) << 32 | (static_cast<std::uint64_t>(z) & 0xFFFFFFFF);
+    return loader::position_key(x, z);
 }
 
-vx3d::world_loader::world_loader() : _thread_pool(0)
+vx3d::world_loader::world_loader() : _thread_pool(0), _chunk_cache(std::size_t(1) << 30)
 {
 }
 
@@ -19,41 +19,354 @@ vx3d::world_loader::world_loader() : _thread_pool(0)
 //    return found;
 //}
 
-void vx3d::world_loader::set_world(const std::filesystem::path &world_folder)
+void vx3d::world_loader::set_world(const std::filesystem::path &world_folder, bool index_entities)
 {
-    _world_folder = world_folder;
+    ZoneScopedN("WorldLoader::set_world");
+    auto world_guard = std::unique_lock(_world_mutex);
+
+    _chunk_cache.clear();
+    {
+        auto guard = std::lock_guard(_region_files_mutex);
+        _world_folder = world_folder;
+        _region_files.clear();
+    }
+    {
+        auto guard = std::lock_guard(_loaded_chunks_mutex);
+        _loaded_chunk_headers.clear();
+        _region_headers.clear();
+        _region_times.clear();
+    }
+    _summaries.open(world_folder);
     _load_chunk_headers();
+    if (index_entities)
+        _entity_index.build(world_folder);
+    else
+        _entity_index.clear();
+    _generation++;
+}
+
+std::shared_ptr<const vx3d::world_loader::region_file>
+  vx3d::world_loader::_region_file(std::int32_t region_x, std::int32_t region_z)
+{
+    auto guard = std::lock_guard(_region_files_mutex);
+    if (const auto at = _region_files.find(hash_pos(region_x, region_z)); at != _region_files.end())
+        return at->second;
+
+    const auto path = _world_folder / "region" /
+      ("r." + std::to_string(region_x) + "." + std::to_string(region_z) + ".mca");
+
+    auto file = std::make_shared<const region_file>(path.string());
+    _region_files.insert({ hash_pos(region_x, region_z), file });
+    return file;
 }
 
-void vx3d::world_loader::_chunk_load(std::int32_t x, std::int32_t z)
+std::shared_ptr<const vx3d::loader::chunk>
+  vx3d::world_loader::load_chunk(std::int32_t x, std::int32_t z, std::uint32_t flags)
 {
+    auto world_guard = std::shared_lock(_world_mutex);
+    return _load_chunk(x, z, flags);
+}
+
+std::shared_ptr<const vx3d::loader::chunk>
+  vx3d::world_loader::_load_chunk(std::int32_t x, std::int32_t z, std::uint32_t flags)
+{
+    ZoneScopedN("WorldLoader::load_chunk");
+
+    if (auto cached = _chunk_cache.find(x, z, flags)) return cached;
+
+    // Keep whatever the cached copy already had, so toggling a view doesn't thrash the cache
+    flags |= _chunk_cache.decoded_flags(x, z);
+
+    const auto location = _location(x, z);
+    if (!location) return nullptr;
+
+    // Arithmetic shifts so negative chunks land in the right region
+    const auto file = _region_file(x >> 5, z >> 5);
+    if (!*file) return nullptr;
+
+    try
+    {
+        const auto document = loader::read_chunk(*location, *file);
+        auto       decoded  = loader::decode_chunk(document.root(), flags);
+        decoded.x           = x;
+        decoded.z           = z;
+
+        auto shared = std::make_shared<const loader::chunk>(std::move(decoded));
+        _chunk_cache.insert(shared);
+        return shared;
+    }
+    catch (const std::exception &exception)
+    {
+        std::cerr << "Failed to load chunk " << x << ", " << z << ": " << exception.what()
+                  << std::endl;
+        return nullptr;
+    }
+}
+
+std::shared_ptr<const vx3d::map::column_summary>
+  vx3d::world_loader::load_summary(std::int32_t x, std::int32_t z, bool light)
+{
+    ZoneScopedN("WorldLoader::load_summary");
+    auto world_guard = std::shared_lock(_world_mutex);
+
+    const auto location = _location(x, z);
+    if (!location) return nullptr;
+
+    auto cached = _summaries.find(x, z, location->time_stamp);
+    if (cached && (cached->lit || !light))
+    {
+        _summaries_cached++;
+        return cached;
+    }
+
+    // Light takes as long to decode as the blocks, so only the light modes pay for it
+    const auto flags = light ? loader::decode_flag_all | loader::decode_flag_light : loader::decode_flag_all;
+    const auto chunk = _load_chunk(x, z, flags);
+    if (!chunk) return nullptr;
+
+    auto summary        = std::make_shared<map::column_summary>(map::summarize_chunk(*chunk));
+    summary->time_stamp = location->time_stamp;
+    _summaries.insert(summary);
+    _summaries_decoded++;
+    return summary;
+}
+
+std::shared_ptr<const vx3d::map::column_summary> vx3d::world_loader::load_slice(
+  std::int32_t x,
+  std::int32_t z,
+  std::int32_t top,
+  std::int32_t bottom)
+{
+    ZoneScopedN("WorldLoader::load_slice");
+    auto world_guard = std::shared_lock(_world_mutex);
+
+    if (const auto cached = _chunk_cache.find(x, z, loader::decode_flag_all))
+        return std::make_shared<map::column_summary>(map::summarize_chunk(*cached, top, bottom));
+
+    const auto location = _location(x, z);
+    if (!location) return nullptr;
+
+    const auto file = _region_file(x >> 5, z >> 5);
+    if (!*file) return nullptr;
+
+    try
+    {
+        const auto data = loader::read_chunk_data(*location, *file);
+
+        // A cap usually finds something in the two sections under it, only look further down
+        // for the columns that don't
+        const auto near = std::max(bottom, top - 31);
+        auto decoded    = loader::decode_chunk_range(data.data(), data.size(), near, top);
+        decoded.x       = x;
+        decoded.z       = z;
+
+        auto summary = map::summarize_chunk(decoded, top, bottom);
+        if (near > bottom &&
+            std::find(
+              summary.surface_height.begin(),
+              summary.surface_height.end(),
+              map::column_summary::no_surface) != summary.surface_height.end())
+        {
+            decoded   = loader::decode_chunk_range(data.data(), data.size(), bottom, top);
+            decoded.x = x;
+            decoded.z = z;
+            summary   = map::summarize_chunk(decoded, top, bottom);
+        }
+
+        return std::make_shared<map::column_summary>(summary);
+    }
+    catch (const std::exception &exception)
+    {
+        std::cerr << "Failed to slice chunk " << x << ", " << z << ": " << exception.what()
+                  << std::endl;
+        return nullptr;
+    }
+}
+
+std::vector<glm::ivec2>
+  vx3d::world_loader::regions_in(const glm::ivec2 &min, const glm::ivec2 &max)
+{
+    auto found = std::vector<glm::ivec2>();
+    auto guard = std::lock_guard(_loaded_chunks_mutex);
+
+    // Whichever is smaller, the rectangle or the list of regions
+    const auto area = std::uint64_t(max.x - min.x + 1) * std::uint64_t(max.y - min.y + 1);
+    if (area <= _region_headers.size())
+    {
+        for (auto x = min.x; x <= max.x; x++)
+            for (auto z = min.y; z <= max.y; z++)
+                if (_region_headers.count(hash_pos(x, z))) found.emplace_back(x, z);
+    }
+    else
+        for (const auto &[region, header] : _region_headers)
+        {
+            const auto x = static_cast<std::int32_t>(region >> 32);
+            const auto z = static_cast<std::int32_t>(region & 0xFFFFFFFF);
+            if (x >= min.x && x <= max.x && z >= min.y && z <= max.y) found.emplace_back(x, z);
+        }
+
+    return found;
+}
+
+std::vector<vx3d::loader::chunk_location>
+  vx3d::world_loader::chunks_in(const glm::ivec2 &min, const glm::ivec2 &max)
+{
+    ZoneScopedN("WorldLoader::chunks_in");
+    auto found = std::vector<vx3d::loader::chunk_location>();
+
+    // Arithmetic shifts so negative chunks land in the right region
+    for (const auto &region : regions_in(min >> 5, max >> 5))
+    {
+        const auto from = glm::max(min, region * 32);
+        const auto to   = glm::min(max, region * 32 + 31);
+
+        auto guard = std::lock_guard(_loaded_chunks_mutex);
+        for (auto x = from.x; x <= to.x; x++)
+            for (auto z = from.y; z <= to.y; z++)
+                if (const auto at = _loaded_chunk_headers.find(hash_pos(x, z));
+                    at != _loaded_chunk_headers.end())
+                    found.push_back(at->second);
+    }
+
+    return found;
+}
+
+std::optional<vx3d::loader::chunk_location>
+  vx3d::world_loader::_location(std::int32_t x, std::int32_t z)
+{
+    auto       guard = std::lock_guard(_loaded_chunks_mutex);
+    const auto at    = _loaded_chunk_headers.find(hash_pos(x, z));
+    if (at == _loaded_chunk_headers.end()) return std::nullopt;
+    return at->second;
+}
+
+void vx3d::world_loader::_list_regions(
+  std::vector<listed_region> &   regions,
+  tsl::robin_set<std::uint64_t> &external) const
+{
+    // Chunks over 1 MiB are moved out of their region into a c.X.Z.mcc file of their own
+    auto error = std::error_code();
+    for (const auto &file : std::filesystem::directory_iterator(_world_folder / "region", error))
+    {
+        const auto extension = file.path().extension();
+        // Old .mcr regions are in a format of their own, the game converts them to .mca
+        if (extension == ".mca")
+        {
+            auto       region = listed_region { file.path() };
+            const auto stem   = file.path().stem().string();
+            if (std::sscanf(stem.data(), "r.%d.%d", &region.x, &region.z) != 2) continue;
+            region.write_time = file.last_write_time(error);
+            regions.push_back(std::move(region));
+        }
+        else if (extension == ".mcc")
+        {
+            auto chunk_x = std::int32_t(0);
+            auto chunk_z = std::int32_t(0);
+            if (std::sscanf(file.path().stem().string().data(), "c.%d.%d", &chunk_x, &chunk_z) == 2)
+                external.insert(hash_pos(chunk_x, chunk_z));
+        }
+    }
 }
 
 void vx3d::world_loader::_load_chunk_headers()
 {
     ZoneScopedN("WorldLoader::load_chunk_headers");
-    for (const auto &file : std::filesystem::directory_iterator(_world_folder / "region"))
-    {
-        const auto file_name = file.path().stem().string();
-        auto       region_x  = std::int32_t(0);
-        auto       region_z  = std::int32_t(0);
-        std::sscanf(file_name.data(), "r.%d.%d.mcr", &region_x, &region_z);
 
-        const auto mapped =
-          daw::filesystem::memory_mapped_file_t<std::uint8_t>(file.path().string());
+    auto regions  = std::vector<listed_region>();
+    auto external = tsl::robin_set<std::uint64_t>();
+    _list_regions(regions, external);
+    for (const auto &region : regions) static_cast<void>(_read_region(region, external));
+}
+
+std::vector<glm::ivec2> vx3d::world_loader::_read_region(
+  const listed_region &                region,
+  const tsl::robin_set<std::uint64_t> &external)
+{
+    const auto mapped = daw::filesystem::memory_mapped_file_t<std::uint8_t>(region.path.string());
+
+    // Anything shorter doesn't even have a whole header, it's read again once the game is done
+    if (mapped.size() < 8192) return {};
+    const auto chunk_locations = vx3d::loader::read_data_table(mapped);
 
-        if (mapped.size())
+    auto header  = std::make_shared<loader::region_header>();
+    auto changed = std::vector<glm::ivec2>();
+    auto guard   = std::lock_guard(_loaded_chunks_mutex);
+
+    const auto key      = hash_pos(region.x, region.z);
+    const auto previous = _region_headers.find(key);
+    for (auto i = 0; i < 1024; i++)
+    {
+        auto location = chunk_locations[i];
+        location.x += region.x * 32;
+        location.z += region.z * 32;
+        if (location.valid())
         {
-            const auto chunk_locations = vx3d::loader::read_data_table(mapped);
-            for (auto location : chunk_locations)
+            location.external      = external.count(hash_pos(location.x, location.z)) != 0;
+            header->time_stamps[i] = location.time_stamp;
+            header->sectors[i]     = location.size;
+            header->external[i]    = location.external;
+            _loaded_chunk_headers.insert_or_assign(hash_pos(location.x, location.z), location);
+        }
+        else
+            _loaded_chunk_headers.erase(hash_pos(location.x, location.z));
+
+        const auto was_stamped = previous == _region_headers.end() ? 0 : previous->second->time_stamps[i];
+        const auto was_sectors = previous == _region_headers.end() ? 0 : previous->second->sectors[i];
+        if (header->time_stamps[i] != was_stamped || header->sectors[i] != was_sectors)
+            changed.emplace_back(location.x, location.z);
+    }
+    _region_headers.insert_or_assign(key, std::move(header));
+    _region_times.insert_or_assign(key, region.write_time);
+    return changed;
+}
+
+std::vector<glm::ivec2> vx3d::world_loader::refresh_regions()
+{
+    ZoneScopedN("WorldLoader::refresh_regions");
+    if (_world_folder.empty()) return {};
+
+    auto regions  = std::vector<listed_region>();
+    auto external = tsl::robin_set<std::uint64_t>();
+    _list_regions(regions, external);
+    {
+        auto guard = std::lock_guard(_loaded_chunks_mutex);
+        regions.erase(
+          std::remove_if(
+            regions.begin(),
+            regions.end(),
+            [this](const listed_region &region)
             {
-                location.x += region_x;
-                location.z += region_z;
-                if (location.valid())
-                    _loaded_chunk_headers.insert({ hash_pos(location.x, location.z), location });
-            }
+                const auto at = _region_times.find(hash_pos(region.x, region.z));
+                return at != _region_times.end() && at->second == region.write_time;
+            }),
+          regions.end());
+    }
+    if (regions.empty()) return {};
+
+    // Loads in flight finish on the old file first, the ones after map the file as it is now
+    auto world_guard = std::unique_lock(_world_mutex);
+    auto changed     = std::vector<glm::ivec2>();
+    for (const auto &region : regions)
+    {
+        {
+            auto guard = std::lock_guard(_region_files_mutex);
+            _region_files.erase(hash_pos(region.x, region.z));
+        }
+        for (const auto &chunk : _read_region(region, external))
+        {
+            _chunk_cache.erase(chunk.x, chunk.y);
+            changed.push_back(chunk);
         }
     }
+    return changed;
+}
+
+std::shared_ptr<const vx3d::loader::region_header>
+  vx3d::world_loader::region_header(std::int32_t region_x, std::int32_t region_z)
+{
+    auto       guard = std::lock_guard(_loaded_chunks_mutex);
+    const auto at    = _region_headers.find(hash_pos(region_x, region_z));
+    return at == _region_headers.end() ? nullptr : at->second;
 }
 
 std::vector<vx3d::loader::chunk_location>
@@ -63,10 +376,11 @@ std::vector<vx3d::loader::chunk_location>
     auto found = std::vector<vx3d::loader::chunk_location>();
     found.reserve(locations.size());
 
+    auto guard = std::lock_guard(_loaded_chunks_mutex);
     for (auto location : locations)
         if (const auto &at = _loaded_chunk_headers.find(hash_pos(location.x, location.z));
             at != _loaded_chunk_headers.end())
-            found.push_back(location);
+            found.push_back(at->second);
 
     return found;
 }
@@ -1,9 +1,17 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
 #include <thread_pool.h>
 #include <tsl/robin_map.h>
+#include <tsl/robin_set.h>
+#include <glm/glm.hpp>
 #include <loader/minecraft_loader.h>
+#include <loader/chunk_cache.h>
+#include <loader/entity_index.h>
+#include <map/column_summary.h>
 #include <tracy/Tracy.hpp>
 
 namespace vx3d
@@ -11,29 +19,148 @@ namespace vx3d
     class world_loader
     {
     private:
+        using region_file = daw::filesystem::memory_mapped_file_t<std::uint8_t>;
 
-        void _chunk_load(std::int32_t x, std::int32_t z);
+        [[nodiscard]] std::shared_ptr<const region_file>
+          _region_file(std::int32_t region_x, std::int32_t region_z);
+
+        // A region file as found in the world's region folder
+        struct listed_region
+        {
+            std::filesystem::path           path;
+            std::int32_t                    x = 0;
+            std::int32_t                    z = 0;
+            std::filesystem::file_time_type write_time {};
+        };
+
+        /// The region files of the world and the chunks moved out of them into .mcc files
+        void
+          _list_regions(std::vector<listed_region> &regions, tsl::robin_set<std::uint64_t> &external) const;
 
         void _load_chunk_headers();
 
+        /// Reads the header of a region file over what was known of it
+        /// \return Chunks whose time stamp or size differs from before, including ones that are new
+        /// or gone
+        std::vector<glm::ivec2>
+          _read_region(const listed_region &region, const tsl::robin_set<std::uint64_t> &external);
+
+        [[nodiscard]] std::optional<loader::chunk_location> _location(std::int32_t x, std::int32_t z);
+
+        /// `load_chunk` for callers already holding `_world_mutex`
+        [[nodiscard]] std::shared_ptr<const loader::chunk>
+          _load_chunk(std::int32_t x, std::int32_t z, std::uint32_t flags);
+
     public:
+        // Chunks out from the origin past the world border, so `chunks_in` between it and its
+        // negative takes in any world. Close enough that region and block coordinates don't overflow.
+        static constexpr std::int32_t world_limit = std::int32_t(1) << 22;
+
+        // Of `load_summary`, summaries it found made already and those it decoded a chunk for
+        struct summary_counts
+        {
+            std::uint64_t cached  = 0;
+            std::uint64_t decoded = 0;
+        };
+
         [[nodiscard]] static std::uint64_t hash_pos(std::int32_t x, std::int32_t z);
 
         world_loader();
 
 //        [[nodiscard]] bool get_chunk(std::int32_t x, std::int32_t z);
 
+        /// Headers of the chunks that exist out of those asked for, time stamps included
         [[nodiscard]] std::vector<loader::chunk_location>
           get_locations(const std::vector<loader::chunk_location> &locations);
 
-        void set_world(const std::filesystem::path &world_folder);
+        /// Every region file between two corners, inclusive, in region coordinates
+        [[nodiscard]] std::vector<glm::ivec2> regions_in(const glm::ivec2 &min, const glm::ivec2 &max);
+
+        /// The header of a region file, read when the world was opened
+        /// \return nullptr if there's no such region
+        [[nodiscard]] std::shared_ptr<const loader::region_header>
+          region_header(std::int32_t region_x, std::int32_t region_z);
+
+        /// Every chunk with a header between two corners, inclusive. Only looks at the regions that
+        /// exist, so it stays cheap for rectangles far bigger than the world.
+        [[nodiscard]] std::vector<loader::chunk_location>
+          chunks_in(const glm::ivec2 &min, const glm::ivec2 &max);
+
+        /// Reads and decodes a chunk, safe to call from any thread. Decoded chunks are cached, a
+        /// cached chunk missing some of `flags` (light, usually) is decoded again with both sets.
+        /// \return nullptr if the chunk doesn't exist or couldn't be decoded
+        [[nodiscard]] std::shared_ptr<const loader::chunk> load_chunk(
+          std::int32_t  x,
+          std::int32_t  z,
+          std::uint32_t flags = loader::decode_flag_all);
+
+        /// Column summary of a chunk, only decoded again once the chunk changed on disk
+        /// \param light Whether the summary has to be `lit`, a summary made without light is made
+        /// again with it
+        /// \return nullptr if the chunk doesn't exist or couldn't be decoded
+        [[nodiscard]] std::shared_ptr<const map::column_summary>
+          load_summary(std::int32_t x, std::int32_t z, bool light = false);
+
+        /// Column summary of the blocks between two heights, see `map::summarize_chunk`. Chunks
+        /// already in the cache are summarised directly, otherwise only the sections in range
+        /// are decoded.
+        /// \return nullptr if the chunk doesn't exist or couldn't be decoded
+        [[nodiscard]] std::shared_ptr<const map::column_summary>
+          load_slice(std::int32_t x, std::int32_t z, std::int32_t top, std::int32_t bottom);
+
+        /// \param index_entities Whether to index the world's entities in the background, see
+        /// `entities`. It reads every region file, so only what needs the index asks for it.
+        /// Waits for the chunks and summaries being loaded on other threads, loads started after
+        /// this come from the new world
+        void set_world(const std::filesystem::path &world_folder, bool index_entities = false);
+
+        /// Reads the headers of the region files written since they were last read again, so a map
+        /// of a world that's still being played follows it. Chunks cached from those regions are
+        /// dropped. Call it from the thread that calls `set_world`.
+        /// \return Chunks saved, created or deleted since
+        [[nodiscard]] std::vector<glm::ivec2> refresh_regions();
+
+        [[nodiscard]] const std::filesystem::path &world_folder() const noexcept { return _world_folder; }
+
+        /// Changes every time a different world is opened, anything derived from chunks of an
+        /// older generation is stale
+        [[nodiscard]] std::uint32_t generation() const noexcept { return _generation; }
+
+        [[nodiscard]] summary_counts summary_lookups() const noexcept
+        {
+            return { _summaries_cached, _summaries_decoded };
+        }
+
+        /// Block entities and entities of the current world, indexed in the background if
+        /// `set_world` was asked to, empty otherwise
+        [[nodiscard]] const loader::entity_index &entities() const noexcept { return _entity_index; }
 
     private:
+        // Held shared while a chunk or summary is loaded and exclusively while the world changes,
+        // so nothing from one world ends up in the caches of the next
+        std::shared_mutex _world_mutex;
+
         std::filesystem::path _world_folder;
 
+        std::atomic<std::uint32_t> _generation = 0;
+
+        std::atomic<std::uint64_t> _summaries_cached  = 0;
+        std::atomic<std::uint64_t> _summaries_decoded = 0;
+
         vx3d::thread_pool _thread_pool;
 
         std::mutex                          _loaded_chunks_mutex;
         tsl::robin_map<std::uint64_t, vx3d::loader::chunk_location> _loaded_chunk_headers;
+        tsl::robin_map<std::uint64_t, std::shared_ptr<const loader::region_header>> _region_headers;
+        tsl::robin_map<std::uint64_t, std::filesystem::file_time_type>              _region_times;
+
+        vx3d::loader::chunk_cache _chunk_cache;
+
+        vx3d::loader::entity_index _entity_index;
+
+        vx3d::map::summary_store _summaries;
+
+        std::mutex                                                    _region_files_mutex;
+        tsl::robin_map<std::uint64_t, std::shared_ptr<const region_file>> _region_files;
     };
 }    // namespace vx3d
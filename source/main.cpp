@@ -1,12 +1,142 @@
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <string_view>
+
+#include <loader/entity_search.h>
+#include <map/world_export.h>
+#include <map/xyz_export.h>
+#include <renderer/camera_path.h>
+#include <renderer/map_export.h>
+#include <renderer/replay_benchmark.h>
 #include <ui/display.h>
+#include <voxel/dag_benchmark.h>
+#include <voxel/mesh_benchmark.h>
+#include <voxel/raycast_export.h>
+
+int main(int argc, char **argv) {
+    // vx3d --mesh-benchmark <world folder> [radius in chunks]
+    if (argc >= 3 && std::string_view(argv[1]) == "--mesh-benchmark")
+        return vx3d::voxel::run_mesh_benchmark(argv[2], argc >= 4 ? std::atoi(argv[3]) : 8);
+
+    // vx3d --dag-benchmark <world folder> [radius in regions]
+    if (argc >= 3 && std::string_view(argv[1]) == "--dag-benchmark")
+        return vx3d::voxel::run_dag_benchmark(argv[2], argc >= 4 ? std::atoi(argv[3]) : 1);
+
+    // vx3d --raycast <world folder> <output png> <x> <y> <z> <yaw> <pitch> [width] [height] [fov or
+    //   "ortho" and the height in blocks]
+    if (argc >= 9 && std::string_view(argv[1]) == "--raycast")
+    {
+        auto camera     = vx3d::voxel::camera();
+        camera.position = glm::vec3(std::atof(argv[4]), std::atof(argv[5]), std::atof(argv[6]));
+        camera.yaw      = static_cast<float>(std::atof(argv[7]));
+        camera.pitch    = static_cast<float>(std::atof(argv[8]));
+
+        auto options = vx3d::voxel::raycast_options();
+        if (argc >= 11) options.size = { std::atoi(argv[9]), std::atoi(argv[10]) };
+        if (argc >= 13 && std::string_view(argv[11]) == "ortho")
+        {
+            camera.orthographic = true;
+            camera.height       = static_cast<float>(std::atof(argv[12]));
+        }
+        else if (argc >= 12)
+            camera.fov = static_cast<float>(std::atof(argv[11]));
+        return vx3d::voxel::run_raycast_export(argv[2], argv[3], camera, options);
+    }
+
+    // vx3d --export <world folder> <output png> [width] [height] [blocks per pixel] [centre x] [centre z]
+    //   [rgba8|bc1]
+    if (argc >= 4 && std::string_view(argv[1]) == "--export")
+    {
+        auto options = vx3d::export_options();
+        if (argc >= 6) options.size = { std::atoi(argv[4]), std::atoi(argv[5]) };
+        if (argc >= 7) options.zoom = static_cast<float>(std::atof(argv[6]));
+        if (argc >= 9) options.centre = glm::vec2(std::atof(argv[7]), std::atof(argv[8]));
+        if (argc >= 10) options.compressed_tiles = std::string_view(argv[9]) == "bc1";
+        return vx3d::run_map_export(argv[2], argv[3], options);
+    }
+
+    // vx3d --export-world <world folder> <output png> [blocks per pixel] [min x] [min z] [max x] [max z]
+    if (argc >= 4 && std::string_view(argv[1]) == "--export-world")
+    {
+        auto options = vx3d::map::world_export_options();
+        if (argc >= 5) options.blocks_per_pixel = static_cast<std::uint32_t>(std::atoi(argv[4]));
+        if (argc >= 9)
+        {
+            options.whole_world = false;
+            options.min         = { std::atoi(argv[5]), std::atoi(argv[6]) };
+            options.max         = { std::atoi(argv[7]), std::atoi(argv[8]) };
+        }
+        return vx3d::map::run_world_export(argv[2], argv[3], options);
+    }
+
+    // vx3d --export-tiles <world folder> <output folder> [lowest zoom or "iso"]
+    if (argc >= 4 && std::string_view(argv[1]) == "--export-tiles")
+    {
+        auto options = vx3d::map::xyz_export_options();
+        if (argc >= 5 && std::string_view(argv[4]) == "iso")
+            options.isometric = true;
+        else if (argc >= 5)
+            options.min_zoom = static_cast<std::uint8_t>(std::atoi(argv[4]));
+        return vx3d::map::run_xyz_export(argv[2], argv[3], options);
+    }
+
+    // vx3d --find <world folder> <id> [min x] [min y] [min z] [max x] [max y] [max z]
+    if (argc >= 4 && std::string_view(argv[1]) == "--find")
+    {
+        // Everywhere, unless a box is given
+        auto min = glm::ivec3(std::numeric_limits<std::int32_t>::min());
+        auto max = glm::ivec3(std::numeric_limits<std::int32_t>::max());
+        if (argc >= 10)
+        {
+            min = { std::atoi(argv[4]), std::atoi(argv[5]), std::atoi(argv[6]) };
+            max = { std::atoi(argv[7]), std::atoi(argv[8]), std::atoi(argv[9]) };
+        }
+        return vx3d::loader::run_entity_search(argv[2], argv[3], min, max);
+    }
+
+    // vx3d --benchmark <world folder> [camera path or "survey"] [width] [height] [cold|warm]
+    if (argc >= 3 && std::string_view(argv[1]) == "--benchmark")
+    {
+        auto options = vx3d::replay_options();
+        auto camera  = std::filesystem::path();
+        if (argc >= 4 && std::string_view(argv[3]) != "survey") camera = argv[3];
+        if (argc >= 6) options.size = { std::atoi(argv[4]), std::atoi(argv[5]) };
+        if (argc >= 7) options.cold = std::string_view(argv[6]) == "cold";
+        return vx3d::run_replay_benchmark(argv[2], camera, options);
+    }
+
+    // vx3d --record-camera <camera path>, saves where the viewer looked for --benchmark on exit
+    const auto recording = argc >= 3 && std::string_view(argv[1]) == "--record-camera";
+    auto       camera    = vx3d::camera_path();
+
+    // Keys go by the clock, the loop waits up to half a second between frames while nothing moves
+    const auto start      = std::chrono::steady_clock::now();
+    auto       last_frame = std::chrono::steady_clock::rep(-1);
 
-int main() {
     auto world_loader = vx3d::world_loader();
     auto display = vx3d::ui::display(1920, 1080);
     auto renderer = vx3d::renderer();
+#ifdef VX3D_SHADER_HOT_RELOAD
+    renderer.watch_shaders(display.shared_context());
+#endif
 
     while (!display.should_close())
+    {
         display.render(world_loader, renderer);
+        const auto frame = (std::chrono::steady_clock::now() - start) / vx3d::camera_path::frame_interval;
+        if (recording && frame > last_frame)
+        {
+            camera.add(
+              display.view().zoom,
+              display.view().centre(display.view_size()),
+              static_cast<std::uint32_t>(frame - last_frame));
+            last_frame = frame;
+        }
+        display.wait(!renderer.idle());
+    }
+
+    if (recording && !camera.save(argv[2])) return 1;
 
     return 0;
 }
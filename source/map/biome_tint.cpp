@@ -0,0 +1,121 @@
+#include "biome_tint.h"
+
+#include <algorithm>
+
+#include <tracy/Tracy.hpp>
+
+
+namespace
+{
+    struct rgb
+    {
+        float r, g, b;
+    };
+
+    [[nodiscard]] rgb unpack(std::uint32_t color)
+    {
+        return { float((color >> 16) & 0xFF), float((color >> 8) & 0xFF), float(color & 0xFF) };
+    }
+
+    [[nodiscard]] std::uint32_t pack(rgb color)
+    {
+        const auto channel = [](float value)
+        { return static_cast<std::uint32_t>(std::clamp(value + 0.5f, 0.0f, 255.0f)); };
+        return channel(color.r) << 16 | channel(color.g) << 8 | channel(color.b);
+    }
+
+    // The game samples a triangular colormap texture by temperature and downfall, this blends
+    // between the colours at its three corners instead
+    [[nodiscard]] std::uint32_t colormap(
+      float         temperature,
+      float         downfall,
+      std::uint32_t hot_wet,
+      std::uint32_t hot_dry,
+      std::uint32_t cold)
+    {
+        const auto t = std::clamp(temperature, 0.0f, 1.0f);
+        const auto d = std::clamp(downfall, 0.0f, 1.0f) * t;
+
+        const auto a = unpack(hot_wet);
+        const auto b = unpack(hot_dry);
+        const auto c = unpack(cold);
+
+        return pack({ a.r * d + b.r * (t - d) + c.r * (1.0f - t),
+                      a.g * d + b.g * (t - d) + c.g * (1.0f - t),
+                      a.b * d + b.b * (t - d) + c.b * (1.0f - t) });
+    }
+
+    [[nodiscard]] bool is_any_of(std::string_view name, std::initializer_list<std::string_view> names)
+    {
+        return std::find(names.begin(), names.end(), name) != names.end();
+    }
+}    // namespace
+
+vx3d::map::biome_tint_table::biome_tint_table()
+{
+    ZoneScopedN("BiomeTintTable::creation");
+    using loader::tint_type;
+
+    for (auto id = 0; id < 256; id++)
+    {
+        const auto  biome = static_cast<loader::biome_id>(id);
+        const auto &info  = loader::biomes::info(biome);
+
+        auto grass   = ::colormap(info.temperature, info.downfall, 0x47CD33, 0xBFB755, 0x80B497);
+        auto foliage = ::colormap(info.temperature, info.downfall, 0x1ABF00, 0xAEA42A, 0x60A17B);
+
+        if (::is_any_of(info.name, { "swamp", "swamp_hills" }))
+            grass = foliage = 0x6A7039;
+        else if (info.name == "mangrove_swamp")
+        {
+            grass   = 0x6A7039;
+            foliage = 0x8DB127;
+        }
+        else if (::is_any_of(info.name, { "dark_forest", "dark_forest_hills" }))
+            grass = ((grass & 0xFEFEFE) + 0x28340A) >> 1;
+        else if (::is_any_of(
+                   info.name,
+                   { "badlands",
+                     "wooded_badlands",
+                     "badlands_plateau",
+                     "eroded_badlands",
+                     "modified_wooded_badlands_plateau",
+                     "modified_badlands_plateau" }))
+        {
+            grass   = 0x90814D;
+            foliage = 0x9E814D;
+        }
+        else if (info.name == "cherry_grove")
+            grass = foliage = 0xB6DB61;
+        else if (info.name == "pale_garden")
+        {
+            grass   = 0x778272;
+            foliage = 0x878D76;
+        }
+
+        _colors[static_cast<std::size_t>(tint_type::none) << 8 | id]    = make_rgba(0xFFFFFF);
+        _colors[static_cast<std::size_t>(tint_type::grass) << 8 | id]   = make_rgba(grass);
+        _colors[static_cast<std::size_t>(tint_type::foliage) << 8 | id] = make_rgba(foliage);
+        _colors[static_cast<std::size_t>(tint_type::water) << 8 | id]   = make_rgba(info.water);
+    }
+}
+
+const vx3d::map::biome_tint_table &vx3d::map::biome_tint_table::get()
+{
+    static const auto table = biome_tint_table();
+    return table;
+}
+
+void vx3d::map::biome_tint_table::apply(
+  rgba *                  pixels,
+  const loader::biome_id *biomes,
+  const loader::tint_type *tints) const noexcept
+{
+    ZoneScopedN("BiomeTintTable::apply");
+
+    // Multiplying by white is exact, so untinted columns go through the same path branch free
+    auto factors = std::array<rgba, tile_pixels>();
+    for (auto i = 0; i < tile_pixels; i++) factors[i] = color(tints[i], biomes[i]);
+
+    multiply_tile(pixels, factors.data());
+}
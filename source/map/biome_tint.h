@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <loader/blocks.h>
+#include <loader/biomes.h>
+#include <map/tile_ops.h>
+
+namespace vx3d::map
+{
+    // Grass, foliage and water colours of every biome, computed once from the biome climate
+    class biome_tint_table
+    {
+    public:
+        biome_tint_table();
+
+        [[nodiscard]] static const biome_tint_table &get();
+
+        [[nodiscard]] rgba color(loader::tint_type tint, loader::biome_id biome) const noexcept
+        {
+            return _colors[static_cast<std::size_t>(tint) << 8 | biome];
+        }
+
+        /// Multiplies every pixel of a 16x16 tile by the tint of its column, columns without a
+        /// tint are left untouched
+        /// \param pixels 256 pixels, z * 16 + x
+        /// \param biomes The biome of every column
+        /// \param tints What kind of tint the visible block of every column takes
+        void apply(rgba *pixels, const loader::biome_id *biomes, const loader::tint_type *tints)
+          const noexcept;
+
+    private:
+        // tint_type::none maps to white so it multiplies to the same colour
+        std::array<rgba, 4 * 256> _colors;
+    };
+}    // namespace vx3d::map
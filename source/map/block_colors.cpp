@@ -0,0 +1,251 @@
+#include "block_colors.h"
+
+#include <algorithm>
+#include <string_view>
+
+namespace
+{
+    struct named_color
+    {
+        std::string_view name;
+        std::uint32_t    rgb;
+    };
+
+    // Exact matches, checked before any of the patterns below
+    constexpr named_color exact_colors[] = {
+      { "stone", 0x7D7D7D },
+      { "granite", 0x956756 },
+      { "polished_granite", 0x9A6A59 },
+      { "diorite", 0xBCBCBC },
+      { "polished_diorite", 0xC0C1C2 },
+      { "andesite", 0x888888 },
+      { "polished_andesite", 0x848686 },
+      { "deepslate", 0x505053 },
+      { "cobbled_deepslate", 0x4D4D50 },
+      { "tuff", 0x6C6D66 },
+      { "calcite", 0xDFE0DC },
+      { "cobblestone", 0x7A7A7A },
+      { "mossy_cobblestone", 0x6E775F },
+      { "bedrock", 0x555555 },
+      { "grass_block", 0xA0A0A0 },
+      { "dirt", 0x866043 },
+      { "coarse_dirt", 0x77553B },
+      { "rooted_dirt", 0x90684D },
+      { "podzol", 0x5B3F18 },
+      { "mycelium", 0x6F6265 },
+      { "dirt_path", 0x947A41 },
+      { "farmland", 0x52301A },
+      { "mud", 0x3C393D },
+      { "clay", 0xA0A6B3 },
+      { "gravel", 0x847F7E },
+      { "sand", 0xDBCFA3 },
+      { "red_sand", 0xBE6621 },
+      { "sandstone", 0xD8CB9B },
+      { "red_sandstone", 0xBA631D },
+      { "snow", 0xF9FEFE },
+      { "snow_block", 0xF9FEFE },
+      { "powder_snow", 0xF8FDFD },
+      { "ice", 0x91B7FD },
+      { "packed_ice", 0x8DB4FA },
+      { "blue_ice", 0x74A7FD },
+      { "water", 0xD0D0D0 },
+      { "bubble_column", 0xD0D0D0 },
+      { "lava", 0xCF5B14 },
+      { "obsidian", 0x0F0B19 },
+      { "crying_obsidian", 0x210A3C },
+      { "netherrack", 0x622626 },
+      { "nether_bricks", 0x2C1518 },
+      { "soul_sand", 0x513E32 },
+      { "soul_soil", 0x4B3A2E },
+      { "basalt", 0x505155 },
+      { "blackstone", 0x2A2328 },
+      { "glowstone", 0xAB8354 },
+      { "magma_block", 0x8E3F1F },
+      { "crimson_nylium", 0x831F1F },
+      { "warped_nylium", 0x2B7265 },
+      { "nether_wart_block", 0x722B0D },
+      { "warped_wart_block", 0x167E86 },
+      { "shroomlight", 0xF09246 },
+      { "end_stone", 0xDBDE9E },
+      { "purpur_block", 0xA97DA9 },
+      { "chorus_plant", 0x5D395D },
+      { "chorus_flower", 0x977C97 },
+      { "coal_ore", 0x737373 },
+      { "iron_ore", 0x88817B },
+      { "gold_ore", 0x8F8C7D },
+      { "diamond_ore", 0x7D8E8D },
+      { "redstone_ore", 0x856B6B },
+      { "lapis_ore", 0x667086 },
+      { "emerald_ore", 0x75886F },
+      { "copper_ore", 0x7C7D78 },
+      { "iron_block", 0xDCDCDC },
+      { "gold_block", 0xF6D03D },
+      { "diamond_block", 0x62EDE4 },
+      { "emerald_block", 0x2ACB57 },
+      { "lapis_block", 0x1F438C },
+      { "redstone_block", 0xAF1805 },
+      { "coal_block", 0x101010 },
+      { "copper_block", 0xC06C50 },
+      { "netherite_block", 0x423D3F },
+      { "bricks", 0x976253 },
+      { "stone_bricks", 0x7A7979 },
+      { "mossy_stone_bricks", 0x737969 },
+      { "mud_bricks", 0x89684F },
+      { "prismarine", 0x639C97 },
+      { "dark_prismarine", 0x335B4B },
+      { "sea_lantern", 0xACC7BE },
+      { "sponge", 0xC3C04A },
+      { "wet_sponge", 0xAAB446 },
+      { "pumpkin", 0xC6761C },
+      { "carved_pumpkin", 0xC6761C },
+      { "jack_o_lantern", 0xD79A31 },
+      { "melon", 0x6F9118 },
+      { "hay_block", 0xA68B0C },
+      { "cactus", 0x5B8C2C },
+      { "bamboo", 0x5D9012 },
+      { "sugar_cane", 0xAAAAAA },
+      { "lily_pad", 0x208030 },
+      { "kelp", 0x57822B },
+      { "kelp_plant", 0x57822B },
+      { "seagrass", 0x32690F },
+      { "tall_seagrass", 0x32690F },
+      { "vine", 0x6A6A6A },
+      { "moss_block", 0x596D2D },
+      { "moss_carpet", 0x596D2D },
+      { "azalea_leaves", 0x5A7328 },
+      { "flowering_azalea_leaves", 0x646F3D },
+      { "spruce_leaves", 0x3D5E3D },
+      { "birch_leaves", 0x5A7D3F },
+      { "cherry_leaves", 0xE5ADC2 },
+      { "dripstone_block", 0x866B5C },
+      { "pointed_dripstone", 0x866B5C },
+      { "amethyst_block", 0x8562BF },
+      { "sculk", 0x0D1E24 },
+      { "bookshelf", 0x6B5839 },
+      { "crafting_table", 0x81603A },
+      { "furnace", 0x6E6E6E },
+      { "chest", 0x9C6E23 },
+      { "trapped_chest", 0x9C6E23 },
+      { "tnt", 0xDB441A },
+      { "torch", 0xFFD800 },
+      { "wall_torch", 0xFFD800 },
+      { "redstone_wire", 0x8F0000 },
+      { "rail", 0x7D6F57 },
+      { "brown_mushroom", 0x9A7559 },
+      { "red_mushroom", 0xD94B44 },
+      { "brown_mushroom_block", 0x957051 },
+      { "red_mushroom_block", 0xC82E2D },
+      { "dandelion", 0xFFEC4F },
+      { "poppy", 0xED302C },
+      { "cornflower", 0x466AEB },
+      { "sunflower", 0xF6C52F },
+      { "dead_bush", 0x6B4F29 },
+      { "cobweb", 0xE4E9EA },
+      { "glass", 0xDAF0F4 },
+      { "tinted_glass", 0x2C2630 },
+      { "slime_block", 0x6FC05B },
+      { "honey_block", 0xFBB936 },
+      { "quartz_block", 0xECE6DF },
+      { "smooth_stone", 0x9E9E9E },
+      { "terracotta", 0x985E44 },
+      { "nether_quartz_ore", 0x75413E },
+      { "ancient_debris", 0x5F4037 },
+    };
+
+    // Blocks named "<wood>_something" take the colour of their planks, logs are looked at from
+    // the top so they show their rings
+    constexpr named_color wood_colors[] = {
+      { "oak", 0xA2834F },         { "spruce", 0x735531 },   { "birch", 0xC0AF79 },
+      { "jungle", 0xA07351 },      { "acacia", 0xA85A32 },   { "dark_oak", 0x432B14 },
+      { "mangrove", 0x773631 },    { "cherry", 0xE2B2AC },   { "bamboo", 0xC1AD50 },
+      { "crimson", 0x653147 },     { "warped", 0x2B6963 },   { "pale_oak", 0xE4D9D6 },
+    };
+
+    // Wool, concrete, terracotta, glass and everything else that comes in the sixteen dyes
+    constexpr named_color dye_colors[] = {
+      { "white", 0xE9ECEC },     { "orange", 0xF07613 },     { "magenta", 0xBD44B3 },
+      { "light_blue", 0x3AAFD9 }, { "yellow", 0xF8C527 },    { "lime", 0x70B919 },
+      { "pink", 0xED8DAC },      { "gray", 0x3E4447 },       { "light_gray", 0x8E8E86 },
+      { "cyan", 0x158991 },      { "purple", 0x792AAC },     { "blue", 0x35399D },
+      { "brown", 0x724728 },     { "green", 0x546D1B },      { "red", 0xA12722 },
+      { "black", 0x141519 },
+    };
+
+    // Anything that's still unknown falls back on what its name contains
+    constexpr named_color pattern_colors[] = {
+      { "leaves", 0x8A8A8A },    { "grass", 0x9A9A9A },      { "fern", 0x8A8A8A },
+      { "deepslate", 0x4F4F52 }, { "blackstone", 0x2A2328 }, { "sandstone", 0xD8CB9B },
+      { "quartz", 0xECE6DF },    { "prismarine", 0x639C97 }, { "purpur", 0xA97DA9 },
+      { "end_stone", 0xDBDE9E }, { "nether_brick", 0x2C1518 }, { "copper", 0xC06C50 },
+      { "mud_brick", 0x89684F }, { "stone", 0x7D7D7D },      { "brick", 0x976253 },
+      { "ore", 0x7F7F7F },       { "coral", 0xC85A88 },      { "tulip", 0xD06A3A },
+      { "mushroom", 0x9A7559 },  { "sapling", 0x477A21 },    { "rail", 0x7D6F57 },
+      { "glass", 0xDAF0F4 },     { "ice", 0x91B7FD },        { "snow", 0xF9FEFE },
+      { "sand", 0xDBCFA3 },      { "dirt", 0x866043 },       { "nylium", 0x5B2C3C },
+    };
+
+    constexpr auto fallback_color = std::uint32_t(0x7F7F7F);
+
+    [[nodiscard]] bool starts_with(std::string_view text, std::string_view prefix)
+    {
+        return text.substr(0, prefix.size()) == prefix;
+    }
+
+    [[nodiscard]] std::uint32_t resolve(std::string_view name)
+    {
+        name = name.substr(name.find(':') + 1);
+
+        for (const auto &entry : exact_colors)
+            if (entry.name == name) return entry.rgb;
+
+        // "light_gray" has to win over "gray", so the longest matching dye is taken
+        const named_color *dye = nullptr;
+        for (const auto &entry : dye_colors)
+            if (::starts_with(name, entry.name) && name.size() > entry.name.size() &&
+                name[entry.name.size()] == '_' && (!dye || entry.name.size() > dye->name.size()))
+                dye = &entry;
+
+        if (dye)
+        {
+            // Terracotta and concrete powder are duller than the dye itself
+            const auto rest = name.substr(dye->name.size() + 1);
+            if (rest == "terracotta" || rest == "glazed_terracotta" || rest == "concrete_powder")
+                return ((dye->rgb & 0xFEFEFE) >> 1) + ((0x985E44 & 0xFEFEFE) >> 1);
+            return dye->rgb;
+        }
+
+        const named_color *wood = nullptr;
+        for (const auto &entry : wood_colors)
+            if (::starts_with(name, entry.name) && name.size() > entry.name.size() &&
+                name[entry.name.size()] == '_' && (!wood || entry.name.size() > wood->name.size()))
+                wood = &entry;
+
+        if (wood && name.find("leaves") == std::string_view::npos) return wood->rgb;
+
+        for (const auto &entry : pattern_colors)
+            if (name.find(entry.name) != std::string_view::npos) return entry.rgb;
+
+        return fallback_color;
+    }
+}    // namespace
+
+const vx3d::map::block_color_table &vx3d::map::block_color_table::get()
+{
+    static const auto table = block_color_table();
+    return table;
+}
+
+vx3d::map::rgba vx3d::map::block_color_table::color(loader::block_id id) const noexcept
+{
+    if (id >= _colors.size()) return make_rgba(fallback_color);
+
+    if (const auto cached = _colors[id].load(std::memory_order_relaxed)) return cached;
+
+    const auto &info = loader::block_registry::info(id);
+    if (info.is_air()) return 0;
+
+    // Racing threads resolve the same colour, whichever store lands is fine
+    const auto resolved = make_rgba(::resolve(info.name));
+    _colors[id].store(resolved, std::memory_order_relaxed);
+    return resolved;
+}
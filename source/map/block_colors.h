@@ -0,0 +1,26 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <loader/blocks.h>
+#include <map/tile_ops.h>
+
+namespace vx3d::map
+{
+    // Top down colour of every block, roughly the average of its top texture. Blocks that take a
+    // biome tint are grey so the tint multiplies onto them, air is fully transparent.
+    class block_color_table
+    {
+    public:
+        [[nodiscard]] static const block_color_table &get();
+
+        /// Resolved the first time a block is asked for and cached from then on, lock free
+        [[nodiscard]] rgba color(loader::block_id id) const noexcept;
+
+    private:
+        // 0 until resolved, every resolved colour is opaque so it can't be mistaken for that
+        mutable std::array<std::atomic<rgba>, loader::block_registry::max_blocks> _colors {};
+    };
+}    // namespace vx3d::map
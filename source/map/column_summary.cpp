@@ -0,0 +1,317 @@
+#include "column_summary.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <tracy/Tracy.hpp>
+
+#include <map/light_shading.h>
+#include <util/cache_path.h>
+
+namespace
+{
+    constexpr auto summary_magic   = std::uint32_t(0x53435856);    // "VXCS"
+    constexpr auto summary_version = std::uint32_t(2);
+
+    [[nodiscard]] std::int32_t key_x(std::uint64_t key) noexcept
+    {
+        return static_cast<std::int32_t>(key >> 32);
+    }
+
+    [[nodiscard]] std::int32_t key_z(std::uint64_t key) noexcept
+    {
+        return static_cast<std::int32_t>(key & 0xFFFFFFFF);
+    }
+
+    template<typename T>
+    void write_value(std::ofstream &out, const T &value)
+    {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    [[nodiscard]] bool read_value(std::ifstream &in, T &value)
+    {
+        return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+    }
+}    // namespace
+
+vx3d::map::column_summary
+  vx3d::map::summarize_chunk(const loader::chunk &chunk, std::int32_t top, std::int32_t bottom)
+{
+    ZoneScopedN("ColumnSummary::summarize_chunk");
+    using loader::block_registry;
+
+    auto summary         = column_summary();
+    summary.x            = chunk.x;
+    summary.z            = chunk.z;
+    summary.data_version = chunk.data_version;
+
+    constexpr auto see_through =
+      loader::block_flag_air | loader::block_flag_water | loader::block_flag_aquatic |
+      loader::block_flag_passable;
+
+    const auto below = top == std::numeric_limits<std::int32_t>::max() ? top : top + 1;
+
+    for (auto z = 0; z < 16; z++)
+        for (auto x = 0; x < 16; x++)
+        {
+            const auto column  = z * 16 + x;
+            const auto surface = chunk.highest_block(x, z, below);
+            if (surface == loader::chunk::no_block || surface < bottom)
+            {
+                summary.surface_height[column] = column_summary::no_surface;
+                summary.floor_height[column]   = column_summary::no_surface;
+                continue;
+            }
+
+            const auto surface_block = chunk.block_at(x, surface, z);
+            auto       floor         = surface;
+            if (block_registry::info(surface_block).flags & see_through)
+                floor = chunk.highest_block(x, z, surface, see_through);
+            if (floor < bottom) floor = loader::chunk::no_block;
+
+            summary.surface_block[column]  = surface_block;
+            summary.surface_height[column] = static_cast<std::int16_t>(surface);
+            summary.floor_block[column] =
+              floor == loader::chunk::no_block ? block_registry::air : chunk.block_at(x, floor, z);
+            summary.floor_height[column] = floor == loader::chunk::no_block
+              ? column_summary::no_surface
+              : static_cast<std::int16_t>(floor);
+        }
+
+    if (chunk.decoded & loader::decode_flag_light)
+    {
+        const auto light    = sample_surface_light(chunk);
+        summary.lit         = true;
+        summary.sky_light   = light.sky;
+        summary.block_light = light.block;
+        summary.spawnable   = light.spawnable;
+    }
+    else
+        summary.sky_light.fill(15);
+
+    if (chunk.biomes.empty())
+        summary.biome.fill(loader::biomes::plains);
+    else
+        chunk.biomes.surface(summary.surface_height, summary.biome);
+
+    return summary;
+}
+
+vx3d::map::summary_store::summary_store(std::size_t max_regions)
+    : _max_regions(std::max<std::size_t>(max_regions, 1))
+{
+}
+
+vx3d::map::summary_store::~summary_store()
+{
+    flush();
+}
+
+void vx3d::map::summary_store::open(const std::filesystem::path &world_folder)
+{
+    flush();
+
+    auto guard = std::lock_guard(_mutex);
+    _regions.clear();
+    _world_folder = world_folder;
+}
+
+std::shared_ptr<const vx3d::map::column_summary>
+  vx3d::map::summary_store::find(std::int32_t x, std::int32_t z, std::uint32_t time_stamp)
+{
+    auto        guard  = std::lock_guard(_mutex);
+    const auto &chunks = _region(x >> 5, z >> 5).chunks;
+
+    const auto at = chunks.find(loader::position_key(x, z));
+    if (at == chunks.end() || at->second->time_stamp != time_stamp) return nullptr;
+    return at->second;
+}
+
+void vx3d::map::summary_store::insert(std::shared_ptr<const column_summary> summary)
+{
+    auto  guard  = std::lock_guard(_mutex);
+    auto &region = _region(summary->x >> 5, summary->z >> 5);
+    region.chunks[loader::position_key(summary->x, summary->z)] = std::move(summary);
+    region.dirty                                 = true;
+}
+
+void vx3d::map::summary_store::flush()
+{
+    ZoneScopedN("SummaryStore::flush");
+    auto guard = std::lock_guard(_mutex);
+    for (auto at = _regions.begin(); at != _regions.end(); ++at)
+    {
+        if (!at->second.dirty) continue;
+        _save(at->first, at->second);
+        at.value().dirty = false;
+    }
+}
+
+vx3d::map::summary_store::region &
+  vx3d::map::summary_store::_region(std::int32_t region_x, std::int32_t region_z)
+{
+    const auto region_key = loader::position_key(region_x, region_z);
+    if (auto at = _regions.find(region_key); at != _regions.end())
+    {
+        at.value().last_used = ++_clock;
+        return at.value();
+    }
+
+    // Only the regions in use are kept around, the least recently used one goes back to disk
+    if (_regions.size() >= _max_regions)
+    {
+        auto oldest = _regions.begin();
+        for (auto at = _regions.begin(); at != _regions.end(); ++at)
+            if (at->second.last_used < oldest->second.last_used) oldest = at;
+
+        if (oldest->second.dirty) _save(oldest->first, oldest->second);
+        _regions.erase(oldest);
+    }
+
+    auto loaded      = region();
+    loaded.last_used = ++_clock;
+    _load(region_x, region_z, loaded);
+    return _regions.insert({ region_key, std::move(loaded) }).first.value();
+}
+
+std::filesystem::path
+  vx3d::map::summary_store::_path(std::int32_t region_x, std::int32_t region_z) const
+{
+    if (_world_folder.empty()) return {};
+    return vx3d::cache::world_file(
+      _world_folder,
+      "summary." + std::to_string(region_x) + "." + std::to_string(region_z) + ".bin");
+}
+
+void vx3d::map::summary_store::_load(std::int32_t region_x, std::int32_t region_z, region &into) const
+{
+    ZoneScopedN("SummaryStore::load");
+    const auto path = _path(region_x, region_z);
+    if (path.empty()) return;
+
+    auto in = std::ifstream(path, std::ios::binary);
+    if (!in) return;
+
+    auto magic   = std::uint32_t(0);
+    auto version = std::uint32_t(0);
+    if (!::read_value(in, magic) || !::read_value(in, version) || magic != summary_magic ||
+        version != summary_version)
+        return;
+
+    // Block ids only live as long as the process, so the file carries the names they stood for
+    auto name_count = std::uint32_t(0);
+    if (!::read_value(in, name_count)) return;
+    auto remap = std::vector<loader::block_id>(name_count);
+    for (auto &id : remap)
+    {
+        auto length = std::uint16_t(0);
+        if (!::read_value(in, length)) return;
+        auto name = std::string(length, '\0');
+        if (!in.read(name.data(), length)) return;
+        id = loader::block_registry::intern(name);
+    }
+
+    auto count = std::uint32_t(0);
+    if (!::read_value(in, count)) return;
+
+    auto chunks = decltype(into.chunks)();
+    for (auto i = std::uint32_t(0); i < count; i++)
+    {
+        auto summary = std::make_shared<column_summary>();
+        if (!::read_value(in, summary->x) || !::read_value(in, summary->z) ||
+            !::read_value(in, summary->data_version) || !::read_value(in, summary->time_stamp) ||
+            !::read_value(in, summary->surface_block) || !::read_value(in, summary->surface_height) ||
+            !::read_value(in, summary->floor_block) || !::read_value(in, summary->floor_height) ||
+            !::read_value(in, summary->biome) || !::read_value(in, summary->lit) ||
+            !::read_value(in, summary->sky_light) || !::read_value(in, summary->block_light) ||
+            !::read_value(in, summary->spawnable))
+            return;
+
+        for (auto *blocks : { &summary->surface_block, &summary->floor_block })
+            for (auto &block : *blocks)
+            {
+                if (block >= remap.size()) return;
+                block = remap[block];
+            }
+
+        chunks.insert({ loader::position_key(summary->x, summary->z), std::move(summary) });
+    }
+
+    into.chunks = std::move(chunks);
+}
+
+void vx3d::map::summary_store::_save(std::uint64_t region_key, const region &from) const
+{
+    ZoneScopedN("SummaryStore::save");
+    const auto path = _path(::key_x(region_key), ::key_z(region_key));
+    if (path.empty()) return;
+
+    auto names  = std::vector<loader::block_id>();
+    auto local  = tsl::robin_map<loader::block_id, loader::block_id>();
+    const auto to_local = [&](loader::block_id id)
+    {
+        auto at = local.find(id);
+        if (at == local.end())
+        {
+            at = local.insert({ id, static_cast<loader::block_id>(names.size()) }).first;
+            names.push_back(id);
+        }
+        return at->second;
+    };
+
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+        auto out = std::ofstream(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) return;
+
+        // Remapped up front, the name table has to come before the summaries
+        auto remapped = std::vector<column_summary>();
+        remapped.reserve(from.chunks.size());
+        for (const auto &[chunk_key, summary] : from.chunks)
+        {
+            auto &copy = remapped.emplace_back(*summary);
+            for (auto *blocks : { &copy.surface_block, &copy.floor_block })
+                for (auto &block : *blocks) block = to_local(block);
+        }
+
+        ::write_value(out, summary_magic);
+        ::write_value(out, summary_version);
+        ::write_value(out, static_cast<std::uint32_t>(names.size()));
+        for (const auto id : names)
+        {
+            const auto &name = loader::block_registry::info(id).name;
+            ::write_value(out, static_cast<std::uint16_t>(name.size()));
+            out.write(name.data(), static_cast<std::streamsize>(name.size()));
+        }
+
+        ::write_value(out, static_cast<std::uint32_t>(remapped.size()));
+        for (const auto &summary : remapped)
+        {
+            ::write_value(out, summary.x);
+            ::write_value(out, summary.z);
+            ::write_value(out, summary.data_version);
+            ::write_value(out, summary.time_stamp);
+            ::write_value(out, summary.surface_block);
+            ::write_value(out, summary.surface_height);
+            ::write_value(out, summary.floor_block);
+            ::write_value(out, summary.floor_height);
+            ::write_value(out, summary.biome);
+            ::write_value(out, summary.lit);
+            ::write_value(out, summary.sky_light);
+            ::write_value(out, summary.block_light);
+            ::write_value(out, summary.spawnable);
+        }
+
+        if (!out) return;
+    }
+
+    auto error = std::error_code();
+    std::filesystem::rename(temporary, path, error);
+    if (error) std::cerr << "Couldn't write column summaries: " << error.message() << std::endl;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+#include <tsl/robin_map.h>
+
+#include <loader/chunk.h>
+#include <map/tile_ops.h>
+
+namespace vx3d::map
+{
+    // Everything the 2D map views need from a chunk, one entry per column (z * 16 + x), so they
+    // never have to touch the chunk or its NBT again
+    struct column_summary
+    {
+        static constexpr std::int16_t no_surface = std::numeric_limits<std::int16_t>::min();
+
+        std::int32_t  x            = 0;
+        std::int32_t  z            = 0;
+        std::int32_t  data_version = 0;
+        std::uint32_t time_stamp   = 0;    // Of the chunk in its region file, when it was summarised
+
+        // Highest visible block, water and plants included
+        std::array<loader::block_id, tile_pixels> surface_block {};
+        std::array<std::int16_t, tile_pixels>     surface_height {};
+
+        // Highest block that isn't water, plants or air, the surface itself on dry land
+        std::array<loader::block_id, tile_pixels> floor_block {};
+        std::array<std::int16_t, tile_pixels>     floor_height {};
+
+        std::array<loader::biome_id, tile_pixels> biome {};
+
+        // Light above the highest solid block, see `sample_surface_light`. Made up (full sky light
+        // and no block light) unless `lit`, the chunk has to be decoded with light for it.
+        bool                                  lit = false;
+        std::array<std::uint8_t, tile_pixels> sky_light {};
+        std::array<std::uint8_t, tile_pixels> block_light {};
+        std::array<bool, tile_pixels>         spawnable {};
+
+        [[nodiscard]] std::int32_t water_depth(std::int32_t column) const noexcept
+        {
+            return surface_height[column] - floor_height[column];
+        }
+    };
+
+    /// Summarises every column of a chunk, optionally only looking at a range of heights. The
+    /// surface is then the highest block at or below `top`, which shows caves and the inside of
+    /// the nether, or a horizontal slice when `top` and `bottom` are the same.
+    /// \param chunk Light is only filled in if decoded with `decode_flag_light`
+    [[nodiscard]] column_summary summarize_chunk(
+      const loader::chunk &chunk,
+      std::int32_t         top    = std::numeric_limits<std::int32_t>::max(),
+      std::int32_t         bottom = std::numeric_limits<std::int32_t>::min());
+
+    // Column summaries of a world, kept per region in memory and persisted to the cache directory
+    // with the chunk time stamps they were made from. Safe to use from any thread.
+    class summary_store
+    {
+    public:
+        explicit summary_store(std::size_t max_regions = 64);
+
+        ~summary_store();
+
+        /// Flushes the current world and switches to another one, an empty path closes the store
+        void open(const std::filesystem::path &world_folder);
+
+        /// \return The summary if one was made from the chunk as it's stored at `time_stamp`
+        [[nodiscard]] std::shared_ptr<const column_summary>
+          find(std::int32_t x, std::int32_t z, std::uint32_t time_stamp);
+
+        void insert(std::shared_ptr<const column_summary> summary);
+
+        /// Writes every region with new summaries to disk
+        void flush();
+
+    private:
+        struct region
+        {
+            tsl::robin_map<std::uint64_t, std::shared_ptr<const column_summary>> chunks;
+            std::uint64_t last_used = 0;
+            bool          dirty     = false;
+        };
+
+        [[nodiscard]] region &_region(std::int32_t region_x, std::int32_t region_z);
+
+        [[nodiscard]] std::filesystem::path _path(std::int32_t region_x, std::int32_t region_z) const;
+
+        void _load(std::int32_t region_x, std::int32_t region_z, region &into) const;
+
+        void _save(std::uint64_t key, const region &from) const;
+
+        std::mutex _mutex;
+
+        std::filesystem::path _world_folder;
+        std::size_t           _max_regions;
+        std::uint64_t         _clock = 0;
+
+        tsl::robin_map<std::uint64_t, region> _regions;
+    };
+}    // namespace vx3d::map
@@ -0,0 +1,158 @@
+#include "header_overlay.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include <tracy/Tracy.hpp>
+
+namespace
+{
+    constexpr auto seconds_per_day = 86400.0f;
+
+    // Scores of the oversized overlay, 0 is left for pixels without a chunk
+    constexpr auto score_small    = std::uint8_t(1);
+    constexpr auto score_over     = std::uint8_t(200);
+    constexpr auto score_external = std::uint8_t(255);
+
+    // Cold to hot, the higher a chunk scores the more it stands out
+    constexpr auto age_ramp = std::array<vx3d::map::rgba, 3>({
+      vx3d::map::make_rgba(0x1B2A49),
+      vx3d::map::make_rgba(0xC2416B),
+      vx3d::map::make_rgba(0xF9E14B),
+    });
+    constexpr auto size_ramp = std::array<vx3d::map::rgba, 3>({
+      vx3d::map::make_rgba(0x1A9850),
+      vx3d::map::make_rgba(0xFEE08B),
+      vx3d::map::make_rgba(0xD73027),
+    });
+    constexpr auto oversized_colors = std::array<vx3d::map::rgba, 3>({
+      vx3d::map::make_rgba(0x3A3A3A),
+      vx3d::map::make_rgba(0xFF8C00),
+      vx3d::map::make_rgba(0xFF00FF),
+    });
+
+    [[nodiscard]] vx3d::map::rgba lerp(vx3d::map::rgba a, vx3d::map::rgba b, float t) noexcept
+    {
+        auto mixed = vx3d::map::rgba(0);
+        for (auto shift = 0; shift < 32; shift += 8)
+        {
+            const auto from  = static_cast<float>((a >> shift) & 0xFF);
+            const auto to    = static_cast<float>((b >> shift) & 0xFF);
+            const auto value = static_cast<std::uint32_t>(from + (to - from) * t + 0.5f);
+            mixed |= std::min(value, 255u) << shift;
+        }
+        return mixed;
+    }
+
+    [[nodiscard]] vx3d::map::rgba
+      ramp(const std::array<vx3d::map::rgba, 3> &stops, std::uint8_t score) noexcept
+    {
+        const auto t = static_cast<float>(score - 1) / 254.0f;
+        return t < 0.5f ? ::lerp(stops[0], stops[1], t * 2.0f)
+                        : ::lerp(stops[1], stops[2], t * 2.0f - 1.0f);
+    }
+
+    // 1 to 255, how much a chunk stands out in a mode
+    [[nodiscard]] std::uint8_t score(
+      vx3d::map::tile_mode                 mode,
+      const vx3d::map::overlay_settings &  settings,
+      const vx3d::loader::region_header &  header,
+      int                                  index) noexcept
+    {
+        using vx3d::map::tile_mode;
+
+        const auto sectors = header.sectors[index];
+        switch (mode)
+        {
+        case tile_mode::age:
+        {
+            // Saved today is hottest, a few years back is as cold as it gets
+            const auto saved = header.time_stamps[index];
+            const auto days =
+              saved < settings.now ? static_cast<float>(settings.now - saved) / ::seconds_per_day : 0.0f;
+            const auto value = 255.0f - std::log2(1.0f + days) * 24.0f;
+            return static_cast<std::uint8_t>(std::clamp(value, 1.0f, 255.0f));
+        }
+        case tile_mode::size:
+        {
+            if (header.external[index]) return 255;
+            const auto value = std::log2(static_cast<float>(sectors)) * 32.0f + 1.0f;
+            return static_cast<std::uint8_t>(std::clamp(value, 1.0f, 255.0f));
+        }
+        case tile_mode::oversized:
+            if (header.external[index]) return ::score_external;
+            return sectors >= settings.size_threshold ? ::score_over : ::score_small;
+        default: return 0;
+        }
+    }
+
+    [[nodiscard]] vx3d::map::rgba color(vx3d::map::tile_mode mode, std::uint8_t score) noexcept
+    {
+        using vx3d::map::tile_mode;
+
+        if (score == 0) return 0;
+        switch (mode)
+        {
+        case tile_mode::age: return ::ramp(::age_ramp, score);
+        case tile_mode::size: return ::ramp(::size_ramp, score);
+        case tile_mode::oversized:
+            return score == ::score_external ? ::oversized_colors[2]
+              : score >= ::score_over        ? ::oversized_colors[1]
+                                             : ::oversized_colors[0];
+        default: return 0;
+        }
+    }
+}    // namespace
+
+bool vx3d::map::render_header_tile(
+  tile_mode                      mode,
+  const overlay_settings &       settings,
+  const std::vector<glm::ivec2> &regions,
+  const region_header_source &   source,
+  tile &                         tile)
+{
+    ZoneScopedN("Map::render_header_tile");
+
+    const auto level  = static_cast<int>(tile.level);
+    const auto width  = 1 << level;
+    const auto min    = glm::ivec2(tile.x, tile.z) * width;
+    const auto max    = min + (width - 1);
+    const auto span   = level <= 4 ? 16 >> level : 1;
+    const auto shrink = level <= 4 ? 0 : level - 4;
+
+    auto scores = std::array<std::uint8_t, tile_pixels>();
+    auto any    = false;
+    for (const auto &region : regions)
+    {
+        const auto header = source(region.x, region.y);
+        if (!header) continue;
+
+        const auto first = glm::max(min, region * 32);
+        const auto last  = glm::min(max, region * 32 + 31);
+        for (auto z = first.y; z <= last.y; z++)
+            for (auto x = first.x; x <= last.x; x++)
+            {
+                const auto index = (z - region.y * 32) * 32 + (x - region.x * 32);
+                if (header->sectors[index] == 0) continue;
+
+                const auto value = ::score(mode, settings, *header, index);
+                const auto pixel = glm::ivec2(x - min.x, z - min.y);
+                any              = true;
+
+                if (span == 1)
+                {
+                    auto &at = scores[(pixel.y >> shrink) * 16 + (pixel.x >> shrink)];
+                    at       = std::max(at, value);
+                    continue;
+                }
+
+                for (auto py = pixel.y * span; py < (pixel.y + 1) * span; py++)
+                    for (auto px = pixel.x * span; px < (pixel.x + 1) * span; px++)
+                        scores[py * 16 + px] = value;
+            }
+    }
+
+    for (auto i = 0; i < tile_pixels; i++) tile.pixels[i] = ::color(mode, scores[i]);
+    return any;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <loader/minecraft_loader.h>
+#include <map/tile_renderer.h>
+
+namespace vx3d::map
+{
+    struct overlay_settings
+    {
+        std::uint32_t now            = 0;     // Seconds since the epoch, ages are counted from here
+        std::uint8_t  size_threshold = 64;    // Sectors, a chunk at or over this is oversized
+    };
+
+    [[nodiscard]] constexpr bool is_header_overlay(tile_mode mode) noexcept
+    {
+        return mode == tile_mode::age || mode == tile_mode::size || mode == tile_mode::oversized;
+    }
+
+    using region_header_source = std::function<
+      std::shared_ptr<const loader::region_header>(std::int32_t x, std::int32_t z)>;
+
+    /// Paints a tile of any level from the headers of the regions under it, no chunk is read.
+    /// A pixel covering several chunks shows the one that stands out most.
+    /// \param regions The regions under the tile that exist, see `world_loader::regions_in`
+    /// \return false if no chunk is under the tile
+    bool render_header_tile(
+      tile_mode                      mode,
+      const overlay_settings &       settings,
+      const std::vector<glm::ivec2> &regions,
+      const region_header_source &   source,
+      tile &                         tile);
+}    // namespace vx3d::map
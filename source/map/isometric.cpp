@@ -0,0 +1,344 @@
+#include "isometric.h"
+
+#include <algorithm>
+
+#include <tsl/robin_map.h>
+#include <tracy/Tracy.hpp>
+
+#include <loader/world_loader.h>
+#include <map/biome_tint.h>
+#include <map/block_colors.h>
+
+namespace
+{
+    // Every format fits in here, 1.18 worlds go from -64 up to 319
+    constexpr auto min_height = -64;
+    constexpr auto max_height = 319;
+
+    // Sections by their y, which is somewhere between -32 and 31 for any sensible world
+    constexpr auto section_slots  = 64;
+    constexpr auto section_offset = 32;
+
+    // Chunks decoded together by a single task
+    constexpr auto decode_batch = 16;
+
+    // Which face of a block every pixel of its 4x4 sprite shows
+    enum face : std::uint8_t
+    {
+        face_none,
+        face_top,
+        face_south,    // +z, lower left
+        face_east      // +x, lower right
+    };
+
+    constexpr auto sprite = std::array<std::array<face, 4>, 4>({ {
+      { face_none, face_top, face_top, face_none },
+      { face_top, face_top, face_top, face_top },
+      { face_south, face_south, face_east, face_east },
+      { face_south, face_south, face_east, face_east },
+    } });
+
+    // Light from above, the two side faces a little and a lot darker
+    constexpr auto face_shade = std::array<std::uint8_t, 4>({ 0, 255, 204, 166 });
+
+    [[nodiscard]] constexpr std::int32_t floor_div(std::int32_t value, std::int32_t divisor) noexcept
+    {
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+
+    [[nodiscard]] constexpr std::int32_t ceil_div(std::int32_t value, std::int32_t divisor) noexcept
+    {
+        return -::floor_div(-value, divisor);
+    }
+
+    // Hides whatever is behind it, plants, water and air don't
+    [[nodiscard]] bool is_opaque(vx3d::loader::block_id id) noexcept
+    {
+        using namespace vx3d::loader;
+        return !(block_registry::info(id).flags &
+                 (block_flag_air | block_flag_water | block_flag_aquatic | block_flag_passable));
+    }
+
+    struct prepared_chunk
+    {
+        std::shared_ptr<const vx3d::loader::chunk> chunk;
+
+        std::array<std::int8_t, section_slots> slots {};    // Into `chunk->sections`, -1 if absent
+        std::vector<bool>                      solid;       // Per section, every block opaque
+
+        [[nodiscard]] const vx3d::loader::chunk_section *section(std::int32_t y) const noexcept
+        {
+            const auto slot = y + section_offset;
+            if (slot < 0 || slot >= section_slots || slots[slot] < 0) return nullptr;
+            return &chunk->sections[slots[slot]];
+        }
+
+        [[nodiscard]] bool is_solid(std::int32_t y) const noexcept
+        {
+            const auto slot = y + section_offset;
+            return slot >= 0 && slot < section_slots && slots[slot] >= 0 && solid[slots[slot]];
+        }
+
+        /// \param x, z Local to this chunk
+        [[nodiscard]] bool opaque_at(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept
+        {
+            const auto *found = section(y >> 4);
+            return found && ::is_opaque(found->at(x, y & 15, z));
+        }
+    };
+
+    [[nodiscard]] prepared_chunk prepare(std::shared_ptr<const vx3d::loader::chunk> chunk)
+    {
+        auto prepared = prepared_chunk();
+        prepared.slots.fill(-1);
+        prepared.solid.resize(chunk->sections.size());
+
+        for (auto i = std::size_t(0); i < chunk->sections.size(); i++)
+        {
+            const auto &section = chunk->sections[i];
+            const auto  slot    = section.y + section_offset;
+            if (slot < 0 || slot >= section_slots) continue;
+
+            prepared.slots[slot] = static_cast<std::int8_t>(i);
+            prepared.solid[i]    = std::all_of(
+              section.blocks.begin(),
+              section.blocks.end(),
+              [](auto id) { return ::is_opaque(id); });
+        }
+
+        prepared.chunk = std::move(chunk);
+        return prepared;
+    }
+
+    void put(vx3d::map::rgba &pixel, vx3d::map::rgba color) noexcept
+    {
+        const auto alpha = color >> 24;
+        if (alpha == 255)
+        {
+            pixel = color;
+            return;
+        }
+
+        auto result = std::max(pixel >> 24, alpha) << 24;
+        for (auto shift = 0; shift < 24; shift += 8)
+        {
+            const auto under = (pixel >> shift) & 0xFF;
+            const auto over  = (color >> shift) & 0xFF;
+            result |= ((under * (255 - alpha) + over * alpha) / 255) << shift;
+        }
+        pixel = result;
+    }
+
+    // Draws the blocks of one chunk that land in a tile, back to front. Columns go by x + z and
+    // each one bottom to top, so nearer blocks are drawn over the ones behind them.
+    void draw_chunk(
+      const prepared_chunk &chunk,
+      const prepared_chunk *east,
+      const prepared_chunk *south,
+      const glm::ivec2 &    origin,
+      vx3d::map::rgba *     pixels,
+      bool &                drawn)
+    {
+        using namespace vx3d::map;
+        using vx3d::loader::block_registry;
+
+        const auto &colors = block_color_table::get();
+        const auto &tints  = biome_tint_table::get();
+        const auto &blocks = *chunk.chunk;
+
+        const auto base_x = blocks.x * 16;
+        const auto base_z = blocks.z * 16;
+
+        // A section is hidden when the ones above, east and south of it hide everything behind them
+        const auto hidden = [&](std::int32_t section_y)
+        {
+            return chunk.is_solid(section_y + 1) && east && east->is_solid(section_y) && south &&
+              south->is_solid(section_y);
+        };
+
+        for (auto diagonal = 0; diagonal <= 30; diagonal++)
+            for (auto x = std::max(0, diagonal - 15); x <= std::min(15, diagonal); x++)
+            {
+                const auto z        = diagonal - x;
+                const auto screen_x = (base_x + x - base_z - z) * 2 - origin.x;
+                if (screen_x + 3 < 0 || screen_x >= iso_tile_size) continue;
+
+                // Only the heights whose sprite lands in the tile
+                const auto row    = base_x + x + base_z + z - origin.y;
+                const auto top    = std::min(::floor_div(row + 3, 2), ::max_height);
+                const auto bottom = std::max(::floor_div(row - iso_tile_size, 2) + 1, ::min_height);
+                if (bottom > top) continue;
+
+                for (const auto &section : blocks.sections)
+                {
+                    const auto section_base = section.y * 16;
+                    if (section_base + 15 < bottom || section_base > top || hidden(section.y))
+                        continue;
+
+                    const auto from = std::max(bottom, section_base);
+                    const auto to   = std::min(top, section_base + 15);
+                    for (auto y = from; y <= to; y++)
+                    {
+                        const auto  id   = section.at(x, y & 15, z);
+                        const auto &info = block_registry::info(id);
+                        if (info.is_air()) continue;
+
+                        const auto above = chunk.opaque_at(x, y + 1, z);
+                        const auto right = x < 15 ? ::is_opaque(section.at(x + 1, y & 15, z))
+                                                  : east && east->opaque_at(0, y, z);
+                        const auto left = z < 15 ? ::is_opaque(section.at(x, y & 15, z + 1))
+                                                 : south && south->opaque_at(x, y, 0);
+                        if (above && right && left) continue;
+
+                        auto color = colors.color(id);
+                        if (info.is_water())
+                        {
+                            // Only the surface of water, see through enough to show what's under it
+                            const auto surface =
+                              !block_registry::info(blocks.block_at(x, y + 1, z)).is_water();
+                            if (!surface) continue;
+                            const auto water =
+                              tints.color(vx3d::loader::tint_type::water, blocks.biomes.at(x, y, z));
+                            color = (water & 0x00FFFFFF) | 0x8C000000;
+                        }
+                        else if (info.tint != vx3d::loader::tint_type::none)
+                            color = multiply_rgb(color, tints.color(info.tint, blocks.biomes.at(x, y, z)));
+
+                        const auto shown = std::array<bool, 4>({ false, !above, !left, !right });
+                        const auto faces = std::array<rgba, 4>({
+                          0,
+                          shade_rgb(color, face_shade[face_top]),
+                          shade_rgb(color, face_shade[face_south]),
+                          shade_rgb(color, face_shade[face_east]),
+                        });
+
+                        const auto screen_y = row - y * 2;
+                        for (auto sprite_y = 0; sprite_y < 4; sprite_y++)
+                        {
+                            const auto pixel_y = screen_y + sprite_y;
+                            if (pixel_y < 0 || pixel_y >= iso_tile_size) continue;
+                            for (auto sprite_x = 0; sprite_x < 4; sprite_x++)
+                            {
+                                const auto pixel_x = screen_x + sprite_x;
+                                const auto face    = ::sprite[sprite_y][sprite_x];
+                                if (!shown[face] || pixel_x < 0 || pixel_x >= iso_tile_size) continue;
+
+                                ::put(pixels[pixel_y * iso_tile_size + pixel_x], faces[face]);
+                                drawn = true;
+                            }
+                        }
+                    }
+                }
+            }
+    }
+}    // namespace
+
+std::vector<glm::ivec2> vx3d::map::iso_tile_chunks(const glm::ivec2 &tile)
+{
+    const auto origin = tile * iso_tile_size;
+
+    // In chunk diagonals u = x - z and v = x + z a chunk covers a fixed box of the screen,
+    // 64 pixels wide and as tall as the world
+    const auto min_u = ::ceil_div(origin.x - 33, 32);
+    const auto max_u = ::floor_div(origin.x + iso_tile_size - 1 + 30, 32);
+    const auto min_v = ::ceil_div(origin.y - 33 + 2 * ::min_height, 16);
+    const auto max_v = ::floor_div(origin.y + iso_tile_size - 1 + 2 * ::max_height, 16);
+
+    auto chunks = std::vector<glm::ivec2>();
+    for (auto v = min_v; v <= max_v; v++)
+        for (auto u = min_u; u <= max_u; u++)
+            if (((u + v) & 1) == 0) chunks.emplace_back((u + v) / 2, (v - u) / 2);
+    return chunks;
+}
+
+std::vector<glm::ivec2> vx3d::map::iso_chunk_tiles(const glm::ivec2 &chunk)
+{
+    const auto u = chunk.x - chunk.y;
+    const auto v = chunk.x + chunk.y;
+
+    auto tiles = std::vector<glm::ivec2>();
+    for (auto y = ::floor_div(16 * v - 2 * ::max_height, iso_tile_size);
+         y <= ::floor_div(16 * v + 33 - 2 * ::min_height, iso_tile_size);
+         y++)
+        for (auto x = ::floor_div(32 * u - 30, iso_tile_size);
+             x <= ::floor_div(32 * u + 33, iso_tile_size);
+             x++)
+            tiles.emplace_back(x, y);
+    return tiles;
+}
+
+vx3d::map::isometric_renderer::isometric_renderer(chunk_source source, std::uint32_t threads)
+    : _source(std::move(source)), _thread_pool(vx3d::default_worker_count(threads))
+{
+}
+
+std::vector<vx3d::map::iso_tile>
+  vx3d::map::isometric_renderer::render(const std::vector<glm::ivec2> &tiles)
+{
+    ZoneScopedN("IsometricRenderer::render");
+
+    // The dependency sets of every tile, and every chunk in any of them once
+    auto dependencies = std::vector<std::vector<glm::ivec2>>();
+    auto chunk_index  = tsl::robin_map<std::uint64_t, std::size_t>();
+    auto chunks       = std::vector<glm::ivec2>();
+    dependencies.reserve(tiles.size());
+    for (const auto &tile : tiles)
+    {
+        dependencies.push_back(iso_tile_chunks(tile));
+        for (const auto &chunk : dependencies.back())
+            if (chunk_index.insert({ world_loader::hash_pos(chunk.x, chunk.y), chunks.size() }).second)
+                chunks.push_back(chunk);
+    }
+
+    // Each task writes its own slots, so nothing needs a lock
+    auto prepared = std::vector<prepared_chunk>(chunks.size());
+    auto decode   = std::vector<std::function<void()>>();
+    for (auto first = std::size_t(0); first < chunks.size(); first += ::decode_batch)
+        decode.emplace_back(
+          [&, first]
+          {
+              ZoneScopedN("IsometricRenderer::decode");
+              for (auto i = first; i < std::min(first + ::decode_batch, chunks.size()); i++)
+                  if (auto chunk = _source(chunks[i].x, chunks[i].y))
+                      prepared[i] = ::prepare(std::move(chunk));
+          });
+    _thread_pool.run_tasks(decode);
+
+    const auto find = [&](std::int32_t x, std::int32_t z) -> const prepared_chunk *
+    {
+        const auto at = chunk_index.find(world_loader::hash_pos(x, z));
+        return at != chunk_index.end() && prepared[at->second].chunk ? &prepared[at->second] : nullptr;
+    };
+
+    auto rendered = std::vector<iso_tile>(tiles.size());
+    auto drawn    = std::vector<std::uint8_t>(tiles.size());
+    auto draw     = std::vector<std::function<void()>>();
+    for (auto i = std::size_t(0); i < tiles.size(); i++)
+        draw.emplace_back(
+          [&, i]
+          {
+              ZoneScopedN("IsometricRenderer::draw");
+              auto &tile = rendered[i];
+              tile.x     = tiles[i].x;
+              tile.y     = tiles[i].y;
+              tile.pixels.assign(iso_tile_size * iso_tile_size, 0);
+
+              auto any = false;
+              for (const auto &chunk : dependencies[i])
+                  if (const auto *at = find(chunk.x, chunk.y))
+                      ::draw_chunk(
+                        *at,
+                        find(chunk.x + 1, chunk.y),
+                        find(chunk.x, chunk.y + 1),
+                        tiles[i] * iso_tile_size,
+                        tile.pixels.data(),
+                        any);
+              drawn[i] = any;
+          });
+    _thread_pool.run_tasks(draw);
+
+    auto result = std::vector<iso_tile>();
+    for (auto i = std::size_t(0); i < tiles.size(); i++)
+        if (drawn[i]) result.push_back(std::move(rendered[i]));
+    return result;
+}
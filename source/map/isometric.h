@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <thread_pool.h>
+#include <loader/chunk.h>
+#include <map/tile_ops.h>
+
+namespace vx3d::map
+{
+    // A block is drawn 4 pixels across, its top a diamond and its east and south faces below it,
+    // looking down at the world from the south east. Block (x, y, z) lands at
+    // ((x - z) * 2, (x + z) - y * 2) and isometric tiles are squares of that space.
+    constexpr auto iso_tile_size = 256;
+
+    struct iso_tile
+    {
+        std::int32_t      x = 0;
+        std::int32_t      y = 0;
+        std::vector<rgba> pixels;    // iso_tile_size squared, row major
+    };
+
+    /// Every chunk that can draw into an isometric tile, whether it exists or not, back to front
+    [[nodiscard]] std::vector<glm::ivec2> iso_tile_chunks(const glm::ivec2 &tile);
+
+    /// Every isometric tile a chunk can draw into, for redrawing the tiles of a changed chunk
+    [[nodiscard]] std::vector<glm::ivec2> iso_chunk_tiles(const glm::ivec2 &chunk);
+
+    // Draws isometric tiles from decoded chunks on a pool of worker threads. The chunks every tile
+    // of a call depends on are decoded once up front and shared between the tiles, which are then
+    // drawn in parallel. Callers rendering a whole world bound the memory used by calling with a
+    // strip of tiles at a time.
+    class isometric_renderer
+    {
+    public:
+        using chunk_source =
+          std::function<std::shared_ptr<const loader::chunk>(std::int32_t x, std::int32_t z)>;
+
+        /// \param source Must be safe to call from any thread, see `world_loader::load_chunk`
+        /// \param threads Workers to render with, 0 leaves one hardware thread for the caller
+        explicit isometric_renderer(chunk_source source, std::uint32_t threads = 0);
+
+        /// Draws tiles and waits for them, tiles without a single block in them are left out
+        [[nodiscard]] std::vector<iso_tile> render(const std::vector<glm::ivec2> &tiles);
+
+    private:
+        chunk_source _source;
+
+        // Last, so the workers are joined before anything they use goes away
+        vx3d::thread_pool _thread_pool;
+    };
+}    // namespace vx3d::map
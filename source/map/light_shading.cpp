@@ -0,0 +1,129 @@
+#include "light_shading.h"
+
+#include <algorithm>
+
+#include <tracy/Tracy.hpp>
+
+namespace
+{
+    // DataVersion of 1.18, monsters only spawn in complete darkness from there on
+    constexpr auto data_version_dark_spawning = 2860;
+
+    // Sky light lost at midnight
+    constexpr auto night_sky_darkening = 11;
+
+    // Per light level colour factor, the game's brightness curve with a little ambient light
+    [[nodiscard]] const std::array<vx3d::map::rgba, 16> &night_factors()
+    {
+        static const auto factors = []
+        {
+            auto built = std::array<vx3d::map::rgba, 16>();
+            for (auto level = 0; level < 16; level++)
+            {
+                const auto f          = level / 15.0f;
+                const auto brightness = f / (3.0f * (1.0f - f) + 1.0f);
+                const auto value = static_cast<std::uint32_t>((0.08f + 0.92f * brightness) * 255.0f);
+                built[level]     = value | value << 8 | value << 16 | 0xFF000000;
+            }
+            return built;
+        }();
+        return factors;
+    }
+}    // namespace
+
+std::uint8_t vx3d::map::spawn_light_limit(std::int32_t data_version) noexcept
+{
+    return data_version >= data_version_dark_spawning ? 0 : 7;
+}
+
+vx3d::map::surface_light vx3d::map::sample_surface_light(const loader::chunk &chunk)
+{
+    ZoneScopedN("LightShading::sample_surface_light");
+    using loader::block_registry;
+
+    auto light = surface_light();
+
+    for (auto z = 0; z < 16; z++)
+        for (auto x = 0; x < 16; x++)
+        {
+            const auto height = chunk.highest_block(
+              x,
+              z,
+              std::numeric_limits<std::int32_t>::max(),
+              loader::block_flag_air | loader::block_flag_passable);
+            const auto index = z * 16 + x;
+
+            light.height[index] = static_cast<std::int16_t>(
+              height == loader::chunk::no_block ? std::numeric_limits<std::int16_t>::min() : height);
+            light.spawnable[index] = height != loader::chunk::no_block &&
+              block_registry::info(chunk.block_at(x, height, z)).can_spawn_on();
+        }
+
+    // Columns share heights a lot, so unpack each layer of light once and pick from it
+    auto block_layer = std::array<std::uint8_t, tile_pixels>();
+    auto sky_layer   = std::array<std::uint8_t, tile_pixels>();
+    auto done        = std::array<bool, tile_pixels>();
+
+    for (auto i = 0; i < tile_pixels; i++)
+    {
+        if (done[i]) continue;
+
+        if (light.height[i] == std::numeric_limits<std::int16_t>::min())
+        {
+            light.sky[i] = 15;
+            done[i]      = true;
+            continue;
+        }
+
+        const auto  y       = light.height[i] + 1;
+        const auto *section = chunk.light_section(y >> 4);
+        if (section) section->layer(y & 15, block_layer.data(), sky_layer.data());
+
+        for (auto j = i; j < tile_pixels; j++)
+        {
+            if (done[j] || light.height[j] + 1 != y) continue;
+
+            light.block[j] = section ? block_layer[j] : 0;
+            light.sky[j]   = section ? sky_layer[j] : chunk.sky_light_at(j & 15, y, j >> 4);
+            done[j]        = true;
+        }
+    }
+
+    return light;
+}
+
+void vx3d::map::shade_night(rgba *pixels, const surface_light &light) noexcept
+{
+    ZoneScopedN("LightShading::shade_night");
+    const auto &table = ::night_factors();
+
+    auto factors = std::array<rgba, tile_pixels>();
+    for (auto i = 0; i < tile_pixels; i++)
+    {
+        const auto sky = std::max(0, light.sky[i] - night_sky_darkening);
+        factors[i]     = table[std::max<std::int32_t>(light.block[i], sky)];
+    }
+
+    multiply_tile(pixels, factors.data());
+}
+
+void vx3d::map::shade_light_levels(
+  rgba *               pixels,
+  const surface_light &light,
+  std::uint8_t         spawn_limit) noexcept
+{
+    ZoneScopedN("LightShading::shade_light_levels");
+
+    auto overlay = std::array<rgba, tile_pixels>();
+    for (auto i = 0; i < tile_pixels; i++)
+    {
+        if (light.spawnable[i] && light.block[i] <= spawn_limit)
+            overlay[i] = make_rgba(0xFF0000, 160);
+        else if (light.block[i] <= 7)
+            overlay[i] = make_rgba(0xFFD800, 64);
+        else
+            overlay[i] = 0;
+    }
+
+    blend_tile(pixels, overlay.data());
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <loader/chunk.h>
+#include <map/tile_ops.h>
+
+namespace vx3d::map
+{
+    // Light in the air block above the surface of every column, z * 16 + x
+    struct surface_light
+    {
+        std::array<std::int16_t, tile_pixels> height {};
+        std::array<std::uint8_t, tile_pixels> block {};
+        std::array<std::uint8_t, tile_pixels> sky {};
+        std::array<bool, tile_pixels>         spawnable {};
+    };
+
+    /// Highest block light monsters still spawn at, 0 from 1.18 onwards and 7 before
+    [[nodiscard]] std::uint8_t spawn_light_limit(std::int32_t data_version) noexcept;
+
+    /// Samples the light above the highest solid block of every column
+    /// \param chunk Must have been decoded with `decode_flag_light`
+    [[nodiscard]] surface_light sample_surface_light(const loader::chunk &chunk);
+
+    /// Darkens a tile as if it was midnight, block lit surfaces keep their colour
+    void shade_night(rgba *pixels, const surface_light &light) noexcept;
+
+    /// Tints surfaces by block light, spawnable surfaces at or below `spawn_limit` in red
+    void shade_light_levels(rgba *pixels, const surface_light &light, std::uint8_t spawn_limit) noexcept;
+}    // namespace vx3d::map
@@ -0,0 +1,202 @@
+#include "relief.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <util/simd.h>
+
+namespace
+{
+    // Columns with nothing in them, the void of the end, sit at the bottom of the world
+    constexpr auto void_height = -64.0f;
+
+    // Ground flat on to the light isn't drawn at full brightness, so slopes facing it still stand out
+    constexpr auto ambient = 0.2f;
+
+    [[nodiscard]] float ground_height(const vx3d::map::column_summary &summary, int column) noexcept
+    {
+        using vx3d::map::column_summary;
+        if (summary.floor_height[column] != column_summary::no_surface)
+            return summary.floor_height[column];
+        if (summary.surface_height[column] != column_summary::no_surface)
+            return summary.surface_height[column];
+        return ::void_height;
+    }
+
+    // The light as a unit vector, x east, y up and z south, with the slopes pre-scaled
+    struct light_vector
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+        float k = 1.0f;    // Horn's 1/8 and the exaggeration
+    };
+
+    [[nodiscard]] light_vector to_vector(const vx3d::map::relief_light &light) noexcept
+    {
+        constexpr auto radians = 3.14159265f / 180.0f;
+        const auto     azimuth = light.azimuth * radians;
+        const auto     up      = std::clamp(light.altitude, 0.0f, 90.0f) * radians;
+
+        auto vector = light_vector();
+        vector.x    = std::sin(azimuth) * std::cos(up);
+        vector.y    = std::sin(up);
+        vector.z    = -std::cos(azimuth) * std::cos(up);
+        vector.k    = light.exaggeration / 8.0f;
+        return vector;
+    }
+
+#if !defined(VX3D_SIMD_SSE2)
+    [[nodiscard]] constexpr vx3d::map::rgba grey(std::uint32_t value) noexcept
+    {
+        return value | value << 8 | value << 16 | 0xFF000000;
+    }
+#endif
+}    // namespace
+
+vx3d::map::relief_heights
+  vx3d::map::gather_relief_heights(const std::array<const column_summary *, 9> &around) noexcept
+{
+    auto heights = relief_heights();
+    for (auto z = -1; z <= 16; z++)
+        for (auto x = -1; x <= 16; x++)
+        {
+            const auto chunk_x = x < 0 ? 0 : x > 15 ? 2 : 1;
+            const auto chunk_z = z < 0 ? 0 : z > 15 ? 2 : 1;
+
+            // A missing neighbour repeats the edge, so the border of the world shades as flat
+            const auto *summary = around[chunk_z * 3 + chunk_x];
+            auto        local_x = (x + 16) & 15;
+            auto        local_z = (z + 16) & 15;
+            if (!summary)
+            {
+                summary = around[4];
+                local_x = std::clamp(x, 0, 15);
+                local_z = std::clamp(z, 0, 15);
+            }
+
+            heights[(z + 1) * relief_width + x + 1] = ::ground_height(*summary, local_z * 16 + local_x);
+        }
+    return heights;
+}
+
+void vx3d::map::shade_relief(const relief_heights &heights, const relief_light &light, rgba *factors) noexcept
+{
+    const auto sun = ::to_vector(light);
+
+    // Horn's method, the gradient from the 3x3 neighbourhood weighting the nearest neighbours
+    // twice. Rows are 16 columns, which is 2 AVX or 4 SSE vectors across.
+    for (auto z = 0; z < 16; z++)
+    {
+        const auto *north = heights.data() + z * relief_width;
+        const auto *row   = north + relief_width;
+        const auto *south = row + relief_width;
+        auto *      out   = factors + z * 16;
+
+#if defined(VX3D_SIMD_AVX2)
+        const auto two    = _mm256_set1_ps(2.0f);
+        const auto k      = _mm256_set1_ps(sun.k);
+        const auto one    = _mm256_set1_ps(1.0f);
+        const auto scale  = _mm256_set1_ps(255.0f * (1.0f - ::ambient));
+        const auto base   = _mm256_set1_ps(255.0f * ::ambient);
+        const auto zero   = _mm256_setzero_ps();
+        const auto opaque = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+        for (auto x = 0; x < 16; x += 8)
+        {
+            const auto nw = _mm256_loadu_ps(north + x);
+            const auto n  = _mm256_loadu_ps(north + x + 1);
+            const auto ne = _mm256_loadu_ps(north + x + 2);
+            const auto w  = _mm256_loadu_ps(row + x);
+            const auto e  = _mm256_loadu_ps(row + x + 2);
+            const auto sw = _mm256_loadu_ps(south + x);
+            const auto s  = _mm256_loadu_ps(south + x + 1);
+            const auto se = _mm256_loadu_ps(south + x + 2);
+
+            const auto dx = _mm256_mul_ps(
+              k,
+              _mm256_sub_ps(
+                _mm256_add_ps(_mm256_add_ps(ne, se), _mm256_mul_ps(two, e)),
+                _mm256_add_ps(_mm256_add_ps(nw, sw), _mm256_mul_ps(two, w))));
+            const auto dz = _mm256_mul_ps(
+              k,
+              _mm256_sub_ps(
+                _mm256_add_ps(_mm256_add_ps(sw, se), _mm256_mul_ps(two, s)),
+                _mm256_add_ps(_mm256_add_ps(nw, ne), _mm256_mul_ps(two, n))));
+
+            // Normal (-dx, 1, -dz) dotted with the light, over the length of the normal
+            const auto lit = _mm256_sub_ps(
+              _mm256_set1_ps(sun.y),
+              _mm256_add_ps(
+                _mm256_mul_ps(dx, _mm256_set1_ps(sun.x)),
+                _mm256_mul_ps(dz, _mm256_set1_ps(sun.z))));
+            const auto length = _mm256_sqrt_ps(
+              _mm256_add_ps(one, _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dz, dz))));
+            const auto shade = _mm256_max_ps(_mm256_div_ps(lit, length), zero);
+
+            const auto value = _mm256_cvtps_epi32(_mm256_add_ps(base, _mm256_mul_ps(scale, shade)));
+            const auto grey  = _mm256_or_si256(
+              _mm256_or_si256(value, _mm256_slli_epi32(value, 8)),
+              _mm256_or_si256(_mm256_slli_epi32(value, 16), opaque));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x), grey);
+        }
+#elif defined(VX3D_SIMD_SSE2)
+        const auto two    = _mm_set1_ps(2.0f);
+        const auto k      = _mm_set1_ps(sun.k);
+        const auto one    = _mm_set1_ps(1.0f);
+        const auto scale  = _mm_set1_ps(255.0f * (1.0f - ::ambient));
+        const auto base   = _mm_set1_ps(255.0f * ::ambient);
+        const auto zero   = _mm_setzero_ps();
+        const auto opaque = _mm_set1_epi32(static_cast<int>(0xFF000000));
+        for (auto x = 0; x < 16; x += 4)
+        {
+            const auto nw = _mm_loadu_ps(north + x);
+            const auto n  = _mm_loadu_ps(north + x + 1);
+            const auto ne = _mm_loadu_ps(north + x + 2);
+            const auto w  = _mm_loadu_ps(row + x);
+            const auto e  = _mm_loadu_ps(row + x + 2);
+            const auto sw = _mm_loadu_ps(south + x);
+            const auto s  = _mm_loadu_ps(south + x + 1);
+            const auto se = _mm_loadu_ps(south + x + 2);
+
+            const auto dx = _mm_mul_ps(
+              k,
+              _mm_sub_ps(
+                _mm_add_ps(_mm_add_ps(ne, se), _mm_mul_ps(two, e)),
+                _mm_add_ps(_mm_add_ps(nw, sw), _mm_mul_ps(two, w))));
+            const auto dz = _mm_mul_ps(
+              k,
+              _mm_sub_ps(
+                _mm_add_ps(_mm_add_ps(sw, se), _mm_mul_ps(two, s)),
+                _mm_add_ps(_mm_add_ps(nw, ne), _mm_mul_ps(two, n))));
+
+            const auto lit = _mm_sub_ps(
+              _mm_set1_ps(sun.y),
+              _mm_add_ps(_mm_mul_ps(dx, _mm_set1_ps(sun.x)), _mm_mul_ps(dz, _mm_set1_ps(sun.z))));
+            const auto length =
+              _mm_sqrt_ps(_mm_add_ps(one, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz))));
+            const auto shade = _mm_max_ps(_mm_div_ps(lit, length), zero);
+
+            const auto value = _mm_cvtps_epi32(_mm_add_ps(base, _mm_mul_ps(scale, shade)));
+            const auto grey  = _mm_or_si128(
+              _mm_or_si128(value, _mm_slli_epi32(value, 8)),
+              _mm_or_si128(_mm_slli_epi32(value, 16), opaque));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), grey);
+        }
+#else
+        for (auto x = 0; x < 16; x++)
+        {
+            const auto dx = sun.k *
+              ((north[x + 2] + south[x + 2] + 2.0f * row[x + 2]) -
+               (north[x] + south[x] + 2.0f * row[x]));
+            const auto dz = sun.k *
+              ((south[x] + south[x + 2] + 2.0f * south[x + 1]) -
+               (north[x] + north[x + 2] + 2.0f * north[x + 1]));
+
+            const auto lit   = sun.y - dx * sun.x - dz * sun.z;
+            const auto shade = std::max(lit / std::sqrt(1.0f + dx * dx + dz * dz), 0.0f);
+            out[x]           = ::grey(static_cast<std::uint32_t>(
+              std::lround(255.0f * ::ambient + 255.0f * (1.0f - ::ambient) * shade)));
+        }
+#endif
+    }
+}
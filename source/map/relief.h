@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <map/column_summary.h>
+#include <map/tile_ops.h>
+
+namespace vx3d::map
+{
+    struct relief_light
+    {
+        float azimuth      = 315.0f;    // Degrees clockwise from north the light comes from
+        float altitude     = 45.0f;     // Degrees above the horizon
+        float exaggeration = 1.0f;      // Scales every slope, flat worlds read better above 1
+
+        [[nodiscard]] bool operator==(const relief_light &other) const noexcept
+        {
+            return azimuth == other.azimuth && altitude == other.altitude &&
+              exaggeration == other.exaggeration;
+        }
+
+        [[nodiscard]] bool operator!=(const relief_light &other) const noexcept
+        {
+            return !(*this == other);
+        }
+    };
+
+    // Ground heights of a chunk with a one column border taken from its neighbours, z * 18 + x
+    constexpr auto relief_width = 18;
+    using relief_heights        = std::array<float, relief_width * relief_width>;
+
+    /// Heights under the water and plants of a chunk and the columns around it
+    /// \param around Summaries of the 3x3 chunks centred on the chunk, row major from the north
+    /// west. The centre must be set, the border next to a missing neighbour repeats the edge.
+    [[nodiscard]] relief_heights
+      gather_relief_heights(const std::array<const column_summary *, 9> &around) noexcept;
+
+    /// How lit each column is from its slope over its 3x3 neighbourhood, as grey factors for
+    /// `multiply_tile`. Computed a row of 16 columns at a time.
+    void shade_relief(const relief_heights &heights, const relief_light &light, rgba *factors) noexcept;
+}    // namespace vx3d::map
@@ -0,0 +1,446 @@
+#include "tile_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <daw/daw_memory_mapped_file.h>
+#include <tracy/Tracy.hpp>
+
+#include <util/cache_path.h>
+
+namespace
+{
+    constexpr auto cache_magic   = std::uint32_t(0x43545856);    // "VXTC"
+    constexpr auto cache_version = std::uint32_t(2);
+    constexpr auto file_header   = std::uint64_t(8);
+
+    // Written in front of every tile, the payload follows and is padded to 8 bytes
+    struct record_header
+    {
+        std::uint64_t key;
+        std::uint32_t time_stamp;
+        std::uint16_t size;
+        std::uint8_t  encoding;
+        std::uint8_t  reserved;
+    };
+    static_assert(sizeof(record_header) == 16);
+
+    // Most tiles only use a handful of colours, a palette and indices is a lot smaller and far
+    // cheaper to decode than running them through zlib
+    enum encoding : std::uint8_t
+    {
+        encoding_raw,         // 256 colours
+        encoding_solid,       // One colour
+        encoding_palette4,    // Colour count - 1, the colours, then 4 bit indices
+        encoding_palette8,    // Colour count - 1, the colours, then 8 bit indices
+        encoding_count
+    };
+
+    constexpr auto max_payload = vx3d::map::tile_pixels * sizeof(vx3d::map::rgba);
+
+    [[nodiscard]] constexpr std::uint64_t padded(std::uint64_t size) noexcept
+    {
+        return (size + 7) & ~std::uint64_t(7);
+    }
+
+    [[nodiscard]] std::uint8_t encode(const vx3d::map::tile &tile, std::vector<std::uint8_t> &out)
+    {
+        using vx3d::map::rgba;
+        using vx3d::map::tile_pixels;
+        out.clear();
+
+        // Open addressing over twice as many slots as pixels, colours are numbered in the order
+        // they first show up
+        auto slots   = std::array<std::int16_t, tile_pixels * 2>();
+        auto palette = std::array<rgba, tile_pixels>();
+        auto indices = std::array<std::uint8_t, tile_pixels>();
+        auto colors  = std::size_t(0);
+        slots.fill(-1);
+
+        for (auto i = 0; i < tile_pixels; i++)
+        {
+            const auto pixel = tile.pixels[i];
+            auto       slot  = (pixel * 0x9E3779B1u) >> 23;
+            while (slots[slot] >= 0 && palette[slots[slot]] != pixel) slot = (slot + 1) & 511;
+
+            if (slots[slot] < 0)
+            {
+                slots[slot]       = static_cast<std::int16_t>(colors);
+                palette[colors++] = pixel;
+            }
+            indices[i] = static_cast<std::uint8_t>(slots[slot]);
+        }
+
+        const auto append = [&out](const void *data, std::size_t size)
+        {
+            const auto *bytes = static_cast<const std::uint8_t *>(data);
+            out.insert(out.end(), bytes, bytes + size);
+        };
+
+        if (colors == 1)
+        {
+            append(palette.data(), sizeof(rgba));
+            return encoding_solid;
+        }
+
+        const auto wide = colors > 16;
+        if (1 + colors * sizeof(rgba) + (wide ? 256 : 128) >= max_payload)
+        {
+            append(tile.pixels.data(), max_payload);
+            return encoding_raw;
+        }
+
+        out.push_back(static_cast<std::uint8_t>(colors - 1));
+        append(palette.data(), colors * sizeof(rgba));
+
+        if (wide)
+        {
+            append(indices.data(), indices.size());
+            return encoding_palette8;
+        }
+
+        for (auto i = 0; i < tile_pixels; i += 2)
+            out.push_back(static_cast<std::uint8_t>(indices[i] | indices[i + 1] << 4));
+        return encoding_palette4;
+    }
+
+    [[nodiscard]] bool
+      decode(std::uint8_t encoding, const std::uint8_t *data, std::size_t size, vx3d::map::tile &tile)
+    {
+        using vx3d::map::rgba;
+
+        switch (encoding)
+        {
+        case encoding_raw:
+            if (size != max_payload) return false;
+            std::memcpy(tile.pixels.data(), data, max_payload);
+            return true;
+
+        case encoding_solid:
+        {
+            if (size != sizeof(rgba)) return false;
+            auto color = rgba(0);
+            std::memcpy(&color, data, sizeof(rgba));
+            tile.pixels.fill(color);
+            return true;
+        }
+
+        case encoding_palette4:
+        case encoding_palette8:
+        {
+            if (size < 1) return false;
+            const auto colors  = std::size_t(data[0]) + 1;
+            const auto indices = encoding == encoding_palette8 ? 256 : 128;
+            if (size != 1 + colors * sizeof(rgba) + indices) return false;
+
+            auto palette = std::array<rgba, 256>();
+            std::memcpy(palette.data(), data + 1, colors * sizeof(rgba));
+
+            // Out of range indices read zeroes from the rest of the palette, never past it
+            const auto *packed = data + 1 + colors * sizeof(rgba);
+            if (encoding == encoding_palette8)
+                for (auto i = 0; i < vx3d::map::tile_pixels; i++) tile.pixels[i] = palette[packed[i]];
+            else
+                for (auto i = 0; i < vx3d::map::tile_pixels; i += 2)
+                {
+                    tile.pixels[i]     = palette[packed[i / 2] & 0x0F];
+                    tile.pixels[i + 1] = palette[packed[i / 2] >> 4];
+                }
+            return true;
+        }
+
+        default: return false;
+        }
+    }
+
+    // Undoes `tile_key`, sign extending the 30 bit coordinates
+    void unpack_key(std::uint64_t key, vx3d::map::tile &tile) noexcept
+    {
+        const auto coordinate = [](std::uint64_t bits)
+        {
+            return static_cast<std::int32_t>(static_cast<std::uint32_t>(bits & 0x3FFFFFFF) << 2) >> 2;
+        };
+
+        tile.level = static_cast<std::uint8_t>(key >> 60);
+        tile.x     = coordinate(key >> 30);
+        tile.z     = coordinate(key);
+    }
+}    // namespace
+
+vx3d::map::tile_cache::~tile_cache()
+{
+    close();
+}
+
+void vx3d::map::tile_cache::open(const std::filesystem::path &world_folder, tile_mode mode)
+{
+    ZoneScopedN("TileCache::open");
+    close();
+    if (world_folder.empty()) return;
+
+    const auto path = vx3d::cache::world_file(
+      world_folder,
+      "tiles." + std::to_string(static_cast<int>(mode)) + ".bin");
+    if (path.empty()) return;
+
+    auto guard = std::lock_guard(_mutex);
+    _load(path);
+
+    if (_end < file_header)
+    {
+        auto created = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        created.write(reinterpret_cast<const char *>(&cache_magic), sizeof(cache_magic));
+        created.write(reinterpret_cast<const char *>(&cache_version), sizeof(cache_version));
+        if (!created) return;
+        _end = file_header;
+    }
+
+    _file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!_file)
+    {
+        std::cerr << "Couldn't open the tile cache " << path << std::endl;
+        _records.clear();
+    }
+}
+
+void vx3d::map::tile_cache::close()
+{
+    auto guard = std::lock_guard(_mutex);
+    if (_file.is_open()) _file.close();
+    _file.clear();
+    _records.clear();
+    _end = 0;
+}
+
+bool vx3d::map::tile_cache::contains(std::uint64_t key, std::uint32_t time_stamp) const
+{
+    auto       guard = std::lock_guard(_mutex);
+    const auto at    = _records.find(key);
+    return at != _records.end() && at->second.time_stamp == time_stamp;
+}
+
+std::optional<vx3d::map::tile>
+  vx3d::map::tile_cache::find(std::uint64_t key, std::uint32_t time_stamp)
+{
+    ZoneScopedN("TileCache::find");
+    auto guard = std::lock_guard(_mutex);
+
+    const auto at = _records.find(key);
+    if (at == _records.end() || at->second.time_stamp != time_stamp || !_file.is_open())
+    {
+        _lookups.misses++;
+        return std::nullopt;
+    }
+
+    auto payload = std::array<std::uint8_t, max_payload>();
+    _file.seekg(static_cast<std::streamoff>(at->second.offset));
+    if (!_file.read(reinterpret_cast<char *>(payload.data()), at->second.size))
+    {
+        _file.clear();
+        _lookups.misses++;
+        return std::nullopt;
+    }
+
+    auto found       = tile();
+    found.time_stamp = time_stamp;
+    ::unpack_key(key, found);
+    if (!::decode(at->second.encoding, payload.data(), at->second.size, found))
+    {
+        _lookups.misses++;
+        return std::nullopt;
+    }
+    _lookups.hits++;
+    return found;
+}
+
+void vx3d::map::tile_cache::store(const std::vector<tile> &tiles)
+{
+    ZoneScopedN("TileCache::store");
+    auto guard = std::lock_guard(_mutex);
+    if (!_file.is_open() || tiles.empty()) return;
+
+    // Encoded in one go, so the file sees a single write
+    auto buffer  = std::vector<std::uint8_t>();
+    auto encoded = std::vector<std::uint8_t>();
+    auto added   = std::vector<std::pair<std::uint64_t, record>>();
+    added.reserve(tiles.size());
+
+    for (const auto &tile : tiles)
+    {
+        auto header       = ::record_header();
+        header.key        = tile_key(tile.level, tile.x, tile.z);
+        header.time_stamp = tile.time_stamp;
+        header.encoding   = ::encode(tile, encoded);
+        header.size       = static_cast<std::uint16_t>(encoded.size());
+        header.reserved   = 0;
+
+        auto stored       = record();
+        stored.offset     = _end + buffer.size() + sizeof(header);
+        stored.time_stamp = header.time_stamp;
+        stored.size       = header.size;
+        stored.encoding   = header.encoding;
+        added.emplace_back(header.key, stored);
+
+        const auto *bytes = reinterpret_cast<const std::uint8_t *>(&header);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(header));
+        buffer.insert(buffer.end(), encoded.begin(), encoded.end());
+        buffer.resize(::padded(buffer.size()));
+    }
+
+    _file.seekp(static_cast<std::streamoff>(_end));
+    _file.write(
+      reinterpret_cast<const char *>(buffer.data()),
+      static_cast<std::streamsize>(buffer.size()));
+    _file.flush();
+    if (!_file)
+    {
+        // Whatever made it in is cut off as a torn record the next time the file is opened
+        std::cerr << "Couldn't write to the tile cache" << std::endl;
+        _file.close();
+        _records.clear();
+        return;
+    }
+
+    _end += buffer.size();
+    for (const auto &[key, stored] : added) _records[key] = stored;
+}
+
+std::size_t vx3d::map::tile_cache::size() const
+{
+    auto guard = std::lock_guard(_mutex);
+    return _records.size();
+}
+
+bool vx3d::map::tile_cache::is_open() const
+{
+    auto guard = std::lock_guard(_mutex);
+    return _file.is_open();
+}
+
+vx3d::map::tile_cache::lookups vx3d::map::tile_cache::lookup_counts() const
+{
+    auto guard = std::lock_guard(_mutex);
+    return _lookups;
+}
+
+void vx3d::map::tile_cache::_load(const std::filesystem::path &path)
+{
+    ZoneScopedN("TileCache::load");
+    _records.clear();
+    _end = 0;
+
+    auto error = std::error_code();
+    if (!std::filesystem::exists(path, error)) return;
+
+    auto temporary = path;
+    temporary += ".tmp";
+
+    auto good_end  = std::uint64_t(0);
+    auto file_size = std::uint64_t(0);
+    auto compacted = false;
+    {
+        const auto mapped = daw::filesystem::memory_mapped_file_t<std::uint8_t>(path.string());
+        if (!mapped || mapped.size() < file_header) return;
+
+        const auto *data = mapped.data();
+        file_size        = mapped.size();
+
+        auto magic   = std::uint32_t(0);
+        auto version = std::uint32_t(0);
+        std::memcpy(&magic, data, sizeof(magic));
+        std::memcpy(&version, data + sizeof(magic), sizeof(version));
+        if (magic != cache_magic || version != cache_version) return;
+
+        // Later copies of a tile replace earlier ones, a crash mid append leaves a record that
+        // runs past the end
+        auto offset     = file_header;
+        auto live_bytes = file_header;
+        while (offset + sizeof(record_header) <= file_size)
+        {
+            auto header = ::record_header();
+            std::memcpy(&header, data + offset, sizeof(header));
+
+            const auto next = offset + ::padded(sizeof(header) + header.size);
+            if (header.encoding >= encoding_count || header.size > max_payload || next > file_size)
+                break;
+
+            auto stored       = record();
+            stored.offset     = offset + sizeof(header);
+            stored.time_stamp = header.time_stamp;
+            stored.size       = header.size;
+            stored.encoding   = header.encoding;
+
+            auto [at, inserted] = _records.insert({ header.key, stored });
+            if (!inserted)
+            {
+                live_bytes -= ::padded(sizeof(header) + at->second.size);
+                at.value() = stored;
+            }
+            live_bytes += next - offset;
+            offset = next;
+        }
+        good_end = offset;
+
+        // Rewritten once most of it is older copies, the records come over in file order
+        if (live_bytes * 2 < good_end && good_end > (std::uint64_t(1) << 20))
+        {
+            ZoneScopedN("TileCache::compact");
+            auto out = std::ofstream(temporary, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(data), file_header);
+
+            auto order = std::vector<std::pair<std::uint64_t, std::uint64_t>>();
+            order.reserve(_records.size());
+            for (const auto &[key, stored] : _records) order.emplace_back(stored.offset, key);
+            std::sort(order.begin(), order.end());
+
+            auto moved   = std::vector<std::pair<std::uint64_t, std::uint64_t>>();
+            auto written = file_header;
+            moved.reserve(order.size());
+            for (const auto &[old_offset, key] : order)
+            {
+                const auto begin  = old_offset - sizeof(record_header);
+                const auto length = ::padded(sizeof(record_header) + _records[key].size);
+                out.write(
+                  reinterpret_cast<const char *>(data + begin),
+                  static_cast<std::streamsize>(length));
+                moved.emplace_back(key, written + sizeof(record_header));
+                written += length;
+            }
+
+            out.close();
+            compacted = static_cast<bool>(out);
+            if (compacted)
+            {
+                for (const auto &[key, offset] : moved) _records[key].offset = offset;
+                good_end = written;
+            }
+            else
+                std::filesystem::remove(temporary, error);
+        }
+    }
+
+    // Only once unmapped, neither works on a mapped file everywhere
+    if (compacted)
+    {
+        std::filesystem::rename(temporary, path, error);
+        if (error)
+        {
+            std::cerr << "Couldn't compact the tile cache: " << error.message() << std::endl;
+            _records.clear();
+            return;
+        }
+    }
+    else if (good_end < file_size)
+    {
+        std::filesystem::resize_file(path, good_end, error);
+        if (error)
+        {
+            _records.clear();
+            return;
+        }
+    }
+
+    _end = good_end;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <tsl/robin_map.h>
+
+#include <map/tile_pyramid.h>
+#include <map/tile_renderer.h>
+
+namespace vx3d::map
+{
+    // Rendered tiles of one world and mode on disk, every level of the pyramid. The file is a
+    // log of 8 byte aligned records, a tile stored again is appended and the older copy dropped
+    // when the file is next opened and found to be mostly stale. Chunk tiles carry the time stamps
+    // of the chunks they're rendered from, so they're served straight from here until one changes.
+    class tile_cache
+    {
+    public:
+        // Of `find`, across every file the cache opened
+        struct lookups
+        {
+            std::uint64_t hits   = 0;
+            std::uint64_t misses = 0;
+        };
+
+        tile_cache() = default;
+
+        ~tile_cache();
+
+        tile_cache(const tile_cache &) = delete;
+
+        tile_cache &operator=(const tile_cache &) = delete;
+
+        /// Closes the current file and reads the index of another one, an empty path just closes
+        void open(const std::filesystem::path &world_folder, tile_mode mode);
+
+        void close();
+
+        /// \param key See `tile_key`
+        /// \param time_stamp See `tile_stamp` for level 0 tiles, 0 above
+        [[nodiscard]] bool contains(std::uint64_t key, std::uint32_t time_stamp) const;
+
+        /// \return The tile if it's stored with the same time stamp
+        [[nodiscard]] std::optional<tile> find(std::uint64_t key, std::uint32_t time_stamp);
+
+        /// Appends tiles, their time stamps are stored along with them
+        void store(const std::vector<tile> &tiles);
+
+        [[nodiscard]] std::size_t size() const;
+
+        /// Whether there's a file, without one nothing is found and stores are dropped
+        [[nodiscard]] bool is_open() const;
+
+        [[nodiscard]] lookups lookup_counts() const;
+
+    private:
+        struct record
+        {
+            std::uint64_t offset     = 0;    // Of the payload
+            std::uint32_t time_stamp = 0;
+            std::uint16_t size       = 0;
+            std::uint8_t  encoding   = 0;
+        };
+
+        /// Indexes the records of the file, truncating a record cut short and dropping stale ones
+        void _load(const std::filesystem::path &path);
+
+        mutable std::mutex _mutex;
+
+        std::fstream  _file;
+        std::uint64_t _end = 0;
+        lookups       _lookups;
+
+        tsl::robin_map<std::uint64_t, record, tile_key_hash> _records;
+    };
+}    // namespace vx3d::map
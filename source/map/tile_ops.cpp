@@ -0,0 +1,123 @@
+#include "tile_ops.h"
+
+#include <util/simd.h>
+
+namespace
+{
+    [[nodiscard]] constexpr std::uint32_t divide_255(std::uint32_t value) noexcept
+    {
+        value += 128;
+        return (value + (value >> 8)) >> 8;
+    }
+
+#if defined(VX3D_SIMD_SSE2)
+    // x / 255 rounded on 16 bit lanes, (x + 128 + ((x + 128) >> 8)) >> 8
+    [[nodiscard]] inline __m128i divide_255(__m128i value) noexcept
+    {
+        value = _mm_add_epi16(value, _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+    }
+#endif
+
+#if defined(VX3D_SIMD_AVX2)
+    [[nodiscard]] inline __m256i divide_255(__m256i value) noexcept
+    {
+        value = _mm256_add_epi16(value, _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(value, _mm256_srli_epi16(value, 8)), 8);
+    }
+#endif
+}    // namespace
+
+void vx3d::map::multiply_tile(rgba *pixels, const rgba *factors) noexcept
+{
+#if defined(VX3D_SIMD_AVX2)
+    const auto zero = _mm256_setzero_si256();
+    for (auto i = 0; i < tile_pixels; i += 8)
+    {
+        const auto pixel  = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i));
+        const auto factor = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(factors + i));
+
+        const auto low = ::divide_255(
+          _mm256_mullo_epi16(_mm256_unpacklo_epi8(pixel, zero), _mm256_unpacklo_epi8(factor, zero)));
+        const auto high = ::divide_255(
+          _mm256_mullo_epi16(_mm256_unpackhi_epi8(pixel, zero), _mm256_unpackhi_epi8(factor, zero)));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pixels + i), _mm256_packus_epi16(low, high));
+    }
+#elif defined(VX3D_SIMD_SSE2)
+    const auto zero = _mm_setzero_si128();
+    for (auto i = 0; i < tile_pixels; i += 4)
+    {
+        const auto pixel  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        const auto factor = _mm_loadu_si128(reinterpret_cast<const __m128i *>(factors + i));
+
+        const auto low = ::divide_255(
+          _mm_mullo_epi16(_mm_unpacklo_epi8(pixel, zero), _mm_unpacklo_epi8(factor, zero)));
+        const auto high = ::divide_255(
+          _mm_mullo_epi16(_mm_unpackhi_epi8(pixel, zero), _mm_unpackhi_epi8(factor, zero)));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), _mm_packus_epi16(low, high));
+    }
+#else
+    for (auto i = 0; i < tile_pixels; i++)
+    {
+        auto result = rgba(0);
+        for (auto shift = 0; shift < 32; shift += 8)
+            result |= ::divide_255(((pixels[i] >> shift) & 0xFF) * ((factors[i] >> shift) & 0xFF))
+              << shift;
+        pixels[i] = result;
+    }
+#endif
+}
+
+void vx3d::map::blend_tile(rgba *pixels, const rgba *overlay) noexcept
+{
+#if defined(VX3D_SIMD_SSE2)
+    const auto zero       = _mm_setzero_si128();
+    const auto full       = _mm_set1_epi16(255);
+    const auto keep_alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    for (auto i = 0; i < tile_pixels; i += 4)
+    {
+        const auto pixel = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        const auto over  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(overlay + i));
+
+        // Broadcast each overlay alpha over the four channels of its pixel
+        auto alpha = _mm_srli_epi32(over, 24);
+        alpha      = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16));
+        alpha      = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 8));
+
+        const auto blend = [&](__m128i p, __m128i o, __m128i a)
+        {
+            return ::divide_255(
+              _mm_add_epi16(_mm_mullo_epi16(p, _mm_sub_epi16(full, a)), _mm_mullo_epi16(o, a)));
+        };
+
+        const auto low = blend(
+          _mm_unpacklo_epi8(pixel, zero),
+          _mm_unpacklo_epi8(over, zero),
+          _mm_unpacklo_epi8(alpha, zero));
+        const auto high = blend(
+          _mm_unpackhi_epi8(pixel, zero),
+          _mm_unpackhi_epi8(over, zero),
+          _mm_unpackhi_epi8(alpha, zero));
+
+        const auto result = _mm_or_si128(
+          _mm_andnot_si128(keep_alpha, _mm_packus_epi16(low, high)),
+          _mm_and_si128(keep_alpha, pixel));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), result);
+    }
+#else
+    for (auto i = 0; i < tile_pixels; i++)
+    {
+        const auto alpha  = overlay[i] >> 24;
+        auto       result = pixels[i] & 0xFF000000;
+        for (auto shift = 0; shift < 24; shift += 8)
+        {
+            const auto p = (pixels[i] >> shift) & 0xFF;
+            const auto o = (overlay[i] >> shift) & 0xFF;
+            result |= ::divide_255(p * (255 - alpha) + o * alpha) << shift;
+        }
+        pixels[i] = result;
+    }
+#endif
+}
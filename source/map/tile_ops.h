@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+namespace vx3d::map
+{
+    // Packed 0xAABBGGRR, so the bytes sit in memory as R, G, B, A and upload as GL_RGBA8
+    using rgba = std::uint32_t;
+
+    [[nodiscard]] constexpr rgba make_rgba(std::uint32_t rgb, std::uint8_t alpha = 255) noexcept
+    {
+        return ((rgb >> 16) & 0xFF) | (rgb & 0xFF00) | ((rgb & 0xFF) << 16) |
+          (static_cast<std::uint32_t>(alpha) << 24);
+    }
+
+    /// Multiplies the colour of a pixel by a factor's channel by channel, alpha is kept
+    [[nodiscard]] constexpr rgba multiply_rgb(rgba color, rgba factor) noexcept
+    {
+        auto result = color & 0xFF000000;
+        for (auto shift = 0; shift < 24; shift += 8)
+            result |= (((color >> shift) & 0xFF) * ((factor >> shift) & 0xFF) / 255) << shift;
+        return result;
+    }
+
+    /// Darkens the colour of a pixel by a grey factor, 255 leaves it unchanged and alpha is kept
+    [[nodiscard]] constexpr rgba shade_rgb(rgba color, std::uint8_t factor) noexcept
+    {
+        return multiply_rgb(color, factor * 0x010101u);
+    }
+
+    // Pixels in a 16x16 tile, one per block column
+    constexpr auto tile_pixels = 256;
+
+    /// Multiplies every channel of a tile by a per pixel factor, 255 leaves a channel unchanged
+    void multiply_tile(rgba *pixels, const rgba *factors) noexcept;
+
+    /// Blends a per pixel overlay over a tile using the overlay's alpha, the tile keeps its alpha
+    void blend_tile(rgba *pixels, const rgba *overlay) noexcept;
+}    // namespace vx3d::map
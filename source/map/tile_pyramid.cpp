@@ -0,0 +1,196 @@
+#include "tile_pyramid.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <tracy/Tracy.hpp>
+
+namespace
+{
+    // Pixels [min, max) of a tile, per axis
+    struct pixel_rect
+    {
+        std::int32_t min_x = 0;
+        std::int32_t min_z = 0;
+        std::int32_t max_x = 16;
+        std::int32_t max_z = 16;
+    };
+
+    // Averages the covered pixels of a 2x2 block, so the edge of the world doesn't fade out
+    [[nodiscard]] vx3d::map::rgba average(
+      vx3d::map::rgba a,
+      vx3d::map::rgba b,
+      vx3d::map::rgba c,
+      vx3d::map::rgba d) noexcept
+    {
+        auto sums    = std::array<std::uint32_t, 4>();
+        auto covered = std::uint32_t(0);
+        for (const auto pixel : { a, b, c, d })
+        {
+            if (!(pixel >> 24)) continue;
+            covered++;
+            for (auto channel = 0; channel < 4; channel++)
+                sums[channel] += (pixel >> (channel * 8)) & 0xFF;
+        }
+
+        if (!covered) return 0;
+
+        auto averaged = vx3d::map::rgba(0);
+        for (auto channel = 0; channel < 4; channel++)
+            averaged |= ((sums[channel] + covered / 2) / covered) << (channel * 8);
+        return averaged;
+    }
+
+    /// Downsamples the changed pixels of a tile into its quadrant of the tile above
+    /// \return The pixels of the tile above that changed
+    [[nodiscard]] pixel_rect downsample(
+      const vx3d::map::tile &child,
+      const pixel_rect &     changed,
+      vx3d::map::tile &      parent) noexcept
+    {
+        const auto offset_x = (child.x & 1) * 8;
+        const auto offset_z = (child.z & 1) * 8;
+
+        auto rect  = pixel_rect();
+        rect.min_x = offset_x + changed.min_x / 2;
+        rect.min_z = offset_z + changed.min_z / 2;
+        rect.max_x = offset_x + (changed.max_x + 1) / 2;
+        rect.max_z = offset_z + (changed.max_z + 1) / 2;
+
+        const auto *from = child.pixels.data();
+        for (auto z = rect.min_z; z < rect.max_z; z++)
+            for (auto x = rect.min_x; x < rect.max_x; x++)
+            {
+                const auto source = (z - offset_z) * 32 + (x - offset_x) * 2;
+                parent.pixels[z * 16 + x] =
+                  ::average(from[source], from[source + 1], from[source + 16], from[source + 17]);
+            }
+
+        return rect;
+    }
+}    // namespace
+
+std::uint8_t vx3d::map::tile_level(float blocks_per_pixel) noexcept
+{
+    if (!(blocks_per_pixel > 1.0f)) return 0;
+    const auto level = static_cast<int>(std::ceil(std::log2(blocks_per_pixel)));
+    return static_cast<std::uint8_t>(std::min<int>(level, max_tile_level));
+}
+
+vx3d::map::tile_pyramid::tile_pyramid(std::size_t budget_bytes)
+    : _max_tiles(std::max<std::size_t>(budget_bytes / sizeof(entry), max_tile_level))
+{
+}
+
+void vx3d::map::tile_pyramid::set_backing(tile_source source, tile_sink sink)
+{
+    _source = std::move(source);
+    _sink   = std::move(sink);
+}
+
+void vx3d::map::tile_pyramid::insert(const tile &base)
+{
+    ZoneScopedN("TilePyramid::insert");
+
+    auto        changed = ::pixel_rect();
+    const auto *child   = &base;
+    for (auto level = std::uint8_t(1); level <= max_tile_level; level++)
+    {
+        auto &parent = _tile(level, child->x >> 1, child->z >> 1);
+        changed      = ::downsample(*child, changed, parent);
+        _changed.insert(tile_key(level, parent.x, parent.z));
+        child = &parent;
+    }
+
+    // Only now, the chain just touched is at the front and can't be what goes
+    _evict();
+}
+
+const vx3d::map::tile *vx3d::map::tile_pyramid::find(std::uint64_t key)
+{
+    const auto at = _find(key);
+    if (at == _entries.end()) return nullptr;
+
+    _evict();
+    return &at->tile;
+}
+
+std::vector<std::uint64_t> vx3d::map::tile_pyramid::take_changed()
+{
+    auto changed = std::vector<std::uint64_t>(_changed.begin(), _changed.end());
+    _changed.clear();
+    return changed;
+}
+
+void vx3d::map::tile_pyramid::flush()
+{
+    ZoneScopedN("TilePyramid::flush");
+    auto dirty = std::vector<tile>();
+    for (auto &stored : _entries)
+        if (stored.dirty)
+        {
+            dirty.push_back(stored.tile);
+            stored.dirty = false;
+        }
+
+    if (_sink && !dirty.empty()) _sink(dirty);
+}
+
+void vx3d::map::tile_pyramid::clear()
+{
+    _entries.clear();
+    _lookup.clear();
+    _changed.clear();
+}
+
+std::list<vx3d::map::tile_pyramid::entry>::iterator vx3d::map::tile_pyramid::_find(std::uint64_t key)
+{
+    if (const auto at = _lookup.find(key); at != _lookup.end())
+    {
+        _entries.splice(_entries.begin(), _entries, at->second);
+        return at->second;
+    }
+
+    if (!_source) return _entries.end();
+
+    auto loaded = _source(key);
+    if (!loaded) return _entries.end();
+
+    auto &created = _entries.emplace_front();
+    created.key   = key;
+    created.tile  = *loaded;
+    _lookup.insert({ key, _entries.begin() });
+    return _entries.begin();
+}
+
+vx3d::map::tile &vx3d::map::tile_pyramid::_tile(std::uint8_t level, std::int32_t x, std::int32_t z)
+{
+    const auto key = tile_key(level, x, z);
+    auto       at  = _find(key);
+    if (at == _entries.end())
+    {
+        auto &created      = _entries.emplace_front();
+        created.key        = key;
+        created.tile.x     = x;
+        created.tile.z     = z;
+        created.tile.level = level;
+        _lookup.insert({ key, _entries.begin() });
+        at = _entries.begin();
+    }
+
+    at->dirty = true;
+    return at->tile;
+}
+
+void vx3d::map::tile_pyramid::_evict()
+{
+    auto dirty = std::vector<tile>();
+    while (_entries.size() > _max_tiles)
+    {
+        if (_entries.back().dirty) dirty.push_back(_entries.back().tile);
+        _lookup.erase(_entries.back().key);
+        _entries.pop_back();
+    }
+
+    if (_sink && !dirty.empty()) _sink(dirty);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <optional>
+#include <vector>
+
+#include <tsl/robin_map.h>
+#include <tsl/robin_set.h>
+
+#include <map/tile_renderer.h>
+
+namespace vx3d::map
+{
+    // A level 12 tile is 4096 chunks across, the whole world border fits on a screen
+    constexpr std::uint8_t max_tile_level = 12;
+
+    /// Identifies a tile of any level, 30 bits per coordinate is plenty for chunk coordinates
+    [[nodiscard]] constexpr std::uint64_t
+      tile_key(std::uint8_t level, std::int32_t x, std::int32_t z) noexcept
+    {
+        return static_cast<std::uint64_t>(level) << 60 |
+          (static_cast<std::uint64_t>(x) & 0x3FFFFFFF) << 30 |
+          (static_cast<std::uint64_t>(z) & 0x3FFFFFFF);
+    }
+
+    // Keys of neighbouring tiles only differ in their upper bits, which the identity hash of
+    // std::hash leaves out of the bucket index
+    struct tile_key_hash
+    {
+        [[nodiscard]] std::size_t operator()(std::uint64_t key) const noexcept
+        {
+            key ^= key >> 33;
+            key *= 0xFF51AFD7ED558CCD;
+            key ^= key >> 33;
+            return static_cast<std::size_t>(key);
+        }
+    };
+
+    /// Lowest level whose pixels are at least as big as a screen pixel
+    /// \param blocks_per_pixel Blocks along one screen pixel, the zoom of the map view
+    [[nodiscard]] std::uint8_t tile_level(float blocks_per_pixel) noexcept;
+
+    // Mip pyramid over the chunk tiles, each tile of a level is a 2x2 downsample of the four
+    // below it. Built bottom up as chunk tiles come in, only the part of every level above that
+    // a chunk covers is touched, so a chunk that changed just has to be inserted again. Tiles
+    // past the budget are dropped least recently used first, or handed to a backing store.
+    class tile_pyramid
+    {
+    public:
+        using tile_source = std::function<std::optional<tile>(std::uint64_t key)>;
+        using tile_sink   = std::function<void(const std::vector<tile> &tiles)>;
+
+        explicit tile_pyramid(std::size_t budget_bytes = std::size_t(256) << 20);
+
+        /// Where tiles come from when they aren't in memory and where changed ones go when they
+        /// leave it, so chunks inserted later only update their part of a stored tile
+        void set_backing(tile_source source, tile_sink sink);
+
+        /// Folds a chunk tile into every level above it
+        void insert(const tile &base);
+
+        /// \param key See `tile_key`
+        /// \return nullptr for level 0 and tiles nothing was inserted under yet
+        [[nodiscard]] const tile *find(std::uint64_t key);
+
+        /// Keys of the tiles that changed since the last call
+        [[nodiscard]] std::vector<std::uint64_t> take_changed();
+
+        /// Hands every changed tile to the sink
+        void flush();
+
+        /// Forgets every tile, without flushing
+        void clear();
+
+    private:
+        struct entry
+        {
+            std::uint64_t key;
+            map::tile     tile;
+            bool          dirty = false;
+        };
+
+        /// Brings a tile in from the source if it isn't in memory
+        /// \return _entries.end() if neither has it
+        [[nodiscard]] std::list<entry>::iterator _find(std::uint64_t key);
+
+        [[nodiscard]] map::tile &_tile(std::uint8_t level, std::int32_t x, std::int32_t z);
+
+        void _evict();
+
+        std::size_t _max_tiles;
+        tile_source _source;
+        tile_sink   _sink;
+
+        // Front is the most recently used
+        std::list<entry>                                          _entries;
+        tsl::robin_map<std::uint64_t, std::list<entry>::iterator, tile_key_hash> _lookup;
+        tsl::robin_set<std::uint64_t, tile_key_hash>                             _changed;
+    };
+}    // namespace vx3d::map
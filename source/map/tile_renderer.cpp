@@ -0,0 +1,428 @@
+#include "tile_renderer.h"
+
+#include <algorithm>
+
+#include <tsl/robin_map.h>
+#include <tracy/Tracy.hpp>
+
+#include <loader/world_loader.h>
+#include <map/biome_tint.h>
+#include <map/block_colors.h>
+#include <map/light_shading.h>
+#include <util/bc1.h>
+
+namespace
+{
+    // Chunks are rendered in squares of this many chunks across
+    constexpr auto batch_width = 8;
+
+    // Height shading, the same three steps the in-game map uses
+    constexpr auto shade_higher = vx3d::map::make_rgba(0xFFFFFF);
+    constexpr auto shade_level  = vx3d::map::make_rgba(0xDCDCDC);
+    constexpr auto shade_lower  = vx3d::map::make_rgba(0xB4B4B4);
+
+    [[nodiscard]] vx3d::map::rgba lerp(vx3d::map::rgba a, vx3d::map::rgba b, float t) noexcept
+    {
+        auto mixed = vx3d::map::rgba(0);
+        for (auto shift = 0; shift < 32; shift += 8)
+        {
+            const auto from  = static_cast<float>((a >> shift) & 0xFF);
+            const auto to    = static_cast<float>((b >> shift) & 0xFF);
+            const auto value = static_cast<std::uint32_t>(from + (to - from) * t + 0.5f);
+            mixed |= std::min(value, 255u) << shift;
+        }
+        return mixed;
+    }
+
+    // Height above the surface of the ground a column shows, water is looked through
+    [[nodiscard]] std::int16_t ground_height(const vx3d::map::column_summary &summary, int column)
+    {
+        return summary.floor_height[column] != vx3d::map::column_summary::no_surface
+          ? summary.floor_height[column]
+          : summary.surface_height[column];
+    }
+
+    void render_color(
+      const vx3d::map::column_summary &summary,
+      const vx3d::map::column_summary *north,
+      vx3d::map::rgba *                pixels)
+    {
+        using namespace vx3d::map;
+        using vx3d::loader::block_registry;
+
+        const auto &colors = block_color_table::get();
+        const auto &tints  = biome_tint_table::get();
+
+        auto tint_types = std::array<vx3d::loader::tint_type, tile_pixels>();
+        auto shading    = std::array<rgba, tile_pixels>();
+        auto water      = std::array<rgba, tile_pixels>();
+
+        for (auto column = 0; column < tile_pixels; column++)
+        {
+            water[column]   = 0;
+            shading[column] = shade_higher;
+
+            const auto height = summary.surface_height[column];
+            if (height == column_summary::no_surface)
+            {
+                pixels[column]     = 0;
+                tint_types[column] = vx3d::loader::tint_type::none;
+                continue;
+            }
+
+            const auto &surface  = block_registry::info(summary.surface_block[column]);
+            const auto  has_floor = summary.floor_height[column] != column_summary::no_surface;
+            const auto  shown     = surface.is_water() && has_floor ? summary.floor_block[column]
+                                                                    : summary.surface_block[column];
+
+            pixels[column]     = colors.color(shown);
+            tint_types[column] = block_registry::info(shown).tint;
+
+            if (surface.is_water())
+            {
+                // Shallow water shows the floor, deep water is close to opaque
+                const auto depth = has_floor ? summary.water_depth(column) : 64;
+                const auto alpha = std::clamp(110 + depth * 12, 110, 235);
+                water[column]    = (tints.color(vx3d::loader::tint_type::water, summary.biome[column]) &
+                                 0x00FFFFFF) |
+                  static_cast<rgba>(alpha) << 24;
+                continue;
+            }
+
+            // Lit from the north like the in-game map, the row at z = 0 looks into the next chunk
+            const auto z            = column / 16;
+            const auto north_height = z > 0 ? ::ground_height(summary, column - 16)
+              : north                       ? ::ground_height(*north, column + 240)
+                                            : column_summary::no_surface;
+            const auto own_height   = ::ground_height(summary, column);
+
+            if (north_height == column_summary::no_surface || own_height > north_height)
+                shading[column] = shade_higher;
+            else if (own_height == north_height)
+                shading[column] = shade_level;
+            else
+                shading[column] = shade_lower;
+        }
+
+        tints.apply(pixels, summary.biome.data(), tint_types.data());
+        multiply_tile(pixels, shading.data());
+        blend_tile(pixels, water.data());
+    }
+
+    // The light kernels work on a sampled chunk, a lit summary kept everything they look at
+    [[nodiscard]] vx3d::map::surface_light light_of(const vx3d::map::column_summary &summary)
+    {
+        auto light      = vx3d::map::surface_light();
+        light.sky       = summary.sky_light;
+        light.block     = summary.block_light;
+        light.spawnable = summary.spawnable;
+        return light;
+    }
+
+    void render_biome(const vx3d::map::column_summary &summary, vx3d::map::rgba *pixels)
+    {
+        using namespace vx3d::map;
+        const auto &tints = biome_tint_table::get();
+
+        for (auto column = 0; column < tile_pixels; column++)
+        {
+            const auto &surface = vx3d::loader::block_registry::info(summary.surface_block[column]);
+            const auto  tint    = surface.is_water() ? vx3d::loader::tint_type::water
+                                                     : vx3d::loader::tint_type::grass;
+            pixels[column] = summary.surface_height[column] == column_summary::no_surface
+              ? 0
+              : tints.color(tint, summary.biome[column]);
+        }
+    }
+
+    void render_depth(const vx3d::map::column_summary &summary, vx3d::map::rgba *pixels)
+    {
+        using namespace vx3d::map;
+
+        for (auto column = 0; column < tile_pixels; column++)
+        {
+            const auto height = summary.surface_height[column];
+            if (height == column_summary::no_surface)
+            {
+                pixels[column] = 0;
+                continue;
+            }
+
+            const auto &surface = vx3d::loader::block_registry::info(summary.surface_block[column]);
+            if (surface.is_water())
+            {
+                const auto depth = summary.floor_height[column] == column_summary::no_surface
+                  ? 64
+                  : summary.water_depth(column);
+                pixels[column] = ::lerp(
+                  make_rgba(0x7FC8FF),
+                  make_rgba(0x081850),
+                  std::clamp(static_cast<float>(depth) / 48.0f, 0.0f, 1.0f));
+            }
+            else
+                pixels[column] = ::lerp(
+                  make_rgba(0x1A3A12),
+                  make_rgba(0xF4F0E8),
+                  std::clamp(static_cast<float>(height + 64) / 384.0f, 0.0f, 1.0f));
+        }
+    }
+}    // namespace
+
+void vx3d::map::render_tile(
+  const summary_neighbourhood &around,
+  tile_mode                    mode,
+  const relief_light &         light,
+  rgba *                       pixels) noexcept
+{
+    const auto &summary = *around[4];
+    switch (mode)
+    {
+    case tile_mode::color:
+    case tile_mode::slice: ::render_color(summary, around[1], pixels); break;
+    case tile_mode::biome: ::render_biome(summary, pixels); break;
+    case tile_mode::depth: ::render_depth(summary, pixels); break;
+    case tile_mode::relief:
+    {
+        auto shading = std::array<rgba, tile_pixels>();
+        shade_relief(gather_relief_heights(around), light, shading.data());
+        ::render_depth(summary, pixels);
+        multiply_tile(pixels, shading.data());
+        break;
+    }
+    case tile_mode::night:
+        ::render_color(summary, around[1], pixels);
+        shade_night(pixels, ::light_of(summary));
+        break;
+    case tile_mode::light_levels:
+        ::render_color(summary, around[1], pixels);
+        shade_light_levels(pixels, ::light_of(summary), spawn_light_limit(summary.data_version));
+        break;
+    // Drawn straight from the region headers, never from a summary
+    case tile_mode::age:
+    case tile_mode::size:
+    case tile_mode::oversized: break;
+    }
+}
+
+vx3d::map::tile_renderer::tile_renderer(summary_source source, std::uint32_t threads)
+    : _source(std::move(source)), _thread_pool(vx3d::default_worker_count(threads))
+{
+}
+
+std::vector<vx3d::map::tile>
+  vx3d::map::tile_renderer::render(const std::vector<glm::ivec2> &chunks, tile_mode mode) const
+{
+    ZoneScopedN("TileRenderer::render");
+    auto tiles = std::vector<tile>();
+    tiles.reserve(chunks.size());
+
+    auto light = relief_light();
+    auto slice = slice_range();
+    {
+        auto guard = std::lock_guard(_mutex);
+        light      = _light;
+        slice      = _slice;
+    }
+
+    // Chunks of a batch are neighbours, so each summary is only fetched once for all of them
+    auto       fetched = tsl::robin_map<std::uint64_t, std::shared_ptr<const column_summary>>();
+    const auto fetch   = [&](std::int32_t x, std::int32_t z)
+    {
+        const auto key = world_loader::hash_pos(x, z);
+        auto       at  = fetched.find(key);
+        if (at == fetched.end()) at = fetched.insert({ key, _source(x, z, mode, slice) }).first;
+        return at->second.get();
+    };
+
+    const auto needed = neighbours_of(mode);
+    for (const auto &chunk : chunks)
+    {
+        auto around = summary_neighbourhood();
+        around[4]   = fetch(chunk.x, chunk.y);
+        if (!around[4]) continue;
+
+        for (auto i = 0; i < 9; i++)
+            if (needed & (1 << i)) around[i] = fetch(chunk.x + i % 3 - 1, chunk.y + i / 3 - 1);
+
+        auto stamps = std::array<std::uint32_t, 9>();
+        for (auto i = 0; i < 9; i++)
+            if (around[i]) stamps[i] = around[i]->time_stamp;
+
+        auto &rendered      = tiles.emplace_back();
+        rendered.x          = chunk.x;
+        rendered.z          = chunk.y;
+        rendered.time_stamp = tile_stamp(mode, stamps);
+        render_tile(around, mode, light, rendered.pixels.data());
+    }
+
+    return tiles;
+}
+
+void vx3d::map::tile_renderer::request(const std::vector<glm::ivec2> &chunks, tile_mode mode)
+{
+    ZoneScopedN("TileRenderer::request");
+
+    // Bucketed into squares, and sorted north to south in each so the northern neighbour a row
+    // shades against was usually just fetched
+    auto batches    = tsl::robin_map<std::uint64_t, std::vector<glm::ivec2>>();
+    auto compressed = false;
+    {
+        auto guard = std::lock_guard(_mutex);
+        compressed = _compressed;
+        for (const auto &chunk : chunks)
+        {
+            if (!_queued.insert(world_loader::hash_pos(chunk.x, chunk.y)).second) continue;
+            const auto batch = world_loader::hash_pos(
+              chunk.x >= 0 ? chunk.x / batch_width : (chunk.x + 1) / batch_width - 1,
+              chunk.y >= 0 ? chunk.y / batch_width : (chunk.y + 1) / batch_width - 1);
+            batches[batch].push_back(chunk);
+        }
+    }
+
+    const auto generation = _generation.load();
+    for (auto at = batches.begin(); at != batches.end(); ++at)
+    {
+        auto &batch = at.value();
+        std::sort(
+          batch.begin(),
+          batch.end(),
+          [](const auto &a, const auto &b) { return a.y != b.y ? a.y < b.y : a.x < b.x; });
+
+        _thread_pool.submit_task(
+          [this, batch = std::move(batch), mode, compressed, generation]
+          {
+              ZoneScopedN("TileRenderer::batch");
+              if (generation != _generation) return;
+
+              auto tiles = render(batch, mode);
+
+              // Chunks that couldn't be summarised get an empty tile, so they aren't asked for
+              // again every frame
+              if (tiles.size() != batch.size())
+              {
+                  auto rendered = tsl::robin_set<std::uint64_t>();
+                  for (const auto &tile : tiles) rendered.insert(world_loader::hash_pos(tile.x, tile.z));
+                  for (const auto &chunk : batch)
+                      if (!rendered.count(world_loader::hash_pos(chunk.x, chunk.y)))
+                      {
+                          auto &empty = tiles.emplace_back();
+                          empty.x     = chunk.x;
+                          empty.z     = chunk.y;
+                      }
+              }
+
+              // Here rather than when the atlas takes them, which happens on the render thread
+              if (compressed)
+              {
+                  ZoneScopedN("TileRenderer::compress");
+                  for (auto &tile : tiles)
+                  {
+                      tile.blocks.resize(bc1::tile_bytes);
+                      bc1::compress_tile(tile.pixels.data(), tile.blocks.data());
+                  }
+              }
+
+              auto guard = std::lock_guard(_mutex);
+              if (generation != _generation) return;
+              for (const auto &chunk : batch) _queued.erase(world_loader::hash_pos(chunk.x, chunk.y));
+              std::move(tiles.begin(), tiles.end(), std::back_inserter(_finished));
+          });
+    }
+}
+
+std::vector<vx3d::map::tile> vx3d::map::tile_renderer::take_finished()
+{
+    auto guard    = std::lock_guard(_mutex);
+    auto finished = std::move(_finished);
+    _finished.clear();
+    return finished;
+}
+
+std::size_t vx3d::map::tile_renderer::pending()
+{
+    auto guard = std::lock_guard(_mutex);
+    return _queued.size();
+}
+
+bool vx3d::map::tile_renderer::idle()
+{
+    auto guard = std::lock_guard(_mutex);
+    return _queued.empty() && _finished.empty();
+}
+
+void vx3d::map::tile_renderer::set_relief_light(const relief_light &light)
+{
+    auto guard = std::lock_guard(_mutex);
+    _light     = light;
+}
+
+void vx3d::map::tile_renderer::set_slice(const slice_range &slice)
+{
+    auto guard = std::lock_guard(_mutex);
+    _slice     = slice;
+}
+
+void vx3d::map::tile_renderer::set_compressed(bool compressed)
+{
+    auto guard  = std::lock_guard(_mutex);
+    _compressed = compressed;
+}
+
+void vx3d::map::tile_renderer::clear()
+{
+    auto guard = std::lock_guard(_mutex);
+    _generation++;
+    _queued.clear();
+    _finished.clear();
+}
+
+vx3d::map::tile_renderer::summary_source vx3d::map::world_summaries(world_loader &loader)
+{
+    return [&loader](std::int32_t x, std::int32_t z, tile_mode mode, const slice_range &slice)
+    {
+        // Slices depend on the range, so they're made every time rather than stored
+        if (mode == tile_mode::slice) return loader.load_slice(x, z, slice.top, slice.bottom);
+        return loader.load_summary(x, z, needs_light(mode));
+    };
+}
+
+std::vector<std::uint32_t> vx3d::map::tile_stamps(
+  world_loader &                             loader,
+  tile_mode                                  mode,
+  const std::vector<loader::chunk_location> &locations)
+{
+    ZoneScopedN("TileRenderer::tile_stamps");
+    const auto needed = neighbours_of(mode);
+
+    auto known = tsl::robin_map<std::uint64_t, std::uint32_t>();
+    for (const auto &location : locations)
+        known[world_loader::hash_pos(location.x, location.z)] = location.time_stamp;
+
+    // Most neighbours are among the chunks asked about, only those around the edge are looked up
+    auto outside = std::vector<loader::chunk_location>();
+    for (const auto &location : locations)
+        for (auto i = 0; i < 9; i++)
+        {
+            const auto x = location.x + i % 3 - 1;
+            const auto z = location.z + i / 3 - 1;
+            if (needed & (1 << i) && !known.count(world_loader::hash_pos(x, z))) outside.emplace_back(x, z);
+        }
+    for (const auto &location : loader.get_locations(outside))
+        known[world_loader::hash_pos(location.x, location.z)] = location.time_stamp;
+
+    auto stamps = std::vector<std::uint32_t>();
+    stamps.reserve(locations.size());
+    for (const auto &location : locations)
+    {
+        auto around = std::array<std::uint32_t, 9>();
+        for (auto i = 0; i < 9; i++)
+        {
+            if (i != 4 && !(needed & (1 << i))) continue;
+            const auto key = world_loader::hash_pos(location.x + i % 3 - 1, location.z + i / 3 - 1);
+            const auto at  = known.find(key);
+            if (at != known.end()) around[i] = at->second;
+        }
+        stamps.push_back(tile_stamp(mode, around));
+    }
+    return stamps;
+}
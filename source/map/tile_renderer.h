@@ -0,0 +1,188 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <tsl/robin_set.h>
+
+#include <thread_pool.h>
+#include <map/column_summary.h>
+#include <map/relief.h>
+#include <map/tile_ops.h>
+
+namespace vx3d
+{
+    class world_loader;
+}    // namespace vx3d
+
+namespace vx3d::loader
+{
+    struct chunk_location;
+}    // namespace vx3d::loader
+
+namespace vx3d::map
+{
+    enum class tile_mode : std::uint8_t
+    {
+        color,           // Block colours, biome tints, height shading and see-through water
+        biome,           // Flat biome colours
+        depth,           // Terrain height, and water depth for oceans
+        relief,          // Depth shaded by the slope of the ground, lit from `relief_light`
+        night,           // Colours as at midnight, only what blocks light keeps its colour
+        light_levels,    // Colours with dark surfaces marked, those monsters spawn on in red
+        slice,           // Colours of only the blocks in `slice_range`, caves and the nether's inside
+        age,             // When each chunk was last saved, see header_overlay.h for these three
+        size,            // How much of its region each chunk takes
+        oversized        // Chunks over a size threshold or moved out into a .mcc file
+    };
+
+    // Heights the slice mode looks between, inclusive, see `summarize_chunk`. A cap shows the
+    // highest block at or below `top`, a slice only the blocks at it.
+    struct slice_range
+    {
+        std::int32_t top    = 62;
+        std::int32_t bottom = std::numeric_limits<std::int32_t>::min();
+
+        [[nodiscard]] bool operator==(const slice_range &other) const noexcept
+        {
+            return top == other.top && bottom == other.bottom;
+        }
+
+        [[nodiscard]] bool operator!=(const slice_range &other) const noexcept
+        {
+            return !(*this == other);
+        }
+    };
+
+    // A chunk at level 0, above that a tile covers 2^level chunks across at one pixel per
+    // 2^level blocks, and x and z count tiles of that size
+    struct tile
+    {
+        std::int32_t                  x          = 0;
+        std::int32_t                  z          = 0;
+        std::uint8_t                  level      = 0;
+        std::uint32_t                 time_stamp = 0;    // See `tile_stamp`, for level 0 tiles
+        std::array<rgba, tile_pixels> pixels {};
+
+        // The pixels as BC1, when the renderer was asked for them, see `tile_renderer::set_compressed`.
+        // Only on the way to the atlas, the cache and the pyramid keep the pixels.
+        std::vector<std::uint8_t> blocks;
+    };
+
+    // The summaries of the 3x3 chunks around a chunk, row major from the north west and the chunk
+    // itself in the middle. Modes only look at the neighbours they need, see `neighbours_of`.
+    using summary_neighbourhood = std::array<const column_summary *, 9>;
+
+    /// Which neighbours a mode shades against, as a bit per index of `summary_neighbourhood`
+    [[nodiscard]] constexpr std::uint16_t neighbours_of(tile_mode mode) noexcept
+    {
+        return mode == tile_mode::relief ? 0b111101111
+          : mode == tile_mode::color || mode == tile_mode::night || mode == tile_mode::light_levels ||
+            mode == tile_mode::slice
+          ? 0b000000010
+          : 0;
+    }
+
+    /// The time stamp a level 0 tile is cached under. Shading against a neighbour makes the tile
+    /// go stale when the neighbour is saved again, so its stamp is mixed in with the chunk's own.
+    /// \param stamps Of the chunks around, indexed like `summary_neighbourhood`, 0 where there's none
+    [[nodiscard]] constexpr std::uint32_t
+      tile_stamp(tile_mode mode, const std::array<std::uint32_t, 9> &stamps) noexcept
+    {
+        auto       stamp  = stamps[4];
+        const auto needed = neighbours_of(mode);
+        for (auto i = 0; i < 9; i++)
+            if (i != 4 && needed & (1 << i)) stamp = stamp * 0x9E3779B1u ^ stamps[i];
+        return stamp;
+    }
+
+    /// Whether a mode shades by light, its summaries have to be made from chunks decoded with it
+    [[nodiscard]] constexpr bool needs_light(tile_mode mode) noexcept
+    {
+        return mode == tile_mode::night || mode == tile_mode::light_levels;
+    }
+
+    /// Paints the tile of one chunk, nothing in here touches the GPU
+    /// \param around The chunk in the middle, neighbours left out of `neighbours_of` may be nullptr
+    void render_tile(
+      const summary_neighbourhood &around,
+      tile_mode                    mode,
+      const relief_light &         light,
+      rgba *                       pixels) noexcept;
+
+    // Turns column summaries into tiles on a pool of worker threads. Requests are split into
+    // batches of neighbouring chunks, so the summaries of a batch (and the neighbours they shade
+    // against) are fetched together.
+    class tile_renderer
+    {
+    public:
+        /// Given the mode a chunk is rendered in, so light is only decoded for the modes that need it
+        /// and slices are summarised from the sections in range
+        using summary_source = std::function<std::shared_ptr<const column_summary>(
+          std::int32_t x, std::int32_t z, tile_mode mode, const slice_range &slice)>;
+
+        /// \param threads Workers to render with, 0 leaves one hardware thread for the caller
+        explicit tile_renderer(summary_source source, std::uint32_t threads = 0);
+
+        /// Renders chunks on the calling thread, chunks the source doesn't have are left out
+        [[nodiscard]] std::vector<tile>
+          render(const std::vector<glm::ivec2> &chunks, tile_mode mode = tile_mode::color) const;
+
+        /// Queues chunks to be rendered in the background, chunks already queued are skipped
+        void request(const std::vector<glm::ivec2> &chunks, tile_mode mode = tile_mode::color);
+
+        /// Tiles finished since the last call
+        [[nodiscard]] std::vector<tile> take_finished();
+
+        /// Chunks queued and not finished yet
+        [[nodiscard]] std::size_t pending();
+
+        /// Whether nothing is queued and every finished tile was taken
+        [[nodiscard]] bool idle();
+
+        /// Forgets everything queued or finished, for when the world or the mode changes
+        void clear();
+
+        /// Lights relief tiles requested from now on
+        void set_relief_light(const relief_light &light);
+
+        /// Heights of the slice tiles requested from now on
+        void set_slice(const slice_range &slice);
+
+        /// Whether tiles requested from now on come with their `blocks`, for a BC1 atlas
+        void set_compressed(bool compressed);
+
+    private:
+        summary_source _source;
+
+        // Bumped by `clear`, batches started before that throw their tiles away
+        std::atomic<std::uint32_t> _generation = 0;
+
+        mutable std::mutex            _mutex;
+        tsl::robin_set<std::uint64_t> _queued;
+        std::vector<tile>             _finished;
+        relief_light                  _light;
+        slice_range                   _slice;
+        bool                          _compressed = false;
+
+        // Last, so the workers are joined before anything they use goes away
+        vx3d::thread_pool _thread_pool;
+    };
+
+    /// Summaries of the world a loader has open, sliced or lit as the mode needs
+    [[nodiscard]] tile_renderer::summary_source world_summaries(world_loader &loader);
+
+    /// `tile_stamp` of every chunk out of the headers the loader has read
+    /// \param locations Chunks with a header, as `world_loader::chunks_in` hands them out
+    [[nodiscard]] std::vector<std::uint32_t> tile_stamps(
+      world_loader &                             loader,
+      tile_mode                                  mode,
+      const std::vector<loader::chunk_location> &locations);
+}    // namespace vx3d::map
@@ -0,0 +1,240 @@
+#include "world_export.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include <tracy/Tracy.hpp>
+
+#include <loader/world_loader.h>
+#include <thread_pool.h>
+#include <util/png.h>
+
+namespace
+{
+    // Output rows rendered and written at a time
+    constexpr auto strip_rows = std::int32_t(64);
+
+    // Block columns of a strip one task renders, a region across
+    constexpr auto task_blocks = std::int32_t(512);
+
+    constexpr auto report_interval = std::chrono::seconds(1);
+
+    /// Rounds towards negative infinity
+    /// \param step A power of two
+    [[nodiscard]] glm::ivec2 align_down(const glm::ivec2 &position, std::int32_t step) noexcept
+    {
+        return { position.x & -step, position.y & -step };
+    }
+
+    [[nodiscard]] double seconds_since(std::chrono::steady_clock::time_point start) noexcept
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Part of a strip, `step` is the size of a pixel in blocks and `from` the block in the top left
+    struct strip_task
+    {
+        glm::ivec2   from {};
+        std::int32_t columns = 0;    // In pixels, from the left of the task
+        std::int32_t rows    = 0;
+        std::int32_t step    = 1;
+    };
+
+    /// Renders the chunks under part of a strip and averages the covered blocks under every pixel,
+    /// the same way the tile pyramid does, so the edge of the world doesn't fade out
+    /// \param to The pixel at the top left of the task, rows `stride` pixels apart
+    /// \return Chunks rendered
+    std::size_t render_task(
+      const vx3d::map::tile_renderer &renderer,
+      vx3d::map::tile_mode            mode,
+      const strip_task &              task,
+      vx3d::map::rgba *               to,
+      std::size_t                     stride)
+    {
+        ZoneScopedN("WorldExport::render_task");
+        using namespace vx3d::map;
+
+        const auto pixels  = static_cast<std::size_t>(task.columns) * task.rows;
+        auto       sums    = std::vector<std::array<std::uint32_t, 4>>(pixels);
+        auto       covered = std::vector<std::uint32_t>(pixels);
+
+        const auto chunk_columns = task.columns * task.step / 16;
+        auto       chunks        = std::vector<glm::ivec2>(chunk_columns);
+        auto       rendered      = std::size_t(0);
+        for (auto z = task.from.y >> 4; z < (task.from.y + task.rows * task.step) >> 4; z++)
+        {
+            for (auto x = 0; x < chunk_columns; x++) chunks[x] = { (task.from.x >> 4) + x, z };
+
+            for (const auto &tile : renderer.render(chunks, mode))
+            {
+                rendered++;
+                for (auto column = 0; column < tile_pixels; column++)
+                {
+                    const auto pixel = tile.pixels[column];
+                    if (!(pixel >> 24)) continue;
+
+                    const auto x     = (tile.x * 16 + column % 16 - task.from.x) / task.step;
+                    const auto y     = (tile.z * 16 + column / 16 - task.from.y) / task.step;
+                    const auto index = static_cast<std::size_t>(y) * task.columns + x;
+                    covered[index]++;
+                    for (auto channel = 0; channel < 4; channel++)
+                        sums[index][channel] += (pixel >> (channel * 8)) & 0xFF;
+                }
+            }
+        }
+
+        for (auto y = 0; y < task.rows; y++)
+            for (auto x = 0; x < task.columns; x++)
+            {
+                const auto index = static_cast<std::size_t>(y) * task.columns + x;
+                auto       pixel = rgba(0);
+                if (const auto count = covered[index])
+                    for (auto channel = 0; channel < 4; channel++)
+                        pixel |= ((sums[index][channel] + count / 2) / count) << (channel * 8);
+                to[y * stride + x] = pixel;
+            }
+
+        return rendered;
+    }
+}    // namespace
+
+int vx3d::map::run_world_export(
+  const std::filesystem::path &world_folder,
+  const std::filesystem::path &output,
+  const world_export_options & options)
+{
+    const auto step = static_cast<std::int32_t>(options.blocks_per_pixel);
+    if (!step || (step & (step - 1)) || options.blocks_per_pixel > max_blocks_per_pixel)
+    {
+        std::cerr << "Blocks per pixel has to be a power of two up to " << max_blocks_per_pixel << std::endl;
+        return 1;
+    }
+    if (
+      options.mode == tile_mode::age || options.mode == tile_mode::size ||
+      options.mode == tile_mode::oversized)
+    {
+        std::cerr << "Overlay modes are drawn from region headers and can't be exported" << std::endl;
+        return 1;
+    }
+
+    const auto start  = std::chrono::steady_clock::now();
+    auto       loader = world_loader();
+    loader.set_world(world_folder);
+
+    // Bounds of the chunks there are, in blocks, inclusive
+    auto min = glm::ivec2(std::numeric_limits<std::int32_t>::max());
+    auto max = glm::ivec2(std::numeric_limits<std::int32_t>::min());
+    {
+        const auto chunks = options.whole_world
+          ? loader.chunks_in(glm::ivec2(-world_loader::world_limit), glm::ivec2(world_loader::world_limit))
+          : loader.chunks_in(options.min >> 4, options.max >> 4);
+        for (const auto &chunk : chunks)
+        {
+            min = glm::min(min, glm::ivec2(chunk.x, chunk.z) * 16);
+            max = glm::max(max, glm::ivec2(chunk.x, chunk.z) * 16 + 15);
+        }
+        if (chunks.empty())
+        {
+            std::cerr << "No chunks to export in " << world_folder << std::endl;
+            return 1;
+        }
+    }
+    if (!options.whole_world)
+    {
+        min = glm::max(min, options.min);
+        max = glm::min(max, options.max);
+    }
+
+    // Whole chunks and whole pixels, so no task or strip ever splits either
+    const auto alignment = std::max(step, 16);
+    const auto origin    = ::align_down(min, alignment);
+    const auto end       = ::align_down(max + alignment, alignment);
+    const auto size      = (end - origin) / step;
+
+    auto image = png::writer(output, size.x, size.y, options.compression);
+    if (!image.good()) return 1;
+
+    std::cout << "Exporting " << size.x << "x" << size.y << " at " << step << " blocks a pixel, from "
+              << origin.x << ", " << origin.y << " to " << end.x - 1 << ", " << end.y - 1 << std::endl;
+
+    // Only the calling thread of the renderer is used, the strips bring their own pool
+    auto renderer = tile_renderer(world_summaries(loader), 1);
+    auto       thread_pool = vx3d::thread_pool(vx3d::default_worker_count(options.threads));
+    const auto task_width  = std::max(::task_blocks, alignment);
+    const auto stride      = static_cast<std::size_t>(size.x);
+
+    // One strip renders while the one before it is written
+    auto strips   = std::array<std::vector<rgba>, 2>();
+    auto writing  = std::future<void>();
+    auto rendered = std::atomic<std::size_t>(0);
+
+    auto last_report = start;
+    for (auto row = std::int32_t(0), strip = 0; row < size.y; row += ::strip_rows, strip++)
+    {
+        ZoneScopedN("WorldExport::strip");
+        const auto rows   = std::min(::strip_rows, size.y - row);
+        auto &     pixels = strips[strip % 2];
+        pixels.resize(stride * rows);
+
+        auto tasks = std::vector<std::function<void()>>();
+        for (auto x = origin.x; x < end.x; x += task_width)
+        {
+            const auto task = ::strip_task { { x, origin.y + row * step },
+                                             (std::min(x + task_width, end.x) - x) / step,
+                                             rows,
+                                             step };
+            auto *     to   = pixels.data() + (x - origin.x) / step;
+            tasks.emplace_back(
+              [&, task, to]
+              { rendered += ::render_task(renderer, options.mode, task, to, stride); });
+        }
+        thread_pool.run_tasks(tasks);
+
+        // Also frees the other buffer for the next strip
+        if (writing.valid()) writing.get();
+
+        if (std::chrono::steady_clock::now() - last_report >= ::report_interval)
+        {
+            last_report = std::chrono::steady_clock::now();
+
+            // Rows still to be written are counted, they're done rendering
+            const auto seconds = ::seconds_since(start);
+            const auto done    = row + rows;
+            std::cout << "Row " << done << " of " << size.y << " (" << std::fixed << std::setprecision(1)
+                      << 100.0 * done / size.y << "%), "
+                      << static_cast<double>(done) * size.x / seconds / 1e6 << " Mpx/s, "
+                      << static_cast<double>(rendered) / seconds << " chunks/s, "
+                      << static_cast<double>(image.bytes_written()) / (1 << 20) << " MiB written"
+                      << std::defaultfloat << std::setprecision(6) << std::endl;
+        }
+
+        writing = std::async(
+          std::launch::async,
+          [&image, &pixels, rows]
+          { image.write_rows(reinterpret_cast<const std::uint8_t *>(pixels.data()), rows); });
+    }
+    if (writing.valid()) writing.get();
+
+    if (!image.finish())
+    {
+        std::cerr << "Couldn't write " << output << std::endl;
+        return 1;
+    }
+
+    const auto seconds = ::seconds_since(start);
+    const auto mpx     = static_cast<double>(size.x) * size.y / 1e6;
+    std::cout << std::fixed << std::setprecision(2) << "Wrote " << size.x << "x" << size.y << " (" << mpx
+              << " Mpx, " << rendered << " chunks, " << static_cast<double>(image.bytes_written()) / (1 << 20)
+              << " MiB) to " << output << " in " << seconds << " s, " << mpx / seconds << " Mpx/s"
+              << std::defaultfloat << std::endl;
+    return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+#include <glm/glm.hpp>
+
+#include <map/tile_renderer.h>
+
+namespace vx3d::map
+{
+    struct world_export_options
+    {
+        std::uint32_t blocks_per_pixel = 1;       // A power of two, up to `max_blocks_per_pixel`
+        bool          whole_world      = true;    // Otherwise only the blocks between `min` and `max`
+        glm::ivec2    min {};                     // Inclusive, in blocks
+        glm::ivec2    max {};
+        tile_mode     mode        = tile_mode::color;    // One of the modes drawn from summaries
+        std::uint32_t threads     = 0;    // Workers to render with, 0 leaves one hardware thread free
+        int           compression = 1;    // zlib level, the map is mostly flat colour
+    };
+
+    // Past this a pixel's channel sums could overflow
+    constexpr auto max_blocks_per_pixel = std::uint32_t(1024);
+
+    /// Renders every chunk of a world, or of a rectangle of it, into one PNG at a fixed scale, on
+    /// the CPU. The image is made a strip of rows at a time and each strip is compressed and
+    /// written while the next one renders, so memory grows with the width of the image and never
+    /// with its height. Bounds are rounded out to whole chunks, pixels no chunk covers are left
+    /// transparent and progress is printed every second.
+    /// \return An exit code, not 0 if there's nothing to export or the image couldn't be written
+    int run_world_export(
+      const std::filesystem::path &world_folder,
+      const std::filesystem::path &output,
+      const world_export_options & options);
+}    // namespace vx3d::map
@@ -0,0 +1,530 @@
+#include "xyz_export.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tsl/robin_map.h>
+#include <tsl/robin_set.h>
+#include <tracy/Tracy.hpp>
+
+#include <loader/world_loader.h>
+#include <map/header_overlay.h>
+#include <map/isometric.h>
+#include <map/tile_cache.h>
+#include <thread_pool.h>
+#include <util/png.h>
+
+namespace
+{
+    constexpr auto tile_size   = 256;
+    constexpr auto tile_chunks = tile_size / 16;
+
+    // Chunks between the north west corner of zoom 0 and chunk 0, 0
+    constexpr auto chunk_offset = std::int32_t(1) << (vx3d::map::xyz_max_zoom + 3);
+
+    // Regions past the world border, in every direction
+    constexpr auto region_limit = chunk_offset >> 5;
+
+    constexpr auto tiles_per_task = 16;
+
+    // Decoded chunks an isometric batch may hold at once, a few hundred MiB
+    constexpr auto iso_batch_chunks = std::size_t(2048);
+
+    constexpr auto manifest_name    = "manifest.txt";
+    constexpr auto manifest_magic   = "vx3d-tiles";
+    constexpr auto manifest_version = 2;
+
+    constexpr auto report_interval = std::chrono::seconds(1);
+
+    using signature_map = tsl::robin_map<std::uint64_t, std::uint64_t, vx3d::map::tile_key_hash>;
+
+    struct manifest_entry
+    {
+        std::uint64_t signature = 0;
+        std::int64_t  written   = 0;    // Seconds since the epoch
+        std::string   reason;           // Why it was last written
+    };
+
+    using manifest = tsl::robin_map<std::uint64_t, manifest_entry, vx3d::map::tile_key_hash>;
+
+    [[nodiscard]] double seconds_since(std::chrono::steady_clock::time_point start) noexcept
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /// Mixes a chunk and its `tile_stamp`, tiles add these up so the order chunks come in doesn't
+    /// matter and a chunk or a neighbour it's shaded against being saved again changes the sum
+    [[nodiscard]] std::uint64_t
+      chunk_signature(std::int32_t x, std::int32_t z, std::uint32_t time_stamp) noexcept
+    {
+        auto value = (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32 |
+                      static_cast<std::uint32_t>(z)) ^
+          static_cast<std::uint64_t>(time_stamp) * 0x9E3779B97F4A7C15;
+        value ^= value >> 30;
+        value *= 0xBF58476D1CE4E5B9;
+        value ^= value >> 27;
+        value *= 0x94D049BB133111EB;
+        value ^= value >> 31;
+        return value;
+    }
+
+    /// Identifies a tile, `tile_key` only has room for the levels of the pyramid. Coordinates are
+    /// under 2^18, so keys sort by zoom, then x, then y.
+    [[nodiscard]] constexpr std::uint64_t xyz_key(std::uint8_t zoom, std::int32_t x, std::int32_t y) noexcept
+    {
+        return static_cast<std::uint64_t>(zoom) << 48 | static_cast<std::uint64_t>(x) << 24 |
+          static_cast<std::uint64_t>(y);
+    }
+
+    [[nodiscard]] std::uint8_t zoom_of(std::uint64_t key) noexcept
+    {
+        return static_cast<std::uint8_t>(key >> 48);
+    }
+
+    [[nodiscard]] glm::ivec2 position_of(std::uint64_t key) noexcept
+    {
+        return { static_cast<std::int32_t>((key >> 24) & 0xFFFFFF),
+                 static_cast<std::int32_t>(key & 0xFFFFFF) };
+    }
+
+    [[nodiscard]] std::filesystem::path tile_path(const std::filesystem::path &folder, std::uint64_t key)
+    {
+        const auto position = ::position_of(key);
+        return folder / std::to_string(::zoom_of(key)) / std::to_string(position.x) /
+          (std::to_string(position.y) + ".png");
+    }
+
+    [[nodiscard]] std::filesystem::path
+      iso_tile_path(const std::filesystem::path &folder, const vx3d::map::iso_tile &tile)
+    {
+        return folder / std::to_string(tile.x) / (std::to_string(tile.y) + ".png");
+    }
+
+    /// \return Nothing if the manifest was written for another mode, empty if there's none
+    [[nodiscard]] std::optional<manifest>
+      read_manifest(const std::filesystem::path &path, vx3d::map::tile_mode mode)
+    {
+        auto file = std::ifstream(path);
+        if (!file) return manifest();
+
+        auto magic        = std::string();
+        auto version      = 0;
+        auto written_mode = -1;
+        file >> magic >> version >> written_mode;
+        if (
+          magic != ::manifest_magic || version != ::manifest_version ||
+          written_mode != static_cast<int>(mode))
+            return std::nullopt;
+
+        auto read  = manifest();
+        auto zoom  = 0;
+        auto x     = std::int32_t(0);
+        auto y     = std::int32_t(0);
+        auto entry = manifest_entry();
+        while (file >> zoom >> x >> y >> std::hex >> entry.signature >> std::dec >> entry.written >>
+               entry.reason)
+            read[::xyz_key(static_cast<std::uint8_t>(zoom), x, y)] = entry;
+        return read;
+    }
+
+    /// Written next to the old one and moved over it, so an export cut short leaves the old one
+    /// and every tile it didn't get to is written again next time
+    [[nodiscard]] bool
+      write_manifest(const std::filesystem::path &path, vx3d::map::tile_mode mode, const manifest &tiles)
+    {
+        // Sorted, so exports of a slightly changed world diff well
+        auto keys = std::vector<std::uint64_t>();
+        keys.reserve(tiles.size());
+        for (const auto &[key, entry] : tiles) keys.push_back(key);
+        std::sort(keys.begin(), keys.end());
+
+        auto temporary = path;
+        temporary += ".tmp";
+        {
+            auto file = std::ofstream(temporary, std::ios::trunc);
+            file << ::manifest_magic << ' ' << ::manifest_version << ' ' << static_cast<int>(mode) << '\n';
+            for (const auto key : keys)
+            {
+                const auto &entry    = tiles.at(key);
+                const auto  position = ::position_of(key);
+                file << static_cast<int>(::zoom_of(key)) << ' ' << position.x << ' ' << position.y << ' '
+                     << std::hex << entry.signature << std::dec << ' ' << entry.written << ' ' << entry.reason
+                     << '\n';
+            }
+            if (!file.flush()) return false;
+        }
+
+        auto error = std::error_code();
+        std::filesystem::rename(temporary, path, error);
+        return !error;
+    }
+
+    /// Sums the signatures of the chunks under every tile, from the lowest zoom to the highest
+    [[nodiscard]] std::vector<signature_map>
+      tile_signatures(vx3d::world_loader &loader, vx3d::map::tile_mode mode, std::uint8_t min_zoom)
+    {
+        using vx3d::map::xyz_max_zoom;
+
+        auto       signatures = std::vector<signature_map>(xyz_max_zoom + 1);
+        const auto regions =
+          loader.regions_in(glm::ivec2(-::region_limit), glm::ivec2(::region_limit - 1));
+        for (const auto &region : regions)
+        {
+            const auto chunks = loader.chunks_in(region * 32, region * 32 + 31);
+            const auto stamps = vx3d::map::tile_stamps(loader, mode, chunks);
+            for (auto i = std::size_t(0); i < chunks.size(); i++)
+            {
+                const auto tile = (glm::ivec2(chunks[i].x, chunks[i].z) + ::chunk_offset) / ::tile_chunks;
+                signatures[xyz_max_zoom][::xyz_key(xyz_max_zoom, tile.x, tile.y)] +=
+                  ::chunk_signature(chunks[i].x, chunks[i].z, stamps[i]);
+            }
+        }
+
+        for (auto zoom = xyz_max_zoom; zoom > min_zoom; zoom--)
+            for (const auto &[key, signature] : signatures[zoom])
+            {
+                const auto position = ::position_of(key) / 2;
+                signatures[zoom - 1][::xyz_key(zoom - 1, position.x, position.y)] += signature;
+            }
+
+        return signatures;
+    }
+
+    /// Puts an XYZ tile together from the pyramid level with the same scale and writes it out
+    [[nodiscard]] bool encode_tile(
+      vx3d::world_loader &         loader,
+      vx3d::map::tile_cache &      cache,
+      vx3d::map::tile_mode         mode,
+      std::uint64_t                key,
+      const std::filesystem::path &output_folder,
+      int                          compression)
+    {
+        ZoneScopedN("XyzExport::encode_tile");
+        using namespace vx3d::map;
+
+        const auto level = static_cast<std::uint8_t>(xyz_max_zoom - ::zoom_of(key));
+        const auto first = ::position_of(key) * ::tile_chunks - (::chunk_offset >> level);
+
+        // Chunk tiles are cached along with the time stamps of the chunks they're rendered from
+        auto tiles = std::vector<std::optional<tile>>();
+        if (level == 0)
+        {
+            auto chunks = std::vector<vx3d::loader::chunk_location>();
+            for (auto x = 0; x < ::tile_chunks; x++)
+                for (auto z = 0; z < ::tile_chunks; z++) chunks.emplace_back(first.x + x, first.y + z);
+            const auto locations = loader.get_locations(chunks);
+            const auto stamps    = tile_stamps(loader, mode, locations);
+            for (auto i = std::size_t(0); i < locations.size(); i++)
+                tiles.push_back(cache.find(tile_key(0, locations[i].x, locations[i].z), stamps[i]));
+        }
+        else
+            for (auto x = 0; x < ::tile_chunks; x++)
+                for (auto z = 0; z < ::tile_chunks; z++)
+                    tiles.push_back(cache.find(tile_key(level, first.x + x, first.y + z), 0));
+
+        auto pixels = std::vector<rgba>(::tile_size * ::tile_size);
+        for (const auto &found : tiles)
+        {
+            if (!found) continue;
+            const auto corner = (glm::ivec2(found->x, found->z) - first) * 16;
+            for (auto row = 0; row < 16; row++)
+                std::copy_n(
+                  found->pixels.data() + row * 16,
+                  16,
+                  pixels.data() + (corner.y + row) * ::tile_size + corner.x);
+        }
+
+        return vx3d::png::write(
+          ::tile_path(output_folder, key),
+          ::tile_size,
+          ::tile_size,
+          reinterpret_cast<const std::uint8_t *>(pixels.data()),
+          compression);
+    }
+
+    /// Draws the isometric tiles of every chunk of the world and writes them out, a batch at a
+    /// time. Tiles above each other draw from mostly the same chunks, so batches go down columns.
+    [[nodiscard]] int export_isometric(
+      vx3d::world_loader &                  loader,
+      const std::filesystem::path &         output_folder,
+      const vx3d::map::xyz_export_options & options,
+      std::chrono::steady_clock::time_point start)
+    {
+        using namespace vx3d::map;
+
+        auto       chunks  = tsl::robin_set<std::uint64_t>();
+        auto       tiles   = std::vector<glm::ivec2>();
+        auto       found   = tsl::robin_set<std::uint64_t>();
+        const auto regions = loader.regions_in(glm::ivec2(-::region_limit), glm::ivec2(::region_limit - 1));
+        for (const auto &region : regions)
+            for (const auto &chunk : loader.chunks_in(region * 32, region * 32 + 31))
+            {
+                chunks.insert(vx3d::world_loader::hash_pos(chunk.x, chunk.z));
+                for (const auto &tile : iso_chunk_tiles({ chunk.x, chunk.z }))
+                    if (found.insert(vx3d::world_loader::hash_pos(tile.x, tile.y)).second)
+                        tiles.push_back(tile);
+            }
+        if (tiles.empty())
+        {
+            std::cerr << "No chunks to export in " << loader.world_folder() << std::endl;
+            return 1;
+        }
+        std::sort(
+          tiles.begin(),
+          tiles.end(),
+          [](const glm::ivec2 &a, const glm::ivec2 &b) { return a.x != b.x ? a.x < b.x : a.y < b.y; });
+        std::cout << tiles.size() << " isometric tiles to write" << std::endl;
+
+        auto renderer = isometric_renderer(
+          [&loader](std::int32_t x, std::int32_t z) { return loader.load_chunk(x, z); },
+          options.threads);
+        auto thread_pool = vx3d::thread_pool(vx3d::default_worker_count(options.threads));
+
+        auto last_report = start;
+        auto written     = std::size_t(0);
+        auto failed      = std::size_t(0);
+        auto folders     = tsl::robin_set<std::int32_t>();
+        for (auto first = std::size_t(0); first < tiles.size();)
+        {
+            // Only the chunks that exist count towards a batch
+            auto batch_chunks = tsl::robin_set<std::uint64_t>();
+            auto last         = first;
+            for (; last < tiles.size() && batch_chunks.size() < ::iso_batch_chunks; last++)
+                for (const auto &chunk : iso_tile_chunks(tiles[last]))
+                    if (const auto key = vx3d::world_loader::hash_pos(chunk.x, chunk.y); chunks.count(key))
+                        batch_chunks.insert(key);
+
+            const auto drawn = renderer.render({ tiles.begin() + first, tiles.begin() + last });
+            for (const auto &tile : drawn)
+                if (folders.insert(tile.x).second)
+                    std::filesystem::create_directories(::iso_tile_path(output_folder, tile).parent_path());
+
+            auto results = std::vector<std::uint8_t>(drawn.size());
+            auto tasks   = std::vector<std::function<void()>>();
+            for (auto from = std::size_t(0); from < drawn.size(); from += ::tiles_per_task)
+                tasks.emplace_back(
+                  [&, from]
+                  {
+                      for (auto i = from; i < std::min(drawn.size(), from + ::tiles_per_task); i++)
+                          results[i] = vx3d::png::write(
+                            ::iso_tile_path(output_folder, drawn[i]),
+                            iso_tile_size,
+                            iso_tile_size,
+                            reinterpret_cast<const std::uint8_t *>(drawn[i].pixels.data()),
+                            options.compression);
+                  });
+            thread_pool.run_tasks(tasks);
+
+            for (const auto result : results) (result ? written : failed)++;
+            first = last;
+
+            if (std::chrono::steady_clock::now() - last_report < ::report_interval) continue;
+            last_report = std::chrono::steady_clock::now();
+            std::cout << "Drew " << first << " of " << tiles.size() << " tiles, "
+                      << static_cast<double>(first) / ::seconds_since(start) << " tiles/s" << std::endl;
+        }
+
+        std::cout << "Wrote " << written << " isometric tiles to " << output_folder << " in "
+                  << ::seconds_since(start) << " s" << std::endl;
+        if (failed) std::cerr << failed << " tiles couldn't be written" << std::endl;
+        return failed ? 1 : 0;
+    }
+}    // namespace
+
+int vx3d::map::run_xyz_export(
+  const std::filesystem::path &world_folder,
+  const std::filesystem::path &output_folder,
+  const xyz_export_options &   options)
+{
+    if (
+      !options.isometric &&
+      (is_header_overlay(options.mode) || options.mode == tile_mode::relief ||
+       options.mode == tile_mode::slice))
+    {
+        std::cerr << "Only modes kept in the tile cache can be exported as tiles" << std::endl;
+        return 1;
+    }
+    if (options.min_zoom < xyz_min_zoom || options.min_zoom > xyz_max_zoom)
+    {
+        std::cerr << "The lowest zoom has to be between " << static_cast<int>(xyz_min_zoom) << " and "
+                  << static_cast<int>(xyz_max_zoom) << std::endl;
+        return 1;
+    }
+
+    const auto start  = std::chrono::steady_clock::now();
+    auto       loader = world_loader();
+    loader.set_world(world_folder);
+    if (options.isometric) return ::export_isometric(loader, output_folder, options, start);
+
+    const auto signatures = ::tile_signatures(loader, options.mode, options.min_zoom);
+    if (signatures[xyz_max_zoom].empty())
+    {
+        std::cerr << "No chunks to export in " << world_folder << std::endl;
+        return 1;
+    }
+
+    // Tiles whose chunks kept their time stamps since the last export keep their entry
+    const auto manifest_path = output_folder / ::manifest_name;
+    const auto previous      = ::read_manifest(manifest_path, options.mode);
+    const auto now           = std::chrono::duration_cast<std::chrono::seconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+
+    auto tiles = ::manifest();
+    auto dirty = std::vector<std::uint64_t>();
+    for (auto zoom = options.min_zoom; zoom <= xyz_max_zoom; zoom++)
+        for (const auto &[key, signature] : signatures[zoom])
+        {
+            auto reason = "rebuilt";
+            if (previous)
+            {
+                const auto before = previous->find(key);
+                if (before != previous->end() && before->second.signature == signature)
+                {
+                    tiles[key] = before->second;
+                    continue;
+                }
+                reason = before == previous->end() ? "new" : "changed";
+            }
+
+            tiles[key] = { signature, now, reason };
+            dirty.push_back(key);
+        }
+
+    auto removed = std::size_t(0);
+    if (previous)
+        for (const auto &[key, entry] : *previous)
+        {
+            if (tiles.count(key)) continue;
+            auto error = std::error_code();
+            if (std::filesystem::remove(::tile_path(output_folder, key), error)) removed++;
+        }
+
+    std::cout << tiles.size() << " tiles from zoom " << static_cast<int>(options.min_zoom) << " to "
+              << static_cast<int>(xyz_max_zoom) << ", " << dirty.size() << " to write, " << removed
+              << " removed" << std::endl;
+
+    // Chunks without a tile in the cache aren't part of the cached levels above yet, the same as
+    // in the viewer
+    auto cache = tile_cache();
+    cache.open(world_folder, options.mode);
+    if (!cache.is_open())
+    {
+        std::cerr << "Tiles are put together from the tile cache, which couldn't be opened" << std::endl;
+        return 1;
+    }
+
+    auto pyramid = tile_pyramid();
+    pyramid.set_backing(
+      [&cache](std::uint64_t key) { return cache.find(key, 0); },
+      [&cache](const std::vector<tile> &stored) { cache.store(stored); });
+
+    // Only the calling thread of the renderer is used, regions are spread over the export's pool
+    auto renderer = tile_renderer(world_summaries(loader), 1);
+    auto       thread_pool = vx3d::thread_pool(vx3d::default_worker_count(options.threads));
+    const auto batch_size  = vx3d::default_worker_count(options.threads) * 4;
+
+    auto last_report = start;
+    auto rendered    = std::size_t(0);
+    {
+        const auto regions =
+          loader.regions_in(glm::ivec2(-::region_limit), glm::ivec2(::region_limit - 1));
+        for (auto first = std::size_t(0); first < regions.size(); first += batch_size)
+        {
+            const auto count   = std::min<std::size_t>(batch_size, regions.size() - first);
+            auto       batches = std::vector<std::vector<tile>>(count);
+            auto       tasks   = std::vector<std::function<void()>>();
+            for (auto i = std::size_t(0); i < count; i++)
+                tasks.emplace_back(
+                  [&, i]
+                  {
+                      const auto &region    = regions[first + i];
+                      const auto  locations = loader.chunks_in(region * 32, region * 32 + 31);
+                      const auto  stamps    = tile_stamps(loader, options.mode, locations);
+
+                      auto chunks = std::vector<glm::ivec2>();
+                      for (auto j = std::size_t(0); j < locations.size(); j++)
+                          if (!cache.contains(tile_key(0, locations[j].x, locations[j].z), stamps[j]))
+                              chunks.emplace_back(locations[j].x, locations[j].z);
+                      if (!chunks.empty()) batches[i] = renderer.render(chunks, options.mode);
+                  });
+            thread_pool.run_tasks(tasks);
+
+            for (const auto &batch : batches)
+            {
+                for (const auto &rendered_tile : batch) pyramid.insert(rendered_tile);
+                cache.store(batch);
+                rendered += batch.size();
+            }
+            static_cast<void>(pyramid.take_changed());
+
+            if (std::chrono::steady_clock::now() - last_report < ::report_interval) continue;
+            last_report = std::chrono::steady_clock::now();
+            std::cout << "Rendered " << rendered << " chunks, region " << first + count << " of "
+                      << regions.size() << std::endl;
+        }
+        pyramid.flush();
+    }
+
+    // Folders first, workers only ever write files
+    auto folders = tsl::robin_set<std::uint64_t, tile_key_hash>();
+    for (const auto key : dirty)
+        if (folders.insert(key & ~std::uint64_t(0xFFFFFF)).second)
+            std::filesystem::create_directories(::tile_path(output_folder, key).parent_path());
+
+    auto written = std::vector<std::uint8_t>(dirty.size());
+    for (auto first = std::size_t(0); first < dirty.size(); first += batch_size * ::tiles_per_task)
+    {
+        auto tasks = std::vector<std::function<void()>>();
+        for (auto from = first; from < std::min(dirty.size(), first + batch_size * ::tiles_per_task);
+             from += ::tiles_per_task)
+            tasks.emplace_back(
+              [&, from]
+              {
+                  for (auto i = from; i < std::min(dirty.size(), from + ::tiles_per_task); i++)
+                      written[i] = ::encode_tile(
+                        loader,
+                        cache,
+                        options.mode,
+                        dirty[i],
+                        output_folder,
+                        options.compression);
+              });
+        thread_pool.run_tasks(tasks);
+
+        if (std::chrono::steady_clock::now() - last_report < ::report_interval) continue;
+        last_report        = std::chrono::steady_clock::now();
+        const auto done    = std::min(dirty.size(), first + batch_size * ::tiles_per_task);
+        const auto seconds = ::seconds_since(start);
+        std::cout << "Wrote " << done << " of " << dirty.size() << " tiles, " << done / seconds << " tiles/s"
+                  << std::endl;
+    }
+
+    // Tiles that couldn't be written are left out, so the next export tries them again
+    auto failed = std::size_t(0);
+    for (auto i = std::size_t(0); i < dirty.size(); i++)
+        if (!written[i])
+        {
+            tiles.erase(dirty[i]);
+            failed++;
+        }
+
+    if (!::write_manifest(manifest_path, options.mode, tiles))
+    {
+        std::cerr << "Couldn't write " << manifest_path << std::endl;
+        return 1;
+    }
+
+    std::cout << "Rendered " << rendered << " chunks and wrote " << dirty.size() - failed << " tiles to "
+              << output_folder << " in " << ::seconds_since(start) << " s" << std::endl;
+    if (failed) std::cerr << failed << " tiles couldn't be written" << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+#include <map/tile_pyramid.h>
+#include <map/tile_renderer.h>
+
+namespace vx3d::map
+{
+    // One block a pixel. Zoom 0 is 2^26 blocks across, centred on 0, 0, which takes in the whole
+    // world border, so a tile keeps its coordinates however the world grows.
+    constexpr std::uint8_t xyz_max_zoom = 18;
+
+    // Below this a tile would be drawn from more than one tile of the highest pyramid level
+    constexpr std::uint8_t xyz_min_zoom = xyz_max_zoom - max_tile_level;
+
+    struct xyz_export_options
+    {
+        tile_mode     mode        = tile_mode::color;    // One of the modes kept in the tile cache
+        std::uint8_t  min_zoom    = xyz_min_zoom;
+        std::uint32_t threads     = 0;    // Workers to render and encode with, 0 leaves one free
+        int           compression = 6;    // zlib level
+        bool          isometric   = false;    // Isometric tiles instead, see `iso_tile`
+    };
+
+    /// Writes the map of a world as a `z/x/y.png` pyramid of 256 pixel tiles for web maps, x
+    /// growing east and y south. Tiles are put together from the levels of the tile pyramid,
+    /// which are brought up to date through the tile cache first, and encoded on a pool of workers.
+    ///
+    /// Exports are incremental. Every tile has a signature of the time stamps of the chunks under
+    /// it, and `manifest.txt` in the output folder keeps the signature of each tile along with
+    /// when and why it was last written. Tiles whose signature is unchanged are left alone, tiles
+    /// nothing is under anymore are deleted.
+    ///
+    /// Isometric exports write every `iso_tile` any chunk draws into as `x/y.png` at the one scale
+    /// they're drawn at, coordinates as in `iso_tile_chunks`, and aren't incremental.
+    /// \return An exit code, not 0 if there's nothing to export or a tile couldn't be written
+    int run_xyz_export(
+      const std::filesystem::path &world_folder,
+      const std::filesystem::path &output_folder,
+      const xyz_export_options &   options);
+}    // namespace vx3d::map
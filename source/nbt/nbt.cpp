@@ -14,12 +14,23 @@ namespace
           reinterpret_cast<char *>(buffer.at_and_increment(string_size)),
           string_size);
     }
+
+    template<typename T>
+    [[nodiscard]] T read_big_endian(const std::byte *data)
+    {
+        auto value = std::make_unsigned_t<T>(0);
+        for (auto i = size_t(0); i < sizeof(T); i++)
+            value = (value << 8) | static_cast<std::uint8_t>(data[i]);
+        return static_cast<T>(value);
+    }
 }    // namespace
 
 vx3d::nbt::node::node_list vx3d::nbt::node::read(byte_buffer &buffer)
 {
     ZoneScopedN("nbt::node::read");
-    auto nodes = std::make_unique<node[]>(buffer.size() / sizeof(vx3d::nbt::node));
+    // Nodes can be smaller than a byte of input (list terminators), so the array has to grow
+    auto nodes = std::vector<node>();
+    nodes.reserve(buffer.size() / sizeof(vx3d::nbt::node));
     auto count = size_t(0);
     _parse_nbt(buffer, nodes, count);
     auto result = node_list();
@@ -30,7 +41,7 @@ vx3d::nbt::node::node_list vx3d::nbt::node::read(byte_buffer &buffer)
 
 bool vx3d::nbt::node::_parse_nbt(
   byte_buffer &                       buffer,
-  std::unique_ptr<vx3d::nbt::node[]> &nodes,
+  std::vector<vx3d::nbt::node> &      nodes,
   size_t &                            count,
   TagType                             parent,
   TagType                             list_type)
@@ -52,18 +63,22 @@ bool vx3d::nbt::node::_parse_nbt(
         value._type = ::read_type(buffer);
         if (value._type == TagType::END)
         {
-            nodes[count++] = value;
+            nodes.push_back(value);
+            count++;
             return false;
         }
 
         value._name = ::read_string(buffer);
     }
-    nodes[count++] = value;
+    const auto index = count;
+    nodes.push_back(value);
+    count++;
     _read_value(buffer, nodes, count);
+    nodes[index]._skip = static_cast<std::uint32_t>(count - index);
     return true;
 }
 
-void vx3d::nbt::node::_read_value(byte_buffer &buffer, std::unique_ptr<vx3d::nbt::node[]> &nodes, size_t &count)
+void vx3d::nbt::node::_read_value(byte_buffer &buffer, std::vector<vx3d::nbt::node> &nodes, size_t &count)
 {
     auto &node = nodes[count - 1];
 
@@ -100,9 +115,11 @@ void vx3d::nbt::node::_read_value(byte_buffer &buffer, std::unique_ptr<vx3d::nbt
         for (auto i = 0; i < children_count; i++)
             _parse_nbt(buffer, nodes, count, TagType::LIST, child_type);
 
+        // `node` may dangle once the children grew the array, don't touch it past this point
         auto value  = vx3d::nbt::node();
         value._type = TagType::END;
-        nodes[count++] = value;
+        nodes.push_back(value);
+        count++;
         break;
     }
     case TagType::COMPOUND:
@@ -131,15 +148,67 @@ void vx3d::nbt::node::_read_value(byte_buffer &buffer, std::unique_ptr<vx3d::nbt
 
 const vx3d::nbt::node *vx3d::nbt::node::get_node(std::string_view value) const
 {
-    // I do not like this function one bit... Too much C++ bullshit going on
-    const node *node_ptr = nullptr;
+    if (_type != TagType::COMPOUND) return nullptr;    // Can't search by name
+
+    for (auto child = first_child(); child; child = child->next_sibling())
+        if (child->_name == value) return child;
 
-    if (_type != TagType::COMPOUND) return node_ptr;    // Can't search by name
+    return nullptr;
+}
+
+const vx3d::nbt::node *vx3d::nbt::node::first_child() const noexcept
+{
+    if (_type != TagType::COMPOUND && _type != TagType::LIST) return nullptr;
 
-    //    const auto &nodes = std::get<std::vector<node>>(_value);
+    // Both compounds and lists are terminated by an END node, so an empty one is followed by it
+    const auto child = this + 1;
+    return child->_type == TagType::END ? nullptr : child;
+}
 
-    //    for (const auto &node : nodes)
-    //        if (std::string_view(node._name.value()) == value) node_ptr = &node;
-    //
-    return node_ptr;
-}
\ No newline at end of file
+const vx3d::nbt::node *vx3d::nbt::node::next_sibling() const noexcept
+{
+    const auto next = this + _skip;
+    return next->_type == TagType::END ? nullptr : next;
+}
+
+std::int64_t vx3d::nbt::node::as_integer() const
+{
+    switch (_type)
+    {
+    case TagType::BYTE: return static_cast<std::int8_t>(_value[0]);
+    case TagType::SHORT: return ::read_big_endian<std::int16_t>(_value);
+    case TagType::INT: return ::read_big_endian<std::int32_t>(_value);
+    case TagType::LONG: return ::read_big_endian<std::int64_t>(_value);
+    default: throw std::logic_error("Tag is not an integer");
+    }
+}
+
+std::string_view vx3d::nbt::node::as_string() const
+{
+    if (_type != TagType::STRING) throw std::logic_error("Tag is not a string");
+
+    // The string payload still carries its u16 length prefix
+    return std::string_view(
+      reinterpret_cast<const char *>(_value + 2),
+      ::read_big_endian<std::uint16_t>(_value));
+}
+
+std::int32_t vx3d::nbt::node::array_size() const
+{
+    if (_type != TagType::BYTE_ARRAY && _type != TagType::INT_ARRAY &&
+        _type != TagType::LONG_ARRAY)
+        throw std::logic_error("Tag is not an array");
+
+    // The i32 length sits right before the payload
+    return ::read_big_endian<std::int32_t>(_value - 4);
+}
+
+std::int32_t vx3d::nbt::node::int_at(std::int32_t index) const
+{
+    return ::read_big_endian<std::int32_t>(_value + index * sizeof(std::int32_t));
+}
+
+std::int64_t vx3d::nbt::node::long_at(std::int32_t index) const
+{
+    return ::read_big_endian<std::int64_t>(_value + index * sizeof(std::int64_t));
+}
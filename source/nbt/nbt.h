@@ -35,25 +35,52 @@ namespace vx3d::nbt
 
         [[nodiscard]] const node *get_node(std::string_view value) const;
 
+        [[nodiscard]] TagType type() const noexcept { return _type; }
+
+        [[nodiscard]] std::string_view name() const noexcept { return _name; }
+
+        // Children of a compound or list, iterate with `next_sibling` until it returns nullptr
+        [[nodiscard]] const node *first_child() const noexcept;
+
+        [[nodiscard]] const node *next_sibling() const noexcept;
+
+        // Any of BYTE, SHORT, INT or LONG widened to 64 bits
+        [[nodiscard]] std::int64_t as_integer() const;
+
+        [[nodiscard]] std::string_view as_string() const;
+
+        // Element count of BYTE_ARRAY, INT_ARRAY and LONG_ARRAY tags
+        [[nodiscard]] std::int32_t array_size() const;
+
+        // Raw (big endian) payload of an array tag
+        [[nodiscard]] const std::byte *array_data() const noexcept { return _value; }
+
+        [[nodiscard]] std::int32_t int_at(std::int32_t index) const;
+
+        [[nodiscard]] std::int64_t long_at(std::int32_t index) const;
+
         struct node_list
         {
-            size_t count;
-            std::unique_ptr<vx3d::nbt::node[]> nodes;
+            size_t            count;
+            std::vector<node> nodes;
+
+            [[nodiscard]] const node *root() const noexcept { return count ? &nodes[0] : nullptr; }
         };
         [[nodiscard]] static node_list read(byte_buffer &buffer);
 
     private:
         static bool _parse_nbt(
           byte_buffer &          buffer,
-          std::unique_ptr<node[]> &nodes,
+          std::vector<node> &    nodes,
           size_t &count,
           TagType                parent    = TagType::END,
           TagType                list_type = TagType::END);
 
-        static void _read_value(byte_buffer &buffer, std::unique_ptr<vx3d::nbt::node[]> &nodes, size_t &count);
+        static void _read_value(byte_buffer &buffer, std::vector<node> &nodes, size_t &count);
 
-        TagType          _type;
-        std::byte *      _value;
+        TagType          _type  = TagType::END;
+        std::uint32_t    _skip  = 1;    // Nodes taken up by this tag and all of its children
+        std::byte *      _value = nullptr;
         std::string_view _name;
 
     public:
@@ -0,0 +1,171 @@
+#include "selective.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    // The same nesting limit the game enforces, deeper documents are malformed or malicious
+    constexpr auto max_depth = 512u;
+
+    // Payload size of tags that don't carry a length, 0 for everything else
+    [[nodiscard]] std::size_t fixed_size(vx3d::nbt::TagType type) noexcept
+    {
+        using vx3d::nbt::TagType;
+        switch (type)
+        {
+        case TagType::BYTE: return 1;
+        case TagType::SHORT: return 2;
+        case TagType::INT:
+        case TagType::FLOAT: return 4;
+        case TagType::LONG:
+        case TagType::DOUBLE: return 8;
+        default: return 0;
+        }
+    }
+}    // namespace
+
+vx3d::nbt::scanner::scanner(const std::byte *data, std::size_t size) noexcept
+    : _at(data), _end(data + size)
+{
+}
+
+vx3d::nbt::scanner::tag vx3d::nbt::scanner::root()
+{
+    auto header = tag();
+    header.type = static_cast<TagType>(_read<std::uint8_t>());
+    if (header.type != TagType::END) header.name = read_string();
+    return header;
+}
+
+vx3d::nbt::scanner::tag vx3d::nbt::scanner::next()
+{
+    return root();
+}
+
+void vx3d::nbt::scanner::skip(TagType type)
+{
+    _skip(type, 0);
+}
+
+bool vx3d::nbt::scanner::find(std::string_view name, TagType type)
+{
+    for (auto header = next(); header.type != TagType::END; header = next())
+    {
+        if (header.type == type && header.name == name) return true;
+        skip(header.type);
+    }
+
+    return false;
+}
+
+std::int64_t vx3d::nbt::scanner::read_integer(TagType type)
+{
+    switch (type)
+    {
+    case TagType::BYTE: return _read<std::int8_t>();
+    case TagType::SHORT: return _read<std::int16_t>();
+    case TagType::INT: return _read<std::int32_t>();
+    case TagType::LONG: return _read<std::int64_t>();
+    default: throw std::runtime_error("Tag is not an integer");
+    }
+}
+
+double vx3d::nbt::scanner::read_number(TagType type)
+{
+    switch (type)
+    {
+    case TagType::FLOAT:
+    {
+        const auto bits  = _read<std::uint32_t>();
+        auto       value = 0.0f;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    case TagType::DOUBLE:
+    {
+        const auto bits  = _read<std::uint64_t>();
+        auto       value = 0.0;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    default: return static_cast<double>(read_integer(type));
+    }
+}
+
+std::string_view vx3d::nbt::scanner::read_string()
+{
+    const auto size = _read<std::uint16_t>();
+    return std::string_view(reinterpret_cast<const char *>(_advance(size)), size);
+}
+
+std::pair<vx3d::nbt::TagType, std::int32_t> vx3d::nbt::scanner::read_list()
+{
+    const auto type  = static_cast<TagType>(_read<std::uint8_t>());
+    const auto count = _read<std::int32_t>();
+    return { type, count < 0 ? 0 : count };
+}
+
+template<typename T>
+T vx3d::nbt::scanner::_read()
+{
+    const auto *data  = _advance(sizeof(T));
+    auto        value = std::make_unsigned_t<T>(0);
+    for (auto i = size_t(0); i < sizeof(T); i++)
+        value = static_cast<std::make_unsigned_t<T>>(value << 8 | static_cast<std::uint8_t>(data[i]));
+    return static_cast<T>(value);
+}
+
+const std::byte *vx3d::nbt::scanner::_advance(std::size_t size)
+{
+    if (static_cast<std::size_t>(_end - _at) < size) throw std::runtime_error("NBT ends early");
+    const auto *at = _at;
+    _at += size;
+    return at;
+}
+
+void vx3d::nbt::scanner::_skip(TagType type, std::uint32_t depth)
+{
+    if (depth > max_depth) throw std::runtime_error("NBT nested too deeply");
+
+    switch (type)
+    {
+    case TagType::END: break;
+    case TagType::BYTE:
+    case TagType::SHORT:
+    case TagType::INT:
+    case TagType::FLOAT:
+    case TagType::LONG:
+    case TagType::DOUBLE: (void) _advance(::fixed_size(type)); break;
+    case TagType::STRING: (void) _advance(_read<std::uint16_t>()); break;
+    case TagType::BYTE_ARRAY:
+    case TagType::INT_ARRAY:
+    case TagType::LONG_ARRAY:
+    {
+        const auto element = type == TagType::BYTE_ARRAY ? 1u : type == TagType::INT_ARRAY ? 4u : 8u;
+        const auto count   = _read<std::int32_t>();
+        if (count < 0) throw std::runtime_error("Negative NBT array length");
+        (void) _advance(static_cast<std::size_t>(count) * element);
+        break;
+    }
+    case TagType::LIST:
+    {
+        const auto [child_type, count] = read_list();
+
+        // Lists of plain numbers are skipped in one go
+        const auto fixed = ::fixed_size(child_type);
+        if (fixed)
+            (void) _advance(static_cast<std::size_t>(count) * fixed);
+        else
+            for (auto i = 0; i < count; i++) _skip(child_type, depth + 1);
+        break;
+    }
+    case TagType::COMPOUND:
+    {
+        for (auto header = next(); header.type != TagType::END; header = next())
+            _skip(header.type, depth + 1);
+        break;
+    }
+    default: throw std::runtime_error("Unknown NBT tag type");
+    }
+}
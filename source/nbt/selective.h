@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include <nbt/nbt.h>
+
+namespace vx3d::nbt
+{
+    // Walks serialized NBT in place without building nodes, for readers that only want a few
+    // tags out of a large document. Reads are bounds checked and throw std::runtime_error.
+    class scanner
+    {
+    public:
+        struct tag
+        {
+            TagType          type = TagType::END;
+            std::string_view name;
+        };
+
+        scanner(const std::byte *data, std::size_t size) noexcept;
+
+        /// Reads the header of the root tag, leaving the scanner at its payload
+        [[nodiscard]] tag root();
+
+        /// Reads the header of the next tag in the compound being scanned
+        /// \return A tag of type END once the compound is exhausted
+        [[nodiscard]] tag next();
+
+        /// Moves past the payload of a tag, including everything nested in it
+        void skip(TagType type);
+
+        /// Skips ahead to a child of the compound being scanned
+        /// \return false if the compound ended without it, the compound is consumed in that case
+        [[nodiscard]] bool find(std::string_view name, TagType type);
+
+        /// Any of BYTE, SHORT, INT or LONG widened to 64 bits
+        [[nodiscard]] std::int64_t read_integer(TagType type);
+
+        /// Any numeric tag, FLOAT and DOUBLE included
+        [[nodiscard]] double read_number(TagType type);
+
+        [[nodiscard]] std::string_view read_string();
+
+        /// Where the next read starts, for remembering a tag's payload to come back to
+        [[nodiscard]] const std::byte *position() const noexcept { return _at; }
+
+        /// Reads a list header, the elements follow without tag headers
+        /// \return The element type and count
+        [[nodiscard]] std::pair<TagType, std::int32_t> read_list();
+
+    private:
+        template<typename T>
+        [[nodiscard]] T _read();
+
+        [[nodiscard]] const std::byte *_advance(std::size_t size);
+
+        void _skip(TagType type, std::uint32_t depth);
+
+        const std::byte *_at;
+        const std::byte *_end;
+    };
+}    // namespace vx3d::nbt
@@ -0,0 +1,142 @@
+#include "camera_path.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include <map/tile_pyramid.h>
+#include <util/cache_path.h>
+
+namespace
+{
+    constexpr auto header  = std::string_view("vx3d-camera");
+    constexpr auto version = 1;
+
+    // Blocks a frame when panning at one block a pixel, a screen width in a second at 1080p
+    constexpr auto pan_speed = 32.0f;
+
+    // Of zooming by a factor of 16 or so
+    constexpr auto zoom_frames = std::uint32_t(120);
+
+    // Closest zoom the viewer goes to
+    constexpr auto closest_zoom = 1.0f / 16.0f;
+
+    // Every key, precise enough to read back exactly
+    void write_keys(std::ostream &to, const std::vector<vx3d::camera_path::key> &keys)
+    {
+        to << std::setprecision(std::numeric_limits<float>::max_digits10);
+        for (const auto &key : keys)
+            to << key.frame << ' ' << key.zoom << ' ' << key.centre.x << ' ' << key.centre.y << '\n';
+    }
+}    // namespace
+
+vx3d::camera_path
+  vx3d::camera_path::survey(const glm::ivec2 &min, const glm::ivec2 &max, const glm::ivec2 &resolution)
+{
+    const auto extent = glm::vec2(max - min + 1);
+    const auto middle = glm::vec2(min) + extent / 2.0f;
+    const auto fit    = std::clamp(
+      std::max(extent.x / static_cast<float>(resolution.x), extent.y / static_cast<float>(resolution.y)),
+      1.0f,
+      static_cast<float>(1 << map::max_tile_level));
+
+    // From edge to edge, so the first and last screens are half empty like at the edge in the viewer
+    const auto pan_frames = static_cast<std::uint32_t>(extent.x / ::pan_speed);
+    auto       path       = camera_path();
+    path.add(1.0f, { static_cast<float>(min.x), middle.y });
+    path.add(1.0f, { static_cast<float>(max.x), middle.y }, pan_frames);
+    path.add(fit, middle, ::zoom_frames);
+    path.add(::closest_zoom, middle, ::zoom_frames * 2);
+    path.add(1.0f, middle, ::zoom_frames);
+    return path;
+}
+
+std::optional<vx3d::camera_path> vx3d::camera_path::load(const std::filesystem::path &path)
+{
+    auto file = std::ifstream(path);
+    if (!file)
+    {
+        std::cerr << "Couldn't open " << path << std::endl;
+        return std::nullopt;
+    }
+
+    auto line         = std::string();
+    auto name         = std::string();
+    auto file_version = 0;
+    if (
+      !std::getline(file, line) || !(std::istringstream(line) >> name >> file_version) || name != ::header ||
+      file_version != ::version)
+    {
+        std::cerr << path << " isn't a camera path" << std::endl;
+        return std::nullopt;
+    }
+
+    auto loaded = camera_path();
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#') continue;
+
+        auto read = key();
+        if (
+          !(std::istringstream(line) >> read.frame >> read.zoom >> read.centre.x >> read.centre.y) ||
+          read.zoom <= 0.0f || (!loaded._keys.empty() && read.frame <= loaded._keys.back().frame))
+        {
+            std::cerr << "Bad key in " << path << ": " << line << std::endl;
+            return std::nullopt;
+        }
+        loaded._keys.push_back(read);
+    }
+    return loaded;
+}
+
+bool vx3d::camera_path::save(const std::filesystem::path &path) const
+{
+    auto file = std::ofstream(path, std::ios::trunc);
+    file << ::header << ' ' << ::version << '\n';
+    ::write_keys(file, _keys);
+
+    if (!file.flush())
+    {
+        std::cerr << "Couldn't write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void vx3d::camera_path::add(float zoom, const glm::vec2 &centre, std::uint32_t frames)
+{
+    const auto frame = _keys.empty() ? 0 : _keys.back().frame + std::max(frames, 1u);
+    _keys.push_back({ frame, zoom, centre });
+}
+
+vx3d::camera_path::key vx3d::camera_path::at(std::uint32_t frame) const
+{
+    if (_keys.empty()) return { frame };
+
+    const auto next = std::upper_bound(
+      _keys.begin(),
+      _keys.end(),
+      frame,
+      [](std::uint32_t at, const key &next_key) { return at < next_key.frame; });
+    if (next == _keys.begin()) return { frame, next->zoom, next->centre };
+    if (next == _keys.end()) return { frame, _keys.back().zoom, _keys.back().centre };
+
+    const auto &from = *(next - 1);
+    const auto  t    = static_cast<float>(frame - from.frame) / static_cast<float>(next->frame - from.frame);
+    return { frame,
+             from.zoom * std::pow(next->zoom / from.zoom, t),
+             from.centre + (next->centre - from.centre) * t };
+}
+
+std::uint64_t vx3d::camera_path::hash() const
+{
+    auto text = std::ostringstream();
+    ::write_keys(text, _keys);
+    return cache::hash(text.str());
+}
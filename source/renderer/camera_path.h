@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace vx3d
+{
+    // Where the map was looked at, frame by frame, so a session in the viewer can be replayed
+    // without a window. Kept by the block in the middle of the screen rather than a `map_view`, so
+    // a path plays back the same at any resolution.
+    //
+    // On disk it's text, a `vx3d-camera 1` line and then `frame zoom x z` for every key, frames
+    // increasing. Frames between keys are interpolated, so paths can be written by hand as well.
+    class camera_path
+    {
+    public:
+        // Paths are played at 60 frames a second
+        static constexpr auto frame_interval = std::chrono::microseconds(16667);
+
+        struct key
+        {
+            std::uint32_t frame = 0;
+            float         zoom  = 1.0f;    // Blocks along a screen pixel
+            glm::vec2     centre {};
+        };
+
+        /// Pans across the bounds at one block a pixel, zooms out until all of them fit on screen,
+        /// then in past 1:1 and back, at 60 frames a second
+        /// \param min The corner of the bounds, in blocks
+        [[nodiscard]] static camera_path
+          survey(const glm::ivec2 &min, const glm::ivec2 &max, const glm::ivec2 &resolution);
+
+        /// \return nullopt if the file couldn't be read or isn't a camera path
+        [[nodiscard]] static std::optional<camera_path> load(const std::filesystem::path &path);
+
+        [[nodiscard]] bool save(const std::filesystem::path &path) const;
+
+        /// Adds a key `frames` after the last one, the first key is frame 0
+        void add(float zoom, const glm::vec2 &centre, std::uint32_t frames = 1);
+
+        /// Zoom goes between keys geometrically, so zooming takes as long at every scale
+        [[nodiscard]] key at(std::uint32_t frame) const;
+
+        /// The frames to play, 0 for an empty path
+        [[nodiscard]] std::uint32_t frames() const noexcept
+        {
+            return _keys.empty() ? 0 : _keys.back().frame + 1;
+        }
+
+        /// Tells paths apart, results are only comparable between runs of the same one
+        [[nodiscard]] std::uint64_t hash() const;
+
+    private:
+        std::vector<key> _keys;
+    };
+}    // namespace vx3d
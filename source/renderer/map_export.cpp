@@ -0,0 +1,59 @@
+#include "map_export.h"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <loader/world_loader.h>
+#include <renderer/renderer.h>
+#include <ui/headless.h>
+#include <util/png.h>
+
+namespace
+{
+    // Between frames while tiles are rendering, any shorter only takes time from the workers
+    constexpr auto poll_interval = std::chrono::milliseconds(5);
+}    // namespace
+
+int vx3d::run_map_export(
+  const std::filesystem::path &world_folder,
+  const std::filesystem::path &output,
+  const export_options &       options)
+{
+    // First, so it outlives everything holding GL objects
+    const auto context = ui::headless();
+    if (!context.valid()) return 1;
+
+    const auto start  = std::chrono::steady_clock::now();
+    auto       loader = world_loader();
+    loader.set_world(world_folder);
+
+    auto renderer = vx3d::renderer();
+    renderer.set_tile_mode(options.mode);
+    renderer.set_compressed_tiles(options.compressed_tiles);
+
+    const auto size = options.size - options.size % 2;
+    const auto view = map_view::centred_on(options.centre, size, options.zoom);
+
+    auto texture = renderer.render(size, view, loader);
+    while (!renderer.idle())
+    {
+        std::this_thread::sleep_for(::poll_interval);
+        texture = renderer.render(size, view, loader);
+    }
+
+    auto pixels = std::vector<std::uint8_t>(static_cast<std::size_t>(size.x) * size.y * 4);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    if (!png::write(output, size.x, size.y, pixels.data())) return 1;
+
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Wrote " << size.x << "x" << size.y << " to " << output << " in " << seconds << " s"
+              << std::endl;
+    if (const auto psnr = renderer.tile_psnr())
+        std::cout << "Tiles kept as BC1, PSNR " << *psnr << " dB" << std::endl;
+    return 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+#include <glm/glm.hpp>
+
+#include <map/tile_renderer.h>
+
+namespace vx3d
+{
+    struct export_options
+    {
+        glm::ivec2     size { 1920, 1080 };    // Rounded down to even numbers, like the window
+        float          zoom = 1.0f;            // Blocks along a pixel
+        glm::vec2      centre {};              // Block in the middle of the image
+        map::tile_mode mode = map::tile_mode::color;
+        bool           compressed_tiles = false;    // Through a BC1 atlas, its PSNR is printed
+    };
+
+    /// Renders a view of a world without a window and writes it to a PNG, through the same
+    /// renderer and shaders the viewer uses. Waits for every tile in view first, places with no
+    /// chunks are left transparent.
+    /// \return An exit code, not 0 if there's no context to render with or the image couldn't be
+    /// written
+    int run_map_export(
+      const std::filesystem::path &world_folder,
+      const std::filesystem::path &output,
+      const export_options &       options);
+}    // namespace vx3d
@@ -0,0 +1,178 @@
+#include "page_table.h"
+
+#include <algorithm>
+
+#include <tracy/Tracy.hpp>
+
+#include <loader/chunk.h>
+
+namespace
+{
+    // Pages across the table to start with, 512 tiles is a big screen at the usual zoom
+    constexpr auto initial_table_size = 16;
+
+    // Pool pages to start with, two rows of the texture
+    constexpr auto initial_capacity = 2 * vx3d::page_table::pool_pages_per_row;
+}    // namespace
+
+vx3d::page_table::page_table() : _table_size(::initial_table_size)
+{
+    _table.assign(static_cast<std::size_t>(_table_size) * _table_size, no_page);
+
+    _pages.resize(::initial_capacity);
+    _texels.assign(_pages.size() * page_area, no_chunk);
+    for (auto page = capacity(); page > 0; page--) _free.push_back(page - 1);
+}
+
+void vx3d::page_table::set_view(const glm::ivec2 &min, const glm::ivec2 &max)
+{
+    const auto span = (max >> page_shift) - (min >> page_shift) + 1;
+    if (std::max(span.x, span.y) > _table_size) _grow_table(std::max(span.x, span.y));
+}
+
+void vx3d::page_table::set(std::int32_t x, std::int32_t z, std::int32_t slot)
+{
+    // Counted as a tile, it would keep its page forever
+    if (slot == no_chunk)
+    {
+        erase(x, z);
+        return;
+    }
+
+    const auto index = _page({ x >> page_shift, z >> page_shift });
+    auto &     texel = _texels[_texel(index, x, z)];
+    if (texel == slot) return;
+
+    if (texel == no_chunk) _pages[index].tiles++;
+    texel = slot;
+    _mark_dirty(index);
+}
+
+void vx3d::page_table::erase(std::int32_t x, std::int32_t z)
+{
+    const auto found = _lookup.find(loader::position_key(x >> page_shift, z >> page_shift));
+    if (found == _lookup.end()) return;
+
+    const auto index = found->second;
+    auto &     texel = _texels[_texel(index, x, z)];
+    if (texel == no_chunk) return;
+
+    texel = no_chunk;
+    _mark_dirty(index);
+    if (--_pages[index].tiles) return;
+
+    // Its last tile went off screen
+    _table[_table_index(_pages[index].position)] = no_page;
+    _lookup.erase(found);
+    _free.push_back(index);
+    _table_dirty = true;
+}
+
+void vx3d::page_table::clear()
+{
+    std::fill(_table.begin(), _table.end(), no_page);
+    std::fill(_texels.begin(), _texels.end(), no_chunk);
+    std::fill(_pages.begin(), _pages.end(), page());
+    _lookup.clear();
+    _dirty.clear();
+    _table_dirty = true;
+
+    _free.clear();
+    for (auto page = capacity(); page > 0; page--) _free.push_back(page - 1);
+}
+
+std::int32_t vx3d::page_table::at(std::int32_t x, std::int32_t z) const noexcept
+{
+    const auto page = _table[_table_index({ x >> page_shift, z >> page_shift })];
+    if (page == no_page) return no_chunk;
+
+    return _texels[_texel(page, x, z)];
+}
+
+bool vx3d::page_table::take_table_dirty() noexcept
+{
+    const auto dirty = _table_dirty;
+    _table_dirty     = false;
+    return dirty;
+}
+
+std::vector<std::int32_t> vx3d::page_table::take_dirty_pages()
+{
+    auto dirty = std::vector<std::int32_t>();
+    dirty.swap(_dirty);
+    for (const auto page : dirty) _pages[page].dirty = false;
+
+    std::sort(dirty.begin(), dirty.end());
+    return dirty;
+}
+
+std::int32_t vx3d::page_table::_page(const glm::ivec2 &position)
+{
+    const auto key = loader::position_key(position.x, position.y);
+    if (const auto at = _lookup.find(key); at != _lookup.end()) return at->second;
+
+    if (_free.empty())
+    {
+        ZoneScopedN("PageTable::grow_pool");
+
+        // The texture is made again at the new size, so everything in it goes up again
+        const auto old_capacity = capacity();
+        _pages.resize(_pages.size() * 2);
+        _texels.resize(_pages.size() * page_area, no_chunk);
+        for (auto page = capacity(); page > old_capacity; page--) _free.push_back(page - 1);
+
+        for (const auto &[page_key, index] : _lookup) _mark_dirty(index);
+    }
+
+    const auto index = _free.back();
+    _free.pop_back();
+    _pages[index]          = page();
+    _pages[index].position = position;
+    _lookup[key]           = index;
+
+    // Another page shares its entry, one left over from the last frame when the view moves
+    if (_table[_table_index(position)] != no_page)
+        _grow_table(0);
+    else
+    {
+        _table[_table_index(position)] = index;
+        _table_dirty                   = true;
+    }
+    return index;
+}
+
+void vx3d::page_table::_grow_table(std::int32_t at_least)
+{
+    ZoneScopedN("PageTable::grow_table");
+
+    auto used = std::vector<bool>();
+    const auto fits = [&](std::int32_t size)
+    {
+        used.assign(static_cast<std::size_t>(size) * size, false);
+        for (const auto &[page_key, index] : _lookup)
+        {
+            const auto wrapped = _pages[index].position & (size - 1);
+            const auto entry   = static_cast<std::size_t>(wrapped.y) * size + wrapped.x;
+            if (used[entry]) return false;
+            used[entry] = true;
+        }
+        return true;
+    };
+
+    auto size = _table_size;
+    do size *= 2;
+    while (size < at_least || !fits(size));
+
+    _table_size = size;
+    _table.assign(static_cast<std::size_t>(size) * size, no_page);
+    for (const auto &[page_key, index] : _lookup) _table[_table_index(_pages[index].position)] = index;
+    _table_dirty = true;
+}
+
+void vx3d::page_table::_mark_dirty(std::int32_t page)
+{
+    if (_pages[page].dirty) return;
+
+    _pages[page].dirty = true;
+    _dirty.push_back(page);
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <tsl/robin_map.h>
+
+#include <map/tile_pyramid.h>
+
+namespace vx3d
+{
+    // Which atlas slot every tile on screen is in, for the shader to find with a fetch from a
+    // table and one from a page instead of probing a hash table per pixel. Tiles are grouped in
+    // pages of `page_width` squared, a region at level 0, and only pages with a tile on screen
+    // have one of the pool's pages. The table of pages wraps around, page x lands in column x
+    // modulo its size, so it only has to be as big as the screen and moving the view rewrites
+    // the entries of the pages that come into it.
+    //
+    // Nothing here touches OpenGL, the renderer uploads `table` and the dirty pages of `texels`.
+    class page_table
+    {
+    public:
+        static constexpr std::int32_t page_shift = 5;
+        static constexpr std::int32_t page_width = 1 << page_shift;
+        static constexpr std::int32_t page_area  = page_width * page_width;
+
+        // Pool pages are laid out in rows of this many in the texture
+        static constexpr std::int32_t pool_pages_per_row = 32;
+
+        static constexpr std::int32_t no_page  = -1;    // Table entry of a page without tiles
+        static constexpr std::int32_t no_chunk = -2;    // Texel of a tile without anything to show
+
+        page_table();
+
+        /// Makes sure every page between two corners, in tiles, has an entry of its own
+        void set_view(const glm::ivec2 &min, const glm::ivec2 &max);
+
+        /// Sets the atlas slot of a tile
+        /// \param slot -1 while the tile is being rendered, it's drawn plain white. `no_chunk` erases it.
+        void set(std::int32_t x, std::int32_t z, std::int32_t slot);
+
+        /// Drops a tile that went off screen, and its page once it has none left
+        void erase(std::int32_t x, std::int32_t z);
+
+        void clear();
+
+        /// Looks a tile up the way the shader does
+        /// \return Its slot, -1 or `no_chunk`
+        [[nodiscard]] std::int32_t at(std::int32_t x, std::int32_t z) const noexcept;
+
+        /// Pool page of every page modulo `table_size`, z then x
+        [[nodiscard]] const std::vector<std::int32_t> &table() const noexcept { return _table; }
+
+        /// Pages across the table, a power of two
+        [[nodiscard]] std::int32_t table_size() const noexcept { return _table_size; }
+
+        /// Pages in the pool, a multiple of `pool_pages_per_row`
+        [[nodiscard]] std::int32_t capacity() const noexcept
+        {
+            return static_cast<std::int32_t>(_pages.size());
+        }
+
+        /// The tiles of a pool page, `page_width` rows of z
+        [[nodiscard]] const std::int32_t *texels(std::int32_t page) const noexcept
+        {
+            return &_texels[static_cast<std::size_t>(page) * page_area];
+        }
+
+        [[nodiscard]] std::size_t pages() const noexcept { return _lookup.size(); }
+
+        /// Whether the table changed since the last call
+        [[nodiscard]] bool take_table_dirty() noexcept;
+
+        /// Pool pages changed since the last call, every one in use after the pool grew
+        [[nodiscard]] std::vector<std::int32_t> take_dirty_pages();
+
+    private:
+        struct page
+        {
+            glm::ivec2    position {};
+            std::uint32_t tiles = 0;
+            bool          dirty = false;
+        };
+
+        [[nodiscard]] std::size_t _table_index(const glm::ivec2 &page) const noexcept
+        {
+            const auto wrapped = page & (_table_size - 1);
+            return static_cast<std::size_t>(wrapped.y) * _table_size + wrapped.x;
+        }
+
+        /// Index of a tile in `_texels`
+        [[nodiscard]] static std::size_t
+          _texel(std::int32_t page, std::int32_t x, std::int32_t z) noexcept
+        {
+            return static_cast<std::size_t>(page) * page_area + (z & (page_width - 1)) * page_width +
+              (x & (page_width - 1));
+        }
+
+        /// Pool page of a page, taking one if it has none
+        [[nodiscard]] std::int32_t _page(const glm::ivec2 &position);
+
+        /// Doubles the table until no two pages in use share an entry
+        void _grow_table(std::int32_t at_least);
+
+        void _mark_dirty(std::int32_t page);
+
+        std::int32_t              _table_size;
+        std::vector<std::int32_t> _table;
+        bool                      _table_dirty = true;
+
+        std::vector<page>         _pages;
+        std::vector<std::int32_t> _texels;
+        std::vector<std::int32_t> _free;    // Lowest page last, so it's handed out first
+        std::vector<std::int32_t> _dirty;
+
+        tsl::robin_map<std::uint64_t, std::int32_t, map::tile_key_hash> _lookup;
+    };
+}    // namespace vx3d
@@ -1,21 +1,73 @@
 #include "renderer.h"
 
+#include <chrono>
+#include <utility>
+
 namespace
 {
-    [[nodiscard]] inline std::int32_t wang_hash(int seed)
+    // Chunks queued for tiles before zoomed out views stop asking for more
+    constexpr auto max_pending_chunks = std::size_t(1) << 14;
+
+    // Pyramid tiles at this level and above cover whole regions
+    constexpr auto region_level = 5;
+
+    // New chunk tiles kept back before they're written to the cache even if more are coming
+    constexpr auto max_unsaved_tiles = std::size_t(4096);
+
+    // Chunks across the screen, the map is drawn from their middle
+    [[nodiscard]] glm::ivec2 chunk_count(const glm::ivec2 &resolution, float zoom) noexcept
     {
-        seed = (seed ^ 61) ^ (seed >> 16);
-        seed *= 9;
-        seed = seed ^ (seed >> 4);
-        seed *= 0x27d4eb2d;
-        seed = seed ^ (seed >> 15);
-        return seed;
+        return glm::ivec2(
+          (std::int32_t((resolution.x + (16 - (resolution.x % 16)))) * zoom) / 16,
+          (std::int32_t((resolution.y + (16 - (resolution.y % 16)))) * zoom) / 16);
     }
 
-    [[nodiscard]] inline std::int32_t hash_32b(int x, int z) { return wang_hash(x * wang_hash(z)); }
+    // Overlays are quicker to paint again than to read back and their ages go stale, relief is
+    // lit differently whenever the light moves and slices change with their range
+    [[nodiscard]] constexpr bool is_cached(vx3d::map::tile_mode mode) noexcept
+    {
+        return !vx3d::map::is_header_overlay(mode) && mode != vx3d::map::tile_mode::relief &&
+          mode != vx3d::map::tile_mode::slice;
+    }
+
+    // Tiles between two corners, empty if `max` is below `min`
+    struct tile_rect
+    {
+        glm::ivec2 min {};
+        glm::ivec2 max { -1 };
+    };
+
+    /// The tiles of one rect outside of another, in up to four rects
+    [[nodiscard]] std::vector<tile_rect> subtract(const tile_rect &from, const tile_rect &without)
+    {
+        const auto min = glm::max(from.min, without.min);
+        const auto max = glm::min(from.max, without.max);
+        if (min.x > max.x || min.y > max.y) return { from };
+
+        // The rows above and below the overlap, then what's left of it and right of it
+        auto parts = std::vector<tile_rect>();
+        if (from.min.y < min.y) parts.push_back({ from.min, { from.max.x, min.y - 1 } });
+        if (from.max.y > max.y) parts.push_back({ { from.min.x, max.y + 1 }, from.max });
+        if (from.min.x < min.x) parts.push_back({ { from.min.x, min.y }, { min.x - 1, max.y } });
+        if (from.max.x > max.x) parts.push_back({ { max.x + 1, min.y }, { from.max.x, max.y } });
+        return parts;
+    }
 }    // namespace
 
+vx3d::map_view vx3d::map_view::centred_on(const glm::vec2 &block, const glm::ivec2 &resolution, float zoom)
+{
+    const auto res = resolution - resolution % 2;
+    return { zoom, block - glm::vec2(res / 2) * zoom + glm::vec2((::chunk_count(res, zoom) / 2) * 16) };
+}
+
+glm::vec2 vx3d::map_view::centre(const glm::ivec2 &resolution) const
+{
+    const auto res = resolution - resolution % 2;
+    return translation + glm::vec2(res / 2) * zoom - glm::vec2((::chunk_count(res, zoom) / 2) * 16);
+}
+
 vx3d::renderer::renderer()
+    : _display_shader(std::string(VX3D_ASSET_PATH) + "shaders/texture_display.comp", GL_COMPUTE_SHADER)
 {
     glGenTextures(1, &_target_texture);
     glBindTexture(GL_TEXTURE_2D, _target_texture);
@@ -24,31 +76,44 @@ vx3d::renderer::renderer()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    glGenBuffers(1, &_chunk_buffer);
-    glGenBuffers(1, &_index_buffer);
+    // Integer textures are only complete without mipmaps
+    for (auto *texture : { &_page_table_texture, &_page_texture })
+    {
+        glGenTextures(1, texture);
+        glBindTexture(GL_TEXTURE_2D, *texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+
+    _find_uniforms();
 
-    _compute_shader = vx3d::opengl::create_shader(
-      std::string(VX3D_ASSET_PATH) + "shaders/texture_display.comp",
-      GL_COMPUTE_SHADER);
-    _compute_program = vx3d::opengl::create_program(_compute_shader);
+    _pyramid.set_backing(
+      [this](std::uint64_t key) { return _cache.find(key, 0); },
+      [this](const std::vector<map::tile> &tiles) { _cache.store(tiles); });
+}
 
-    _uniform_scene_size  = glGetUniformLocation(_compute_program, "scene_size");
-    _uniform_chunk_count = glGetUniformLocation(_compute_program, "chunk_count");
-    _uniform_zoom        = glGetUniformLocation(_compute_program, "zoom");
-    _uniform_translation = glGetUniformLocation(_compute_program, "translation");
+vx3d::renderer::~renderer()
+{
+    _save_tiles();
+    glDeleteTextures(1, &_page_table_texture);
+    glDeleteTextures(1, &_page_texture);
 }
 
-GLuint vx3d::renderer::render(const glm::ivec2 &resolution, vx3d::world_loader &loader)
+GLuint vx3d::renderer::render(const glm::ivec2 &resolution, const map_view &view, vx3d::world_loader &loader)
 {
     ZoneScopedN("Renderer::render");
+    _uploads.begin_frame();
     const auto res = resolution - resolution % 2;
 
-    static auto previous_res = res;
-    static auto first        = true;
-    if (previous_res != res || first)
+    if (_display_shader.poll())
     {
-        first        = false;
-        previous_res = res;
+        _find_uniforms();
+        _redraw = true;
+    }
+
+    if (_target_size != res)
+    {
+        _target_size = res;
         // Texture resized, now we need to render to it
         glBindTexture(GL_TEXTURE_2D, _target_texture);
         glTexImage2D(
@@ -64,123 +129,505 @@ GLuint vx3d::renderer::render(const glm::ivec2 &resolution, vx3d::world_loader &
         glClearTexImage(_target_texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
     }
 
-    glUseProgram(_compute_program);
-    glBindImageTexture(0, _target_texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
-    glClearTexImage(_target_texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    const auto chunk_count = ::chunk_count(res, view.zoom);
 
-    static auto current_zoom        = float(1.0f);
-    static auto current_translation = glm::vec2(0.0f, 0.0f);
-    if (ImGui::IsWindowHovered())
-    {
-        auto &io = ImGui::GetIO();
-        current_zoom += io.MouseWheel * -0.05;
+    // A tile pixel per screen pixel or so, far out views then touch about as many tiles as a
+    // view at 1:1 does chunks
+    const auto level = map::tile_level(view.zoom);
 
-        if (ImGui::IsMouseDown(0))
-        {
-            auto delta = glm::vec2(io.MouseDelta.x, io.MouseDelta.y) * glm::vec2(-1, -1);
-            delta *= current_zoom;
+    ZoneNamedN(a, "Renderer::render::load_chunks", true);
 
-            current_translation.x += delta.x;
-            current_translation.y += delta.y;
-        }
-    }
+    // The blocks in the corners of the screen, rounded the same way as in the shader
+    const auto centre = (chunk_count / 2) * 16;
+    const auto origin = glm::ivec2(glm::floor(view.translation)) - centre;
+    const auto far =
+      glm::ivec2(glm::floor(glm::vec2(res - 1) * view.zoom + view.translation)) - centre;
+
+    _update_tiles(loader, level, origin >> (4 + level), far >> (4 + level));
 
-    const auto chunk_count = glm::ivec2(
-      (std::int32_t((res.x + (16 - (res.x % 16)))) * current_zoom) / 16,
-      (std::int32_t((res.y + (16 - (res.y % 16)))) * current_zoom) / 16);
+    ZoneNamedN(d, "Renderer::render::upload_pages", true);
+    if (_upload_pages()) _redraw = true;
+
+    // Still showing what it would draw
+    if (!_redraw && res == _drawn_resolution && view == _drawn_view)
+    {
+        _uploads.end_frame();
+        return _target_texture;
+    }
+    _redraw            = false;
+    _drawn_resolution = res;
+    _drawn_view       = view;
 
     ZoneNamedN(z, "Renderer::render::update_uniforms", true);
+    glUseProgram(_display_shader.handle());
+    glBindImageTexture(0, _target_texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glClearTexImage(_target_texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
     glUniform2i(_uniform_scene_size, res.x, res.y);
     glUniform2i(_uniform_chunk_count, chunk_count.x, chunk_count.y);
-    glUniform1f(_uniform_zoom, current_zoom);
-    glUniform2f(_uniform_translation, current_translation.x, current_translation.y);
+    glUniform1f(_uniform_zoom, view.zoom);
+    glUniform2f(_uniform_translation, view.translation.x, view.translation.y);
+    glUniform1i(_uniform_tile_level, level);
 
-    ZoneNamedN(a, "Renderer::render::load_chunks", true);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, _atlas.texture());
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, _page_table_texture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, _page_texture);
+    glActiveTexture(GL_TEXTURE0);
 
-    // Request the chunks we're going to render
-    auto chunks = std::vector<vx3d::loader::chunk_location>();
-    chunks.reserve(chunk_count.x * chunk_count.y);
+    ZoneNamedN(c, "Renderer::render::compute", true);
+    // Groups of 8x8, rounded up so the last column and row of pixels get one too
+    glDispatchCompute(static_cast<GLuint>((res.x + 7) / 8), static_cast<GLuint>((res.y + 7) / 8), 1);
 
-    const auto chunk_offset = glm::ivec2(current_translation) / 16;
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    _uploads.end_frame();
 
-    for (auto x = -chunk_count.x / 2; x < chunk_count.x / 2; x++)
-        for (auto z = -chunk_count.y / 2; z < chunk_count.y / 2; z++)
-            chunks.emplace_back(chunk_offset.x + x, chunk_offset.y + z);
+    return _target_texture;
+}
 
-    auto found = loader.get_locations(chunks);
+void vx3d::renderer::_find_uniforms()
+{
+    const auto program   = _display_shader.handle();
+    _uniform_scene_size  = glGetUniformLocation(program, "scene_size");
+    _uniform_chunk_count = glGetUniformLocation(program, "chunk_count");
+    _uniform_zoom        = glGetUniformLocation(program, "zoom");
+    _uniform_translation = glGetUniformLocation(program, "translation");
+    _uniform_tile_level  = glGetUniformLocation(program, "tile_level");
+}
 
-    ZoneNamedN(b, "Renderer::render::create_indices", true);
+bool vx3d::renderer::_upload_pages()
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-    struct gpu_location_node
+    // Both textures are made again when they grow, the page table marks what has to go up again
+    glBindTexture(GL_TEXTURE_2D, _page_table_texture);
+    const auto table_size = _pages.table_size();
+    if (_page_table_size != table_size)
     {
-        int x     = 0;
-        int z     = 0;
-        int empty = true;
-        int pad   = 0;
-    };
+        _page_table_size = table_size;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32I, table_size, table_size, 0, GL_RED_INTEGER, GL_INT, nullptr);
+    }
+    auto changed = _pages.take_table_dirty();
+    if (changed)
+        _uploads.tex_sub_image(
+          0,
+          0,
+          table_size,
+          table_size,
+          GL_RED_INTEGER,
+          GL_INT,
+          _pages.table().data(),
+          _pages.table().size() * sizeof(std::int32_t));
 
-    struct hash_node_entry
+    glBindTexture(GL_TEXTURE_2D, _page_texture);
+    const auto rows = _pages.capacity() / page_table::pool_pages_per_row;
+    if (_page_rows != rows)
     {
-        int begin = -1;
-        int end   = -1;
-    };
+        _page_rows = rows;
+        glTexImage2D(
+          GL_TEXTURE_2D,
+          0,
+          GL_R32I,
+          page_table::pool_pages_per_row * page_table::page_width,
+          rows * page_table::page_width,
+          0,
+          GL_RED_INTEGER,
+          GL_INT,
+          nullptr);
+    }
+    const auto pages = _pages.take_dirty_pages();
+    for (const auto page : pages)
+        _uploads.tex_sub_image(
+          (page % page_table::pool_pages_per_row) * page_table::page_width,
+          (page / page_table::pool_pages_per_row) * page_table::page_width,
+          page_table::page_width,
+          page_table::page_width,
+          GL_RED_INTEGER,
+          GL_INT,
+          _pages.texels(page),
+          page_table::page_area * sizeof(std::int32_t));
+
+    return changed || !pages.empty();
+}
+
+void vx3d::renderer::watch_shaders(std::function<void(bool)> bind_context)
+{
+    _display_shader.watch(std::move(bind_context));
+}
 
-    auto hash_map = std::vector<std::vector<gpu_location_node>>(found.size() * 1.7);
-    for (const auto location : found)
+void vx3d::renderer::set_tile_mode(map::tile_mode mode)
+{
+    if (mode == _tile_mode) return;
+
+    _save_tiles();
+    _tile_mode = mode;
+    _reset_tiles();
+}
+
+void vx3d::renderer::set_overlay_threshold(std::uint8_t sectors)
+{
+    if (sectors == _overlay.size_threshold) return;
+
+    _overlay.size_threshold = sectors;
+    if (_tile_mode == map::tile_mode::oversized) _reset_tiles();
+}
+
+void vx3d::renderer::set_relief_light(const map::relief_light &light)
+{
+    if (light == _relief) return;
+
+    _relief = light;
+    if (_tiles) _tiles->set_relief_light(light);
+    if (_tile_mode == map::tile_mode::relief) _rerender_tiles();
+}
+
+void vx3d::renderer::set_slice(const map::slice_range &slice)
+{
+    if (slice == _slice) return;
+
+    _slice = slice;
+    if (_tiles) _tiles->set_slice(slice);
+    if (_tile_mode == map::tile_mode::slice) _rerender_tiles();
+}
+
+void vx3d::renderer::set_compressed_tiles(bool compressed)
+{
+    if (compressed == _atlas.compressed()) return;
+
+    _atlas.set_compressed(compressed);
+    if (_tiles) _tiles->set_compressed(_atlas.compressed());
+    _rescan = true;
+    _redraw = true;
+}
+
+void vx3d::renderer::invalidate_chunk(std::int32_t x, std::int32_t z)
+{
+    // Whatever is there stays up until the new tile replaces it all the way up the pyramid
+    if (!_tiles || map::is_header_overlay(_tile_mode)) return;
+
+    // The chunks around shade their edges against this one, each from the other side
+    auto       chunks     = std::vector<glm::ivec2>({ glm::ivec2(x, z) });
+    const auto neighbours = map::neighbours_of(_tile_mode);
+    for (auto i = 0; i < 9; i++)
+        if (i != 4 && neighbours & (1 << i)) chunks.emplace_back(x - i % 3 + 1, z - i / 3 + 1);
+    _tiles->request(chunks, _tile_mode);
+}
+
+bool vx3d::renderer::idle()
+{
+    return (!_tiles || _tiles->idle()) && _expansion.empty() && _atlas.idle();
+}
+
+void vx3d::renderer::_save_tiles()
+{
+    ZoneScopedN("Renderer::save_tiles");
+    _pyramid.flush();
+    _cache.store(_unsaved);
+    _unsaved.clear();
+}
+
+void vx3d::renderer::_reset_tiles()
+{
+    _rerender_tiles();
+    _atlas.clear();
+    _redraw = true;
+
+    _overlay.now = static_cast<std::uint32_t>(
+      std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch())
+        .count());
+    _cache.open(::is_cached(_tile_mode) ? _world_folder : std::filesystem::path(), _tile_mode);
+}
+
+void vx3d::renderer::_rerender_tiles()
+{
+    _atlas.mark_stale();
+    _pyramid.clear();
+    _unsaved.clear();
+    _expanded.clear();
+    _expansion.clear();
+    _expanded_regions.clear();
+    if (_tiles) _tiles->clear();
+    _rescan = true;
+}
+
+void vx3d::renderer::_update_tiles(
+  vx3d::world_loader &loader,
+  std::uint8_t        level,
+  const glm::ivec2 &  min,
+  const glm::ivec2 &  max)
+{
+    ZoneScopedN("Renderer::update_tiles");
+
+    if (!_tiles)
     {
-        auto gpu_location  = gpu_location_node();
-        gpu_location.x     = location.x;
-        gpu_location.z     = location.z;
-        gpu_location.empty = false;
-        gpu_location.pad   = rand();
+        _tiles = std::make_unique<map::tile_renderer>(map::world_summaries(loader));
+        _tiles->set_relief_light(_relief);
+        _tiles->set_slice(_slice);
+        _tiles->set_compressed(_atlas.compressed());
+    }
 
-        const auto hash = ::hash_32b(location.x, location.z);
-        hash_map[hash % hash_map.size()].push_back(gpu_location);
+    if (_tile_generation != loader.generation())
+    {
+        _save_tiles();
+        _tile_generation = loader.generation();
+        _world_folder    = loader.world_folder();
+        _reset_tiles();
     }
 
-    auto flattened_hash_map = std::vector<gpu_location_node>();
-    flattened_hash_map.reserve(found.size());
-    auto hash_map_hash_indices = std::vector<hash_node_entry>(hash_map.size());
-    for (auto i = 0; i < hash_map_hash_indices.size(); i++)
+    _atlas.next_frame();
+    _atlas.set_view(level, min, max);
+
+    // Every chunk tile goes into the pyramid, only those being looked at into the atlas. Tiles the
+    // atlas compressed go first, so anything newer of them replaces them.
+    auto uploads = _atlas.take_compressed();
+    for (auto &tile : _tiles->take_finished())
     {
-        const auto &current_map = hash_map[i];
-        if (!current_map.empty())
+        _pyramid.insert(tile);
+        _unsaved.push_back(tile);
+        if (level == 0 || _atlas.contains(map::tile_key(0, tile.x, tile.z)))
+            uploads.push_back(std::move(tile));
+    }
+
+    for (const auto key : _pyramid.take_changed())
+        if (_atlas.contains(key) || _atlas.on_screen(key))
+            if (const auto *tile = _pyramid.find(key)) uploads.push_back(*tile);
+
+    // The pages only keep one level, what's on screen at another has to be set again anyway. At
+    // the same level only the tiles that came on screen are looked at and those that went off it
+    // dropped, nothing at all while the view stays where it is.
+    const auto screen  = ::tile_rect { min, max };
+    auto       entered = std::vector<::tile_rect>({ screen });
+    if (_rescan || level != _pages_level)
+    {
+        _pages.clear();
+        _pages_level = level;
+        _rescan      = false;
+    }
+    else
+    {
+        entered = ::subtract(screen, { _pages_min, _pages_max });
+        for (const auto &left : ::subtract({ _pages_min, _pages_max }, screen))
+            for (auto x = left.min.x; x <= left.max.x; x++)
+                for (auto z = left.min.y; z <= left.max.y; z++)
+                {
+                    // Tiles are evicted by when they were last on screen
+                    static_cast<void>(_atlas.use(level, x, z));
+                    _pages.erase(x, z);
+                }
+    }
+    _pages_min = min;
+    _pages_max = max;
+
+    _pages.set_view(min, max);
+    for (const auto &part : entered)
+        for (const auto location : _visible_tiles(loader, level, part.min, part.max, uploads))
+            _pages.set(location.x, location.y, _atlas.use(level, location.x, location.y));
+
+    if (!uploads.empty()) _redraw = true;
+    if (_atlas.upload(uploads, _uploads)) _rescan = true;
+    for (const auto &tile : uploads)
+        if (_atlas.on_screen(map::tile_key(tile.level, tile.x, tile.z)))
+            _pages.set(tile.x, tile.z, _atlas.use(level, tile.x, tile.z));
+
+    while (!_expansion.empty() && _tiles->pending() < ::max_pending_chunks)
+    {
+        const auto region = _expansion.front();
+        _expansion.pop_front();
+
+        const auto locations = loader.chunks_in(region * 32, region * 32 + 31);
+        const auto stamps    = map::tile_stamps(loader, _tile_mode, locations);
+
+        auto chunks = std::vector<glm::ivec2>();
+        for (auto i = std::size_t(0); i < locations.size(); i++)
+            if (!_cache.contains(map::tile_key(0, locations[i].x, locations[i].z), stamps[i]))
+                chunks.emplace_back(locations[i].x, locations[i].z);
+        if (!chunks.empty()) _tiles->request(chunks, _tile_mode);
+    }
+
+    // Saved in batches while tiles are still coming in, and whatever is left once they stop
+    const auto idle = _expansion.empty() && _tiles->pending() == 0;
+    if (_unsaved.size() >= ::max_unsaved_tiles || (idle && !_unsaved.empty())) _save_tiles();
+
+    // Tiles on screen that never came, let go by the pyramid before they were shown, are looked
+    // for again once nothing else is on its way
+    if (idle && !_tiles_idle) _rescan = true;
+    _tiles_idle = idle;
+}
+
+std::vector<glm::ivec2> vx3d::renderer::_visible_tiles(
+  vx3d::world_loader &    loader,
+  std::uint8_t            level,
+  const glm::ivec2 &      min,
+  const glm::ivec2 &      max,
+  std::vector<map::tile> &uploads)
+{
+    if (map::is_header_overlay(_tile_mode)) return _overlay_tiles(loader, level, min, max, uploads);
+    if (level == 0) return _chunk_tiles(loader, min, max, uploads);
+    return _pyramid_tiles(loader, level, min, max, uploads);
+}
+
+std::vector<glm::ivec2> vx3d::renderer::_chunk_tiles(
+  vx3d::world_loader &    loader,
+  const glm::ivec2 &      min,
+  const glm::ivec2 &      max,
+  std::vector<map::tile> &uploads)
+{
+    auto chunks = std::vector<vx3d::loader::chunk_location>();
+    chunks.reserve((max.x - min.x + 1) * (max.y - min.y + 1));
+    for (auto x = min.x; x <= max.x; x++)
+        for (auto z = min.y; z <= max.y; z++) chunks.emplace_back(x, z);
+
+    // Chunks saved the same as when their tile was cached never touch their region file
+    const auto locations = loader.get_locations(chunks);
+    const auto stamps    = map::tile_stamps(loader, _tile_mode, locations);
+
+    auto visible = std::vector<glm::ivec2>();
+    auto missing = std::vector<glm::ivec2>();
+    for (auto i = std::size_t(0); i < locations.size(); i++)
+    {
+        const auto &location = locations[i];
+        visible.emplace_back(location.x, location.z);
+
+        const auto key = map::tile_key(0, location.x, location.z);
+        if (_atlas.use(0, location.x, location.z) >= 0 && !_atlas.stale(key)) continue;
+
+        if (auto cached = _cache.find(key, stamps[i]))
+            uploads.push_back(std::move(*cached));
+        else
+            missing.emplace_back(location.x, location.z);
+    }
+
+    if (!missing.empty()) _tiles->request(missing, _tile_mode);
+    return visible;
+}
+
+std::vector<glm::ivec2> vx3d::renderer::_pyramid_tiles(
+  vx3d::world_loader &    loader,
+  std::uint8_t            level,
+  const glm::ivec2 &      min,
+  const glm::ivec2 &      max,
+  std::vector<map::tile> &uploads)
+{
+    auto visible = std::vector<glm::ivec2>();
+
+    const auto idle = _expansion.empty() && _tiles->pending() == 0;
+    for (auto x = min.x; x <= max.x; x++)
+        for (auto z = min.y; z <= max.y; z++)
         {
-            const auto begin_index         = flattened_hash_map.size();
-            const auto end_index           = begin_index + current_map.size();
-            hash_map_hash_indices[i].begin = begin_index;
-            hash_map_hash_indices[i].end   = end_index;
+            const auto key          = map::tile_key(level, x, z);
+            const auto expanded     = _expanded.find(key);
+            const auto was_expanded = expanded != _expanded.end();
+            if (!was_expanded)
+                _expand_tile(loader, level, { x, z });
+            else if (!expanded->second)
+                continue;
 
-            for (const auto &location : current_map) flattened_hash_map.push_back(location);
+            if (_atlas.use(level, x, z) >= 0)
+                visible.emplace_back(x, z);
+            else if (const auto *tile = _pyramid.find(key))
+            {
+                uploads.push_back(*tile);
+                visible.emplace_back(x, z);
+            }
+            else if (idle && was_expanded)
+            {
+                // Requested before and nothing is on the way, so the pyramid had to let it go.
+                // It's expanded again on the next pass.
+                _expanded.erase(key);
+                _rescan = true;
+                if (level >= ::region_level)
+                {
+                    const auto regions = 1 << (level - ::region_level);
+                    for (auto region_x = x * regions; region_x < (x + 1) * regions; region_x++)
+                        for (auto region_z = z * regions; region_z < (z + 1) * regions; region_z++)
+                            _expanded_regions.erase(vx3d::world_loader::hash_pos(region_x, region_z));
+                }
+            }
         }
-    }
 
-    // Loaded chunks
-    ZoneNamedN(d, "Renderer::render::upload_buffers", true);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _chunk_buffer);
-    glBufferData(
-      GL_SHADER_STORAGE_BUFFER,
-      flattened_hash_map.size() * sizeof(std::int32_t) * 4,
-      flattened_hash_map.data(),
-      GL_DYNAMIC_COPY);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, _chunk_buffer);
-
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, _index_buffer);
-    glBufferData(
-      GL_SHADER_STORAGE_BUFFER,
-      hash_map_hash_indices.size() * sizeof(std::int32_t) * 2,
-      hash_map_hash_indices.data(),
-      GL_DYNAMIC_COPY);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, _index_buffer);
+    return visible;
+}
 
-    ZoneNamedN(c, "Renderer::render::compute", true);
-    glDispatchCompute(
-      static_cast<int>(glm::ceil(resolution.x / 8)),
-      static_cast<int>(glm::ceil(resolution.y / 8)),
-      1);
+std::vector<glm::ivec2> vx3d::renderer::_overlay_tiles(
+  vx3d::world_loader &    loader,
+  std::uint8_t            level,
+  const glm::ivec2 &      min,
+  const glm::ivec2 &      max,
+  std::vector<map::tile> &uploads)
+{
+    const auto source = [&loader](std::int32_t x, std::int32_t z) {
+        return loader.region_header(x, z);
+    };
 
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    auto visible = std::vector<glm::ivec2>();
+    for (auto x = min.x; x <= max.x; x++)
+        for (auto z = min.y; z <= max.y; z++)
+        {
+            const auto key = map::tile_key(level, x, z);
+            if (_atlas.use(level, x, z) >= 0)
+            {
+                visible.emplace_back(x, z);
+                continue;
+            }
 
-    return _target_texture;
+            // Tiles without a chunk under them are remembered, so they're only looked at once
+            if (_expanded.count(key)) continue;
+
+            const auto width   = 1 << level;
+            const auto regions = loader.regions_in(
+              glm::ivec2(x, z) * width >> 5,
+              (glm::ivec2(x, z) * width + (width - 1)) >> 5);
+
+            auto tile  = map::tile();
+            tile.x     = x;
+            tile.z     = z;
+            tile.level = level;
+            if (!map::render_header_tile(_tile_mode, _overlay, regions, source, tile))
+            {
+                _expanded[key] = false;
+                continue;
+            }
+
+            uploads.push_back(tile);
+            visible.emplace_back(x, z);
+        }
+
+    return visible;
+}
+
+void vx3d::renderer::_expand_tile(
+  vx3d::world_loader &loader,
+  std::uint8_t        level,
+  const glm::ivec2 &  tile)
+{
+    const auto key = map::tile_key(level, tile.x, tile.y);
+    const auto min = tile * (1 << level);
+    const auto max = min + ((1 << level) - 1);
+
+    if (level < ::region_level)
+    {
+        const auto locations = loader.chunks_in(min, max);
+        const auto stamps    = map::tile_stamps(loader, _tile_mode, locations);
+        _expanded[key]       = !locations.empty();
+
+        // Chunks with a tile in the cache are already part of the cached levels above
+        auto chunks = std::vector<glm::ivec2>();
+        for (auto i = std::size_t(0); i < locations.size(); i++)
+            if (!_cache.contains(map::tile_key(0, locations[i].x, locations[i].z), stamps[i]))
+                chunks.emplace_back(locations[i].x, locations[i].z);
+        if (!chunks.empty()) _tiles->request(chunks, _tile_mode);
+        return;
+    }
+
+    // Regions go into a queue, so zooming out over the whole world doesn't queue every chunk in it
+    // at once. Levels share regions, each one is only asked for once.
+    const auto regions = loader.regions_in(min >> 5, max >> 5);
+    _expanded[key]     = !regions.empty();
+    for (const auto &region : regions)
+        if (_expanded_regions.insert(vx3d::world_loader::hash_pos(region.x, region.y)).second)
+            _expansion.push_back(region);
 }
@@ -1,34 +1,209 @@
 #pragma once
 
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+
 #include <util/opengl.h>
 #include <loader/world_loader.h>
+#include <map/header_overlay.h>
+#include <map/tile_cache.h>
+#include <map/tile_pyramid.h>
+#include <map/tile_renderer.h>
+#include <renderer/page_table.h>
+#include <renderer/shader_program.h>
+#include <renderer/tile_atlas.h>
+#include <renderer/upload_ring.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtx/matrix_transform_2d.hpp>
-#include <imgui/imgui.h>
 
 #include <iostream>
 
 namespace vx3d
 {
+    // What part of the map is on screen
+    struct map_view
+    {
+        float     zoom = 1.0f;    // Blocks along a screen pixel
+        glm::vec2 translation {};
+
+        /// The view with a block in the middle of the screen
+        [[nodiscard]] static map_view
+          centred_on(const glm::vec2 &block, const glm::ivec2 &resolution, float zoom);
+
+        /// The block in the middle of the screen, the inverse of `centred_on`
+        [[nodiscard]] glm::vec2 centre(const glm::ivec2 &resolution) const;
+
+        [[nodiscard]] bool operator==(const map_view &other) const noexcept
+        {
+            return zoom == other.zoom && translation == other.translation;
+        }
+    };
+
     class renderer
     {
     public:
         renderer();
 
-        [[nodiscard]] GLuint render(const glm::ivec2 &resolution, vx3d::world_loader &loader);
+        ~renderer();
+
+        [[nodiscard]] GLuint
+          render(const glm::ivec2 &resolution, const map_view &view, vx3d::world_loader &loader);
+
+        /// Links the shaders again as their sources are edited, see `shader_program::watch`
+        void watch_shaders(std::function<void(bool)> bind_context);
+
+        /// Switches what the tiles show, every tile is rendered again
+        void set_tile_mode(map::tile_mode mode);
+
+        /// Chunks at or over this many sectors are highlighted by the oversized overlay
+        void set_overlay_threshold(std::uint8_t sectors);
+
+        /// Relief tiles on screen stay up until they're lit again, nothing is decoded for it
+        void set_relief_light(const map::relief_light &light);
+
+        /// Slice tiles on screen stay up until the new range replaces them
+        void set_slice(const map::slice_range &slice);
+
+        /// Keeps the tile atlas as BC1 or RGBA8, every tile on screen is uploaded again
+        void set_compressed_tiles(bool compressed);
+
+        [[nodiscard]] map::tile_mode tile_mode() const noexcept { return _tile_mode; }
+
+        [[nodiscard]] bool compressed_tiles() const noexcept { return _atlas.compressed(); }
+
+        /// What compressing the tiles costs, see `tile_atlas::psnr`
+        [[nodiscard]] std::optional<double> tile_psnr() const { return _atlas.psnr(); }
+
+        [[nodiscard]] const map::relief_light &relief_light() const noexcept { return _relief; }
+
+        [[nodiscard]] const map::slice_range &slice() const noexcept { return _slice; }
+
+        [[nodiscard]] map::tile_cache::lookups tile_cache_lookups() const { return _cache.lookup_counts(); }
+
+        [[nodiscard]] std::uint8_t overlay_threshold() const noexcept
+        {
+            return _overlay.size_threshold;
+        }
+
+        /// Renders a chunk again, along with what it covers in every level above
+        void invalidate_chunk(std::int32_t x, std::int32_t z);
+
+        /// Whether there are no tiles on their way, so nothing changes until the view does
+        [[nodiscard]] bool idle();
 
     private:
-        GLuint _compute_program;
-        GLuint _compute_shader;
+        /// Writes new tiles to the cache, changed pyramid tiles first so a chunk tile is never on
+        /// disk without its part of the levels above
+        void _save_tiles();
+
+        void _reset_tiles();
+
+        /// Drops every tile that was made from the summaries, keeping what's on screen until it's
+        /// replaced
+        void _rerender_tiles();
+
+        /// Gets the tiles of a level between two corners into the atlas and the pages. Only the
+        /// tiles that came on screen since the last call are looked at, those that went off it
+        /// dropped and the ones uploaded set, unless the level changed or `_rescan` is set.
+        void _update_tiles(
+          vx3d::world_loader &loader,
+          std::uint8_t        level,
+          const glm::ivec2 &  min,
+          const glm::ivec2 &  max);
+
+        /// The tiles of a level between two corners that have something to show, for the mode
+        [[nodiscard]] std::vector<glm::ivec2> _visible_tiles(
+          vx3d::world_loader &    loader,
+          std::uint8_t            level,
+          const glm::ivec2 &      min,
+          const glm::ivec2 &      max,
+          std::vector<map::tile> &uploads);
+
+        /// Level 0 of `_visible_tiles`, tiles of chunks on screen come from the cache if they can
+        [[nodiscard]] std::vector<glm::ivec2> _chunk_tiles(
+          vx3d::world_loader &    loader,
+          const glm::ivec2 &      min,
+          const glm::ivec2 &      max,
+          std::vector<map::tile> &uploads);
+
+        /// Levels above 0 of `_visible_tiles`, tiles on screen are expanded the first time
+        [[nodiscard]] std::vector<glm::ivec2> _pyramid_tiles(
+          vx3d::world_loader &    loader,
+          std::uint8_t            level,
+          const glm::ivec2 &      min,
+          const glm::ivec2 &      max,
+          std::vector<map::tile> &uploads);
+
+        /// `_visible_tiles` of the header overlays, every level is painted straight from the region
+        /// headers so nothing is requested or cached
+        [[nodiscard]] std::vector<glm::ivec2> _overlay_tiles(
+          vx3d::world_loader &    loader,
+          std::uint8_t            level,
+          const glm::ivec2 &      min,
+          const glm::ivec2 &      max,
+          std::vector<map::tile> &uploads);
+
+        /// Looks up the uniforms of the display shader, again whenever it's relinked
+        void _find_uniforms();
+
+        /// Copies what changed in `_pages` to its textures
+        /// \return Whether anything did
+        bool _upload_pages();
+
+        /// Requests every chunk under a tile above level 0, big tiles are queued a region at a time
+        void _expand_tile(vx3d::world_loader &loader, std::uint8_t level, const glm::ivec2 &tile);
+
+        vx3d::shader_program _display_shader;
+
         GLuint _target_texture;
-        GLuint _chunk_buffer;
-        GLuint _index_buffer;
+        GLuint _page_table_texture;
+        GLuint _page_texture;
+
+        glm::ivec2 _target_size {};
+
+        // Sizes the page textures were made at, in pages and rows of pages
+        std::int32_t _page_table_size = 0;
+        std::int32_t _page_rows       = 0;
+
+        // What the target texture holds, it's only drawn again when the view or the tiles change
+        glm::ivec2 _drawn_resolution {};
+        map_view   _drawn_view;
+        bool       _redraw = true;
 
         GLint _uniform_scene_size;
         GLint _uniform_chunk_count;
         GLint _uniform_zoom;
         GLint _uniform_translation;
+        GLint _uniform_tile_level;
+
+        vx3d::upload_ring                    _uploads;
+        vx3d::tile_atlas                     _atlas;
+        vx3d::page_table                     _pages;
+        std::int32_t                         _pages_level = -1;    // Of the tiles in the pages
+        glm::ivec2                           _pages_min {};        // Tiles last on screen
+        glm::ivec2                           _pages_max { -1 };
+        bool                                 _rescan     = true;    // Looks at every tile on screen
+        bool                                 _tiles_idle = true;
+        std::unique_ptr<map::tile_renderer> _tiles;
+        map::tile_mode                       _tile_mode       = map::tile_mode::color;
+        std::uint32_t                        _tile_generation = 0;
+        map::overlay_settings                _overlay;
+        map::relief_light                    _relief;
+        map::slice_range                     _slice;
+
+        std::filesystem::path  _world_folder;
+        map::tile_pyramid      _pyramid;
+        map::tile_cache        _cache;
+        std::vector<map::tile> _unsaved;
+
+        // Tiles above level 0 whose chunks were requested, and whether they have any
+        tsl::robin_map<std::uint64_t, bool, map::tile_key_hash> _expanded;
+        std::deque<glm::ivec2>                                  _expansion;
+        tsl::robin_set<std::uint64_t>                           _expanded_regions;
     };
 }
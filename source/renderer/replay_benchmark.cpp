@@ -0,0 +1,154 @@
+#include "replay_benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <loader/world_loader.h>
+#include <renderer/camera_path.h>
+#include <renderer/renderer.h>
+#include <ui/headless.h>
+#include <util/cache_path.h>
+
+namespace
+{
+    // Between frames once the path is over and the last tiles come in, like the export's
+    constexpr auto settle_interval = std::chrono::milliseconds(5);
+
+    [[nodiscard]] double milliseconds_since(std::chrono::steady_clock::time_point start) noexcept
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /// Nearest rank
+    [[nodiscard]] double percentile(const std::vector<double> &sorted, double fraction) noexcept
+    {
+        const auto rank = static_cast<std::size_t>(std::ceil(fraction * static_cast<double>(sorted.size())));
+        return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    [[nodiscard]] double percent(std::uint64_t part, std::uint64_t whole) noexcept
+    {
+        return whole ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+    }
+}    // namespace
+
+int vx3d::run_replay_benchmark(
+  const std::filesystem::path &world_folder,
+  const std::filesystem::path &camera,
+  const replay_options &       options)
+{
+    // First, so it outlives everything holding GL objects
+    const auto context = ui::headless();
+    if (!context.valid()) return 1;
+
+    if (options.cold)
+    {
+        // Only ever holds what can be made again from the world
+        auto       error = std::error_code();
+        const auto cache = cache::world_file(world_folder, "");
+        if (!cache.empty()) std::filesystem::remove_all(cache.parent_path(), error);
+    }
+
+    auto loader = world_loader();
+    loader.set_world(world_folder);
+
+    const auto size = options.size - options.size % 2;
+    auto       path = camera_path();
+    if (!camera.empty())
+    {
+        auto loaded = camera_path::load(camera);
+        if (!loaded) return 1;
+        path = std::move(*loaded);
+    }
+    else
+    {
+        const auto limit  = glm::ivec2(world_loader::world_limit);
+        const auto chunks = loader.chunks_in(-limit, limit);
+        if (chunks.empty())
+        {
+            std::cerr << "No chunks to survey in " << world_folder << std::endl;
+            return 1;
+        }
+
+        auto min = glm::ivec2(std::numeric_limits<std::int32_t>::max());
+        auto max = glm::ivec2(std::numeric_limits<std::int32_t>::min());
+        for (const auto &chunk : chunks)
+        {
+            min = glm::min(min, glm::ivec2(chunk.x, chunk.z) * 16);
+            max = glm::max(max, glm::ivec2(chunk.x, chunk.z) * 16 + 15);
+        }
+        path = camera_path::survey(min, max, size);
+    }
+    if (!path.frames())
+    {
+        std::cerr << "The camera path has no frames" << std::endl;
+        return 1;
+    }
+
+    auto renderer = vx3d::renderer();
+    renderer.set_tile_mode(options.mode);
+
+    std::cout << "Replaying " << path.frames() << " frames of path " << std::hex << std::setw(16)
+              << std::setfill('0') << path.hash() << std::dec << std::setfill(' ') << " at " << size.x << "x"
+              << size.y << (options.cold ? ", cold" : ", warm") << std::endl;
+
+    // Each frame is timed from the start of the render to when the GPU is done with it
+    auto       frame_milliseconds = std::vector<double>();
+    auto       view               = map_view();
+    const auto start              = std::chrono::steady_clock::now();
+    for (auto frame = std::uint32_t(0); frame < path.frames(); frame++)
+    {
+        std::this_thread::sleep_until(start + frame * camera_path::frame_interval);
+
+        const auto key         = path.at(frame);
+        view                   = map_view::centred_on(key.centre, size, key.zoom);
+        const auto frame_start = std::chrono::steady_clock::now();
+        static_cast<void>(renderer.render(size, view, loader));
+        glFinish();
+        frame_milliseconds.push_back(::milliseconds_since(frame_start));
+    }
+    const auto played_milliseconds = ::milliseconds_since(start);
+
+    // The last view is drawn until every tile of it is in, so a run always does the same work
+    while (!renderer.idle())
+    {
+        std::this_thread::sleep_for(::settle_interval);
+        static_cast<void>(renderer.render(size, view, loader));
+    }
+    glFinish();
+    const auto seconds = ::milliseconds_since(start) / 1000.0;
+
+    const auto mean = std::accumulate(frame_milliseconds.begin(), frame_milliseconds.end(), 0.0) /
+      static_cast<double>(frame_milliseconds.size());
+    const auto budget = std::chrono::duration<double, std::milli>(camera_path::frame_interval).count();
+    const auto over   = std::count_if(
+      frame_milliseconds.begin(),
+      frame_milliseconds.end(),
+      [budget](double milliseconds) { return milliseconds > budget; });
+    std::sort(frame_milliseconds.begin(), frame_milliseconds.end());
+
+    const auto summaries = loader.summary_lookups();
+    const auto tiles     = renderer.tile_cache_lookups();
+
+    std::cout << std::fixed << std::setprecision(2) << "Frame ms: p50 "
+              << ::percentile(frame_milliseconds, 0.5) << ", p90 " << ::percentile(frame_milliseconds, 0.9)
+              << ", p99 " << ::percentile(frame_milliseconds, 0.99) << ", max " << frame_milliseconds.back()
+              << ", mean " << mean << ", " << over << " over " << budget << std::endl;
+    std::cout << "Chunks decoded: " << summaries.decoded << ", "
+              << static_cast<double>(summaries.decoded) / seconds << "/s" << std::endl;
+    std::cout << "Summary store hits: " << ::percent(summaries.cached, summaries.cached + summaries.decoded)
+              << "% of " << summaries.cached + summaries.decoded << std::endl;
+    std::cout << "Tile cache hits: " << ::percent(tiles.hits, tiles.hits + tiles.misses) << "% of "
+              << tiles.hits + tiles.misses << std::endl;
+    std::cout << "Played in " << played_milliseconds / 1000.0 << " s, settled after " << seconds << " s"
+              << std::defaultfloat << std::endl;
+    return 0;
+}
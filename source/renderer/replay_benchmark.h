@@ -0,0 +1,28 @@
+#pragma once
+
+#include <filesystem>
+
+#include <glm/glm.hpp>
+
+#include <map/tile_renderer.h>
+
+namespace vx3d
+{
+    struct replay_options
+    {
+        glm::ivec2     size { 1920, 1080 };    // Rounded down to even numbers, like the window
+        map::tile_mode mode = map::tile_mode::color;
+        bool           cold = false;    // Drops the world's cache first, summaries and tiles included
+    };
+
+    /// Plays a camera path through the renderer without a window and prints frame time percentiles,
+    /// chunks decoded a second and how often the summary store and the tile cache had what was
+    /// asked for. Frames are paced at 60 a second like the viewer's while it moves, so the tile
+    /// workers get as much time between frames and runs of one path compare across commits.
+    /// \param camera A file saved by `camera_path::save`, empty to survey the whole world
+    /// \return An exit code, not 0 if there's no context, path or world to play
+    int run_replay_benchmark(
+      const std::filesystem::path &world_folder,
+      const std::filesystem::path &camera,
+      const replay_options &       options);
+}    // namespace vx3d
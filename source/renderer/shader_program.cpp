@@ -0,0 +1,228 @@
+#include "shader_program.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <tracy/Tracy.hpp>
+
+#include <util/cache_path.h>
+#include <util/opengl.h>
+
+namespace
+{
+    // How often a watched source is checked for changes
+    constexpr auto watch_interval = std::chrono::milliseconds(250);
+
+    // At the start of a cached binary, followed by its format
+    constexpr auto binary_magic = std::uint32_t(0x62337876);    // "vx3b"
+
+    // Binaries only load on the driver that made them, an update changes its version
+    [[nodiscard]] std::string driver_string()
+    {
+        auto driver = std::string();
+        for (const auto name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+        {
+            const auto *value = reinterpret_cast<const char *>(glGetString(name));
+            driver += value ? value : "";
+            driver += '\n';
+        }
+        return driver;
+    }
+
+    /// Where the binary of a source is cached for the current driver
+    /// \return An empty path if there's nowhere to cache to
+    [[nodiscard]] std::filesystem::path binary_path(const std::string &source)
+    {
+        const auto root = vx3d::cache::directory();
+        if (root.empty()) return {};
+
+        auto error = std::error_code();
+        std::filesystem::create_directories(root / "shaders", error);
+        if (error) return {};
+
+        auto key = std::array<char, 21>();
+        std::snprintf(
+          key.data(),
+          key.size(),
+          "%016llx.bin",
+          static_cast<unsigned long long>(vx3d::cache::hash(source + '\0' + ::driver_string())));
+        return root / "shaders" / key.data();
+    }
+
+    /// \return 0 if there's no binary or the driver won't take it
+    [[nodiscard]] GLuint load_binary(const std::filesystem::path &path)
+    {
+        auto file   = std::ifstream(path, std::ios::binary);
+        auto header = std::array<std::uint32_t, 2>();
+        if (!file.read(reinterpret_cast<char *>(header.data()), sizeof(header))) return 0;
+        if (header[0] != ::binary_magic) return 0;
+        const auto binary = std::vector<char>(std::istreambuf_iterator<char>(file), {});
+
+        const auto program = glCreateProgram();
+        glProgramBinary(program, header[1], binary.data(), static_cast<GLsizei>(binary.size()));
+
+        auto success = GLint(0);
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (success) return program;
+
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    void save_binary(GLuint program, const std::filesystem::path &path)
+    {
+        auto length = GLint(0);
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+
+        auto binary = std::vector<char>(static_cast<std::size_t>(length));
+        auto format = GLenum(0);
+        glGetProgramBinary(program, length, &length, &format, binary.data());
+        if (length <= 0) return;
+
+        // Written next to it first, so another instance never loads half a binary
+        auto temporary = path;
+        temporary += ".tmp";
+        {
+            auto       file   = std::ofstream(temporary, std::ios::binary | std::ios::trunc);
+            const auto header = std::array<std::uint32_t, 2>({ ::binary_magic, format });
+            file.write(reinterpret_cast<const char *>(header.data()), sizeof(header));
+            file.write(binary.data(), length);
+            if (!file) return;
+        }
+        auto error = std::error_code();
+        std::filesystem::rename(temporary, path, error);
+    }
+
+    /// \return 0 if it didn't compile or link
+    [[nodiscard]] GLuint link(const std::string &source, GLenum type)
+    {
+        const auto shader = vx3d::opengl::compile_shader(source, type);
+        if (!shader) return 0;
+
+        const auto program = glCreateProgram();
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
+
+        auto success = GLint(0);
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (success) return program;
+
+        auto log = std::array<char, 512>();
+        glGetProgramInfoLog(program, static_cast<GLsizei>(log.size()), nullptr, log.data());
+        std::cerr << log.data() << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    /// From the cached binary if it's there, otherwise compiled and cached
+    /// \return 0 if it didn't compile or link
+    [[nodiscard]] GLuint load_program(const std::filesystem::path &path, GLenum type)
+    {
+        ZoneScopedN("ShaderProgram::load");
+        const auto source = vx3d::opengl::read_shader(path.string());
+        if (source.empty())
+        {
+            std::cerr << "Couldn't read " << path << std::endl;
+            return 0;
+        }
+
+        auto formats = GLint(0);
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        const auto binary = formats > 0 ? ::binary_path(source) : std::filesystem::path();
+        if (!binary.empty())
+            if (const auto program = ::load_binary(binary)) return program;
+
+        const auto program = ::link(source, type);
+        if (program && !binary.empty()) ::save_binary(program, binary);
+        return program;
+    }
+}    // namespace
+
+vx3d::shader_program::shader_program(std::filesystem::path path, GLenum type)
+    : _path(std::move(path)), _type(type)
+{
+    _handle = ::load_program(_path, _type);
+}
+
+vx3d::shader_program::~shader_program()
+{
+    if (_watcher.joinable())
+    {
+        {
+            auto lock = std::lock_guard(_lock);
+            _stop     = true;
+        }
+        _stop_conditional.notify_all();
+        _watcher.join();
+    }
+
+    // The contexts share objects, so what the watcher linked can go from here
+    if (_relinked) glDeleteProgram(_relinked);
+    if (_handle) glDeleteProgram(_handle);
+}
+
+void vx3d::shader_program::watch(std::function<void(bool)> bind_context)
+{
+    if (_watcher.joinable()) return;
+
+    _bind_context = std::move(bind_context);
+    _watcher      = std::thread(&shader_program::_watch, this);
+}
+
+bool vx3d::shader_program::poll()
+{
+    auto lock = std::lock_guard(_lock);
+    if (!_relinked) return false;
+
+    if (_handle) glDeleteProgram(_handle);
+    _handle = std::exchange(_relinked, 0);
+    return true;
+}
+
+void vx3d::shader_program::_watch()
+{
+    _bind_context(true);
+
+    auto error      = std::error_code();
+    auto last_write = std::filesystem::last_write_time(_path, error);
+
+    auto lock = std::unique_lock(_lock);
+    while (!_stop_conditional.wait_for(lock, ::watch_interval, [this] { return _stop; }))
+    {
+        const auto write = std::filesystem::last_write_time(_path, error);
+        if (error || write == last_write) continue;
+        last_write = write;
+
+        lock.unlock();
+        const auto program = ::load_program(_path, _type);
+
+        // Another context may only use the program once it's done linking
+        glFinish();
+        lock.lock();
+
+        if (!program)
+        {
+            std::cerr << "Keeping the last program that linked for " << _path << std::endl;
+            continue;
+        }
+        std::cout << "Reloaded " << _path << std::endl;
+
+        // Never taken, the render thread hasn't drawn since
+        if (_relinked) glDeleteProgram(_relinked);
+        _relinked = program;
+    }
+
+    _bind_context(false);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <glad/glad.h>
+
+namespace vx3d
+{
+    // A program of a single shader. It's linked from a binary cached for its source and the driver
+    // when there is one, so startup only compiles shaders that changed or a driver that did. Cached
+    // binaries the driver turns down are compiled from source and cached again.
+    //
+    // Once watched, the source is checked for changes on a thread of its own, which compiles and
+    // links in a context sharing objects with the render thread, so editing a shader never stalls a
+    // frame. A shader that doesn't compile leaves the last program that did.
+    class shader_program
+    {
+    public:
+        /// Compiles and links on the calling thread, whose context the program belongs to
+        /// \param path The shader source
+        /// \param type The OpenGL shader type. VERTEX_SHADER, FRAGMENT_SHADER, COMPUTE_SHADER
+        shader_program(std::filesystem::path path, GLenum type);
+
+        ~shader_program();
+
+        shader_program(const shader_program &) = delete;
+
+        shader_program &operator=(const shader_program &) = delete;
+
+        /// 0 if the shader never compiled
+        [[nodiscard]] GLuint handle() const noexcept { return _handle; }
+
+        /// Starts linking the program again whenever its source changes
+        /// \param bind_context Makes a context sharing objects with this one current on the calling
+        /// thread, releases it when passed false
+        void watch(std::function<void(bool)> bind_context);
+
+        /// Takes a program the watcher linked since the last call, deleting the one it replaces
+        /// \return Whether the program changed, its uniforms have to be looked up again
+        [[nodiscard]] bool poll();
+
+    private:
+        void _watch();
+
+        std::filesystem::path _path;
+        GLenum                _type;
+        GLuint                _handle = 0;
+
+        std::function<void(bool)> _bind_context;
+        std::mutex                _lock;
+        std::condition_variable   _stop_conditional;
+        bool                      _stop     = false;
+        GLuint                    _relinked = 0;    // Linked by the watcher, not taken yet
+        std::thread               _watcher;
+    };
+}    // namespace vx3d
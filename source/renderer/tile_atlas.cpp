@@ -0,0 +1,285 @@
+#include "tile_atlas.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <iostream>
+#include <memory>
+#include <numeric>
+
+#include <tracy/Tracy.hpp>
+
+// Part of EXT_texture_compression_s3tc, which the loader was generated without
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+
+namespace
+{
+    // Evicting one tile at a time would scan every slot per upload once the atlas is full
+    constexpr auto evict_fraction = 8;
+
+    // A tile compresses in a few microseconds, a couple of workers keep up with any upload
+    constexpr auto compressor_threads = 2u;
+    constexpr auto tiles_per_task     = std::size_t(64);
+
+    // Compressed tiles decoded again for the PSNR, one in this many comes within a fraction of a dB
+    constexpr auto psnr_interval = 16u;
+
+    [[nodiscard]] bool bc1_supported()
+    {
+        auto supported = GLint(GL_FALSE);
+        glGetInternalformativ(
+          GL_TEXTURE_2D,
+          GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
+          GL_INTERNALFORMAT_SUPPORTED,
+          1,
+          &supported);
+        return supported == GL_TRUE;
+    }
+}    // namespace
+
+vx3d::tile_atlas::tile_atlas() : _slots(slots), _compressors(::compressor_threads)
+{
+    _create_texture();
+    clear();
+}
+
+vx3d::tile_atlas::~tile_atlas()
+{
+    glDeleteTextures(1, &_texture);
+}
+
+bool vx3d::tile_atlas::upload(const std::vector<map::tile> &tiles, upload_ring &ring)
+{
+    ZoneScopedN("TileAtlas::upload");
+    if (tiles.empty()) return false;
+
+    glBindTexture(GL_TEXTURE_2D, _texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    auto evicted_on_screen = false;
+    auto uncompressed      = std::vector<map::tile>();
+    for (const auto &tile : tiles)
+    {
+        const auto tile_key = map::tile_key(tile.level, tile.x, tile.z);
+
+        // Whatever copy is in the texture stays until the compressed one comes back
+        if (_compressed && tile.blocks.size() != bc1::tile_bytes)
+        {
+            uncompressed.push_back(tile);
+            continue;
+        }
+        _in_flight.erase(tile_key);
+
+        auto slot = std::int32_t(-1);
+        if (const auto at = _lookup.find(tile_key); at != _lookup.end())
+            slot = at->second;
+        else
+        {
+            slot              = _allocate(evicted_on_screen);
+            _slots[slot].key  = tile_key;
+            _slots[slot].used = true;
+            _lookup[tile_key] = slot;
+        }
+        _slots[slot].last_used = _frame;
+        _slots[slot].stale     = false;
+
+        const auto x = (slot % (size / 16)) * 16;
+        const auto y = (slot / (size / 16)) * 16;
+        if (_compressed)
+            ring.compressed_tex_sub_image(
+              x,
+              y,
+              16,
+              16,
+              GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
+              tile.blocks.data(),
+              bc1::tile_bytes);
+        else
+            ring.tex_sub_image(
+              x,
+              y,
+              16,
+              16,
+              GL_RGBA,
+              GL_UNSIGNED_BYTE,
+              tile.pixels.data(),
+              tile.pixels.size() * sizeof(tile.pixels[0]));
+
+        if (_compressed && _placed++ % ::psnr_interval == 0)
+        {
+            auto decoded = std::array<map::rgba, map::tile_pixels>();
+            bc1::decompress_tile(tile.blocks.data(), decoded.data());
+            _error.add(tile.pixels.data(), decoded.data());
+            TracyPlot("Atlas PSNR (dB)", _error.psnr());
+        }
+    }
+
+    if (!uncompressed.empty()) _compress(std::move(uncompressed));
+    return evicted_on_screen;
+}
+
+std::vector<vx3d::map::tile> vx3d::tile_atlas::take_compressed()
+{
+    auto finished = std::vector<compressing>();
+    {
+        auto guard = std::lock_guard(_finished_mutex);
+        finished.swap(_finished);
+    }
+
+    auto tiles = std::vector<map::tile>();
+    for (auto &done : finished)
+    {
+        const auto at = _in_flight.find(map::tile_key(done.tile.level, done.tile.x, done.tile.z));
+        if (at == _in_flight.end() || at->second != done.sequence) continue;
+
+        _in_flight.erase(at);
+        tiles.push_back(std::move(done.tile));
+    }
+    return tiles;
+}
+
+void vx3d::tile_atlas::set_compressed(bool compressed)
+{
+    if (compressed == _compressed) return;
+    if (compressed && !::bc1_supported())
+    {
+        std::cerr << "This driver can't sample BC1 textures, the tile atlas stays uncompressed" << std::endl;
+        return;
+    }
+
+    _compressed = compressed;
+    _error      = bc1::error();
+    _placed     = 0;
+    glDeleteTextures(1, &_texture);
+    _create_texture();
+    clear();
+}
+
+std::optional<double> vx3d::tile_atlas::psnr() const
+{
+    if (!_compressed || !_error.samples) return std::nullopt;
+    return _error.psnr();
+}
+
+std::int32_t vx3d::tile_atlas::use(std::uint8_t level, std::int32_t x, std::int32_t z)
+{
+    const auto at = _lookup.find(map::tile_key(level, x, z));
+    if (at == _lookup.end()) return -1;
+
+    _slots[at->second].last_used = _frame;
+    return at->second;
+}
+
+void vx3d::tile_atlas::mark_stale()
+{
+    for (auto &slot : _slots) slot.stale = slot.used;
+}
+
+bool vx3d::tile_atlas::stale(std::uint64_t key) const
+{
+    const auto at = _lookup.find(key);
+    return at != _lookup.end() && _slots[at->second].stale;
+}
+
+bool vx3d::tile_atlas::on_screen(std::uint64_t key) const noexcept
+{
+    // The coordinates of `tile_key` are 30 bits, shifted to the top of 32 and back for their sign
+    const auto x = static_cast<std::int32_t>(static_cast<std::uint32_t>(key >> 30) << 2) >> 2;
+    const auto z = static_cast<std::int32_t>(static_cast<std::uint32_t>(key) << 2) >> 2;
+    return (key >> 60) == _view_level && x >= _view_min.x && x <= _view_max.x && z >= _view_min.y &&
+      z <= _view_max.y;
+}
+
+void vx3d::tile_atlas::clear()
+{
+    _lookup.clear();
+    _in_flight.clear();
+    _free.resize(slots);
+
+    // Handed out from the back, so slot 0 goes first
+    std::iota(_free.rbegin(), _free.rend(), 0);
+    for (auto &slot : _slots) slot = slot_info();
+}
+
+void vx3d::tile_atlas::_create_texture()
+{
+    glGenTextures(1, &_texture);
+    glBindTexture(GL_TEXTURE_2D, _texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexStorage2D(GL_TEXTURE_2D, 1, _compressed ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_RGBA8, size, size);
+}
+
+void vx3d::tile_atlas::_compress(std::vector<map::tile> tiles)
+{
+    ZoneScopedN("TileAtlas::compress");
+    for (auto first = std::size_t(0); first < tiles.size(); first += ::tiles_per_task)
+    {
+        auto batch = std::make_shared<std::vector<compressing>>();
+        for (auto i = first; i < std::min(tiles.size(), first + ::tiles_per_task); i++)
+        {
+            const auto key  = map::tile_key(tiles[i].level, tiles[i].x, tiles[i].z);
+            _in_flight[key] = ++_sequence;
+            batch->push_back({ _sequence, std::move(tiles[i]) });
+        }
+
+        _compressors.submit_task(
+          [this, batch]
+          {
+              ZoneScopedN("TileAtlas::compress_batch");
+              for (auto &pending : *batch)
+              {
+                  pending.tile.blocks.resize(bc1::tile_bytes);
+                  bc1::compress_tile(pending.tile.pixels.data(), pending.tile.blocks.data());
+              }
+
+              auto guard = std::lock_guard(_finished_mutex);
+              std::move(batch->begin(), batch->end(), std::back_inserter(_finished));
+          });
+    }
+}
+
+std::int32_t vx3d::tile_atlas::_allocate(bool &evicted_on_screen)
+{
+    if (_free.empty())
+    {
+        ZoneScopedN("TileAtlas::evict");
+
+        // Tiles on screen count as used this frame, which is never evicted. If everything was,
+        // the oldest slot is reused.
+        auto last_used = std::vector<std::uint64_t>(slots);
+        for (auto slot = 0; slot < slots; slot++)
+            last_used[slot] = on_screen(_slots[slot].key) ? _frame : _slots[slot].last_used;
+
+        auto order = std::vector<std::int32_t>(slots);
+        std::iota(order.begin(), order.end(), 0);
+        std::nth_element(
+          order.begin(),
+          order.begin() + slots / evict_fraction,
+          order.end(),
+          [&last_used](auto a, auto b) { return last_used[a] < last_used[b]; });
+
+        for (auto i = 0; i < slots / evict_fraction; i++)
+        {
+            if (last_used[order[i]] == _frame) continue;
+
+            _lookup.erase(_slots[order[i]].key);
+            _slots[order[i]] = slot_info();
+            _free.push_back(order[i]);
+        }
+
+        if (_free.empty())
+        {
+            evicted_on_screen = evicted_on_screen || on_screen(_slots[order[0]].key);
+            _lookup.erase(_slots[order[0]].key);
+            _slots[order[0]] = slot_info();
+            _free.push_back(order[0]);
+        }
+    }
+
+    const auto slot = _free.back();
+    _free.pop_back();
+    return slot;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <tsl/robin_map.h>
+
+#include <thread_pool.h>
+#include <util/bc1.h>
+#include <util/opengl.h>
+#include <map/tile_pyramid.h>
+#include <renderer/upload_ring.h>
+
+namespace vx3d
+{
+    // One big texture holding the 16x16 tiles on screen, of any pyramid level. When it fills up
+    // the tiles that went longest without being drawn make room. It can be kept as BC1, an eighth
+    // of the memory and of what goes over the bus. Tiles of the tile renderer come compressed, the
+    // rest are compressed on the atlas' workers and go in a frame or so later. Some of them are
+    // decoded again for a PSNR.
+    class tile_atlas
+    {
+    public:
+        static constexpr std::int32_t size  = 4096;
+        static constexpr std::int32_t slots = (size / 16) * (size / 16);
+
+        tile_atlas();
+
+        ~tile_atlas();
+
+        tile_atlas(const tile_atlas &) = delete;
+
+        tile_atlas &operator=(const tile_atlas &) = delete;
+
+        /// Copies finished tiles into the texture, replacing older copies of the same tiles. As BC1,
+        /// tiles without `blocks` are compressed in the background instead, see `take_compressed`.
+        /// \return Whether a tile on screen had to make room, only when the screen holds more
+        /// tiles than the atlas
+        [[nodiscard]] bool upload(const std::vector<map::tile> &tiles, upload_ring &ring);
+
+        /// Tiles compressed since the last call, to be uploaded again. Those that were uploaded
+        /// again or cleared in the meantime are left out.
+        [[nodiscard]] std::vector<map::tile> take_compressed();
+
+        /// Whether no tile is being compressed
+        [[nodiscard]] bool idle() const noexcept { return _in_flight.empty(); }
+
+        /// Switches between RGBA8 and BC1, which empties the atlas. Stays RGBA8 if the driver
+        /// can't do BC1.
+        void set_compressed(bool compressed);
+
+        [[nodiscard]] bool compressed() const noexcept { return _compressed; }
+
+        /// Of every tile compressed since the atlas was last switched to BC1
+        /// \return In dB, nothing if it isn't compressed or nothing went in yet
+        [[nodiscard]] std::optional<double> psnr() const;
+
+        /// Slot of a tile, marking it as drawn this frame
+        /// \return -1 if the tile isn't in the atlas
+        [[nodiscard]] std::int32_t use(std::uint8_t level, std::int32_t x, std::int32_t z);
+
+        [[nodiscard]] bool contains(std::uint64_t key) const { return _lookup.count(key) != 0; }
+
+        /// Keeps every tile on screen until it's uploaded again, see `stale`
+        void mark_stale();
+
+        /// \return Whether a tile is in the atlas and was marked stale since it was uploaded
+        [[nodiscard]] bool stale(std::uint64_t key) const;
+
+        /// Call once per frame, drives which tiles are evicted first
+        void next_frame() noexcept { _frame++; }
+
+        /// Tiles between two corners of a level are never evicted, they only have to be used as
+        /// they come on screen and go off it
+        void set_view(std::uint8_t level, const glm::ivec2 &min, const glm::ivec2 &max) noexcept
+        {
+            _view_level = level;
+            _view_min   = min;
+            _view_max   = max;
+        }
+
+        /// \return Whether a tile is between the corners of the last `set_view`
+        [[nodiscard]] bool on_screen(std::uint64_t key) const noexcept;
+
+        void clear();
+
+        [[nodiscard]] GLuint texture() const noexcept { return _texture; }
+
+    private:
+        struct compressing
+        {
+            std::uint64_t sequence = 0;
+            map::tile     tile;
+        };
+
+        struct slot_info
+        {
+            std::uint64_t key       = 0;
+            std::uint64_t last_used = 0;
+            bool          used      = false;
+            bool          stale     = false;
+        };
+
+        /// \param evicted_on_screen Set if the slot was one of a tile on screen
+        [[nodiscard]] std::int32_t _allocate(bool &evicted_on_screen);
+
+        void _create_texture();
+
+        /// Hands tiles to the workers, `take_compressed` picks them up
+        void _compress(std::vector<map::tile> tiles);
+
+        GLuint        _texture    = 0;
+        bool          _compressed = false;
+        bc1::error    _error;         // Since it was last switched to BC1
+        std::uint64_t _placed = 0;    // Compressed tiles, every so many is sampled for `_error`
+
+        std::uint64_t _frame = 0;
+
+        std::uint8_t _view_level = 0;
+        glm::ivec2   _view_min {};
+        glm::ivec2   _view_max { -1 };
+
+        std::vector<slot_info>                                          _slots;
+        std::vector<std::int32_t>                                       _free;
+        tsl::robin_map<std::uint64_t, std::int32_t, map::tile_key_hash> _lookup;
+
+        // The latest copy of every tile being compressed, older ones are dropped when they're done
+        std::uint64_t                                                    _sequence = 0;
+        tsl::robin_map<std::uint64_t, std::uint64_t, map::tile_key_hash> _in_flight;
+
+        std::mutex               _finished_mutex;
+        std::vector<compressing> _finished;
+
+        // Last, so the workers are joined before anything they use goes away
+        vx3d::thread_pool _compressors;
+    };
+}    // namespace vx3d
@@ -0,0 +1,151 @@
+#include "upload_ring.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include <tracy/Tracy.hpp>
+
+namespace
+{
+    // Texture rows are unpacked 4 byte aligned, 16 keeps any format happy
+    constexpr auto write_alignment = std::size_t(16);
+
+    constexpr auto storage_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}    // namespace
+
+vx3d::upload_ring::upload_ring(std::size_t region_bytes) : _region_bytes(region_bytes)
+{
+    glGenBuffers(1, &_buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+    glBufferStorage(
+      GL_PIXEL_UNPACK_BUFFER,
+      static_cast<GLsizeiptr>(_region_bytes * regions),
+      nullptr,
+      ::storage_flags);
+    _mapped = static_cast<std::uint8_t *>(glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER,
+      0,
+      static_cast<GLsizeiptr>(_region_bytes * regions),
+      ::storage_flags));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!_mapped) std::cerr << "Couldn't map the upload buffer, uploading without it" << std::endl;
+
+    TracyPlotConfig("Upload bytes", tracy::PlotFormatType::Memory);
+}
+
+vx3d::upload_ring::~upload_ring()
+{
+    for (auto fence : _fences)
+        if (fence) glDeleteSync(fence);
+
+    if (_mapped)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &_buffer);
+}
+
+void vx3d::upload_ring::begin_frame()
+{
+    ZoneScopedN("UploadRing::begin_frame");
+    _region  = (_region + 1) % regions;
+    _written = 0;
+
+    auto &fence = _fences[_region];
+    if (!fence) return;
+
+    // Only waits when the GPU is more than two frames behind
+    const auto start  = std::chrono::steady_clock::now();
+    auto       status = GLenum(GL_TIMEOUT_EXPIRED);
+    while (status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    glDeleteSync(fence);
+    fence = nullptr;
+
+    const auto stall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    TracyPlot("Upload stall (ms)", stall.count());
+}
+
+void vx3d::upload_ring::end_frame()
+{
+    _fences[_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    TracyPlot("Upload bytes", static_cast<std::int64_t>(_written));
+}
+
+std::optional<std::size_t> vx3d::upload_ring::write(const void *data, std::size_t bytes)
+{
+    const auto start = (_written + ::write_alignment - 1) / ::write_alignment * ::write_alignment;
+    if (!_mapped || start + bytes > _region_bytes) return std::nullopt;
+
+    const auto offset = _region * _region_bytes + start;
+    std::memcpy(_mapped + offset, data, bytes);
+    _written = start + bytes;
+    return offset;
+}
+
+void vx3d::upload_ring::tex_sub_image(
+  std::int32_t x,
+  std::int32_t y,
+  std::int32_t width,
+  std::int32_t height,
+  GLenum       format,
+  GLenum       type,
+  const void * pixels,
+  std::size_t  bytes)
+{
+    const auto offset = write(pixels, bytes);
+    if (!offset)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, type, pixels);
+        return;
+    }
+
+    // Unbound again right after, every other upload hands glTexSubImage2D client memory
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+    glTexSubImage2D(
+      GL_TEXTURE_2D,
+      0,
+      x,
+      y,
+      width,
+      height,
+      format,
+      type,
+      reinterpret_cast<const void *>(*offset));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void vx3d::upload_ring::compressed_tex_sub_image(
+  std::int32_t x,
+  std::int32_t y,
+  std::int32_t width,
+  std::int32_t height,
+  GLenum       format,
+  const void * data,
+  std::size_t  bytes)
+{
+    const auto offset = write(data, bytes);
+    if (!offset)
+    {
+        const auto size = static_cast<GLsizei>(bytes);
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, size, data);
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer);
+    glCompressedTexSubImage2D(
+      GL_TEXTURE_2D,
+      0,
+      x,
+      y,
+      width,
+      height,
+      format,
+      static_cast<GLsizei>(bytes),
+      reinterpret_cast<const void *>(*offset));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
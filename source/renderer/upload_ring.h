@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include <util/opengl.h>
+
+namespace vx3d
+{
+    // A buffer mapped once for the life of the renderer that texture uploads are staged through,
+    // instead of handing the driver client memory to copy or reallocating storage every frame.
+    // It's split into three regions used a frame each in turn. A fence after each frame's
+    // commands guards its region, so the CPU fills the next one while the GPU still reads from
+    // the last.
+    class upload_ring
+    {
+    public:
+        static constexpr std::size_t regions = 3;
+
+        explicit upload_ring(std::size_t region_bytes = std::size_t(4) << 20);
+
+        ~upload_ring();
+
+        upload_ring(const upload_ring &) = delete;
+
+        upload_ring &operator=(const upload_ring &) = delete;
+
+        /// Moves on to the next region, waiting for the GPU to be done with it if it isn't yet
+        void begin_frame();
+
+        /// Fences the commands that read from this frame's region and plots what went up
+        void end_frame();
+
+        /// Copies data into this frame's region
+        /// \return Its offset in `buffer`, nothing once the region is full and the data has to go
+        /// up some other way
+        [[nodiscard]] std::optional<std::size_t> write(const void *data, std::size_t bytes);
+
+        /// Stages data and uploads it to part of the bound texture from the ring, or straight from
+        /// `pixels` if it doesn't fit
+        void tex_sub_image(
+          std::int32_t x,
+          std::int32_t y,
+          std::int32_t width,
+          std::int32_t height,
+          GLenum       format,
+          GLenum       type,
+          const void * pixels,
+          std::size_t  bytes);
+
+        /// `tex_sub_image` for block compressed data, `width` and `height` are multiples of the block
+        void compressed_tex_sub_image(
+          std::int32_t x,
+          std::int32_t y,
+          std::int32_t width,
+          std::int32_t height,
+          GLenum       format,
+          const void * data,
+          std::size_t  bytes);
+
+        [[nodiscard]] GLuint buffer() const noexcept { return _buffer; }
+
+    private:
+        GLuint        _buffer = 0;
+        std::uint8_t *_mapped = nullptr;
+        std::size_t   _region_bytes;
+
+        std::array<GLsync, regions> _fences {};
+        std::size_t                 _region  = 0;
+        std::size_t                 _written = 0;    // In this frame's region
+    };
+}    // namespace vx3d
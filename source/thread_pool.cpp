@@ -1,5 +1,12 @@
 #include "thread_pool.h"
 
+std::uint32_t vx3d::default_worker_count(std::uint32_t requested) noexcept
+{
+    if (requested) return requested;
+    const auto hardware = std::thread::hardware_concurrency();
+    return hardware > 1 ? hardware - 1 : 1;
+}
+
 vx3d::thread_pool::thread_pool(std::uint32_t thread_count)
 {
     ZoneScopedN("ThreadPool::creation") _threads.reserve(thread_count);
@@ -42,6 +49,29 @@ void vx3d::thread_pool::submit_tasks(const std::vector<std::function<void()>> &t
     _work_conditional.notify_all();
 }
 
+void vx3d::thread_pool::run_tasks(const std::vector<std::function<void()>> &tasks)
+{
+    ZoneScopedN("ThreadPool::run_tasks");
+    auto mutex     = std::mutex();
+    auto finished  = std::condition_variable();
+    auto remaining = tasks.size();
+
+    auto wrapped = std::vector<std::function<void()>>();
+    wrapped.reserve(tasks.size());
+    for (const auto &task : tasks)
+        wrapped.emplace_back(
+          [&, task]
+          {
+              task();
+              auto guard = std::lock_guard(mutex);
+              if (--remaining == 0) finished.notify_all();
+          });
+    submit_tasks(wrapped);
+
+    auto guard = std::unique_lock(mutex);
+    finished.wait(guard, [&] { return remaining == 0; });
+}
+
 std::optional<std::function<void()>> vx3d::thread_pool::_next_task()
 {
     ZoneScopedN("ThreadPool::_next_task");
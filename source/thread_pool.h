@@ -14,6 +14,10 @@
 
 namespace vx3d
 {
+    /// Workers for a pool, `requested` unless it's 0, then one less than there are hardware
+    /// threads so the caller keeps one
+    [[nodiscard]] std::uint32_t default_worker_count(std::uint32_t requested = 0) noexcept;
+
     class thread_pool
     {
     public:
@@ -25,6 +29,10 @@ namespace vx3d
 
         void submit_tasks(const std::vector<std::function<void()>> &tasks);
 
+        /// Submits tasks and waits until every one of them is done, tasks submitted from
+        /// elsewhere are left running
+        void run_tasks(const std::vector<std::function<void()>> &tasks);
+
         void flush();
 
     private:
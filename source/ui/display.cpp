@@ -2,6 +2,21 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
+
+namespace
+{
+    // Between frames while tiles are coming in or the view is being moved
+    constexpr auto active_timeout = 1.0 / 60.0;
+
+    // Between frames when nothing changes, in case something does without an event
+    constexpr auto idle_timeout = 0.5;
+
+    constexpr auto settle_frames = 3u;
+
+    // Between looks at the world's region files, for chunks the game saved since
+    constexpr auto refresh_interval = 1.0;
+}    // namespace
+
 vx3d::ui::display::display(std::uint16_t width, std::uint16_t height)
     : _width(width), _height(height)
 {
@@ -52,21 +67,79 @@ void vx3d::ui::display::render(vx3d::world_loader &world_loader, vx3d::renderer
 
     ImGui::Begin("Hidden", nullptr, flags);
 
-    const auto tab_input = ui::menu_tab_component(_file_browser);
+    const auto tab_input = ui::menu_tab_component(
+      _file_browser,
+      renderer.tile_mode(),
+      renderer.overlay_threshold(),
+      renderer.relief_light(),
+      renderer.slice(),
+      renderer.compressed_tiles(),
+      renderer.tile_psnr());
 
     if (!tab_input.directory.empty()) world_loader.set_world(tab_input.directory);
+    if (tab_input.mode) renderer.set_tile_mode(*tab_input.mode);
+    if (tab_input.threshold) renderer.set_overlay_threshold(*tab_input.threshold);
+    if (tab_input.light) renderer.set_relief_light(*tab_input.light);
+    if (tab_input.slice) renderer.set_slice(*tab_input.slice);
+    if (tab_input.compressed) renderer.set_compressed_tiles(*tab_input.compressed);
+
+    if (const auto now = glfwGetTime(); now >= _next_refresh)
+    {
+        _next_refresh = now + ::refresh_interval;
+        for (const auto &chunk : world_loader.refresh_regions()) renderer.invalidate_chunk(chunk.x, chunk.y);
+    }
 
     auto window_size = ImGui::GetContentRegionAvail();
 
-    const auto texture = renderer.render(glm::ivec2(window_size.x, window_size.y), world_loader);
+    if (ImGui::IsWindowHovered())
+    {
+        const auto &io = ImGui::GetIO();
+        // Multiplicative, so zooming out to the whole world doesn't take forever
+        _view.zoom *= std::pow(1.1f, -io.MouseWheel);
+        _view.zoom = glm::clamp(_view.zoom, 1.0f / 16.0f, static_cast<float>(1 << map::max_tile_level));
+
+        if (ImGui::IsMouseDown(0))
+            _view.translation -= glm::vec2(io.MouseDelta.x, io.MouseDelta.y) * _view.zoom;
+    }
+
+    _view_size         = glm::ivec2(window_size.x, window_size.y);
+    const auto texture = renderer.render(_view_size, _view, world_loader);
 
     ImGui::Image(reinterpret_cast<void *>(texture), ImVec2(1920, 1040));
 
+    const auto &io = ImGui::GetIO();
+    if (
+      io.MouseDelta.x != 0.0f || io.MouseDelta.y != 0.0f || io.MouseWheel != 0.0f ||
+      ImGui::IsAnyMouseDown() || ImGui::IsAnyItemActive() || !io.InputQueueCharacters.empty())
+        _active_frames = ::settle_frames;
+
     ImGui::End();
 
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
     glfwSwapBuffers(_window);
-    glfwPollEvents();
+}
+
+std::function<void(bool)> vx3d::ui::display::shared_context()
+{
+    if (!_shared_window)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        _shared_window = glfwCreateWindow(1, 1, "vx3d shaders", nullptr, _window);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    }
+    return [window = _shared_window](bool current) { glfwMakeContextCurrent(current ? window : nullptr); };
+}
+
+void vx3d::ui::display::wait(bool busy)
+{
+    ZoneScopedN("Display::wait");
+    if (busy || _active_frames)
+    {
+        if (_active_frames) _active_frames--;
+        glfwWaitEventsTimeout(::active_timeout);
+    }
+    else
+        glfwWaitEventsTimeout(::idle_timeout);
 }
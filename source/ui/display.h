@@ -7,6 +7,7 @@
 #include <glm/glm.hpp>
 
 #include <cstdint>
+#include <functional>
 
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
@@ -22,6 +23,21 @@ namespace vx3d::ui
 
         void render(vx3d::world_loader &world_loader, vx3d::renderer &renderer);
 
+        /// Waits for the next frame, until something happens when nothing on screen is changing
+        /// \param busy Whether the renderer still has tiles coming in
+        void wait(bool busy);
+
+        /// A hidden context sharing objects with the window's, made on first use, for linking
+        /// shaders off the render thread
+        /// \return Makes it current on the calling thread, or releases it when passed false
+        [[nodiscard]] std::function<void(bool)> shared_context();
+
+        /// What the map showed last frame
+        [[nodiscard]] const vx3d::map_view &view() const noexcept { return _view; }
+
+        /// Of the map last frame, in pixels
+        [[nodiscard]] const glm::ivec2 &view_size() const noexcept { return _view_size; }
+
     private:
         ImGui::FileBrowser _file_browser;
 
@@ -29,5 +45,15 @@ namespace vx3d::ui
         std::uint16_t _height;
 
         GLFWwindow *_window;
+        GLFWwindow *_shared_window = nullptr;
+
+        vx3d::map_view _view;
+        glm::ivec2     _view_size {};
+
+        // Frames to keep drawing after the last input, ImGui needs a few to settle hover and focus
+        std::uint32_t _active_frames = 0;
+
+        // When to look for region files the game wrote to, in `glfwGetTime` seconds
+        double _next_refresh = 0.0;
     };
 }    // namespace vx3d::ui
\ No newline at end of file
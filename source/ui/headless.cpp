@@ -0,0 +1,106 @@
+#include "headless.h"
+
+#include <array>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#if defined(VX3D_HEADLESS_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+namespace
+{
+    [[nodiscard]] EGLDisplay open_display()
+    {
+        // Needs neither a GPU nor a display server, unlike the default display
+        const auto get_platform_display =
+          reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (get_platform_display)
+        {
+            const auto display =
+              get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY) return display;
+        }
+        return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    [[nodiscard]] void *load(const char *name)
+    {
+        return reinterpret_cast<void *>(eglGetProcAddress(name));
+    }
+}    // namespace
+
+vx3d::ui::headless::headless()
+{
+    const auto display = ::open_display();
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+    {
+        std::cerr << "No EGL display to render without a window on" << std::endl;
+        return;
+    }
+    _display = display;
+
+    // Surfaceless displays have no window configs, which is what's asked for by default
+    const auto config_attributes = std::array<EGLint, 5>(
+      { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE });
+    auto       config            = EGLConfig();
+    auto       configs           = EGLint(0);
+    const auto chosen = eglBindAPI(EGL_OPENGL_API) &&
+      eglChooseConfig(display, config_attributes.data(), &config, 1, &configs) && configs != 0;
+    if (!chosen)
+    {
+        std::cerr << "EGL can't make desktop OpenGL contexts here" << std::endl;
+        return;
+    }
+
+    // The renderer uses a few compatibility profile bits, like the windowed context
+    const auto context_attributes = std::array<EGLint, 7>({ EGL_CONTEXT_MAJOR_VERSION,
+                                                            4,
+                                                            EGL_CONTEXT_MINOR_VERSION,
+                                                            5,
+                                                            EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                                            EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+                                                            EGL_NONE });
+    const auto context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes.data());
+    if (context == EGL_NO_CONTEXT)
+    {
+        std::cerr << "Couldn't make an OpenGL 4.5 context, EGL error " << std::hex << eglGetError()
+                  << std::dec << std::endl;
+        return;
+    }
+    _context = context;
+
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        std::cerr << "Couldn't make the OpenGL context current without a surface" << std::endl;
+        return;
+    }
+
+    if (!gladLoadGLLoader(::load))
+    {
+        std::cerr << "Couldn't load OpenGL functions" << std::endl;
+        return;
+    }
+
+    std::cout << "Rendering with " << glGetString(GL_RENDERER) << ", OpenGL " << glGetString(GL_VERSION)
+              << std::endl;
+    _valid = true;
+}
+
+vx3d::ui::headless::~headless()
+{
+    if (!_display) return;
+
+    eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (_context) eglDestroyContext(_display, _context);
+    eglTerminate(_display);
+}
+#else
+vx3d::ui::headless::headless()
+{
+    std::cerr << "This build can't render without a window, it was made without EGL" << std::endl;
+}
+
+vx3d::ui::headless::~headless() = default;
+#endif
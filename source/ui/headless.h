@@ -0,0 +1,28 @@
+#pragma once
+
+namespace vx3d::ui
+{
+    // An OpenGL 4.5 context without a window or a display server, for rendering maps from the
+    // command line. Made on EGL's surfaceless platform where there is one, which is how Mesa's
+    // llvmpipe renders on machines without a GPU. The context stays current on the thread that
+    // made it until it goes away.
+    class headless
+    {
+    public:
+        headless();
+
+        ~headless();
+
+        headless(const headless &) = delete;
+
+        headless &operator=(const headless &) = delete;
+
+        /// Whether there's a current context with every function the renderer needs loaded
+        [[nodiscard]] bool valid() const noexcept { return _valid; }
+
+    private:
+        void *_display = nullptr;    // EGLDisplay
+        void *_context = nullptr;    // EGLContext
+        bool  _valid   = false;
+    };
+}    // namespace vx3d::ui
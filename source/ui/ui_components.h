@@ -1,6 +1,10 @@
 #pragma once
 
+#include <array>
+#include <limits>
+#include <optional>
 #include <string>
+#include <utility>
 
 #include <imgui/imgui.h>
 #include <imgui/imgui_internal.h>
@@ -8,13 +12,27 @@
 #include <imgui/imgui_impl_glfw.h>
 #include <imgui/imfilebrowser.h>
 
+#include <map/tile_renderer.h>
+
 namespace vx3d::ui {
 
     struct menu_tab_input
     {
-        std::filesystem::path directory;
+        std::filesystem::path            directory;
+        std::optional<map::tile_mode>    mode;
+        std::optional<std::uint8_t>      threshold;    // Sectors, for the oversized overlay
+        std::optional<map::relief_light> light;
+        std::optional<map::slice_range>  slice;
+        std::optional<bool>              compressed;    // Tile atlas kept as BC1
     };
-    [[nodiscard]] inline menu_tab_input menu_tab_component(ImGui::FileBrowser &browser)
+    [[nodiscard]] inline menu_tab_input menu_tab_component(
+      ImGui::FileBrowser &     browser,
+      map::tile_mode           current_mode,
+      std::uint8_t             current_threshold,
+      const map::relief_light &current_light,
+      const map::slice_range & current_slice,
+      bool                     current_compressed,
+      std::optional<double>    tile_psnr)
     {
         auto input = menu_tab_input();
 
@@ -49,6 +67,55 @@ namespace vx3d::ui {
                 ImGui::EndMenu();
             }
 
+            if (ImGui::BeginMenu("View")) {
+                static constexpr auto modes = std::array<std::pair<const char *, map::tile_mode>, 10>({{
+                    { "Colour", map::tile_mode::color },
+                    { "Biomes", map::tile_mode::biome },
+                    { "Depth", map::tile_mode::depth },
+                    { "Relief", map::tile_mode::relief },
+                    { "Night", map::tile_mode::night },
+                    { "Light Levels", map::tile_mode::light_levels },
+                    { "Y Slice", map::tile_mode::slice },
+                    { "Chunk Age", map::tile_mode::age },
+                    { "Chunk Size", map::tile_mode::size },
+                    { "Oversized Chunks", map::tile_mode::oversized },
+                }});
+
+                for (const auto &[name, mode] : modes) {
+                    // The overlays only read region headers, no chunk is decompressed for them
+                    if (mode == map::tile_mode::age) ImGui::Separator();
+                    if (ImGui::MenuItem(name, nullptr, mode == current_mode))
+                        input.mode = mode;
+                }
+
+                ImGui::Separator();
+                auto threshold = static_cast<int>(current_threshold);
+                if (ImGui::SliderInt("Oversized At (Sectors)", &threshold, 1, 255))
+                    input.threshold = static_cast<std::uint8_t>(threshold);
+
+                // Relief is lit again from the summaries, so dragging these stays smooth
+                auto light   = current_light;
+                auto changed = ImGui::SliderFloat("Light Direction", &light.azimuth, 0.0f, 360.0f, "%.0f deg");
+                changed |= ImGui::SliderFloat("Light Height", &light.altitude, 5.0f, 90.0f, "%.0f deg");
+                changed |= ImGui::SliderFloat("Exaggeration", &light.exaggeration, 0.5f, 8.0f, "%.1fx");
+                if (changed) input.light = light;
+
+                // Caps show everything under the height, slices only the layer at it
+                auto slice   = current_slice;
+                auto layer   = slice.bottom == slice.top;
+                auto resized = ImGui::SliderInt("Slice Height", &slice.top, -64, 319);
+                resized |= ImGui::Checkbox("Only This Layer", &layer);
+                slice.bottom = layer ? slice.top : std::numeric_limits<std::int32_t>::min();
+                if (resized) input.slice = slice;
+
+                ImGui::Separator();
+                auto compressed = current_compressed;
+                if (ImGui::Checkbox("Compressed Tiles (BC1)", &compressed)) input.compressed = compressed;
+                if (tile_psnr) ImGui::Text("Tile PSNR: %.1f dB", *tile_psnr);
+
+                ImGui::EndMenu();
+            }
+
             if (ImGui::BeginMenu("Export")) {
 
                 ImGui::EndMenu();
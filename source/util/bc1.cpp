@@ -0,0 +1,213 @@
+#include "bc1.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <tracy/client/TracyDxt1.hpp>
+
+namespace
+{
+    constexpr auto block_bytes = std::size_t(8);
+
+    // Index of transparent black in the three colour mode
+    constexpr auto transparent_index = 3u;
+
+    // Where each of Tracy's indices is in BC1, darkest first
+    constexpr auto index_order = std::array<std::uint32_t, 4>({ 1, 3, 2, 0 });
+
+    using block_pixels = std::array<std::uint32_t, 16>;
+    using colour       = std::array<std::int32_t, 3>;
+
+    [[nodiscard]] std::uint16_t to_565(const colour &value) noexcept
+    {
+        return static_cast<std::uint16_t>((value[0] >> 3) << 11 | (value[1] >> 2) << 5 | value[2] >> 3);
+    }
+
+    [[nodiscard]] colour from_565(std::uint16_t value) noexcept
+    {
+        const auto red   = (value >> 11) & 31;
+        const auto green = (value >> 5) & 63;
+        const auto blue  = value & 31;
+        return { red << 3 | red >> 2, green << 2 | green >> 4, blue << 3 | blue >> 2 };
+    }
+
+    [[nodiscard]] colour channels(std::uint32_t pixel) noexcept
+    {
+        return { static_cast<std::int32_t>(pixel & 0xFF),
+                 static_cast<std::int32_t>((pixel >> 8) & 0xFF),
+                 static_cast<std::int32_t>((pixel >> 16) & 0xFF) };
+    }
+
+    [[nodiscard]] std::uint32_t pack(const colour &value) noexcept
+    {
+        return static_cast<std::uint32_t>(value[0] | value[1] << 8 | value[2] << 16) | 0xFF000000;
+    }
+
+    [[nodiscard]] block_pixels gather(const std::uint32_t *pixels, int block) noexcept
+    {
+        auto gathered = block_pixels();
+        for (auto row = 0; row < 4; row++)
+        {
+            const auto *from = pixels + ((block / 4) * 4 + row) * 16 + (block % 4) * 4;
+            std::copy_n(from, 4, gathered.data() + row * 4);
+        }
+        return gathered;
+    }
+
+    void write_block(std::uint16_t colour_0, std::uint16_t colour_1, std::uint32_t indices, std::uint8_t *to)
+    {
+        const auto block = static_cast<std::uint64_t>(colour_0) | static_cast<std::uint64_t>(colour_1) << 16 |
+          static_cast<std::uint64_t>(indices) << 32;
+        std::memcpy(to, &block, sizeof(block));
+    }
+
+    /// The three colour mode, taken when the first endpoint isn't the greater one, leaves room
+    /// for a transparent index. The endpoints span the opaque pixels and every opaque pixel gets
+    /// the closest of them or their midpoint.
+    void encode_transparent(const block_pixels &pixels, std::uint8_t *to)
+    {
+        auto low    = colour({ 255, 255, 255 });
+        auto high   = colour({ 0, 0, 0 });
+        auto opaque = false;
+        for (const auto pixel : pixels)
+        {
+            if (!(pixel >> 24)) continue;
+            opaque             = true;
+            const auto channel = ::channels(pixel);
+            for (auto i = 0; i < 3; i++)
+            {
+                low[i]  = std::min(low[i], channel[i]);
+                high[i] = std::max(high[i], channel[i]);
+            }
+        }
+
+        if (!opaque)
+        {
+            ::write_block(0, 0, 0xFFFFFFFF, to);
+            return;
+        }
+
+        // Every channel of `high` is at least that of `low`, so its 565 value is too
+        const auto colour_0 = ::to_565(low);
+        const auto colour_1 = ::to_565(high);
+        auto       palette  = std::array<colour, 3>({ ::from_565(colour_0), ::from_565(colour_1), colour() });
+        for (auto i = 0; i < 3; i++) palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+
+        auto indices = std::uint32_t(0);
+        for (auto pixel = 0; pixel < 16; pixel++)
+        {
+            auto index = ::transparent_index;
+            if (pixels[pixel] >> 24)
+            {
+                const auto channel = ::channels(pixels[pixel]);
+                auto       best    = std::numeric_limits<std::int32_t>::max();
+                for (auto entry = 0u; entry < 3; entry++)
+                {
+                    auto distance = 0;
+                    for (auto i = 0; i < 3; i++)
+                        distance += (channel[i] - palette[entry][i]) * (channel[i] - palette[entry][i]);
+                    if (distance < best)
+                    {
+                        best  = distance;
+                        index = entry;
+                    }
+                }
+            }
+            indices |= index << (pixel * 2);
+        }
+
+        ::write_block(colour_0, colour_1, indices, to);
+    }
+}    // namespace
+
+void vx3d::bc1::compress_tile(const std::uint32_t *pixels, std::uint8_t *to) noexcept
+{
+    tracy::CompressImageDxt1(reinterpret_cast<const char *>(pixels), reinterpret_cast<char *>(to), 16, 16);
+
+    for (auto block = 0; block < 16; block++)
+    {
+        auto *     at       = to + block * ::block_bytes;
+        const auto gathered = ::gather(pixels, block);
+        if (std::any_of(gathered.begin(), gathered.end(), [](auto pixel) { return !(pixel >> 24); }))
+        {
+            ::encode_transparent(gathered, at);
+            continue;
+        }
+
+        // Tracy numbers its indices from the darker endpoint to the brighter one, the first
+        // endpoint being the brighter. Its solid blocks come out as the second endpoint either way.
+        auto encoded = std::uint64_t(0);
+        std::memcpy(&encoded, at, sizeof(encoded));
+        const auto colour_0 = static_cast<std::uint16_t>(encoded);
+        const auto colour_1 = static_cast<std::uint16_t>(encoded >> 16);
+
+        auto indices = std::uint32_t(0);
+        for (auto pixel = 0; pixel < 16; pixel++)
+            indices |= ::index_order[(encoded >> (32 + pixel * 2)) & 3] << (pixel * 2);
+
+        // Endpoints rounded to the same colour are the three colour mode, with a transparent index
+        ::write_block(colour_0, colour_1, colour_0 == colour_1 ? 0 : indices, at);
+    }
+}
+
+void vx3d::bc1::decompress_tile(const std::uint8_t *from, std::uint32_t *pixels) noexcept
+{
+    for (auto block = 0; block < 16; block++)
+    {
+        auto encoded = std::uint64_t(0);
+        std::memcpy(&encoded, from + block * ::block_bytes, sizeof(encoded));
+        const auto colour_0 = static_cast<std::uint16_t>(encoded);
+        const auto colour_1 = static_cast<std::uint16_t>(encoded >> 16);
+        const auto indices  = static_cast<std::uint32_t>(encoded >> 32);
+
+        auto palette = std::array<std::uint32_t, 4>();
+        auto low     = ::from_565(colour_0);
+        auto high    = ::from_565(colour_1);
+        auto mixed   = std::array<colour, 2>();
+        for (auto i = 0; i < 3; i++)
+            if (colour_0 > colour_1)
+            {
+                mixed[0][i] = (2 * low[i] + high[i]) / 3;
+                mixed[1][i] = (low[i] + 2 * high[i]) / 3;
+            }
+            else
+                mixed[0][i] = (low[i] + high[i]) / 2;
+
+        palette[0] = ::pack(low);
+        palette[1] = ::pack(high);
+        palette[2] = ::pack(mixed[0]);
+        palette[3] = colour_0 > colour_1 ? ::pack(mixed[1]) : 0;
+
+        for (auto pixel = 0; pixel < 16; pixel++)
+            pixels[((block / 4) * 4 + pixel / 4) * 16 + (block % 4) * 4 + pixel % 4] =
+              palette[(indices >> (pixel * 2)) & 3];
+    }
+}
+
+void vx3d::bc1::error::add(const std::uint32_t *original, const std::uint32_t *decoded) noexcept
+{
+    for (auto pixel = 0; pixel < 256; pixel++)
+    {
+        if (!(original[pixel] >> 24)) continue;
+
+        const auto expected = ::channels(original[pixel]);
+        const auto got      = ::channels(decoded[pixel]);
+        for (auto i = 0; i < 3; i++) squared += (expected[i] - got[i]) * (expected[i] - got[i]);
+        samples += 3;
+    }
+}
+
+void vx3d::bc1::error::add(const error &other) noexcept
+{
+    squared += other.squared;
+    samples += other.samples;
+}
+
+double vx3d::bc1::error::psnr() const noexcept
+{
+    if (squared == 0.0) return std::numeric_limits<double>::infinity();
+    return 10.0 * std::log10(255.0 * 255.0 * static_cast<double>(samples) / squared);
+}
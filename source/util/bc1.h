@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vx3d::bc1
+{
+    // A 16x16 tile is 4x4 blocks of 8 bytes, an eighth of it as RGBA8
+    constexpr auto tile_bytes = std::size_t(128);
+
+    /// Compresses a tile to BC1 with one bit alpha (GL_COMPRESSED_RGBA_S3TC_DXT1_EXT). Opaque
+    /// blocks go through Tracy's DXT1 encoder, blocks with transparent pixels are encoded in the
+    /// three colour mode, where the fourth index is transparent black.
+    /// \param pixels 256 pixels packed 0xAABBGGRR, rows top to bottom, alpha is either 0 or not
+    void compress_tile(const std::uint32_t *pixels, std::uint8_t *to) noexcept;
+
+    /// Decodes a tile the way the GPU does
+    void decompress_tile(const std::uint8_t *from, std::uint32_t *pixels) noexcept;
+
+    // Squared error of compressed tiles, for a PSNR of what compression costs
+    struct error
+    {
+        double        squared = 0.0;
+        std::uint64_t samples = 0;    // Colour channels of opaque pixels
+
+        /// Adds the error of a tile, decoded, against what it was made from
+        void add(const std::uint32_t *original, const std::uint32_t *decoded) noexcept;
+
+        void add(const error &other) noexcept;
+
+        /// \return In dB, infinite without any error
+        [[nodiscard]] double psnr() const noexcept;
+    };
+}    // namespace vx3d::bc1
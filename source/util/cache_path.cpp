@@ -0,0 +1,76 @@
+#include "cache_path.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+
+namespace
+{
+    [[nodiscard]] std::filesystem::path environment_path(const char *name)
+    {
+        const auto *value = std::getenv(name);
+        return value && *value ? std::filesystem::path(value) : std::filesystem::path();
+    }
+
+    [[nodiscard]] std::filesystem::path platform_cache_root()
+    {
+#if defined(_WIN32)
+        return ::environment_path("LOCALAPPDATA");
+#elif defined(__APPLE__)
+        const auto home = ::environment_path("HOME");
+        return home.empty() ? home : home / "Library" / "Caches";
+#else
+        if (auto xdg = ::environment_path("XDG_CACHE_HOME"); !xdg.empty()) return xdg;
+        const auto home = ::environment_path("HOME");
+        return home.empty() ? home : home / ".cache";
+#endif
+    }
+}    // namespace
+
+std::uint64_t vx3d::cache::hash(std::string_view text) noexcept
+{
+    auto value = std::uint64_t(0xcbf29ce484222325);
+    for (const auto character : text)
+    {
+        value ^= static_cast<std::uint8_t>(character);
+        value *= 0x100000001b3;
+    }
+    return value;
+}
+
+std::filesystem::path vx3d::cache::directory()
+{
+    auto error = std::error_code();
+
+    auto root = ::platform_cache_root();
+    if (root.empty()) root = std::filesystem::temp_directory_path(error);
+    if (root.empty()) return {};
+
+    const auto path = root / "vx3d";
+    std::filesystem::create_directories(path, error);
+    return error ? std::filesystem::path() : path;
+}
+
+std::filesystem::path
+  vx3d::cache::world_file(const std::filesystem::path &world_folder, std::string_view name)
+{
+    const auto root = directory();
+    if (root.empty()) return {};
+
+    auto error    = std::error_code();
+    auto absolute = std::filesystem::weakly_canonical(world_folder, error);
+    if (error) absolute = std::filesystem::absolute(world_folder, error);
+
+    auto key = std::array<char, 17>();
+    std::snprintf(
+      key.data(),
+      key.size(),
+      "%016llx",
+      static_cast<unsigned long long>(hash(absolute.generic_string())));
+
+    const auto path = root / key.data();
+    std::filesystem::create_directories(path, error);
+    return error ? std::filesystem::path() : path / name;
+}
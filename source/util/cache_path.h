@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+namespace vx3d::cache
+{
+    /// Per-user directory for data vx3d can always rebuild, created on first use
+    /// \return An empty path if no writable location could be found
+    [[nodiscard]] std::filesystem::path directory();
+
+    /// FNV-1a, only has to tell cached things apart on one machine
+    [[nodiscard]] std::uint64_t hash(std::string_view text) noexcept;
+
+    /// A cache file belonging to a world, worlds are told apart by their absolute path
+    /// \param name File name inside the world's cache directory
+    /// \return An empty path if there's nowhere to cache to
+    [[nodiscard]] std::filesystem::path
+      world_file(const std::filesystem::path &world_folder, std::string_view name);
+}    // namespace vx3d::cache
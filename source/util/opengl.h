@@ -13,17 +13,23 @@
 
 namespace vx3d::opengl
 {
-    /// Creates an opengl shader
-    /// \param path The shader location on disk
-    /// \param shader_type The OpenGL shader type. VERTEX_SHADER, FRAGMENT_SHADER, COMPUTE_SHADER
-    /// \return The shader handle, if there's no value then there was an error creating it
-    [[nodiscard]] inline GLuint create_shader(const std::string &path, GLuint shader_type)
+    /// Reads a shader's source
+    /// \return Empty if the file couldn't be read
+    [[nodiscard]] inline std::string read_shader(const std::string &path)
     {
         auto shader_stream = std::ifstream(path);
         auto shader_string_stream = std::stringstream();
 
         shader_string_stream << shader_stream.rdbuf();
-        const auto shader_source = shader_string_stream.str();
+        return shader_string_stream.str();
+    }
+
+    /// Compiles an opengl shader from its source
+    /// \param shader_source The GLSL source
+    /// \param shader_type The OpenGL shader type. VERTEX_SHADER, FRAGMENT_SHADER, COMPUTE_SHADER
+    /// \return The shader handle, 0 if it didn't compile
+    [[nodiscard]] inline GLuint compile_shader(const std::string &shader_source, GLuint shader_type)
+    {
         const auto shader_string = shader_source.c_str();
 
         const auto shader_handle = glCreateShader(shader_type);
@@ -38,11 +44,21 @@ namespace vx3d::opengl
         {
             glGetShaderInfoLog(shader_handle, 512, nullptr, log.data());
             std::cerr << log.data() << std::endl;
+            glDeleteShader(shader_handle);
             return {};
         }
         return shader_handle;
     }
 
+    /// Creates an opengl shader
+    /// \param path The shader location on disk
+    /// \param shader_type The OpenGL shader type. VERTEX_SHADER, FRAGMENT_SHADER, COMPUTE_SHADER
+    /// \return The shader handle, if there's no value then there was an error creating it
+    [[nodiscard]] inline GLuint create_shader(const std::string &path, GLuint shader_type)
+    {
+        return compile_shader(read_shader(path), shader_type);
+    }
+
     /// Creates a program based on shaders pased in
     /// \tparam ...
     /// \param shaders The shaders you want to attach to the program being created
@@ -0,0 +1,205 @@
+#include "png.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+    constexpr auto bytes_per_pixel = std::size_t(4);
+    constexpr auto chunk_size      = std::size_t(64) << 10;
+
+    constexpr auto signature = std::array<std::uint8_t, 8>({ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' });
+
+    void put_u32(std::uint8_t *to, std::uint32_t value) noexcept
+    {
+        to[0] = static_cast<std::uint8_t>(value >> 24);
+        to[1] = static_cast<std::uint8_t>(value >> 16);
+        to[2] = static_cast<std::uint8_t>(value >> 8);
+        to[3] = static_cast<std::uint8_t>(value);
+    }
+
+    [[nodiscard]] std::uint8_t paeth(std::uint8_t left, std::uint8_t up, std::uint8_t up_left) noexcept
+    {
+        const auto estimate   = left + up - up_left;
+        const auto to_left    = std::abs(estimate - left);
+        const auto to_up      = std::abs(estimate - up);
+        const auto to_up_left = std::abs(estimate - up_left);
+        if (to_left <= to_up && to_left <= to_up_left) return left;
+        return to_up <= to_up_left ? up : up_left;
+    }
+
+    /// Applies one of the five filters to a row
+    /// \param to `row.size() + 1` bytes, the filter type first
+    /// \return The sum of the filtered bytes as signed values, lower usually deflates better
+    std::uint64_t filter(
+      std::uint8_t               type,
+      const std::uint8_t *       row,
+      const std::vector<std::uint8_t> &previous,
+      std::uint8_t *             to) noexcept
+    {
+        to[0]      = type;
+        auto score = std::uint64_t(0);
+        for (auto i = std::size_t(0); i < previous.size(); i++)
+        {
+            const auto left    = i >= ::bytes_per_pixel ? row[i - ::bytes_per_pixel] : std::uint8_t(0);
+            const auto up      = previous[i];
+            const auto up_left = i >= ::bytes_per_pixel ? previous[i - ::bytes_per_pixel] : std::uint8_t(0);
+
+            auto predicted = std::uint8_t(0);
+            switch (type)
+            {
+            case 1: predicted = left; break;
+            case 2: predicted = up; break;
+            case 3: predicted = static_cast<std::uint8_t>((left + up) / 2); break;
+            case 4: predicted = ::paeth(left, up, up_left); break;
+            default: break;
+            }
+
+            const auto value = static_cast<std::uint8_t>(row[i] - predicted);
+            to[i + 1]        = value;
+            score += static_cast<std::uint64_t>(std::abs(static_cast<std::int8_t>(value)));
+        }
+        return score;
+    }
+}    // namespace
+
+vx3d::png::writer::writer(
+  const std::filesystem::path &path,
+  std::uint32_t                width,
+  std::uint32_t                height,
+  int                          level)
+    : _file(path, std::ios::binary), _width(width), _height(height),
+      _previous(static_cast<std::size_t>(width) * ::bytes_per_pixel),
+      _filtered(_previous.size() + 1), _candidate(_previous.size() + 1), _out(::chunk_size)
+{
+    if (!_file)
+    {
+        std::cerr << "Couldn't open " << path << " for writing" << std::endl;
+        _failed = true;
+        return;
+    }
+
+    _file.write(reinterpret_cast<const char *>(::signature.data()), ::signature.size());
+    _bytes_written += ::signature.size();
+
+    // 8 bits a channel, RGBA, deflate, adaptive filtering, not interlaced
+    auto header = std::array<std::uint8_t, 13>();
+    ::put_u32(&header[0], width);
+    ::put_u32(&header[4], height);
+    header[8]  = 8;
+    header[9]  = 6;
+    header[10] = 0;
+    header[11] = 0;
+    header[12] = 0;
+    _chunk("IHDR", header.data(), header.size());
+
+    _stream_open = zng_deflateInit(&_stream, level) == Z_OK;
+    if (!_stream_open)
+    {
+        std::cerr << "Couldn't start compressing " << path << std::endl;
+        _failed = true;
+    }
+    _stream.next_out  = _out.data();
+    _stream.avail_out = static_cast<std::uint32_t>(_out.size());
+}
+
+vx3d::png::writer::~writer()
+{
+    if (_stream_open) zng_deflateEnd(&_stream);
+}
+
+void vx3d::png::writer::write_rows(const std::uint8_t *pixels, std::uint32_t count)
+{
+    if (_failed) return;
+
+    const auto row_bytes = _previous.size();
+    for (auto row = std::uint32_t(0); row < count && _rows < _height; row++, _rows++)
+    {
+        const auto *at = pixels + row * row_bytes;
+
+        auto best = ::filter(0, at, _previous, _filtered.data());
+        for (auto type = std::uint8_t(1); type <= 4; type++)
+            if (const auto score = ::filter(type, at, _previous, _candidate.data()); score < best)
+            {
+                best = score;
+                _filtered.swap(_candidate);
+            }
+
+        _deflate(_filtered.data(), _filtered.size(), Z_NO_FLUSH);
+        std::copy(at, at + row_bytes, _previous.begin());
+    }
+}
+
+bool vx3d::png::writer::finish()
+{
+    if (_failed) return false;
+    if (_rows != _height)
+    {
+        std::cerr << "PNG finished with " << _rows << " of its " << _height << " rows" << std::endl;
+        return false;
+    }
+
+    _deflate(nullptr, 0, Z_FINISH);
+    if (_stream.avail_out != _out.size()) _chunk("IDAT", _out.data(), _out.size() - _stream.avail_out);
+    _chunk("IEND", nullptr, 0);
+
+    _file.flush();
+    return !_failed && _file.good();
+}
+
+void vx3d::png::writer::_chunk(const char *type, const std::uint8_t *data, std::size_t size)
+{
+    auto header = std::array<std::uint8_t, 8>();
+    ::put_u32(&header[0], static_cast<std::uint32_t>(size));
+    std::copy(type, type + 4, header.begin() + 4);
+
+    auto crc = zng_crc32(0, header.data() + 4, 4);
+    if (size) crc = zng_crc32(crc, data, static_cast<std::uint32_t>(size));
+    auto footer = std::array<std::uint8_t, 4>();
+    ::put_u32(footer.data(), static_cast<std::uint32_t>(crc));
+
+    _file.write(reinterpret_cast<const char *>(header.data()), header.size());
+    if (size) _file.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+    _file.write(reinterpret_cast<const char *>(footer.data()), footer.size());
+    _bytes_written += header.size() + size + footer.size();
+
+    if (!_file) _failed = true;
+}
+
+void vx3d::png::writer::_deflate(const std::uint8_t *data, std::size_t size, int flush)
+{
+    _stream.next_in  = data;
+    _stream.avail_in = static_cast<std::uint32_t>(size);
+    for (;;)
+    {
+        const auto result = zng_deflate(&_stream, flush);
+        if (result == Z_STREAM_ERROR)
+        {
+            _failed = true;
+            return;
+        }
+
+        if (_stream.avail_out == 0)
+        {
+            _chunk("IDAT", _out.data(), _out.size());
+            _stream.next_out  = _out.data();
+            _stream.avail_out = static_cast<std::uint32_t>(_out.size());
+            continue;
+        }
+        if (flush == Z_FINISH ? result == Z_STREAM_END : _stream.avail_in == 0) return;
+    }
+}
+
+bool vx3d::png::write(
+  const std::filesystem::path &path,
+  std::uint32_t                width,
+  std::uint32_t                height,
+  const std::uint8_t *         pixels,
+  int                          level)
+{
+    auto image = writer(path, width, height, level);
+    image.write_rows(pixels, height);
+    return image.finish();
+}
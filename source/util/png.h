@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <zlib-ng.h>
+
+namespace vx3d::png
+{
+    // Writes an 8 bit RGBA PNG a few rows at a time, so images far bigger than memory can be
+    // streamed to disk. Every row gets the filter that leaves the smallest sum of differences,
+    // the usual heuristic, and everything is deflated as one stream split into 64 KiB chunks.
+    class writer
+    {
+    public:
+        /// \param level zlib compression level, 1 is plenty for maps with big flat areas
+        writer(const std::filesystem::path &path, std::uint32_t width, std::uint32_t height, int level = 6);
+
+        ~writer();
+
+        writer(const writer &) = delete;
+
+        writer &operator=(const writer &) = delete;
+
+        /// \param pixels `count` rows of `width` pixels, top to bottom
+        void write_rows(const std::uint8_t *pixels, std::uint32_t count);
+
+        /// Ends the image, which has to have all of its rows by then
+        /// \return Whether the whole file was written
+        bool finish();
+
+        [[nodiscard]] bool good() const noexcept { return !_failed; }
+
+        [[nodiscard]] std::uint64_t bytes_written() const noexcept { return _bytes_written; }
+
+    private:
+        void _chunk(const char *type, const std::uint8_t *data, std::size_t size);
+
+        /// Deflates into `_out`, writing out every buffer that fills up
+        void _deflate(const std::uint8_t *data, std::size_t size, int flush);
+
+        std::ofstream _file;
+        zng_stream    _stream {};
+        bool          _stream_open = false;
+
+        std::uint32_t _width;
+        std::uint32_t _height;
+        std::uint32_t _rows = 0;
+
+        std::vector<std::uint8_t> _previous;    // Unfiltered, zeroes above the first row
+        std::vector<std::uint8_t> _filtered;    // Filter type byte first
+        std::vector<std::uint8_t> _candidate;
+        std::vector<std::uint8_t> _out;
+
+        std::uint64_t _bytes_written = 0;
+        bool          _failed        = false;
+    };
+
+    /// Writes a whole image in one go
+    /// \param pixels `width` times `height` RGBA pixels, rows top to bottom
+    /// \return Whether the whole file was written
+    bool write(
+      const std::filesystem::path &path,
+      std::uint32_t                width,
+      std::uint32_t                height,
+      const std::uint8_t *         pixels,
+      int                          level = 6);
+}    // namespace vx3d::png
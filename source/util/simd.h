@@ -0,0 +1,16 @@
+#pragma once
+
+// x86-64 always has SSE2, AVX2 is only used when the compiler targets it (-march=native or /arch)
+#if defined(__AVX2__)
+#define VX3D_SIMD_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define VX3D_SIMD_SSE2
+#endif
+
+#if defined(VX3D_SIMD_AVX2)
+#include <immintrin.h>
+#elif defined(VX3D_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
@@ -0,0 +1,351 @@
+#include "brickmap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <tracy/Tracy.hpp>
+
+namespace
+{
+    constexpr auto brick_blocks = vx3d::voxel::brickmap_brick_width * vx3d::voxel::brickmap_brick_width *
+      vx3d::voxel::brickmap_brick_width;
+
+    // A chunk is 2x2 columns of bricks
+    constexpr auto chunk_bricks = 2 * 2 * vx3d::voxel::brickmap_height;
+
+    [[nodiscard]] constexpr std::int32_t wrap(std::int32_t value, std::int32_t width) noexcept
+    {
+        const auto wrapped = value % width;
+        return wrapped < 0 ? wrapped + width : wrapped;
+    }
+
+    using block_counts = std::vector<std::pair<vx3d::loader::block_id, std::uint32_t>>;
+
+    [[nodiscard]] block_counts::iterator find(block_counts &counts, vx3d::loader::block_id id) noexcept
+    {
+        return std::find_if(counts.begin(), counts.end(), [&](const auto &entry) { return entry.first == id; });
+    }
+
+    [[nodiscard]] constexpr std::int32_t floor_div(std::int32_t value, std::int32_t divisor) noexcept
+    {
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+}    // namespace
+
+vx3d::voxel::built_brick
+  vx3d::voxel::build_brick(const loader::chunk_section *section, const glm::ivec3 &corner)
+{
+    auto built = built_brick();
+    if (!section) return built;
+
+    auto blocks = std::array<loader::block_id, ::brick_blocks>();
+    for (auto y = 0; y < brickmap_brick_width; y++)
+        for (auto z = 0; z < brickmap_brick_width; z++)
+            for (auto x = 0; x < brickmap_brick_width; x++)
+            {
+                const auto id = section->at(corner.x + x, corner.y + y, corner.z + z);
+                blocks[(y * 8 + z) * 8 + x] =
+                  loader::block_registry::info(id).is_air() ? loader::block_registry::air : id;
+            }
+
+    // Palette entries by how often they show up
+    auto counts = ::block_counts();
+    for (const auto id : blocks)
+    {
+        const auto found = ::find(counts, id);
+        if (found != counts.end())
+            found->second++;
+        else
+            counts.emplace_back(id, 1);
+    }
+
+    if (counts.size() == 1)
+    {
+        built.block = counts.front().first;
+        return built;
+    }
+
+    built.uniform = false;
+    if (counts.size() > brick_palette_size)
+    {
+        // Keeping air keeps the shape of the brick, only which solid block it is can be wrong
+        std::stable_sort(
+          counts.begin(),
+          counts.end(),
+          [](const auto &a, const auto &b)
+          {
+              const auto a_air = a.first == loader::block_registry::air;
+              const auto b_air = b.first == loader::block_registry::air;
+              return a_air != b_air ? a_air : a.second > b.second;
+          });
+        counts.resize(brick_palette_size);
+        built.lossy = true;
+    }
+
+    const auto common = std::find_if(
+      counts.begin(),
+      counts.end(),
+      [](const auto &entry) { return entry.first != loader::block_registry::air; });
+    for (auto entry = std::size_t(0); entry < counts.size(); entry++)
+        built.brick.palette[entry >> 1] |= static_cast<std::uint32_t>(counts[entry].first)
+          << ((entry & 1) * 16);
+
+    for (auto index = 0; index < ::brick_blocks; index++)
+    {
+        auto found = ::find(counts, blocks[index]);
+        if (found == counts.end()) found = common;
+
+        const auto entry = static_cast<std::uint32_t>(found - counts.begin());
+        built.brick.indices[index >> 3] |= entry << ((index & 7) * 4);
+    }
+    return built;
+}
+
+vx3d::voxel::brick_pool::brick_pool(std::uint32_t capacity) : _bricks(capacity)
+{
+    _free.reserve(capacity);
+    for (auto slot = capacity; slot > 0; slot--) _free.push_back(slot - 1);
+}
+
+std::optional<std::uint32_t> vx3d::voxel::brick_pool::allocate(const palette_brick &brick)
+{
+    if (_free.empty()) return std::nullopt;
+
+    const auto slot = _free.back();
+    _free.pop_back();
+    _bricks[slot] = brick;
+    _dirty.push_back(slot);
+    return slot;
+}
+
+void vx3d::voxel::brick_pool::release(std::uint32_t slot)
+{
+    _free.push_back(slot);
+}
+
+std::vector<std::uint32_t> vx3d::voxel::brick_pool::take_dirty()
+{
+    auto dirty = std::move(_dirty);
+    _dirty.clear();
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+    return dirty;
+}
+
+vx3d::voxel::brickmap::brickmap(std::int32_t radius, std::size_t budget_bytes)
+    : _radius(std::max(radius, 0)),
+      _width(_radius * 2 + 1),
+      _grid(static_cast<std::size_t>(_width) * _width * ::chunk_bricks, unloaded),
+      _columns(static_cast<std::size_t>(_width) * _width),
+      _pool(static_cast<std::uint32_t>(budget_bytes / sizeof(palette_brick)))
+{
+    for (auto z = -_radius; z <= _radius; z++)
+        for (auto x = -_radius; x <= _radius; x++) _columns[_column_index(x, z)].chunk = { x, z };
+}
+
+void vx3d::voxel::brickmap::set_view(const glm::vec3 &camera)
+{
+    ZoneScopedN("Brickmap::set_view");
+    const auto centre = glm::ivec2(
+      ::floor_div(static_cast<std::int32_t>(std::floor(camera.x)), 16),
+      ::floor_div(static_cast<std::int32_t>(std::floor(camera.z)), 16));
+    if (centre == _centre) return;
+
+    _centre = centre;
+    for (auto z = centre.y - _radius; z <= centre.y + _radius; z++)
+        for (auto x = centre.x - _radius; x <= centre.x + _radius; x++)
+        {
+            auto &at = _columns[_column_index(x, z)];
+            if (at.chunk != glm::ivec2(x, z))
+            {
+                _evict(at);
+                at.chunk = { x, z };
+            }
+            else if (at.state == column_state::rejected)
+                at.state = column_state::missing;
+        }
+}
+
+std::vector<glm::ivec2> vx3d::voxel::brickmap::wanted(std::size_t limit) const
+{
+    auto found = std::vector<glm::ivec2>();
+    for (const auto &at : _columns)
+        if (at.state == column_state::missing) found.push_back(at.chunk);
+
+    const auto nearer = [&](const glm::ivec2 &a, const glm::ivec2 &b)
+    { return _distance(a) < _distance(b); };
+    if (found.size() > limit)
+    {
+        std::partial_sort(found.begin(), found.begin() + limit, found.end(), nearer);
+        found.resize(limit);
+    }
+    else
+        std::sort(found.begin(), found.end(), nearer);
+    return found;
+}
+
+bool vx3d::voxel::brickmap::insert_chunk(std::int32_t x, std::int32_t z, const loader::chunk *chunk)
+{
+    ZoneScopedN("Brickmap::insert_chunk");
+    auto &at = _columns[_column_index(x, z)];
+    if (at.chunk != glm::ivec2(x, z)) return false;
+    _evict(at);
+
+    // Bricks of every section, x and z of the column then y
+    auto built = std::vector<built_brick>(::chunk_bricks);
+    auto needs = std::uint32_t(0);
+    for (auto column = 0; column < 4; column++)
+        for (auto y = 0; y < brickmap_height; y++)
+        {
+            const auto  block_y = brickmap_min_height + y * brickmap_brick_width;
+            const auto *section = chunk ? chunk->section(::floor_div(block_y, 16)) : nullptr;
+            auto &      brick   = built[column * brickmap_height + y];
+            brick = build_brick(section, { (column & 1) * 8, block_y & 15, (column >> 1) * 8 });
+            if (!brick.uniform) needs++;
+        }
+
+    // Furthest first, only chunks further away than this one give up their bricks
+    if (needs > _pool.available())
+    {
+        auto further = std::vector<column *>();
+        auto freed   = _pool.available();
+        for (auto &other : _columns)
+            if (other.state == column_state::resident && _distance(other.chunk) > _distance(at.chunk))
+                further.push_back(&other);
+        std::sort(
+          further.begin(),
+          further.end(),
+          [&](const column *a, const column *b) { return _distance(a->chunk) > _distance(b->chunk); });
+
+        auto evicting = std::size_t(0);
+        for (; evicting < further.size() && freed < needs; evicting++)
+            freed += static_cast<std::uint32_t>(further[evicting]->slots.size());
+        if (freed < needs)
+        {
+            at.state = column_state::rejected;
+            return false;
+        }
+
+        for (auto i = std::size_t(0); i < evicting; i++)
+        {
+            _evict(*further[i]);
+            _stats.evictions++;
+        }
+    }
+
+    const auto base_x = ::wrap(x, _width) * 2;
+    const auto base_z = ::wrap(z, _width) * 2;
+    for (auto column = 0; column < 4; column++)
+    {
+        const auto index = static_cast<std::uint32_t>(
+          (base_z + (column >> 1)) * _width * 2 + base_x + (column & 1));
+        for (auto y = 0; y < brickmap_height; y++)
+        {
+            const auto &brick = built[column * brickmap_height + y];
+            auto &      cell  = _grid[static_cast<std::size_t>(index) * brickmap_height + y];
+            if (brick.uniform)
+            {
+                cell = uniform_flag | brick.block;
+                if (brick.block != loader::block_registry::air) at.uniform++;
+                continue;
+            }
+
+            cell = *_pool.allocate(brick.brick);
+            at.slots.push_back(cell);
+            if (brick.lossy) at.lossy++;
+        }
+        _dirty_columns.push_back(index);
+    }
+
+    at.state = column_state::resident;
+    _stats.columns++;
+    _stats.bricks += static_cast<std::uint32_t>(at.slots.size());
+    _stats.uniform += at.uniform;
+    _stats.lossy += at.lossy;
+    return true;
+}
+
+void vx3d::voxel::brickmap::invalidate_chunk(std::int32_t x, std::int32_t z)
+{
+    auto &at = _columns[_column_index(x, z)];
+    if (at.chunk != glm::ivec2(x, z)) return;
+    _evict(at);
+}
+
+std::uint32_t vx3d::voxel::brickmap::cell(const glm::ivec3 &brick) const noexcept
+{
+    const auto chunk = glm::ivec2(::floor_div(brick.x, 2), ::floor_div(brick.z, 2));
+    if (brick.y < 0 || brick.y >= brickmap_height || std::abs(chunk.x - _centre.x) > _radius ||
+        std::abs(chunk.y - _centre.y) > _radius)
+        return unloaded;
+
+    const auto x = ::wrap(brick.x, _width * 2);
+    const auto z = ::wrap(brick.z, _width * 2);
+    return _grid[(static_cast<std::size_t>(z) * _width * 2 + x) * brickmap_height + brick.y];
+}
+
+vx3d::loader::block_id vx3d::voxel::brickmap::at(const glm::ivec3 &position) const noexcept
+{
+    const auto local = position - glm::ivec3(0, brickmap_min_height, 0);
+    const auto found = cell({
+      ::floor_div(local.x, brickmap_brick_width),
+      ::floor_div(local.y, brickmap_brick_width),
+      ::floor_div(local.z, brickmap_brick_width),
+    });
+
+    if (found == unloaded) return loader::block_registry::air;
+    if (found & uniform_flag) return static_cast<loader::block_id>(found & ~uniform_flag);
+    return _pool.at(found).at(local.x & 7, local.y & 7, local.z & 7);
+}
+
+std::vector<std::uint32_t> vx3d::voxel::brickmap::take_dirty_columns()
+{
+    auto dirty = std::move(_dirty_columns);
+    _dirty_columns.clear();
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+    return dirty;
+}
+
+std::size_t vx3d::voxel::brickmap::_column_index(std::int32_t x, std::int32_t z) const noexcept
+{
+    return static_cast<std::size_t>(::wrap(z, _width)) * _width + ::wrap(x, _width);
+}
+
+std::int64_t vx3d::voxel::brickmap::_distance(const glm::ivec2 &chunk) const noexcept
+{
+    const auto offset = glm::ivec2(chunk.x - _centre.x, chunk.y - _centre.y);
+    return static_cast<std::int64_t>(offset.x) * offset.x +
+      static_cast<std::int64_t>(offset.y) * offset.y;
+}
+
+void vx3d::voxel::brickmap::_evict(column &evicted)
+{
+    if (evicted.state == column_state::resident)
+    {
+        for (const auto slot : evicted.slots) _pool.release(slot);
+
+        _stats.columns--;
+        _stats.bricks -= static_cast<std::uint32_t>(evicted.slots.size());
+        _stats.uniform -= evicted.uniform;
+        _stats.lossy -= evicted.lossy;
+
+        const auto base_x = ::wrap(evicted.chunk.x, _width) * 2;
+        const auto base_z = ::wrap(evicted.chunk.y, _width) * 2;
+        for (auto column = 0; column < 4; column++)
+        {
+            const auto index = static_cast<std::uint32_t>(
+              (base_z + (column >> 1)) * _width * 2 + base_x + (column & 1));
+            std::fill_n(
+              _grid.begin() + static_cast<std::ptrdiff_t>(index) * brickmap_height,
+              brickmap_height,
+              unloaded);
+            _dirty_columns.push_back(index);
+        }
+    }
+
+    evicted.slots.clear();
+    evicted.uniform = 0;
+    evicted.lossy   = 0;
+    evicted.state   = column_state::missing;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <loader/chunk.h>
+
+namespace vx3d::voxel
+{
+    constexpr auto brickmap_brick_width = 8;
+    constexpr auto brick_palette_size   = 16;
+
+    // Bricks from y -64 up to 320, which takes in every world height there has been
+    constexpr auto brickmap_min_height = -64;
+    constexpr auto brickmap_height     = 384 / brickmap_brick_width;
+
+    // 8x8x8 blocks as indices into a palette of 16, 288 bytes laid out the way an std430 array of
+    // uints would be so the pool can be copied into a shader storage buffer as is
+    struct palette_brick
+    {
+        // Two block ids a word, the first in the low half
+        std::array<std::uint32_t, brick_palette_size / 2> palette {};
+
+        // 4 bits a block, (y * 8 + z) * 8 + x, eight to a word from the low bits up
+        std::array<std::uint32_t, 64> indices {};
+
+        [[nodiscard]] loader::block_id at(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept
+        {
+            const auto index = (y * 8 + z) * 8 + x;
+            const auto entry = (indices[index >> 3] >> ((index & 7) * 4)) & 0xF;
+            return static_cast<loader::block_id>((palette[entry >> 1] >> ((entry & 1) * 16)) & 0xFFFF);
+        }
+    };
+    static_assert(sizeof(palette_brick) == 288);
+
+    struct built_brick
+    {
+        // Bricks of a single block, air included, don't need a palette
+        bool             uniform = true;
+        loader::block_id block   = loader::block_registry::air;
+
+        // More than 16 different blocks, the rarest were swapped for the most common solid one
+        bool lossy = false;
+
+        palette_brick brick;
+    };
+
+    /// Builds the brick of a section with its lowest corner at `corner`, every kind of air as air
+    /// \param section nullptr for a section of air
+    /// \param corner Within the section, 0 or 8 on every axis
+    [[nodiscard]] built_brick
+      build_brick(const loader::chunk_section *section, const glm::ivec3 &corner);
+
+    // A fixed number of brick slots allocated up front, the size of the buffer they go into
+    class brick_pool
+    {
+    public:
+        explicit brick_pool(std::uint32_t capacity);
+
+        /// \return The slot the brick went into, nothing if the pool is full
+        [[nodiscard]] std::optional<std::uint32_t> allocate(const palette_brick &brick);
+
+        void release(std::uint32_t slot);
+
+        [[nodiscard]] const palette_brick &at(std::uint32_t slot) const noexcept
+        {
+            return _bricks[slot];
+        }
+
+        [[nodiscard]] const std::vector<palette_brick> &bricks() const noexcept { return _bricks; }
+
+        [[nodiscard]] std::uint32_t capacity() const noexcept
+        {
+            return static_cast<std::uint32_t>(_bricks.size());
+        }
+
+        [[nodiscard]] std::uint32_t used() const noexcept
+        {
+            return capacity() - static_cast<std::uint32_t>(_free.size());
+        }
+
+        [[nodiscard]] std::uint32_t available() const noexcept
+        {
+            return static_cast<std::uint32_t>(_free.size());
+        }
+
+        /// Slots written since the last call, sorted, so only those are uploaded
+        [[nodiscard]] std::vector<std::uint32_t> take_dirty();
+
+    private:
+        std::vector<palette_brick> _bricks;
+        std::vector<std::uint32_t> _free;    // Lowest slot last, so it's handed out first
+        std::vector<std::uint32_t> _dirty;
+    };
+
+    struct brickmap_stats
+    {
+        std::uint32_t columns   = 0;    // Chunks resident
+        std::uint32_t bricks    = 0;    // In the pool
+        std::uint32_t uniform   = 0;    // Cells holding a single block other than air
+        std::uint32_t lossy     = 0;
+        std::uint64_t evictions = 0;    // Chunks dropped for nearer ones since the map was made
+    };
+
+    // A two level brick map of the chunks around the camera: a grid of cells over a square of
+    // chunks, each cell a pool slot, a whole brick of one block or unloaded. The grid wraps around,
+    // chunk x lands in column x modulo the width, so moving the camera only touches the chunks
+    // that come into view. Every brick column is `brickmap_height` cells in a row, x then z:
+    // ((z * width + x) * brickmap_height + y) with x and z in bricks.
+    //
+    // Chunks are loaded by the caller, nearest first from `wanted`, and handed over with
+    // `insert_chunk`. Once the pool is full nearer chunks take the slots of the furthest ones.
+    class brickmap
+    {
+    public:
+        static constexpr std::uint32_t unloaded     = 0xFFFFFFFF;
+        static constexpr std::uint32_t uniform_flag = 0x80000000;    // Low bits are the block
+        static constexpr std::uint32_t empty        = uniform_flag;
+
+        /// \param radius Chunks kept on every side of the camera's chunk
+        /// \param budget_bytes For the pool, every brick is `sizeof(palette_brick)`
+        brickmap(std::int32_t radius, std::size_t budget_bytes);
+
+        /// Moves the window of chunks with the camera, chunks that leave it are dropped
+        void set_view(const glm::vec3 &camera);
+
+        /// Chunks in the window that aren't resident, nearest to the camera first
+        /// \param limit Most to return, what can be loaded before the next frame
+        [[nodiscard]] std::vector<glm::ivec2> wanted(std::size_t limit) const;
+
+        /// Builds the bricks of a loaded chunk, making room in the pool if it's nearer than others
+        /// \param chunk nullptr where there's no chunk, its cells are empty
+        /// \return Whether it's resident now, not when it's out of the window or nothing in the
+        /// pool is further away. Those aren't wanted again until the camera moves to another chunk.
+        bool insert_chunk(std::int32_t x, std::int32_t z, const loader::chunk *chunk);
+
+        /// Drops a chunk that changed, so it's wanted again
+        void invalidate_chunk(std::int32_t x, std::int32_t z);
+
+        /// \return The cell of a brick, `unloaded` outside of the window
+        [[nodiscard]] std::uint32_t cell(const glm::ivec3 &brick) const noexcept;
+
+        /// Looks a block up the way a shader would, for checking what's uploaded
+        /// \return Air for blocks that aren't loaded
+        [[nodiscard]] loader::block_id at(const glm::ivec3 &position) const noexcept;
+
+        [[nodiscard]] const std::vector<std::uint32_t> &grid() const noexcept { return _grid; }
+
+        /// Grid size in bricks
+        [[nodiscard]] glm::ivec3 grid_size() const noexcept
+        {
+            return { _width * 2, brickmap_height, _width * 2 };
+        }
+
+        /// Chunk the window is centred on
+        [[nodiscard]] const glm::ivec2 &centre() const noexcept { return _centre; }
+
+        [[nodiscard]] const brick_pool &pool() const noexcept { return _pool; }
+
+        [[nodiscard]] brick_pool &pool() noexcept { return _pool; }
+
+        /// Brick columns changed since the last call, `brickmap_height` cells from
+        /// column * brickmap_height in the grid
+        [[nodiscard]] std::vector<std::uint32_t> take_dirty_columns();
+
+        [[nodiscard]] const brickmap_stats &stats() const noexcept { return _stats; }
+
+    private:
+        enum class column_state : std::uint8_t
+        {
+            missing,
+            resident,
+            rejected    // Didn't fit, until the camera moves
+        };
+
+        struct column
+        {
+            glm::ivec2                 chunk {};
+            column_state               state = column_state::missing;
+            std::vector<std::uint32_t> slots;
+            std::uint32_t              uniform = 0;
+            std::uint32_t              lossy   = 0;
+        };
+
+        [[nodiscard]] std::size_t _column_index(std::int32_t x, std::int32_t z) const noexcept;
+
+        [[nodiscard]] std::int64_t _distance(const glm::ivec2 &chunk) const noexcept;
+
+        /// Releases the bricks of a chunk and marks its cells unloaded
+        void _evict(column &evicted);
+
+        std::int32_t _radius;
+        std::int32_t _width;    // In chunks
+        glm::ivec2   _centre {};
+
+        std::vector<std::uint32_t> _grid;
+        std::vector<column>        _columns;
+        std::vector<std::uint32_t> _dirty_columns;
+
+        brick_pool     _pool;
+        brickmap_stats _stats;
+    };
+}    // namespace vx3d::voxel
@@ -0,0 +1,357 @@
+#include "dag.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+
+#include <tsl/robin_map.h>
+#include <tracy/Tracy.hpp>
+
+#include <loader/world_loader.h>
+
+namespace
+{
+    using vx3d::voxel::dag;
+
+    // A chunk section is a level 2 node, 16 blocks across
+    constexpr std::uint8_t section_level = 2;
+    constexpr auto         region_cubes  = vx3d::voxel::region_width / 16;
+
+    [[nodiscard]] constexpr std::uint32_t popcount(std::uint32_t mask) noexcept
+    {
+        auto count = std::uint32_t(0);
+        for (; mask; mask &= mask - 1) count++;
+        return count;
+    }
+
+    [[nodiscard]] constexpr std::uint64_t mix(std::uint64_t hash, std::uint64_t value) noexcept
+    {
+        hash ^= value + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2);
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCD;
+        return hash;
+    }
+
+    // Adds bricks and nodes to a DAG, handing back the one already there if it's the same. Hashes
+    // that collide with something different move on to the next hash until they find a free one.
+    class interner
+    {
+    public:
+        explicit interner(dag &into) : _dag(into) {}
+
+        /// \return `dag::empty` for a brick of nothing but air
+        [[nodiscard]] std::uint32_t brick(const vx3d::voxel::brick &blocks)
+        {
+            auto hash  = std::uint64_t(0);
+            auto solid = false;
+            for (auto i = 0; i < 64; i += 4)
+            {
+                const auto word = static_cast<std::uint64_t>(blocks[i]) |
+                  static_cast<std::uint64_t>(blocks[i + 1]) << 16 |
+                  static_cast<std::uint64_t>(blocks[i + 2]) << 32 |
+                  static_cast<std::uint64_t>(blocks[i + 3]) << 48;
+                solid |= word != 0;
+                hash = ::mix(hash, word);
+            }
+            if (!solid) return dag::empty;
+
+            for (;; hash = ::mix(hash, 1))
+            {
+                const auto [at, inserted] = _bricks.insert({ hash, 0 });
+                if (inserted)
+                {
+                    at.value() = static_cast<std::uint32_t>(_dag.bricks.size());
+                    _dag.bricks.push_back(blocks);
+                    return at->second;
+                }
+                if (_dag.bricks[at->second] == blocks) return at->second;
+            }
+        }
+
+        /// \return `dag::empty` for a node without children
+        [[nodiscard]] std::uint32_t node(std::uint8_t level, const std::array<std::uint32_t, 8> &children)
+        {
+            auto words = std::array<std::uint32_t, 9>();
+            auto size  = std::size_t(1);
+            auto mask  = std::uint32_t(0);
+            for (auto i = 0; i < 8; i++)
+                if (children[i] != dag::empty)
+                {
+                    mask |= 1 << i;
+                    words[size++] = children[i];
+                }
+            if (!mask) return dag::empty;
+            words[0] = mask | static_cast<std::uint32_t>(level) << 8;
+
+            auto hash = std::uint64_t(0);
+            for (auto i = std::size_t(0); i < size; i++) hash = ::mix(hash, words[i]);
+
+            for (;; hash = ::mix(hash, 1))
+            {
+                const auto [at, inserted] = _nodes.insert({ hash, 0 });
+                if (inserted)
+                {
+                    at.value() = static_cast<std::uint32_t>(_dag.nodes.size());
+                    _dag.nodes.insert(_dag.nodes.end(), words.begin(), words.begin() + size);
+                    return at->second;
+                }
+                if (std::equal(words.begin(), words.begin() + size, _dag.nodes.begin() + at->second))
+                    return at->second;
+            }
+        }
+
+        /// Copies another DAG in, its nodes are stored children first so one pass remaps them
+        /// \return The root of `part` in this DAG
+        [[nodiscard]] std::uint32_t import(const dag &part)
+        {
+            auto bricks = std::vector<std::uint32_t>(part.bricks.size());
+            for (auto i = std::size_t(0); i < part.bricks.size(); i++) bricks[i] = brick(part.bricks[i]);
+
+            auto nodes = tsl::robin_map<std::uint32_t, std::uint32_t>();
+            nodes.reserve(part.nodes.size() / 2);
+            for (auto offset = std::size_t(0); offset < part.nodes.size();)
+            {
+                const auto header = part.nodes[offset];
+                const auto level  = static_cast<std::uint8_t>(header >> 8);
+
+                auto children = std::array<std::uint32_t, 8>();
+                auto next     = offset + 1;
+                for (auto i = 0; i < 8; i++)
+                {
+                    if (!(header & (1 << i)))
+                        children[i] = dag::empty;
+                    else
+                    {
+                        const auto child = part.nodes[next++];
+                        children[i]      = level == 1 ? bricks[child] : nodes.at(child);
+                    }
+                }
+
+                nodes[static_cast<std::uint32_t>(offset)] = node(level, children);
+                offset                                    = next;
+            }
+
+            return part.root == dag::empty ? dag::empty : nodes.at(part.root);
+        }
+
+    private:
+        dag &_dag;
+
+        tsl::robin_map<std::uint64_t, std::uint32_t> _bricks;
+        tsl::robin_map<std::uint64_t, std::uint32_t> _nodes;
+    };
+
+    /// Puts every 2x2x2 block of a grid of nodes under a node of the level above
+    /// \param size Of `grid`, halved and rounded up to the size of the grid returned
+    [[nodiscard]] std::vector<std::uint32_t> combine(
+      interner &                        intern,
+      std::uint8_t                      level,
+      const std::vector<std::uint32_t> &grid,
+      glm::ivec3 &                      size)
+    {
+        const auto next     = (size + 1) / 2;
+        auto       combined = std::vector<std::uint32_t>(next.x * next.y * next.z, dag::empty);
+        for (auto y = 0; y < next.y; y++)
+            for (auto z = 0; z < next.z; z++)
+                for (auto x = 0; x < next.x; x++)
+                {
+                    auto children = std::array<std::uint32_t, 8>();
+                    for (auto i = 0; i < 8; i++)
+                    {
+                        const auto child = glm::ivec3(x * 2 + (i & 1), y * 2 + ((i >> 1) & 1), z * 2 + (i >> 2));
+                        children[i]      = child.x < size.x && child.y < size.y && child.z < size.z
+                               ? grid[(child.y * size.z + child.z) * size.x + child.x]
+                               : dag::empty;
+                    }
+                    combined[(y * next.z + z) * next.x + x] = intern.node(level, children);
+                }
+
+        size = next;
+        return combined;
+    }
+
+    [[nodiscard]] std::uint32_t section_node(interner &intern, const vx3d::loader::chunk_section &section)
+    {
+        using vx3d::loader::block_registry;
+
+        auto bricks = std::vector<std::uint32_t>(64);
+        for (auto brick_y = 0; brick_y < 4; brick_y++)
+            for (auto brick_z = 0; brick_z < 4; brick_z++)
+                for (auto brick_x = 0; brick_x < 4; brick_x++)
+                {
+                    auto blocks = vx3d::voxel::brick();
+                    for (auto y = 0; y < 4; y++)
+                        for (auto z = 0; z < 4; z++)
+                            for (auto x = 0; x < 4; x++)
+                            {
+                                const auto id = section.at(brick_x * 4 + x, brick_y * 4 + y, brick_z * 4 + z);
+                                blocks[(y * 4 + z) * 4 + x] =
+                                  block_registry::info(id).is_air() ? block_registry::air : id;
+                            }
+                    bricks[(brick_y * 4 + brick_z) * 4 + brick_x] = intern.brick(blocks);
+                }
+
+        auto size  = glm::ivec3(4);
+        auto nodes = ::combine(intern, 1, bricks, size);
+        return ::combine(intern, section_level, nodes, size)[0];
+    }
+
+    struct built_region
+    {
+        dag                        part;
+        vx3d::voxel::region_stats stats;
+    };
+
+    [[nodiscard]] built_region
+      build_region(const glm::ivec2 &region, const vx3d::voxel::dag_builder::chunk_source &source)
+    {
+        ZoneScopedN("DagBuilder::build_region");
+        const auto start = std::chrono::steady_clock::now();
+
+        auto built         = built_region();
+        built.stats.region = region;
+        auto intern        = interner(built.part);
+
+        // Sections are only needed until they're a node, so chunks are let go of one at a time
+        auto grid = std::vector<std::uint32_t>(region_cubes * region_cubes * region_cubes, dag::empty);
+        for (auto z = 0; z < region_cubes; z++)
+            for (auto x = 0; x < region_cubes; x++)
+            {
+                const auto chunk = source(region.x * region_cubes + x, region.y * region_cubes + z);
+                if (!chunk) continue;
+
+                built.stats.chunks++;
+                for (const auto &section : chunk->sections)
+                {
+                    const auto y = section.y - vx3d::voxel::min_height / 16;
+                    if (y < 0 || y >= region_cubes) continue;
+                    grid[(y * region_cubes + z) * region_cubes + x] = ::section_node(intern, section);
+                }
+            }
+
+        auto size = glm::ivec3(region_cubes);
+        for (auto level = std::uint8_t(section_level + 1); level <= vx3d::voxel::region_level; level++)
+            grid = ::combine(intern, level, grid, size);
+
+        built.part.root   = grid[0];
+        built.part.level  = vx3d::voxel::region_level;
+        built.part.origin = glm::ivec3(region.x, 0, region.y) * vx3d::voxel::region_width +
+          glm::ivec3(0, vx3d::voxel::min_height, 0);
+
+        built.stats.nodes  = built.part.node_count();
+        built.stats.bricks = built.part.bricks.size();
+        built.stats.bytes  = built.part.bytes();
+        built.stats.milliseconds =
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return built;
+    }
+}    // namespace
+
+std::size_t vx3d::voxel::dag::node_count() const noexcept
+{
+    auto count = std::size_t(0);
+    for (auto offset = std::size_t(0); offset < nodes.size(); count++)
+        offset += 1 + ::popcount(nodes[offset] & 0xFF);
+    return count;
+}
+
+vx3d::loader::block_id vx3d::voxel::dag::at(const glm::ivec3 &position) const noexcept
+{
+    auto       local = position - origin;
+    const auto width = brick_width << level;
+    if (root == empty || local.x < 0 || local.y < 0 || local.z < 0 || local.x >= width ||
+        local.y >= width || local.z >= width)
+        return loader::block_registry::air;
+
+    auto node = root;
+    for (auto at = level; at > 0; at--)
+    {
+        const auto half   = brick_width << (at - 1);
+        const auto header = nodes[node];
+        const auto octant = glm::ivec3(local.x >= half, local.y >= half, local.z >= half);
+        const auto child  = octant.x | octant.y << 1 | octant.z << 2;
+        if (!(header & (1 << child))) return loader::block_registry::air;
+
+        node = nodes[node + 1 + ::popcount(header & ((1 << child) - 1))];
+        local -= octant * half;
+    }
+
+    return bricks[node][(local.y * 4 + local.z) * 4 + local.x];
+}
+
+vx3d::voxel::dag_builder::dag_builder(chunk_source source, std::uint32_t threads)
+    : _source(std::move(source)), _thread_pool(vx3d::default_worker_count(threads))
+{
+}
+
+vx3d::voxel::dag vx3d::voxel::dag_builder::build(
+  const std::vector<glm::ivec2> &                  regions,
+  const std::function<void(const region_stats &)> &report)
+{
+    ZoneScopedN("DagBuilder::build");
+
+    auto mutex    = std::mutex();
+    auto finished = std::condition_variable();
+    auto built    = std::deque<built_region>();
+
+    auto tasks = std::vector<std::function<void()>>();
+    for (const auto &region : regions)
+        tasks.emplace_back(
+          [&, region]
+          {
+              auto part  = ::build_region(region, _source);
+              auto guard = std::lock_guard(mutex);
+              built.push_back(std::move(part));
+              finished.notify_one();
+          });
+    _thread_pool.submit_tasks(tasks);
+
+    // Merged here as they come in, so only the regions waiting on the merge are held twice
+    auto world  = dag();
+    auto intern = interner(world);
+    auto roots  = tsl::robin_map<std::uint64_t, std::uint32_t>();
+    auto min    = glm::ivec2(std::numeric_limits<std::int32_t>::max());
+    auto max    = glm::ivec2(std::numeric_limits<std::int32_t>::min());
+    for (auto merged = std::size_t(0); merged < regions.size(); merged++)
+    {
+        auto part = built_region();
+        {
+            auto guard = std::unique_lock(mutex);
+            finished.wait(guard, [&] { return !built.empty(); });
+            part = std::move(built.front());
+            built.pop_front();
+        }
+
+        ZoneScopedN("DagBuilder::merge");
+        if (const auto root = intern.import(part.part); root != dag::empty)
+        {
+            roots[world_loader::hash_pos(part.stats.region.x, part.stats.region.y)] = root;
+            min = glm::min(min, part.stats.region);
+            max = glm::max(max, part.stats.region);
+        }
+        if (report) report(part.stats);
+    }
+    if (roots.empty()) return world;
+
+    // Regions are only one node tall, the levels above them are as wide as the widest side
+    auto levels = std::uint8_t(0);
+    while ((1 << levels) < std::max(max.x - min.x + 1, max.y - min.y + 1)) levels++;
+
+    auto size = glm::ivec3(1 << levels, 1, 1 << levels);
+    auto grid = std::vector<std::uint32_t>(size.x * size.z, dag::empty);
+    for (const auto &[region, root] : roots)
+    {
+        const auto x = static_cast<std::int32_t>(region >> 32) - min.x;
+        const auto z = static_cast<std::int32_t>(region & 0xFFFFFFFF) - min.y;
+        grid[z * size.x + x] = root;
+    }
+    for (auto level = std::uint8_t(region_level + 1); level <= region_level + levels; level++)
+        grid = ::combine(intern, level, grid, size);
+
+    world.root   = grid[0];
+    world.level  = region_level + levels;
+    world.origin = glm::ivec3(min.x, 0, min.y) * region_width + glm::ivec3(0, min_height, 0);
+    return world;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <thread_pool.h>
+#include <loader/chunk.h>
+
+namespace vx3d::voxel
+{
+    // Blocks of a 4x4x4 cube, (y * 4 + z) * 4 + x, every kind of air stored as air
+    using brick = std::array<loader::block_id, 64>;
+
+    constexpr auto brick_width = 4;
+
+    // A region is one node, 512 blocks across in every direction from y -64 up, which takes in
+    // every world height there has been
+    constexpr std::uint8_t region_level = 7;
+    constexpr auto         region_width = brick_width << region_level;
+    constexpr auto         min_height   = -64;
+
+    // A sparse voxel octree with every identical subtree stored once. A node at level L is
+    // `brick_width << L` blocks across, bricks are level 0. Nodes are a header word, the child
+    // mask in the low 8 bits and the level above it, followed by the index of every child in
+    // the mask in order: into `bricks` for nodes at level 1, into `nodes` above that. Child i
+    // is the octant at x = i & 1, y = (i >> 1) & 1 and z = i >> 2.
+    struct dag
+    {
+        static constexpr std::uint32_t empty = 0xFFFFFFFF;
+
+        std::vector<std::uint32_t> nodes;
+        std::vector<brick>         bricks;
+
+        std::uint32_t root   = empty;
+        std::uint8_t  level  = 0;     // Of the root
+        glm::ivec3    origin {};      // Lowest corner of the root, in blocks
+
+        [[nodiscard]] std::size_t bytes() const noexcept
+        {
+            return nodes.size() * sizeof(std::uint32_t) + bricks.size() * sizeof(brick);
+        }
+
+        /// Counts header words, nodes are variable length
+        [[nodiscard]] std::size_t node_count() const noexcept;
+
+        /// \return Air outside of the root
+        [[nodiscard]] loader::block_id at(const glm::ivec3 &position) const noexcept;
+    };
+
+    struct region_stats
+    {
+        glm::ivec2    region {};
+        std::uint32_t chunks       = 0;
+        std::size_t   nodes        = 0;    // Of the region on its own, before merging
+        std::size_t   bricks       = 0;
+        std::size_t   bytes        = 0;
+        double        milliseconds = 0.0;
+    };
+
+    // Turns decoded chunks into a DAG, a region per task on a pool of worker threads. Every region
+    // is deduplicated on its own, then merged into the world as it finishes so subtrees shared
+    // between regions are only stored once. Chunks are only needed while their region is built.
+    class dag_builder
+    {
+    public:
+        using chunk_source =
+          std::function<std::shared_ptr<const loader::chunk>(std::int32_t x, std::int32_t z)>;
+
+        /// \param source Must be safe to call from any thread, see `world_loader::load_chunk`
+        /// \param threads Workers to build with, 0 leaves one hardware thread for merging
+        explicit dag_builder(chunk_source source, std::uint32_t threads = 0);
+
+        /// Builds regions and waits for them
+        /// \param report Called on the calling thread with every region as it's merged
+        [[nodiscard]] dag build(
+          const std::vector<glm::ivec2> &                  regions,
+          const std::function<void(const region_stats &)> &report = {});
+
+    private:
+        chunk_source _source;
+
+        // Last, so the workers are joined before anything they use goes away
+        vx3d::thread_pool _thread_pool;
+    };
+}    // namespace vx3d::voxel
@@ -0,0 +1,71 @@
+#include "dag_benchmark.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include <loader/world_loader.h>
+#include <voxel/dag.h>
+
+namespace
+{
+    [[nodiscard]] double milliseconds_since(std::chrono::steady_clock::time_point start) noexcept
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    [[nodiscard]] double kibibytes(std::size_t bytes) noexcept
+    {
+        return static_cast<double>(bytes) / 1024.0;
+    }
+}    // namespace
+
+int vx3d::voxel::run_dag_benchmark(
+  const std::filesystem::path &world_folder,
+  std::int32_t                 radius,
+  std::uint32_t                threads)
+{
+    auto loader = world_loader();
+    loader.set_world(world_folder);
+
+    const auto regions = loader.regions_in({ -radius, -radius }, { radius, radius });
+    if (regions.empty())
+    {
+        std::cerr << "No regions within " << radius << " regions of 0, 0 in " << world_folder << std::endl;
+        return 1;
+    }
+
+    // Chunks are decoded by the region tasks, so their time is part of every region's
+    auto builder = dag_builder(
+      [&loader](std::int32_t x, std::int32_t z)
+      { return loader.load_chunk(x, z, loader::decode_flag_blocks); },
+      threads);
+
+    auto total = region_stats();
+    std::cout << std::fixed << std::setprecision(3);
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto built = builder.build(
+      regions,
+      [&total](const region_stats &stats)
+      {
+          std::cout << "Region " << stats.region.x << ", " << stats.region.y << ": " << stats.chunks
+                    << " chunks, " << stats.nodes << " nodes, " << stats.bricks << " bricks, "
+                    << ::kibibytes(stats.bytes) << " KiB, " << stats.milliseconds << " ms\n";
+          total.chunks += stats.chunks;
+          total.nodes += stats.nodes;
+          total.bricks += stats.bricks;
+          total.bytes += stats.bytes;
+          total.milliseconds += stats.milliseconds;
+      });
+    const auto wall = ::milliseconds_since(start);
+
+    std::cout << "Regions on their own: " << regions.size() << " regions, " << total.chunks << " chunks, "
+              << total.nodes << " nodes, " << total.bricks << " bricks, " << ::kibibytes(total.bytes)
+              << " KiB, " << total.milliseconds << " ms\n";
+    std::cout << "Merged: " << built.node_count() << " nodes, " << built.bricks.size() << " bricks, "
+              << ::kibibytes(built.bytes()) << " KiB, "
+              << (built.bytes() ? static_cast<double>(total.bytes) / static_cast<double>(built.bytes()) : 0.0)
+              << "x smaller, built in " << wall << " ms" << std::endl;
+    return 0;
+}
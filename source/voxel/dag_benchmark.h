@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+namespace vx3d::voxel
+{
+    /// Builds the DAG of the regions within `radius` regions of 0, 0 and prints the nodes, bricks,
+    /// bytes and milliseconds of every region as it's merged, then of the merged DAG. Regions are
+    /// counted on their own, so the totals show how much merging saves.
+    /// \param threads Workers to build with, 0 leaves one hardware thread for merging
+    /// \return An exit code, not 0 if there was nothing to build
+    int run_dag_benchmark(
+      const std::filesystem::path &world_folder,
+      std::int32_t                 radius,
+      std::uint32_t                threads = 0);
+}    // namespace vx3d::voxel
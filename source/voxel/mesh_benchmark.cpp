@@ -0,0 +1,82 @@
+#include "mesh_benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include <tsl/robin_map.h>
+
+#include <loader/world_loader.h>
+#include <voxel/mesher.h>
+
+namespace
+{
+    [[nodiscard]] double milliseconds_since(std::chrono::steady_clock::time_point start) noexcept
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}    // namespace
+
+int vx3d::voxel::run_mesh_benchmark(
+  const std::filesystem::path &world_folder,
+  std::int32_t                 radius,
+  std::uint32_t                threads)
+{
+    auto loader = world_loader();
+    loader.set_world(world_folder);
+
+    const auto locations = loader.chunks_in({ -radius, -radius }, { radius, radius });
+    if (locations.empty())
+    {
+        std::cerr << "No chunks within " << radius << " chunks of 0, 0 in " << world_folder << std::endl;
+        return 1;
+    }
+
+    const auto decode_start = std::chrono::steady_clock::now();
+    auto       chunks       = tsl::robin_map<std::uint64_t, std::shared_ptr<const loader::chunk>>();
+    auto       sections     = std::vector<glm::ivec3>();
+    for (const auto &location : locations)
+        if (auto chunk = loader.load_chunk(location.x, location.z))
+        {
+            for (const auto &section : chunk->sections) sections.emplace_back(chunk->x, section.y, chunk->z);
+            chunks[world_loader::hash_pos(chunk->x, chunk->z)] = std::move(chunk);
+        }
+    const auto decode_milliseconds = ::milliseconds_since(decode_start);
+
+    auto mesher = section_mesher(
+      [&](std::int32_t x, std::int32_t z) -> std::shared_ptr<const loader::chunk>
+      {
+          const auto at = chunks.find(world_loader::hash_pos(x, z));
+          return at != chunks.end() ? at->second : nullptr;
+      },
+      threads);
+
+    const auto mesh_start = std::chrono::steady_clock::now();
+    auto       stats      = mesh_stats();
+    const auto meshes     = mesher.mesh(sections, &stats);
+    const auto wall       = ::milliseconds_since(mesh_start);
+
+    auto times    = std::vector<double>();
+    auto vertices = std::size_t(0);
+    for (const auto &mesh : meshes)
+    {
+        times.push_back(mesh->milliseconds);
+        vertices += mesh->opaque.size() + mesh->translucent.size();
+    }
+    std::sort(times.begin(), times.end());
+
+    const auto count      = std::max<std::size_t>(sections.size(), 1);
+    const auto percentile = [&](double at)
+    { return times.empty() ? 0.0 : times[static_cast<std::size_t>(at * (times.size() - 1))]; };
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Decoded " << chunks.size() << " chunks in " << decode_milliseconds << " ms\n";
+    std::cout << "Meshed " << stats.sections << " sections in " << wall << " ms\n";
+    std::cout << "Quads: " << stats.quads << ", " << static_cast<double>(stats.quads) / count
+              << " per section, " << vertices * sizeof(packed_vertex) / 1024 << " KiB of vertices\n";
+    std::cout << "Milliseconds per section: " << stats.milliseconds / count << " mean, " << percentile(0.5)
+              << " median, " << percentile(0.95) << " 95th percentile, " << percentile(1.0) << " max"
+              << std::endl;
+    return 0;
+}
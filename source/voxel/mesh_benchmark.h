@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+namespace vx3d::voxel
+{
+    /// Meshes every section of the chunks within `radius` chunks of 0, 0 and prints how many
+    /// quads and milliseconds a section takes. Chunks are decoded up front, so only meshing is
+    /// timed.
+    /// \param threads Workers to mesh with, 0 leaves one hardware thread free
+    /// \return An exit code, not 0 if there was nothing to mesh
+    int run_mesh_benchmark(
+      const std::filesystem::path &world_folder,
+      std::int32_t                 radius,
+      std::uint32_t                threads = 0);
+}    // namespace vx3d::voxel
@@ -0,0 +1,369 @@
+#include "mesher.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <tracy/Tracy.hpp>
+
+#include <loader/biomes.h>
+#include <loader/world_loader.h>
+
+namespace
+{
+    // A section with a layer of blocks from the sections around it on every side
+    constexpr auto padded_width = 18;
+    constexpr auto padded_size  = padded_width * padded_width * padded_width;
+
+    // Chunks decoded together by a single task
+    constexpr auto decode_batch = 16;
+
+    // Mask entries of faces of water, which go in with the translucent quads
+    constexpr auto translucent_bit = std::uint32_t(1) << 30;
+
+    // Where nothing is in the way of a corner
+    constexpr auto unoccluded = std::uint32_t(0xFF);
+
+    struct padded_section
+    {
+        // (y * 18 + z) * 18 + x, offset by 1 so the section itself goes from 1 to 16
+        std::array<vx3d::loader::block_id, padded_size> blocks {};
+        std::array<bool, padded_size>                   opaque {};
+    };
+
+    // 28 bits of chunk x and z are enough for any world, sections fit in 8
+    [[nodiscard]] std::uint64_t section_key(const glm::ivec3 &section) noexcept
+    {
+        return (static_cast<std::uint64_t>(section.x) & 0xFFFFFFF) << 36 |
+          (static_cast<std::uint64_t>(section.z) & 0xFFFFFFF) << 8 |
+          (static_cast<std::uint64_t>(section.y) & 0xFF);
+    }
+
+    [[nodiscard]] glm::ivec3 section_of(std::uint64_t key) noexcept
+    {
+        // Shifting the top bits up and back down again sign extends them
+        const auto x = static_cast<std::int32_t>(static_cast<std::uint32_t>(key >> 36) << 4) >> 4;
+        const auto z = static_cast<std::int32_t>(static_cast<std::uint32_t>(key >> 8) << 4) >> 4;
+        return { x, static_cast<std::int8_t>(key & 0xFF), z };
+    }
+
+    [[nodiscard]] constexpr int padded_index(int x, int y, int z) noexcept
+    {
+        return ((y + 1) * ::padded_width + z + 1) * ::padded_width + x + 1;
+    }
+
+    // Hides whatever is behind it, plants, water and air don't
+    [[nodiscard]] bool is_opaque(vx3d::loader::block_id id) noexcept
+    {
+        using namespace vx3d::loader;
+        return !(block_registry::info(id).flags &
+                 (block_flag_air | block_flag_water | block_flag_aquatic | block_flag_passable));
+    }
+
+    void gather(const vx3d::voxel::chunk_neighbourhood &around, std::int32_t section_y, padded_section &out)
+    {
+        using vx3d::loader::block_registry;
+
+        // The 27 sections the padding comes from, (y * 3 + z) * 3 + x
+        auto sections = std::array<const vx3d::loader::chunk_section *, 27>();
+        for (auto y = 0; y < 3; y++)
+            for (auto chunk = 0; chunk < 9; chunk++)
+                sections[y * 9 + chunk] =
+                  around[chunk] ? around[chunk]->section(section_y + y - 1) : nullptr;
+
+        for (auto y = -1; y <= 16; y++)
+            for (auto z = -1; z <= 16; z++)
+                for (auto x = -1; x <= 16; x++)
+                {
+                    const auto from = (((y >> 4) + 1) * 3 + (z >> 4) + 1) * 3 + (x >> 4) + 1;
+                    const auto id   = sections[from] ? sections[from]->at(x & 15, y & 15, z & 15)
+                                                     : block_registry::air;
+
+                    const auto index  = ::padded_index(x, y, z);
+                    out.blocks[index] = block_registry::info(id).is_air() ? block_registry::air : id;
+                    out.opaque[index] = ::is_opaque(id);
+                }
+    }
+
+    // Ambient occlusion of the corner of a face, from the blocks in front of the face that touch it
+    [[nodiscard]] std::uint32_t occlusion(bool side, bool other_side, bool corner) noexcept
+    {
+        if (side && other_side) return 0;
+        return 3 - side - other_side - corner;
+    }
+}    // namespace
+
+vx3d::voxel::section_mesh
+  vx3d::voxel::mesh_section(const chunk_neighbourhood &around, std::int32_t section_y)
+{
+    ZoneScopedN("Mesher::mesh_section");
+    const auto start = std::chrono::steady_clock::now();
+
+    auto mesh    = section_mesh();
+    mesh.section = { around[4] ? around[4]->x : 0, section_y, around[4] ? around[4]->z : 0 };
+
+    const auto *section = around[4] ? around[4]->section(section_y) : nullptr;
+    if (!section) return mesh;
+
+    auto blocks = std::make_unique<padded_section>();
+    ::gather(around, section_y, *blocks);
+
+    const auto &biomes = around[4]->biomes;
+    auto        mask   = std::array<std::uint32_t, 256>();
+
+    // Every face direction a slice at a time, the slice is the plane of u and v
+    for (auto axis = 0; axis < 3; axis++)
+    {
+        const auto u = (axis + 1) % 3;
+        const auto v = (axis + 2) % 3;
+        for (auto side = 0; side < 2; side++)
+        {
+            const auto face   = static_cast<block_face>(axis * 2 + side);
+            auto       normal = glm::ivec3();
+            normal[axis]      = side ? 1 : -1;
+
+            auto step_u = glm::ivec3();
+            auto step_v = glm::ivec3();
+            step_u[u]   = 1;
+            step_v[v]   = 1;
+
+            for (auto layer = 0; layer < 16; layer++)
+            {
+                // Which faces of the slice show, with everything that has to match to merge them
+                for (auto b = 0; b < 16; b++)
+                    for (auto a = 0; a < 16; a++)
+                    {
+                        auto cell  = glm::ivec3();
+                        cell[axis] = layer;
+                        cell[u]    = a;
+                        cell[v]    = b;
+
+                        auto &entry = mask[b * 16 + a];
+                        entry       = 0;
+
+                        const auto id = blocks->blocks[::padded_index(cell.x, cell.y, cell.z)];
+                        if (id == loader::block_registry::air) continue;
+
+                        const auto front = cell + normal;
+                        const auto index = ::padded_index(front.x, front.y, front.z);
+                        const auto other = blocks->blocks[index];
+                        if (blocks->opaque[index] || other == id) continue;
+
+                        // Seagrass and kelp are underwater, there's no surface between them and water
+                        const auto &info  = loader::block_registry::info(id);
+                        const auto  water = info.is_water();
+                        if (water && loader::block_registry::info(other).is_water()) continue;
+                        const auto  biome = info.tint != loader::tint_type::none
+                          ? biomes.at(cell.x, section_y * 16 + cell.y, cell.z)
+                          : loader::biomes::plains;
+
+                        // Corners counter clockwise from (-u, -v) in the plane of u and v
+                        auto corners = ::unoccluded;
+                        if (!water)
+                        {
+                            const auto solid = [&](const glm::ivec3 &at)
+                            { return blocks->opaque[::padded_index(at.x, at.y, at.z)]; };
+
+                            const auto below = solid(front - step_v);
+                            const auto above = solid(front + step_v);
+                            const auto left  = solid(front - step_u);
+                            const auto right = solid(front + step_u);
+                            corners          = ::occlusion(left, below, solid(front - step_u - step_v)) |
+                              ::occlusion(right, below, solid(front + step_u - step_v)) << 2 |
+                              ::occlusion(right, above, solid(front + step_u + step_v)) << 4 |
+                              ::occlusion(left, above, solid(front - step_u + step_v)) << 6;
+                        }
+
+                        entry = id | static_cast<std::uint32_t>(biome) << 14 | corners << 22 |
+                          (water ? ::translucent_bit : 0);
+                    }
+
+                // Grows every face along u as far as it can, then the whole row along v
+                for (auto b = 0; b < 16; b++)
+                    for (auto a = 0; a < 16;)
+                    {
+                        const auto entry = mask[b * 16 + a];
+                        if (!entry)
+                        {
+                            a++;
+                            continue;
+                        }
+
+                        auto width = 1;
+                        while (a + width < 16 && mask[b * 16 + a + width] == entry) width++;
+
+                        auto height = 1;
+                        for (; b + height < 16; height++)
+                        {
+                            const auto *row = &mask[(b + height) * 16 + a];
+                            if (std::any_of(row, row + width, [&](auto other) { return other != entry; }))
+                                break;
+                        }
+
+                        for (auto row = b; row < b + height; row++)
+                            std::fill_n(&mask[row * 16 + a], width, 0);
+
+                        auto origin  = glm::ivec3();
+                        origin[axis] = layer + side;
+                        origin[u]    = a;
+                        origin[v]    = b;
+
+                        auto corners = std::array<glm::ivec3, 4>({
+                          origin,
+                          origin + step_u * width,
+                          origin + step_u * width + step_v * height,
+                          origin + step_v * height,
+                        });
+                        auto occlusion = std::array<std::uint32_t, 4>();
+                        for (auto corner = 0; corner < 4; corner++)
+                            occlusion[corner] = (entry >> (22 + corner * 2)) & 3;
+
+                        // Negative faces wind the other way to stay counter clockwise from outside
+                        if (!side)
+                        {
+                            std::swap(corners[1], corners[3]);
+                            std::swap(occlusion[1], occlusion[3]);
+                        }
+
+                        // Split along the diagonal that keeps the occlusion from showing the seam
+                        const auto first = occlusion[0] + occlusion[2] > occlusion[1] + occlusion[3] ? 1 : 0;
+
+                        auto &     into  = entry & ::translucent_bit ? mesh.translucent : mesh.opaque;
+                        const auto id    = static_cast<loader::block_id>(entry & 0x3FFF);
+                        const auto biome = static_cast<loader::biome_id>((entry >> 14) & 0xFF);
+                        for (auto corner = 0; corner < 4; corner++)
+                        {
+                            const auto at = (first + corner) & 3;
+                            into.push_back(pack_vertex(corners[at], face, occlusion[at], id, biome));
+                        }
+
+                        a += width;
+                    }
+            }
+        }
+    }
+
+    mesh.milliseconds =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return mesh;
+}
+
+vx3d::voxel::section_mesher::section_mesher(chunk_source source, std::uint32_t threads)
+    : _source(std::move(source)), _thread_pool(vx3d::default_worker_count(threads))
+{
+}
+
+std::vector<std::shared_ptr<const vx3d::voxel::section_mesh>>
+  vx3d::voxel::section_mesher::mesh(const std::vector<glm::ivec3> &sections, mesh_stats *stats)
+{
+    ZoneScopedN("SectionMesher::mesh");
+    const auto changes = _changes.load();
+
+    auto result  = std::vector<std::shared_ptr<const section_mesh>>(sections.size());
+    auto missing = tsl::robin_map<std::uint64_t, std::vector<std::size_t>>();    // By chunk
+    {
+        auto guard = std::lock_guard(_mutex);
+        for (auto i = std::size_t(0); i < sections.size(); i++)
+        {
+            const auto found = _meshes.find(::section_key(sections[i]));
+            if (found != _meshes.end())
+                result[i] = found->second;
+            else
+                missing[world_loader::hash_pos(sections[i].x, sections[i].z)].push_back(i);
+        }
+    }
+    if (missing.empty()) return result;
+
+    // Every chunk around the missing sections, decoded once and shared
+    auto chunk_index = tsl::robin_map<std::uint64_t, std::size_t>();
+    auto chunks      = std::vector<glm::ivec2>();
+    for (const auto &[chunk_key, indices] : missing)
+    {
+        const auto &section = sections[indices.front()];
+        for (auto z = section.z - 1; z <= section.z + 1; z++)
+            for (auto x = section.x - 1; x <= section.x + 1; x++)
+                if (chunk_index.emplace(world_loader::hash_pos(x, z), chunks.size()).second)
+                    chunks.emplace_back(x, z);
+    }
+
+    auto decoded = std::vector<std::shared_ptr<const loader::chunk>>(chunks.size());
+    auto decode  = std::vector<std::function<void()>>();
+    for (auto first = std::size_t(0); first < chunks.size(); first += ::decode_batch)
+        decode.emplace_back(
+          [&, first]
+          {
+              ZoneScopedN("SectionMesher::decode");
+              const auto last = std::min(first + ::decode_batch, chunks.size());
+              for (auto i = first; i < last; i++) decoded[i] = _source(chunks[i].x, chunks[i].y);
+          });
+    _thread_pool.run_tasks(decode);
+
+    auto made = std::vector<std::shared_ptr<section_mesh>>(sections.size());
+    auto work = std::vector<std::function<void()>>();
+    for (const auto &[chunk_key, indices] : missing)
+        work.emplace_back(
+          [&, indices = &indices]
+          {
+              const auto &first  = sections[indices->front()];
+              auto        around = chunk_neighbourhood();
+              for (auto z = 0; z < 3; z++)
+                  for (auto x = 0; x < 3; x++)
+                  {
+                      const auto key    = world_loader::hash_pos(first.x + x - 1, first.z + z - 1);
+                      around[z * 3 + x] = decoded[chunk_index.at(key)].get();
+                  }
+
+              for (const auto i : *indices)
+              {
+                  made[i]          = std::make_shared<section_mesh>(mesh_section(around, sections[i].y));
+                  made[i]->section = sections[i];
+              }
+          });
+    _thread_pool.run_tasks(work);
+
+    auto guard = std::lock_guard(_mutex);
+    for (auto i = std::size_t(0); i < sections.size(); i++)
+    {
+        if (!made[i]) continue;
+        if (stats)
+        {
+            stats->sections++;
+            stats->quads += made[i]->quads();
+            stats->milliseconds += made[i]->milliseconds;
+        }
+
+        // Something changed while meshing, the mesh might already be out of date
+        if (_changes.load() == changes) _meshes[::section_key(sections[i])] = made[i];
+        result[i] = std::move(made[i]);
+    }
+    return result;
+}
+
+void vx3d::voxel::section_mesher::invalidate_section(const glm::ivec3 &section)
+{
+    auto guard = std::lock_guard(_mutex);
+    _changes++;
+    for (auto y = -1; y <= 1; y++)
+        for (auto z = -1; z <= 1; z++)
+            for (auto x = -1; x <= 1; x++) _meshes.erase(::section_key(section + glm::ivec3(x, y, z)));
+}
+
+void vx3d::voxel::section_mesher::invalidate_chunk(std::int32_t x, std::int32_t z)
+{
+    auto guard = std::lock_guard(_mutex);
+    _changes++;
+    for (auto at = _meshes.begin(); at != _meshes.end();)
+    {
+        const auto section = ::section_of(at->first);
+        if (std::abs(section.x - x) <= 1 && std::abs(section.z - z) <= 1)
+            at = _meshes.erase(at);
+        else
+            ++at;
+    }
+}
+
+void vx3d::voxel::section_mesher::clear()
+{
+    auto guard = std::lock_guard(_mutex);
+    _changes++;
+    _meshes.clear();
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <tsl/robin_map.h>
+
+#include <thread_pool.h>
+#include <loader/chunk.h>
+
+namespace vx3d::voxel
+{
+    // Faces of a block, the axis times two and 1 for the positive side
+    enum class block_face : std::uint8_t
+    {
+        west,     // -x
+        east,     // +x
+        down,     // -y
+        up,       // +y
+        north,    // -z
+        south     // +z
+    };
+
+    // 8 bytes a vertex. Positions are within the section, 0 to 16 on every axis, and textures
+    // tile with them. Ambient occlusion goes from 0, a corner between two solid blocks, to 3.
+    struct packed_vertex
+    {
+        // x, y and z 5 bits each from bit 0, then the face 3 bits and ambient occlusion 2 bits
+        std::uint32_t position = 0;
+
+        // Block id 14 bits, then the biome 8 bits, plains for blocks without a tint
+        std::uint32_t block = 0;
+    };
+    static_assert(sizeof(packed_vertex) == 8);
+
+    [[nodiscard]] constexpr packed_vertex pack_vertex(
+      const glm::ivec3 &position,
+      block_face        face,
+      std::uint32_t     occlusion,
+      loader::block_id  block,
+      loader::biome_id  biome) noexcept
+    {
+        return {
+          static_cast<std::uint32_t>(position.x | position.y << 5 | position.z << 10) |
+            static_cast<std::uint32_t>(face) << 15 | occlusion << 18,
+          static_cast<std::uint32_t>(block & 0x3FFF) | static_cast<std::uint32_t>(biome) << 14,
+        };
+    }
+
+    // Quads of a section, 4 vertices each to be drawn as the triangles 0 1 2 and 0 2 3, which
+    // are counter clockwise seen from outside the block
+    struct section_mesh
+    {
+        glm::ivec3 section {};    // Chunk x, section y and chunk z
+
+        std::vector<packed_vertex> opaque;
+        std::vector<packed_vertex> translucent;    // Water, drawn after everything opaque
+
+        double milliseconds = 0.0;    // Spent meshing it
+
+        [[nodiscard]] std::size_t quads() const noexcept
+        {
+            return (opaque.size() + translucent.size()) / 4;
+        }
+
+        [[nodiscard]] bool empty() const noexcept { return opaque.empty() && translucent.empty(); }
+    };
+
+    // A chunk and the 8 around it, z * 3 + x with the chunk itself at 4, nullptr where there's none
+    using chunk_neighbourhood = std::array<const loader::chunk *, 9>;
+
+    /// Meshes a section with faces between identical neighbours merged into larger quads. Faces
+    /// against opaque blocks are left out, including those of the sections around it. Missing
+    /// neighbours count as air, so the edge of what's loaded is closed off.
+    [[nodiscard]] section_mesh mesh_section(const chunk_neighbourhood &around, std::int32_t section_y);
+
+    struct mesh_stats
+    {
+        std::uint32_t sections     = 0;    // Meshed, cached ones aren't counted
+        std::size_t   quads        = 0;
+        double        milliseconds = 0.0;    // Summed over every section, not the wall time
+    };
+
+    // Meshes sections on a pool of worker threads and keeps every mesh until the section it was
+    // made from, or one next to it, changes.
+    class section_mesher
+    {
+    public:
+        using chunk_source =
+          std::function<std::shared_ptr<const loader::chunk>(std::int32_t x, std::int32_t z)>;
+
+        /// \param source Must be safe to call from any thread, see `world_loader::load_chunk`
+        /// \param threads Workers to mesh with, 0 leaves one hardware thread for the caller
+        explicit section_mesher(chunk_source source, std::uint32_t threads = 0);
+
+        /// Meshes the sections that aren't cached and waits for them
+        /// \param sections Chunk x, section y and chunk z
+        /// \return A mesh for every section, in the same order, empty for sections of air
+        [[nodiscard]] std::vector<std::shared_ptr<const section_mesh>>
+          mesh(const std::vector<glm::ivec3> &sections, mesh_stats *stats = nullptr);
+
+        /// Drops the meshes of a section and of every section around it
+        void invalidate_section(const glm::ivec3 &section);
+
+        /// Drops the meshes of every section of a chunk and of the chunks around it
+        void invalidate_chunk(std::int32_t x, std::int32_t z);
+
+        void clear();
+
+    private:
+        chunk_source _source;
+
+        std::mutex                                                         _mutex;
+        tsl::robin_map<std::uint64_t, std::shared_ptr<const section_mesh>> _meshes;
+
+        // Counts invalidations, meshes made while one happened aren't cached
+        std::atomic<std::uint64_t> _changes = 0;
+
+        // Last, so the workers are joined before anything they use goes away
+        vx3d::thread_pool _thread_pool;
+    };
+}    // namespace vx3d::voxel
@@ -0,0 +1,474 @@
+#include "ray_caster.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+
+#include <tracy/Tracy.hpp>
+
+#include <loader/biomes.h>
+#include <map/biome_tint.h>
+#include <map/block_colors.h>
+#include <map/tile_ops.h>
+#include <util/simd.h>
+
+namespace
+{
+    // Rays traced together, the packet covers packet_columns by packet_rows pixels
+#if defined(VX3D_SIMD_AVX2)
+    constexpr auto packet_width   = 8;
+    constexpr auto packet_columns = 4;
+#elif defined(VX3D_SIMD_SSE2)
+    constexpr auto packet_width   = 4;
+    constexpr auto packet_columns = 2;
+#else
+    constexpr auto packet_width   = 1;
+    constexpr auto packet_columns = 1;
+#endif
+    constexpr auto packet_rows = packet_width / packet_columns;
+
+    // Pixels a task renders, square
+    constexpr auto tile_size = 16;
+
+    // Nothing in the world is further away than this
+    constexpr auto far_away = 1.0e30f;
+
+    // Direction components closer to 0 than this are pushed out to it, so the inverse and every
+    // slab distance stay finite
+    constexpr auto min_component = 1.0e-12f;
+
+    // Sky blue, rgba is stored with red in the low byte
+    constexpr vx3d::map::rgba sky = 0xFFEBCE87;
+
+    // Light from above, east and west a little darker, north and south more and bottoms the most
+    constexpr auto face_shade   = std::array<std::uint8_t, 3>({ 204, 255, 166 });
+    constexpr auto bottom_shade = std::uint8_t(128);
+
+    // Levels a DAG can have with a 32 bit origin, and every level pushes at most 8 children
+    constexpr auto max_levels = 32;
+
+    struct alignas(32) packet
+    {
+        // Struct of arrays, relative to the lowest corner of the DAG
+        std::array<float, packet_width> origin_x {};
+        std::array<float, packet_width> origin_y {};
+        std::array<float, packet_width> origin_z {};
+        std::array<float, packet_width> inverse_x {};
+        std::array<float, packet_width> inverse_y {};
+        std::array<float, packet_width> inverse_z {};
+        std::array<float, packet_width> far {};
+
+        std::array<glm::vec3, packet_width>            direction {};
+        std::array<vx3d::voxel::ray_hit, packet_width> hits {};
+    };
+
+    struct stack_entry
+    {
+        std::uint32_t node  = 0;
+        std::uint8_t  level = 0;
+        std::uint32_t lanes = 0;    // That hit the parent
+        glm::ivec3    low {};
+    };
+
+    [[nodiscard]] constexpr std::uint32_t popcount(std::uint32_t mask) noexcept
+    {
+        auto count = std::uint32_t(0);
+        for (; mask; mask &= mask - 1) count++;
+        return count;
+    }
+
+    [[nodiscard]] float away_from_zero(float component) noexcept
+    {
+        return std::abs(component) < ::min_component ? std::copysign(::min_component, component)
+                                                     : component;
+    }
+
+    void set_ray(packet &rays, int lane, const glm::vec3 &origin, const glm::vec3 &direction) noexcept
+    {
+        const auto safe = glm::vec3(
+          ::away_from_zero(direction.x),
+          ::away_from_zero(direction.y),
+          ::away_from_zero(direction.z));
+
+        rays.origin_x[lane]  = origin.x;
+        rays.origin_y[lane]  = origin.y;
+        rays.origin_z[lane]  = origin.z;
+        rays.inverse_x[lane] = 1.0f / safe.x;
+        rays.inverse_y[lane] = 1.0f / safe.y;
+        rays.inverse_z[lane] = 1.0f / safe.z;
+        rays.far[lane]       = ::far_away;
+        rays.direction[lane] = safe;
+        rays.hits[lane]      = vx3d::voxel::ray_hit();
+    }
+
+    // Slab test of every lane of `lanes` against a cube. A ray starting on a face of the cube and
+    // going away from it leaves right away and doesn't count, the block it starts in is the one
+    // `floor` puts it in.
+    // \param near Where every lane enters the cube, never behind the origin
+    // \return Lanes that enter the cube before their far distance
+    [[nodiscard]] std::uint32_t intersect(
+      const packet &                    rays,
+      const glm::vec3 &                 low,
+      float                             size,
+      std::uint32_t                     lanes,
+      std::array<float, packet_width> &near) noexcept
+    {
+#if defined(VX3D_SIMD_AVX2)
+        const auto slab = [&](const std::array<float, packet_width> &origin,
+                              const std::array<float, packet_width> &inverse,
+                              float                                  from,
+                              __m256 &                               enter,
+                              __m256 &                               exit)
+        {
+            const auto o  = _mm256_load_ps(origin.data());
+            const auto i  = _mm256_load_ps(inverse.data());
+            const auto t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(from), o), i);
+            const auto t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(from + size), o), i);
+            enter         = _mm256_max_ps(enter, _mm256_min_ps(t0, t1));
+            exit          = _mm256_min_ps(exit, _mm256_max_ps(t0, t1));
+        };
+
+        auto enter = _mm256_setzero_ps();
+        auto exit  = _mm256_load_ps(rays.far.data());
+        slab(rays.origin_x, rays.inverse_x, low.x, enter, exit);
+        slab(rays.origin_y, rays.inverse_y, low.y, enter, exit);
+        slab(rays.origin_z, rays.inverse_z, low.z, enter, exit);
+
+        _mm256_storeu_ps(near.data(), enter);
+        const auto inside = _mm256_and_ps(
+          _mm256_cmp_ps(enter, exit, _CMP_LE_OQ),
+          _mm256_cmp_ps(exit, _mm256_setzero_ps(), _CMP_GT_OQ));
+        return static_cast<std::uint32_t>(_mm256_movemask_ps(inside)) & lanes;
+#elif defined(VX3D_SIMD_SSE2)
+        const auto slab = [&](const std::array<float, packet_width> &origin,
+                              const std::array<float, packet_width> &inverse,
+                              float                                  from,
+                              __m128 &                               enter,
+                              __m128 &                               exit)
+        {
+            const auto o  = _mm_load_ps(origin.data());
+            const auto i  = _mm_load_ps(inverse.data());
+            const auto t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(from), o), i);
+            const auto t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(from + size), o), i);
+            enter         = _mm_max_ps(enter, _mm_min_ps(t0, t1));
+            exit          = _mm_min_ps(exit, _mm_max_ps(t0, t1));
+        };
+
+        auto enter = _mm_setzero_ps();
+        auto exit  = _mm_load_ps(rays.far.data());
+        slab(rays.origin_x, rays.inverse_x, low.x, enter, exit);
+        slab(rays.origin_y, rays.inverse_y, low.y, enter, exit);
+        slab(rays.origin_z, rays.inverse_z, low.z, enter, exit);
+
+        _mm_storeu_ps(near.data(), enter);
+        const auto inside = _mm_and_ps(_mm_cmple_ps(enter, exit), _mm_cmpgt_ps(exit, _mm_setzero_ps()));
+        return static_cast<std::uint32_t>(_mm_movemask_ps(inside)) & lanes;
+#else
+        auto hit = std::uint32_t(0);
+        for (auto lane = 0; lane < packet_width; lane++)
+        {
+            if (!(lanes & (1 << lane))) continue;
+
+            auto       enter = 0.0f;
+            auto       exit  = rays.far[lane];
+            const auto slab  = [&](float origin, float inverse, float from)
+            {
+                const auto t0 = (from - origin) * inverse;
+                const auto t1 = (from + size - origin) * inverse;
+                enter         = std::max(enter, std::min(t0, t1));
+                exit          = std::min(exit, std::max(t0, t1));
+            };
+            slab(rays.origin_x[lane], rays.inverse_x[lane], low.x);
+            slab(rays.origin_y[lane], rays.inverse_y[lane], low.y);
+            slab(rays.origin_z[lane], rays.inverse_z[lane], low.z);
+
+            near[lane] = enter;
+            if (enter <= exit && exit > 0.0f) hit |= 1 << lane;
+        }
+        return hit;
+#endif
+    }
+
+    // Steps a single ray through the blocks of a brick from where it enters
+    // \return Whether it hit something, which is then in the ray's hit
+    [[nodiscard]] bool march(
+      const vx3d::voxel::brick &brick, const glm::ivec3 &low, packet &rays, int lane, float near) noexcept
+    {
+        const auto origin = glm::vec3(rays.origin_x[lane], rays.origin_y[lane], rays.origin_z[lane]);
+        const auto inverse =
+          glm::vec3(rays.inverse_x[lane], rays.inverse_y[lane], rays.inverse_z[lane]);
+        const auto &direction = rays.direction[lane];
+
+        auto cell     = glm::ivec3();
+        auto step     = glm::ivec3();
+        auto next     = glm::vec3();
+        auto delta    = glm::vec3();
+        auto face     = std::uint8_t(1);
+        auto entering = -::far_away;
+        for (auto axis = 0; axis < 3; axis++)
+        {
+            const auto from   = static_cast<float>(low[axis]);
+            const auto inside = origin[axis] + direction[axis] * near - from;
+            cell[axis]        = std::clamp(
+              static_cast<int>(std::floor(inside)), 0, vx3d::voxel::brick_width - 1);
+            step[axis]        = direction[axis] > 0.0f ? 1 : -1;
+            next[axis]        = (from + cell[axis] + (step[axis] > 0) - origin[axis]) * inverse[axis];
+            delta[axis]       = std::abs(inverse[axis]);
+
+            // The face the ray came in through is the slab it entered last. A ray starting on an
+            // edge enters two at once, it came in through the one it moves across the most.
+            const auto side = (from + (step[axis] > 0 ? 0 : vx3d::voxel::brick_width) - origin[axis]) *
+              inverse[axis];
+            if (
+              side > entering ||
+              (side == entering && std::abs(direction[axis]) > std::abs(direction[face])))
+            {
+                entering = side;
+                face     = static_cast<std::uint8_t>(axis);
+            }
+        }
+
+        auto distance = near;
+        for (;;)
+        {
+            const auto block = brick[(cell.y * 4 + cell.z) * 4 + cell.x];
+            if (block != vx3d::loader::block_registry::air)
+            {
+                rays.hits[lane] = { distance, block, face };
+                rays.far[lane]  = distance;
+                return true;
+            }
+
+            const auto axis = next.x < next.y ? (next.x < next.z ? 0 : 2) : (next.y < next.z ? 1 : 2);
+            distance        = next[axis];
+            cell[axis] += step[axis];
+            if (cell[axis] < 0 || cell[axis] >= vx3d::voxel::brick_width) return false;
+            next[axis] += delta[axis];
+            face = static_cast<std::uint8_t>(axis);
+        }
+    }
+
+    // Takes lanes that all point into the same octant through the DAG front to back. Children
+    // go in the order of their index flipped by the signs of the direction, a ray can only go
+    // from a child to one with a higher flipped index, so every ray meets its nearest block first.
+    void traverse(
+      const vx3d::voxel::dag &world, packet &rays, std::uint32_t lanes, std::uint32_t flip) noexcept
+    {
+        auto stack = std::array<stack_entry, ::max_levels * 8>();
+        auto top   = 0;
+        stack[top++] = { world.root, world.level, lanes, glm::ivec3() };
+
+        auto near = std::array<float, packet_width>();
+        while (top && lanes)
+        {
+            const auto entry = stack[--top];
+            const auto size  = vx3d::voxel::brick_width << entry.level;
+            const auto hit   = ::intersect(
+              rays, glm::vec3(entry.low), static_cast<float>(size), entry.lanes & lanes, near);
+            if (!hit) continue;
+
+            if (entry.level == 0)
+            {
+                const auto &brick = world.bricks[entry.node];
+                for (auto lane = 0; lane < packet_width; lane++)
+                    if (hit & (1 << lane) && ::march(brick, entry.low, rays, lane, near[lane]))
+                        lanes &= ~(1 << lane);
+                continue;
+            }
+
+            // Pushed back to front, so the nearest child is popped first
+            const auto header = world.nodes[entry.node];
+            const auto half   = size / 2;
+            for (auto order = 7; order >= 0; order--)
+            {
+                const auto child = static_cast<std::uint32_t>(order) ^ flip;
+                if (!(header & (1 << child))) continue;
+
+                const auto offset = glm::ivec3(child & 1, (child >> 1) & 1, child >> 2) * half;
+                stack[top++]      = {
+                  world.nodes[entry.node + 1 + ::popcount(header & ((1 << child) - 1))],
+                  static_cast<std::uint8_t>(entry.level - 1),
+                  hit,
+                  entry.low + offset,
+                };
+            }
+        }
+    }
+
+    // Rays of a packet that point into different octants go through the DAG a group at a time
+    void trace(const vx3d::voxel::dag &world, packet &rays, std::uint32_t lanes) noexcept
+    {
+        if (world.root == vx3d::voxel::dag::empty) return;
+
+        auto flips = std::array<std::uint32_t, packet_width>();
+        for (auto lane = 0; lane < packet_width; lane++)
+        {
+            const auto &direction = rays.direction[lane];
+            flips[lane] = (direction.x < 0.0f) | (direction.y < 0.0f) << 1 | (direction.z < 0.0f) << 2;
+        }
+
+        for (auto lane = 0; lane < packet_width; lane++)
+        {
+            if (!(lanes & (1 << lane))) continue;
+
+            auto group = std::uint32_t(0);
+            for (auto other = lane; other < packet_width; other++)
+                if (lanes & (1 << other) && flips[other] == flips[lane]) group |= 1 << other;
+
+            ::traverse(world, rays, group, flips[lane]);
+            lanes &= ~group;
+        }
+    }
+
+    // The DAG doesn't keep biomes, everything is tinted as if it were in plains
+    [[nodiscard]] vx3d::map::rgba
+      color_of(const vx3d::voxel::ray_hit &hit, const glm::vec3 &direction) noexcept
+    {
+        using vx3d::loader::block_registry;
+        using vx3d::loader::tint_type;
+        if (hit.block == block_registry::air) return ::sky;
+
+        const auto &info  = block_registry::info(hit.block);
+        const auto &tints = vx3d::map::biome_tint_table::get();
+        auto        color = vx3d::map::block_color_table::get().color(hit.block);
+        if (info.is_water())
+            color = tints.color(tint_type::water, vx3d::loader::biomes::plains);
+        else if (info.tint != tint_type::none)
+            color = vx3d::map::multiply_rgb(color, tints.color(info.tint, vx3d::loader::biomes::plains));
+
+        // A ray stops at what it hits, so pixels are opaque even where the block isn't
+        color |= 0xFF000000;
+        if (hit.face == vx3d::voxel::ray_hit::no_face) return color;
+        if (hit.face == 1 && direction.y > 0.0f) return vx3d::map::shade_rgb(color, ::bottom_shade);
+        return vx3d::map::shade_rgb(color, ::face_shade[hit.face]);
+    }
+
+    struct view
+    {
+        glm::vec3 origin {};    // Relative to the lowest corner of the DAG
+        glm::vec3 forward {};
+        glm::vec3 right {};
+        glm::vec3 up {};
+        glm::vec2 extent {};    // Half the width and height of the image, on the image plane at 1
+        bool      orthographic = false;
+    };
+
+    [[nodiscard]] view to_view(
+      const vx3d::voxel::camera &camera,
+      const glm::ivec3 &         origin,
+      std::int32_t               width,
+      std::int32_t               height) noexcept
+    {
+        constexpr auto radians = 3.14159265f / 180.0f;
+        const auto     yaw     = camera.yaw * radians;
+        const auto     pitch   = std::clamp(camera.pitch, -89.9f, 89.9f) * radians;
+        const auto     aspect  = static_cast<float>(width) / static_cast<float>(height);
+
+        auto result         = view();
+        result.origin       = camera.position - glm::vec3(origin);
+        result.forward      = glm::vec3(
+          std::sin(yaw) * std::cos(pitch), std::sin(pitch), -std::cos(yaw) * std::cos(pitch));
+        result.right        = glm::vec3(std::cos(yaw), 0.0f, std::sin(yaw));
+        result.up           = glm::cross(result.right, result.forward);
+        result.orthographic = camera.orthographic;
+
+        const auto half = camera.orthographic ? camera.height / 2.0f : std::tan(camera.fov * radians / 2.0f);
+        result.extent   = glm::vec2(half * aspect, half);
+        return result;
+    }
+
+    void make_ray(const view &view, float x, float y, glm::vec3 &origin, glm::vec3 &direction) noexcept
+    {
+        const auto across = view.right * (x * view.extent.x) + view.up * (y * view.extent.y);
+        if (view.orthographic)
+        {
+            origin    = view.origin + across;
+            direction = view.forward;
+        }
+        else
+        {
+            origin    = view.origin;
+            direction = glm::normalize(view.forward + across);
+        }
+    }
+}    // namespace
+
+vx3d::voxel::ray_caster::ray_caster(const dag &world, std::uint32_t threads)
+    : _world(world), _thread_pool(vx3d::default_worker_count(threads))
+{
+}
+
+vx3d::voxel::frame
+  vx3d::voxel::ray_caster::render(const camera &camera, std::int32_t width, std::int32_t height)
+{
+    ZoneScopedN("RayCaster::render");
+
+    auto result   = frame();
+    result.width  = std::max(width, 0);
+    result.height = std::max(height, 0);
+    result.pixels.assign(static_cast<std::size_t>(result.width) * result.height, ::sky);
+    if (!result.width || !result.height) return result;
+
+    const auto view    = ::to_view(camera, _world.origin, result.width, result.height);
+    const auto columns = (result.width + ::tile_size - 1) / ::tile_size;
+    const auto rows    = (result.height + ::tile_size - 1) / ::tile_size;
+
+    auto tasks = std::vector<std::function<void()>>();
+    for (auto tile = 0; tile < columns * rows; tile++)
+        tasks.emplace_back(
+          [&, tile]
+          {
+              ZoneScopedN("RayCaster::tile");
+              const auto left   = tile % columns * ::tile_size;
+              const auto top    = tile / columns * ::tile_size;
+              const auto right  = std::min(left + ::tile_size, result.width);
+              const auto bottom = std::min(top + ::tile_size, result.height);
+
+              auto rays = packet();
+              for (auto y = top; y < bottom; y += ::packet_rows)
+                  for (auto x = left; x < right; x += ::packet_columns)
+                  {
+                      auto lanes = std::uint32_t(0);
+                      for (auto lane = 0; lane < ::packet_width; lane++)
+                      {
+                          const auto pixel_x = x + lane % ::packet_columns;
+                          const auto pixel_y = y + lane / ::packet_columns;
+
+                          auto origin    = glm::vec3();
+                          auto direction = glm::vec3();
+                          ::make_ray(
+                            view,
+                            (static_cast<float>(pixel_x) + 0.5f) / result.width * 2.0f - 1.0f,
+                            1.0f - (static_cast<float>(pixel_y) + 0.5f) / result.height * 2.0f,
+                            origin,
+                            direction);
+                          ::set_ray(rays, lane, origin, direction);
+                          if (pixel_x < right && pixel_y < bottom) lanes |= 1 << lane;
+                      }
+
+                      ::trace(_world, rays, lanes);
+                      for (auto lane = 0; lane < ::packet_width; lane++)
+                          if (lanes & (1 << lane))
+                          {
+                              const auto pixel_x = x + lane % ::packet_columns;
+                              const auto pixel_y = y + lane / ::packet_columns;
+                              result.pixels[static_cast<std::size_t>(pixel_y) * result.width + pixel_x] =
+                                ::color_of(rays.hits[lane], rays.direction[lane]);
+                          }
+                  }
+          });
+    _thread_pool.run_tasks(tasks);
+    return result;
+}
+
+vx3d::voxel::ray_hit
+  vx3d::voxel::ray_caster::cast(const glm::vec3 &origin, const glm::vec3 &direction) const noexcept
+{
+    auto rays = packet();
+    for (auto lane = 0; lane < ::packet_width; lane++)
+        ::set_ray(rays, lane, origin - glm::vec3(_world.origin), glm::normalize(direction));
+
+    ::trace(_world, rays, 1);
+    return rays.hits[0];
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <thread_pool.h>
+#include <loader/chunk.h>
+#include <map/tile_ops.h>
+#include <voxel/dag.h>
+
+namespace vx3d::voxel
+{
+    struct camera
+    {
+        glm::vec3 position {};
+        float     yaw   = 0.0f;    // Degrees clockwise from north, -z
+        float     pitch = 0.0f;    // Degrees up from level
+
+        bool  orthographic = false;
+        float fov          = 70.0f;     // Vertical, degrees, perspective only
+        float height       = 256.0f;    // Blocks from the bottom to the top, orthographic only
+    };
+
+    struct ray_hit
+    {
+        static constexpr std::uint8_t no_face = 0xFF;
+
+        float            distance = 0.0f;    // Along the unit direction of the ray
+        loader::block_id block    = loader::block_registry::air;
+        std::uint8_t     face     = no_face;    // Axis the ray entered the block through, 0 x, 1 y, 2 z
+    };
+
+    struct frame
+    {
+        std::int32_t           width  = 0;
+        std::int32_t           height = 0;
+        std::vector<map::rgba> pixels;    // Row major, top row first
+    };
+
+    // Renders 3D views of a DAG on the CPU, for screenshots without a GPU and as a reference to
+    // check GPU renders against. The image is split into square tiles that are rendered as tasks
+    // on a pool of worker threads, and rays go through the DAG in packets of 8 with AVX2 or 4 with
+    // SSE2. A packet descends into a node when any of its rays hits the node, front to back, and
+    // stops as soon as every one of its rays has hit something.
+    class ray_caster
+    {
+    public:
+        /// \param world Has to outlive the ray caster and not change while it renders
+        /// \param threads Workers to render with, 0 leaves one hardware thread for the caller
+        explicit ray_caster(const dag &world, std::uint32_t threads = 0);
+
+        /// Renders a frame and waits for it, rays that hit nothing show the sky
+        [[nodiscard]] frame render(const camera &camera, std::int32_t width, std::int32_t height);
+
+        /// Casts a single ray, for picking and for checking renders
+        /// \return A hit with air in it when the ray doesn't hit anything
+        [[nodiscard]] ray_hit cast(const glm::vec3 &origin, const glm::vec3 &direction) const noexcept;
+
+    private:
+        const dag &_world;
+
+        // Last, so the workers are joined before anything they use goes away
+        vx3d::thread_pool _thread_pool;
+    };
+}    // namespace vx3d::voxel
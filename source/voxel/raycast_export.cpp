@@ -0,0 +1,69 @@
+#include "raycast_export.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include <loader/world_loader.h>
+#include <util/png.h>
+#include <voxel/dag.h>
+
+namespace
+{
+    [[nodiscard]] double milliseconds_since(std::chrono::steady_clock::time_point start) noexcept
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}    // namespace
+
+int vx3d::voxel::run_raycast_export(
+  const std::filesystem::path &world_folder,
+  const std::filesystem::path &output,
+  const camera &               camera,
+  const raycast_options &      options)
+{
+    if (options.size.x <= 0 || options.size.y <= 0)
+    {
+        std::cerr << "The image has to be at least a pixel across" << std::endl;
+        return 1;
+    }
+
+    auto loader = world_loader();
+    loader.set_world(world_folder);
+
+    const auto centre = glm::ivec2(
+      static_cast<std::int32_t>(std::floor(camera.position.x / region_width)),
+      static_cast<std::int32_t>(std::floor(camera.position.z / region_width)));
+    const auto regions = loader.regions_in(centre - options.radius, centre + options.radius);
+    if (regions.empty())
+    {
+        std::cerr << "No regions within " << options.radius << " regions of the camera in " << world_folder
+                  << std::endl;
+        return 1;
+    }
+
+    const auto build_start = std::chrono::steady_clock::now();
+    auto       builder     = dag_builder(
+      [&loader](std::int32_t x, std::int32_t z) { return loader.load_chunk(x, z); },
+      options.threads);
+    const auto world = builder.build(regions);
+    std::cout << "Built " << regions.size() << " regions into " << world.bytes() / 1024 << " KiB in "
+              << ::milliseconds_since(build_start) << " ms" << std::endl;
+
+    const auto render_start = std::chrono::steady_clock::now();
+    auto       caster       = ray_caster(world, options.threads);
+    const auto rendered     = caster.render(camera, options.size.x, options.size.y);
+    std::cout << "Cast " << options.size.x << "x" << options.size.y << " in "
+              << ::milliseconds_since(render_start) << " ms" << std::endl;
+
+    if (!vx3d::png::write(
+          output,
+          static_cast<std::uint32_t>(rendered.width),
+          static_cast<std::uint32_t>(rendered.height),
+          reinterpret_cast<const std::uint8_t *>(rendered.pixels.data())))
+    {
+        std::cerr << "Couldn't write " << output << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+#include <glm/glm.hpp>
+
+#include <voxel/ray_caster.h>
+
+namespace vx3d::voxel
+{
+    struct raycast_options
+    {
+        glm::ivec2    size { 1920, 1080 };
+        std::int32_t  radius  = 1;    // Regions around the camera's to build the DAG of
+        std::uint32_t threads = 0;    // Workers to build and render with, 0 leaves one free
+    };
+
+    /// Builds the DAG of the regions around the camera, renders it with the ray caster and writes
+    /// the frame as a PNG. Nothing past the regions built is drawn, rays leaving them show the sky.
+    /// \return An exit code, not 0 if there's nothing to build or the image couldn't be written
+    int run_raycast_export(
+      const std::filesystem::path &world_folder,
+      const std::filesystem::path &output,
+      const camera &               camera,
+      const raycast_options &      options);
+}    // namespace vx3d::voxel
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <voxel/brickmap.h>
+
+#include "test.h"
+
+namespace
+{
+    using vx3d::loader::block_id;
+    using vx3d::loader::block_registry;
+    using vx3d::voxel::brickmap;
+
+    // Every brick of a chunk made by `make_chunk` needs a slot, 2x2 columns of two
+    constexpr auto chunk_bricks = 8u;
+
+    [[nodiscard]] block_id block(const std::string &name)
+    {
+        return block_registry::intern(name);
+    }
+
+    // A checkerboard in section 0, of a block that tells chunks apart
+    [[nodiscard]] std::shared_ptr<const vx3d::loader::chunk> make_chunk(std::int32_t x, std::int32_t z)
+    {
+        const auto kinds = std::array<block_id, 3>({ ::block("stone"), ::block("dirt"), ::block("sand") });
+        const auto solid = kinds[static_cast<std::size_t>(((x * 7 + z * 3) % 3 + 3) % 3)];
+
+        auto section = vx3d::loader::chunk_section();
+        for (auto i = 0; i < 4096; i++)
+            section.blocks[i] = (i + (i >> 4) + (i >> 8)) & 1 ? solid : block_registry::air;
+
+        auto chunk = std::make_shared<vx3d::loader::chunk>();
+        chunk->x   = x;
+        chunk->z   = z;
+        chunk->sections.push_back(section);
+        return chunk;
+    }
+
+    // Every block of the chunk's section reads back through the brick map
+    [[nodiscard]] bool resident(const brickmap &map, const vx3d::loader::chunk &chunk)
+    {
+        const auto &section = chunk.sections.front();
+        for (auto i = 0; i < 4096; i++)
+        {
+            const auto position =
+              glm::ivec3(chunk.x * 16 + (i & 15), i >> 8, chunk.z * 16 + ((i >> 4) & 15));
+            if (map.at(position) != section.blocks[i]) return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool unloaded(const brickmap &map, std::int32_t x, std::int32_t z)
+    {
+        for (auto i = 0; i < 4096; i++)
+            if (map.at({ x * 16 + (i & 15), i >> 8, z * 16 + ((i >> 4) & 15) }) != block_registry::air)
+                return false;
+        return true;
+    }
+
+    void build_brick_test()
+    {
+        using vx3d::voxel::build_brick;
+
+        const auto air = build_brick(nullptr, {});
+        VX3D_CHECK(air.uniform && air.block == block_registry::air);
+
+        // Every kind of air is air, so a brick of cave air is as empty as one of nothing
+        auto section = vx3d::loader::chunk_section();
+        section.blocks.fill(::block("cave_air"));
+        const auto cave = build_brick(&section, {});
+        VX3D_CHECK(cave.uniform && cave.block == block_registry::air);
+
+        section.blocks.fill(::block("stone"));
+        const auto stone = build_brick(&section, { 8, 0, 8 });
+        VX3D_CHECK(stone.uniform && stone.block == ::block("stone"));
+
+        // A few kinds fit the palette, every block comes back as it was
+        const auto kinds =
+          std::array<block_id, 3>({ ::block("stone"), ::block("dirt"), block_registry::air });
+        for (auto i = 0; i < 4096; i++) section.blocks[i] = kinds[static_cast<std::size_t>(i * 7 % 3)];
+        const auto palette = build_brick(&section, { 8, 8, 0 });
+        VX3D_CHECK(!palette.uniform && !palette.lossy);
+        auto matches = true;
+        for (auto y = 0; y < 8; y++)
+            for (auto z = 0; z < 8; z++)
+                for (auto x = 0; x < 8; x++)
+                    matches = matches && palette.brick.at(x, y, z) == section.at(x + 8, y + 8, z);
+        VX3D_CHECK(matches);
+
+        // 20 solid kinds and a few blocks of air, the rarest solid ones become the most common and
+        // air stays air even though it's rarer still
+        auto solids = std::vector<block_id>();
+        for (auto i = 0; i < 20; i++) solids.push_back(::block("test_block_" + std::to_string(i)));
+        for (auto i = 0; i < 4096; i++) section.blocks[i] = i % 3 ? solids[0] : solids[i % 20];
+        for (auto i = 1; i < 4; i++) section.blocks[(i << 8) | (i << 4) | i] = block_registry::air;
+        const auto lossy = build_brick(&section, {});
+        VX3D_CHECK(!lossy.uniform && lossy.lossy);
+
+        auto shape = true;
+        auto kept  = true;
+        for (auto y = 0; y < 8; y++)
+            for (auto z = 0; z < 8; z++)
+                for (auto x = 0; x < 8; x++)
+                {
+                    const auto was = section.at(x, y, z);
+                    const auto is  = lossy.brick.at(x, y, z);
+                    shape          = shape && (was == block_registry::air) == (is == block_registry::air);
+                    kept           = kept && (was != solids[0] || is == solids[0]);
+                }
+        VX3D_CHECK(shape);
+        VX3D_CHECK(kept);
+    }
+
+    void brick_pool_test()
+    {
+        auto pool  = vx3d::voxel::brick_pool(3);
+        auto brick = vx3d::voxel::palette_brick();
+        brick.indices[0] = 0x12345678;
+
+        // Lowest slot first
+        VX3D_CHECK(pool.allocate(brick) == 0u);
+        VX3D_CHECK(pool.allocate(brick) == 1u);
+        VX3D_CHECK(pool.allocate(brick) == 2u);
+        VX3D_CHECK(!pool.allocate(brick));
+        VX3D_CHECK(pool.used() == 3 && pool.available() == 0);
+        VX3D_CHECK(pool.at(2).indices[0] == 0x12345678);
+
+        pool.release(1);
+        VX3D_CHECK(pool.used() == 2 && pool.available() == 1);
+        brick.indices[0] = 42;
+        VX3D_CHECK(pool.allocate(brick) == 1u);
+        VX3D_CHECK(pool.at(1).indices[0] == 42);
+
+        // Slot 1 was written twice, it's uploaded once
+        VX3D_CHECK(pool.take_dirty() == std::vector<std::uint32_t>({ 0, 1, 2 }));
+        VX3D_CHECK(pool.take_dirty().empty());
+    }
+
+    void eviction_test()
+    {
+        // Room for the bricks of three chunks in a window of 5x5
+        auto map = brickmap(2, ::chunk_bricks * 3 * sizeof(vx3d::voxel::palette_brick));
+
+        const auto corner = ::make_chunk(2, 2);
+        const auto edge   = ::make_chunk(2, 0);
+        const auto near   = ::make_chunk(1, 0);
+        const auto centre = ::make_chunk(0, 0);
+        VX3D_CHECK(map.insert_chunk(2, 2, corner.get()));
+        VX3D_CHECK(map.insert_chunk(2, 0, edge.get()));
+        VX3D_CHECK(map.insert_chunk(1, 0, near.get()));
+        VX3D_CHECK(map.pool().available() == 0);
+
+        // Only the furthest chunk makes room for the nearer one
+        VX3D_CHECK(map.insert_chunk(0, 0, centre.get()));
+        VX3D_CHECK(::resident(map, *centre));
+        VX3D_CHECK(::unloaded(map, 2, 2));
+        VX3D_CHECK(::resident(map, *edge));
+        VX3D_CHECK(::resident(map, *near));
+        VX3D_CHECK(map.stats().evictions == 1);
+        VX3D_CHECK(map.stats().columns == 3);
+
+        // Nothing is further away than this one, it's rejected and not wanted again
+        const auto far = ::make_chunk(2, 1);
+        VX3D_CHECK(!map.insert_chunk(2, 1, far.get()));
+        VX3D_CHECK(::unloaded(map, 2, 1));
+        auto wanted = map.wanted(25);
+        VX3D_CHECK(std::find(wanted.begin(), wanted.end(), glm::ivec2(2, 1)) == wanted.end());
+        VX3D_CHECK(std::find(wanted.begin(), wanted.end(), glm::ivec2(2, 2)) != wanted.end());
+
+        // Nearest first
+        VX3D_CHECK(!wanted.empty() && wanted.front() != glm::ivec2(2, 2));
+
+        // Once the camera moves to another chunk it's worth another try
+        map.set_view({ 24.0f, 64.0f, 8.0f });
+        wanted = map.wanted(25);
+        VX3D_CHECK(std::find(wanted.begin(), wanted.end(), glm::ivec2(2, 1)) != wanted.end());
+
+        // Chunks outside of the window aren't taken
+        const auto outside = ::make_chunk(-2, 0);
+        VX3D_CHECK(!map.insert_chunk(-2, 0, outside.get()));
+    }
+
+    void wraparound_test()
+    {
+        // A 3x3 window with room for every chunk of it
+        auto map = brickmap(1, ::chunk_bricks * 9 * sizeof(vx3d::voxel::palette_brick));
+
+        const auto left  = ::make_chunk(-1, 0);
+        const auto right = ::make_chunk(1, 0);
+        VX3D_CHECK(map.insert_chunk(-1, 0, left.get()));
+        VX3D_CHECK(map.insert_chunk(1, 0, right.get()));
+
+        // Chunk 2 lands in the column chunk -1 had, which left the window
+        map.set_view({ 16.0f, 0.0f, 0.0f });
+        VX3D_CHECK(map.centre() == glm::ivec2(1, 0));
+        VX3D_CHECK(map.stats().columns == 1);
+        VX3D_CHECK(::unloaded(map, -1, 0));
+        VX3D_CHECK(::resident(map, *right));
+
+        const auto wrapped = ::make_chunk(2, 0);
+        VX3D_CHECK(map.insert_chunk(2, 0, wrapped.get()));
+        VX3D_CHECK(::resident(map, *wrapped));
+        VX3D_CHECK(::resident(map, *right));
+        VX3D_CHECK(::unloaded(map, -1, 0));
+
+        // Far out on the negative side, a block west and north of chunk 0, 0 moves the window
+        map.set_view({ -1.0f, 0.0f, -0.5f });
+        VX3D_CHECK(map.centre() == glm::ivec2(-1, -1));
+        map.set_view({ -80.5f, 0.0f, -100.0f });
+        VX3D_CHECK(map.centre() == glm::ivec2(-6, -7));
+        VX3D_CHECK(::unloaded(map, 2, 0));
+
+        auto inserted = std::vector<std::shared_ptr<const vx3d::loader::chunk>>();
+        for (const auto &chunk : map.wanted(9))
+        {
+            inserted.push_back(::make_chunk(chunk.x, chunk.y));
+            VX3D_CHECK(map.insert_chunk(chunk.x, chunk.y, inserted.back().get()));
+        }
+        VX3D_CHECK(inserted.size() == 9);
+        for (const auto &chunk : inserted) VX3D_CHECK(::resident(map, *chunk));
+        VX3D_CHECK(map.wanted(9).empty());
+    }
+}    // namespace
+
+int main()
+{
+    ::build_brick_test();
+    ::brick_pool_test();
+    ::eviction_test();
+    ::wraparound_test();
+    return vx3d::test::failures != 0;
+}
@@ -0,0 +1,255 @@
+#include <cstdint>
+#include <vector>
+
+#include <renderer/page_table.h>
+
+#include "test.h"
+
+namespace
+{
+    using vx3d::page_table;
+
+    // The two textures the renderer keeps, updated from what the table says changed and read the
+    // way `get_tile` in texture_display.comp reads them
+    class gpu_copy
+    {
+    public:
+        void upload(page_table &pages)
+        {
+            if (pages.take_table_dirty())
+            {
+                _table      = pages.table();
+                _table_size = pages.table_size();
+            }
+
+            // Made again at the new size, like the texture, what was in it has to come up again
+            const auto width = page_table::pool_pages_per_row * page_table::page_width;
+            const auto rows  = pages.capacity() / page_table::pool_pages_per_row;
+            if (_rows != rows)
+            {
+                _rows = rows;
+                _pool.assign(static_cast<std::size_t>(width) * rows * page_table::page_width, 0);
+            }
+
+            for (const auto page : pages.take_dirty_pages())
+            {
+                const auto at = corner(page);
+                for (auto z = 0; z < page_table::page_width; z++)
+                    for (auto x = 0; x < page_table::page_width; x++)
+                        _pool[static_cast<std::size_t>(at.y + z) * width + at.x + x] =
+                          pages.texels(page)[z * page_table::page_width + x];
+            }
+        }
+
+        [[nodiscard]] std::int32_t get_tile(std::int32_t x, std::int32_t z) const
+        {
+            const auto table = (glm::ivec2(x, z) >> page_table::page_shift) & (_table_size - 1);
+            const auto page  = _table[static_cast<std::size_t>(table.y) * _table_size + table.x];
+            if (page < 0) return page_table::no_chunk;
+
+            const auto texel = corner(page) + (glm::ivec2(x, z) & (page_table::page_width - 1));
+            return _pool
+              [static_cast<std::size_t>(texel.y) * page_table::pool_pages_per_row * page_table::page_width +
+               texel.x];
+        }
+
+    private:
+        [[nodiscard]] static glm::ivec2 corner(std::int32_t page)
+        {
+            return glm::ivec2(page % page_table::pool_pages_per_row, page / page_table::pool_pages_per_row) *
+              page_table::page_width;
+        }
+
+        std::vector<std::int32_t> _table;
+        std::int32_t              _table_size = 1;
+        std::vector<std::int32_t> _pool;
+        std::int32_t              _rows = 0;
+    };
+
+    // Some tiles are still rendering, some have no chunk
+    [[nodiscard]] std::int32_t slot_of(std::int32_t x, std::int32_t z)
+    {
+        if ((x * 7 + z * 13) % 5 == 0) return page_table::no_chunk;
+        return (x * 3 + z) % 4 == 0 ? -1 : (x * 31 + z * 17) & 0xFFFF;
+    }
+
+    void set_rect(page_table &pages, const glm::ivec2 &min, const glm::ivec2 &max)
+    {
+        pages.set_view(min, max);
+        for (auto x = min.x; x <= max.x; x++)
+            for (auto z = min.y; z <= max.y; z++)
+                if (::slot_of(x, z) != page_table::no_chunk) pages.set(x, z, ::slot_of(x, z));
+    }
+
+    // Every tile of the rect reads back through the table and the copy on the GPU
+    [[nodiscard]] bool matches(
+      const page_table &pages,
+      const gpu_copy &  gpu,
+      const glm::ivec2 &min,
+      const glm::ivec2 &max)
+    {
+        for (auto x = min.x; x <= max.x; x++)
+            for (auto z = min.y; z <= max.y; z++)
+                if (pages.at(x, z) != ::slot_of(x, z) || gpu.get_tile(x, z) != ::slot_of(x, z)) return false;
+        return true;
+    }
+
+    void erase_test()
+    {
+        auto pages = page_table();
+        auto gpu   = gpu_copy();
+
+        // Two pages across, the view moves right by a whole page
+        ::set_rect(pages, { 0, 0 }, { 63, 31 });
+        gpu.upload(pages);
+        VX3D_CHECK(pages.pages() == 2);
+        VX3D_CHECK(::matches(pages, gpu, { 0, 0 }, { 63, 31 }));
+
+        for (auto x = 0; x < 32; x++)
+            for (auto z = 0; z < 32; z++) pages.erase(x, z);
+        ::set_rect(pages, { 64, 0 }, { 95, 31 });
+        gpu.upload(pages);
+
+        // The page that went off screen is free again and reads as empty
+        VX3D_CHECK(pages.pages() == 2);
+        VX3D_CHECK(pages.at(5, 5) == page_table::no_chunk);
+        VX3D_CHECK(gpu.get_tile(5, 5) == page_table::no_chunk);
+        VX3D_CHECK(::matches(pages, gpu, { 32, 0 }, { 95, 31 }));
+
+        // Some of a page's tiles leave, the rest stay
+        for (auto x = 32; x < 40; x++)
+            for (auto z = 0; z < 32; z++) pages.erase(x, z);
+        gpu.upload(pages);
+        VX3D_CHECK(pages.pages() == 2);
+        VX3D_CHECK(::matches(pages, gpu, { 40, 0 }, { 95, 31 }));
+        auto erased = true;
+        for (auto x = 32; x < 40; x++)
+            for (auto z = 0; z < 32; z++)
+                erased = erased && pages.at(x, z) == page_table::no_chunk &&
+                  gpu.get_tile(x, z) == page_table::no_chunk;
+        VX3D_CHECK(erased);
+
+        // Tiles that were never set and tiles of pages without any are left alone
+        pages.erase(33, 0);
+        pages.erase(-500, 7);
+        VX3D_CHECK(pages.pages() == 2);
+
+        // A slot that changed goes up again
+        pages.set(50, 3, 12345);
+        gpu.upload(pages);
+        VX3D_CHECK(gpu.get_tile(50, 3) == 12345);
+        VX3D_CHECK(pages.take_dirty_pages().empty() && !pages.take_table_dirty());
+
+        pages.clear();
+        gpu.upload(pages);
+        VX3D_CHECK(pages.pages() == 0);
+        VX3D_CHECK(gpu.get_tile(50, 3) == page_table::no_chunk);
+    }
+
+    void no_chunk_test()
+    {
+        auto pages = page_table();
+        auto gpu   = gpu_copy();
+
+        // Nothing to show doesn't take a page
+        pages.set(-500, 7, page_table::no_chunk);
+        VX3D_CHECK(pages.pages() == 0);
+
+        // Setting the last tile of a page to nothing frees it like erasing it does
+        pages.set(3, 3, 5);
+        pages.set(4, 3, -1);
+        gpu.upload(pages);
+        VX3D_CHECK(pages.pages() == 1);
+        pages.set(3, 3, page_table::no_chunk);
+        pages.set(4, 3, page_table::no_chunk);
+        gpu.upload(pages);
+        VX3D_CHECK(pages.pages() == 0);
+        VX3D_CHECK(pages.at(3, 3) == page_table::no_chunk && gpu.get_tile(3, 3) == page_table::no_chunk);
+        VX3D_CHECK(pages.at(4, 3) == page_table::no_chunk && gpu.get_tile(4, 3) == page_table::no_chunk);
+    }
+
+    void grow_table_test()
+    {
+        auto pages = page_table();
+        auto gpu   = gpu_copy();
+        VX3D_CHECK(pages.table_size() == 16);
+
+        // Pages 0 and 16 land on the same entry of a table 16 across, it has to double
+        pages.set(0, 0, 1);
+        pages.set(16 * page_table::page_width, 0, 2);
+        gpu.upload(pages);
+        VX3D_CHECK(pages.table_size() == 32);
+        VX3D_CHECK(pages.at(0, 0) == 1 && gpu.get_tile(0, 0) == 1);
+        VX3D_CHECK(pages.at(512, 0) == 2 && gpu.get_tile(512, 0) == 2);
+
+        // On the other side of 0 as well, page -32 shares entry 0 with page 0 until the table is 64
+        pages.set(-32 * page_table::page_width, 0, 3);
+        gpu.upload(pages);
+        VX3D_CHECK(pages.table_size() == 64);
+        VX3D_CHECK(gpu.get_tile(-1024, 0) == 3 && gpu.get_tile(0, 0) == 1 && gpu.get_tile(512, 0) == 2);
+
+        // A view wider than the table makes room for all of it up front
+        pages.set_view({ 0, 0 }, { 100 * page_table::page_width, 0 });
+        VX3D_CHECK(pages.table_size() == 128);
+        VX3D_CHECK(pages.take_table_dirty());
+    }
+
+    void grow_pool_test()
+    {
+        auto pages = page_table();
+        auto gpu   = gpu_copy();
+        VX3D_CHECK(pages.capacity() == 64);
+
+        // A tile in each of 64 pages fills the pool
+        for (auto page = 0; page < 64; page++)
+            pages.set((page % 8) * page_table::page_width, (page / 8) * page_table::page_width, page);
+        gpu.upload(pages);
+        VX3D_CHECK(pages.capacity() == 64);
+
+        // The 65th doubles it, and the pages already in it have to go up again with the new one
+        pages.set(8 * page_table::page_width, 0, 64);
+        VX3D_CHECK(pages.capacity() == 128);
+        const auto dirty = pages.take_dirty_pages();
+        VX3D_CHECK(dirty.size() == 65);
+
+        auto expected = std::vector<std::int32_t>();
+        for (auto page = 0; page < 65; page++) expected.push_back(page);
+        VX3D_CHECK(dirty == expected);
+    }
+
+    void negative_test()
+    {
+        auto pages = page_table();
+        auto gpu   = gpu_copy();
+
+        // Across both axes, pages -2 to 1, with the view moving over it
+        ::set_rect(pages, { -70, -45 }, { 40, 20 });
+        gpu.upload(pages);
+        VX3D_CHECK(::matches(pages, gpu, { -70, -45 }, { 40, 20 }));
+
+        for (auto x = -70; x <= 40; x++)
+            for (auto z = -45; z < -20; z++) pages.erase(x, z);
+        ::set_rect(pages, { -70, 21 }, { 40, 44 });
+        gpu.upload(pages);
+        VX3D_CHECK(::matches(pages, gpu, { -70, -20 }, { 40, 44 }));
+        VX3D_CHECK(pages.at(-1, -21) == page_table::no_chunk);
+        VX3D_CHECK(gpu.get_tile(-1, -21) == page_table::no_chunk);
+
+        // -1 is the last tile of page -1, not the first of page 0
+        pages.set(-1, -1, 77);
+        pages.set(0, 0, 78);
+        gpu.upload(pages);
+        VX3D_CHECK(pages.at(-1, -1) == 77 && gpu.get_tile(-1, -1) == 77);
+        VX3D_CHECK(pages.at(0, 0) == 78 && gpu.get_tile(0, 0) == 78);
+    }
+}    // namespace
+
+int main()
+{
+    ::erase_test();
+    ::no_chunk_test();
+    ::grow_table_test();
+    ::grow_pool_test();
+    ::negative_test();
+    return vx3d::test::failures != 0;
+}
@@ -0,0 +1,126 @@
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+#include <tsl/robin_map.h>
+
+#include <loader/world_loader.h>
+#include <voxel/dag.h>
+#include <voxel/ray_caster.h>
+
+#include "test.h"
+
+namespace
+{
+    // Chunks from -32 up to 31 on both axes, the four regions around 0, 0
+    constexpr auto world_chunks = 32;
+
+    // Blocks a ray is followed for, past the corners of the DAG
+    constexpr auto max_steps = 2048;
+
+    [[nodiscard]] std::uint32_t mix(std::int32_t x, std::int32_t y, std::int32_t z) noexcept
+    {
+        auto value = static_cast<std::uint32_t>(x) * 0x9E3779B1u ^
+          static_cast<std::uint32_t>(y) * 0x85EBCA77u ^ static_cast<std::uint32_t>(z) * 0xC2B2AE3Du;
+        value ^= value >> 15;
+        value *= 0x2C1B3C6Du;
+        value ^= value >> 12;
+        return value;
+    }
+
+    // Scattered blocks of a few kinds from y -64 up to 127, sparse enough that rays go a while
+    [[nodiscard]] std::shared_ptr<const vx3d::loader::chunk> make_chunk(std::int32_t x, std::int32_t z)
+    {
+        using vx3d::loader::block_registry;
+        const auto kinds = std::array<vx3d::loader::block_id, 3>({ block_registry::intern("stone"),
+                                                                   block_registry::intern("dirt"),
+                                                                   block_registry::intern("oak_log") });
+
+        auto chunk = std::make_shared<vx3d::loader::chunk>();
+        chunk->x   = x;
+        chunk->z   = z;
+        for (auto section_y = -4; section_y < 8; section_y++)
+        {
+            auto section = vx3d::loader::chunk_section();
+            section.y    = static_cast<std::int8_t>(section_y);
+            for (auto i = 0; i < 4096; i++)
+            {
+                const auto value =
+                  ::mix(x * 16 + (i & 15), section_y * 16 + (i >> 8), z * 16 + ((i >> 4) & 15));
+                if (value % 97 == 0) section.blocks[i] = kinds[value / 97 % kinds.size()];
+            }
+            chunk->sections.push_back(section);
+        }
+        return chunk;
+    }
+
+    // Steps block by block along an axis, from the block the origin is in
+    [[nodiscard]] vx3d::voxel::ray_hit
+      walk(const vx3d::voxel::dag &world, const glm::vec3 &origin, std::uint8_t axis, std::int32_t step)
+    {
+        auto block = glm::ivec3(glm::floor(origin));
+        for (auto i = 0; i < ::max_steps; i++, block[axis] += step)
+        {
+            const auto found = world.at(block);
+            if (found == vx3d::loader::block_registry::air) continue;
+
+            auto hit  = vx3d::voxel::ray_hit();
+            hit.block = found;
+            hit.face  = axis;
+            hit.distance = step > 0 ? static_cast<float>(block[axis]) - origin[axis]
+                                    : origin[axis] - static_cast<float>(block[axis] + 1);
+            return hit;
+        }
+        return {};
+    }
+}    // namespace
+
+int main()
+{
+    auto chunks = tsl::robin_map<std::uint64_t, std::shared_ptr<const vx3d::loader::chunk>>();
+    for (auto x = -::world_chunks; x < ::world_chunks; x++)
+        for (auto z = -::world_chunks; z < ::world_chunks; z++)
+            chunks[vx3d::world_loader::hash_pos(x, z)] = ::make_chunk(x, z);
+
+    auto builder = vx3d::voxel::dag_builder(
+      [&chunks](std::int32_t x, std::int32_t z) -> std::shared_ptr<const vx3d::loader::chunk>
+      {
+          const auto at = chunks.find(vx3d::world_loader::hash_pos(x, z));
+          return at != chunks.end() ? at->second : nullptr;
+      });
+    const auto world  = builder.build({ { -1, -1 }, { 0, -1 }, { -1, 0 }, { 0, 0 } });
+    const auto caster = vx3d::voxel::ray_caster(world, 1);
+
+    // Both ways along every axis from origins all over the world, inside blocks and on their
+    // edges, in every octant
+    auto hits = 0;
+    for (auto i = 0; i < 4096; i++)
+    {
+        const auto value  = ::mix(i, 17, 4);
+        const auto block =
+          glm::ivec3(value % 1000, value / 1000 % 190, value / 190000 % 1000) - glm::ivec3(500, 63, 500);
+        const auto origin = glm::vec3(block) + glm::vec3(i & 1 ? 0.5f : 0.0f, 0.25f, i & 2 ? 0.75f : 0.0f);
+        if (world.at(glm::ivec3(glm::floor(origin))) != vx3d::loader::block_registry::air) continue;
+
+        for (auto axis = std::uint8_t(0); axis < 3; axis++)
+            for (const auto step : { 1, -1 })
+            {
+                auto direction  = glm::vec3(0.0f);
+                direction[axis] = static_cast<float>(step);
+
+                const auto expected = ::walk(world, origin, axis, step);
+                const auto cast     = caster.cast(origin, direction);
+                const auto matches  = VX3D_CHECK(cast.block == expected.block);
+                if (!matches || expected.block == vx3d::loader::block_registry::air)
+                    continue;
+
+                hits++;
+                VX3D_CHECK(std::abs(cast.distance - expected.distance) < 1.0e-3f);
+                VX3D_CHECK(cast.face == expected.face);
+            }
+    }
+
+    // Most rays run into something, or the world would be too sparse to tell anything
+    VX3D_CHECK(hits > 4096 * 3);
+    return vx3d::test::failures != 0;
+}
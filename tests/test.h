@@ -0,0 +1,21 @@
+#pragma once
+
+#include <iostream>
+
+namespace vx3d::test
+{
+    // Checks that failed so far, a test returns non-zero if there are any
+    inline int failures = 0;
+
+    inline bool check(bool passed, const char *condition, const char *file, int line)
+    {
+        if (passed) return true;
+        std::cerr << file << ":" << line << ": " << condition << " failed" << std::endl;
+        failures++;
+        return false;
+    }
+}    // namespace vx3d::test
+
+// Carries on after a failure, so a test reports everything that's wrong in one run
+#define VX3D_CHECK(condition) \
+    ::vx3d::test::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)